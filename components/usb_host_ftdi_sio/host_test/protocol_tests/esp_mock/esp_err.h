@@ -23,6 +23,7 @@ typedef int esp_err_t;
 // Error codes used by FTDI protocol layer
 #define ESP_OK              0       /*!< Success (no error) */
 #define ESP_ERR_INVALID_ARG 0x102   /*!< Invalid argument */
+#define ESP_ERR_INVALID_SIZE 0x104  /*!< Invalid size */
 
 #ifdef __cplusplus
 }
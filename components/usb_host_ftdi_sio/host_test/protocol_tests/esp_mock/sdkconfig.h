@@ -12,3 +12,4 @@
 
 // For Linux testing, always enable FTDI driver
 #define CONFIG_USB_SERIAL_DRIVER_FTDI 1
+#define CONFIG_USB_HOST_ENABLE_FTDI_SIO_DRIVER 1
@@ -108,6 +108,50 @@ TEST_CASE("FTDI Protocol - Build Set Line Property", "[ftdi_protocol]")
     }
 }
 
+TEST_CASE("FTDI Protocol - Build Set Flow Control", "[ftdi_protocol]")
+{
+    ftdi_control_request_t req;
+
+    SECTION("Disable flow control") {
+        REQUIRE(ftdi_protocol_build_set_flow_ctrl(&req, FTDI_FLOW_NONE, 0x11, 0x13) == ESP_OK);
+        REQUIRE(req.request == FTDI_SIO_SET_FLOW_CTRL);
+        REQUIRE(req.value == 0x0000);
+        REQUIRE(req.index == 0x0000);
+    }
+
+    SECTION("RTS/CTS") {
+        REQUIRE(ftdi_protocol_build_set_flow_ctrl(&req, FTDI_FLOW_RTS_CTS, 0x11, 0x13) == ESP_OK);
+        REQUIRE(req.value == 0x0000);
+        REQUIRE(req.index == 0x0100);
+    }
+
+    SECTION("DTR/DSR") {
+        REQUIRE(ftdi_protocol_build_set_flow_ctrl(&req, FTDI_FLOW_DTR_DSR, 0x11, 0x13) == ESP_OK);
+        REQUIRE(req.index == 0x0200);
+    }
+
+    SECTION("XON/XOFF carries the characters in wValue") {
+        REQUIRE(ftdi_protocol_build_set_flow_ctrl(&req, FTDI_FLOW_XON_XOFF, 0x11, 0x13) == ESP_OK);
+        // XOFF in the high byte, XON in the low byte
+        REQUIRE(req.value == 0x1311);
+        REQUIRE(req.index == 0x0400);
+    }
+
+    SECTION("Port B of a multi-port chip keeps the handshake bits") {
+        REQUIRE(ftdi_protocol_build_set_flow_ctrl(&req, FTDI_FLOW_RTS_CTS, 0x11, 0x13) == ESP_OK);
+        ftdi_protocol_set_port(&req, 2);
+        REQUIRE(req.index == 0x0102);
+    }
+
+    SECTION("Invalid mode") {
+        REQUIRE(ftdi_protocol_build_set_flow_ctrl(&req, (ftdi_flow_control_t)7, 0x11, 0x13) == ESP_ERR_INVALID_ARG);
+    }
+
+    SECTION("NULL pointer") {
+        REQUIRE(ftdi_protocol_build_set_flow_ctrl(NULL, FTDI_FLOW_NONE, 0x11, 0x13) == ESP_ERR_INVALID_ARG);
+    }
+}
+
 TEST_CASE("FTDI Protocol - Build Set Latency Timer", "[ftdi_protocol]")
 {
     ftdi_control_request_t req;
@@ -259,6 +303,74 @@ TEST_CASE("FTDI Protocol - Parse Modem Status", "[ftdi_protocol]")
     }
 }
 
+TEST_CASE("FTDI Protocol - Compact Bulk IN", "[ftdi_protocol]")
+{
+    ftdi_modem_status_t status;
+    size_t payload_len;
+
+    SECTION("Single packet") {
+        uint8_t buf[6] = {0x01, 0x60, 'a', 'b', 'c', 'd'};
+        REQUIRE(ftdi_protocol_compact_bulk_in(buf, sizeof(buf), 64, &payload_len, &status) == ESP_OK);
+        REQUIRE(payload_len == 4);
+        REQUIRE(memcmp(buf, "abcd", 4) == 0);
+        REQUIRE(status.dsr == 1);
+        REQUIRE(status.ri == 1);
+    }
+
+    SECTION("Status-only packet") {
+        uint8_t buf[2] = {0x01, 0x10};
+        REQUIRE(ftdi_protocol_compact_bulk_in(buf, sizeof(buf), 64, &payload_len, &status) == ESP_OK);
+        REQUIRE(payload_len == 0);
+        REQUIRE(status.cts == 1);
+    }
+
+    SECTION("Multiple packets packed into one span") {
+        // mps = 8: three packets, the last one short
+        uint8_t buf[19] = {
+            0x01, 0x00, '0', '1', '2', '3', '4', '5',
+            0x01, 0x00, '6', '7', '8', '9', 'A', 'B',
+            0x01, 0x10, 'C',
+        };
+        REQUIRE(ftdi_protocol_compact_bulk_in(buf, sizeof(buf), 8, &payload_len, &status) == ESP_OK);
+        REQUIRE(payload_len == 13);
+        REQUIRE(memcmp(buf, "0123456789ABC", 13) == 0);
+        REQUIRE(status.cts == 1);  // Line state from last packet
+    }
+
+    SECTION("Error bits merged across packets") {
+        uint8_t buf[8] = {
+            0x03, 0x20, 'x', 'y',   // Overrun in first packet
+            0x01, 0x00, 'z', 'w',
+        };
+        REQUIRE(ftdi_protocol_compact_bulk_in(buf, sizeof(buf), 4, &payload_len, &status) == ESP_OK);
+        REQUIRE(payload_len == 4);
+        REQUIRE(memcmp(buf, "xyzw", 4) == 0);
+        REQUIRE(status.overrun == 1);
+        REQUIRE(status.dsr == 0);  // Line state is not merged
+    }
+
+    SECTION("Trailing fragment shorter than header is ignored") {
+        uint8_t buf[5] = {0x01, 0x00, 'a', 'b', 0x01};
+        REQUIRE(ftdi_protocol_compact_bulk_in(buf, sizeof(buf), 4, &payload_len, &status) == ESP_OK);
+        REQUIRE(payload_len == 2);
+        REQUIRE(memcmp(buf, "ab", 2) == 0);
+    }
+
+    SECTION("Empty transfer") {
+        uint8_t buf[1] = {0x01};
+        REQUIRE(ftdi_protocol_compact_bulk_in(buf, 1, 64, &payload_len, &status) == ESP_ERR_INVALID_SIZE);
+        REQUIRE(payload_len == 0);
+    }
+
+    SECTION("Invalid arguments") {
+        uint8_t buf[4] = {0x01, 0x00, 'a', 'b'};
+        REQUIRE(ftdi_protocol_compact_bulk_in(nullptr, 4, 64, &payload_len, &status) == ESP_ERR_INVALID_ARG);
+        REQUIRE(ftdi_protocol_compact_bulk_in(buf, 4, 64, nullptr, &status) == ESP_ERR_INVALID_ARG);
+        REQUIRE(ftdi_protocol_compact_bulk_in(buf, 4, 64, &payload_len, nullptr) == ESP_ERR_INVALID_ARG);
+        REQUIRE(ftdi_protocol_compact_bulk_in(buf, 4, 2, &payload_len, &status) == ESP_ERR_INVALID_ARG);
+    }
+}
+
 TEST_CASE("FTDI Protocol - Build Set Baudrate", "[ftdi_protocol]")
 {
     ftdi_control_request_t req;
@@ -278,3 +390,41 @@ TEST_CASE("FTDI Protocol - Build Set Baudrate", "[ftdi_protocol]")
         REQUIRE(ftdi_protocol_build_set_baudrate(nullptr, 115200, FTDI_CHIP_TYPE_232R) == ESP_ERR_INVALID_ARG);
     }
 }
+
+TEST_CASE("FTDI Protocol - Multi-port Requests", "[ftdi_protocol]")
+{
+    ftdi_control_request_t req;
+
+    SECTION("Single-port chips are unchanged") {
+        REQUIRE(ftdi_protocol_build_set_modem_ctrl(&req, true, false) == ESP_OK);
+        ftdi_protocol_set_port(&req, 0);
+        REQUIRE(req.index == 0);
+    }
+
+    SECTION("Port in the low byte of wIndex") {
+        REQUIRE(ftdi_protocol_build_set_latency_timer(&req, 4) == ESP_OK);
+        ftdi_protocol_set_port(&req, 2);
+        REQUIRE(req.index == 2);
+        REQUIRE(req.value == 4);
+    }
+
+    SECTION("Baud rate divisor bits move to the high byte") {
+        REQUIRE(ftdi_protocol_build_set_baudrate(&req, 300, FTDI_CHIP_TYPE_2232D) == ESP_OK);
+        uint16_t divisor_high = req.index;
+        uint16_t value = req.value;
+        ftdi_protocol_set_port(&req, 1);
+        REQUIRE(req.index == (uint16_t)((divisor_high << 8) | 1));
+        REQUIRE(req.value == value);
+    }
+
+    SECTION("Port count per chip type") {
+        REQUIRE(ftdi_protocol_port_count(FTDI_CHIP_TYPE_232R) == 1);
+        REQUIRE(ftdi_protocol_port_count(FTDI_CHIP_TYPE_232H) == 1);
+        REQUIRE(ftdi_protocol_port_count(FTDI_CHIP_TYPE_2232D) == 2);
+        REQUIRE(ftdi_protocol_port_count(FTDI_CHIP_TYPE_4232H) == 4);
+    }
+
+    SECTION("NULL pointer") {
+        ftdi_protocol_set_port(nullptr, 1);
+    }
+}
@@ -9,6 +9,7 @@
 #include <sys/queue.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/queue.h"
 #include "usb/usb_host.h"
 #include "usb/ftdi_host_types.h"
 
@@ -16,6 +17,16 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Maximum number of bulk IN transfers queued per device
+ */
+#define FTDI_MAX_IN_XFERS (8)
+
+/**
+ * @brief Maximum number of bulk OUT transfers in the TX pool per device
+ */
+#define FTDI_MAX_OUT_XFERS (8)
+
 /**
  * @brief FTDI device structure
  *
@@ -32,17 +43,22 @@ struct ftdi_dev_s {
     ftdi_chip_type_t chip_type;
     uint16_t vid;
     uint16_t pid;
+    uint8_t port;                         // Port in wIndex (0 = single-port chip, 1 = port A, ...)
 
     // Data endpoints (Bulk IN/OUT)
     struct {
-        usb_transfer_t *out_xfer;         // Bulk OUT transfer
-        usb_transfer_t *in_xfer;          // Bulk IN transfer
-        SemaphoreHandle_t out_mux;        // Mutex for OUT transfer
+        usb_transfer_t *out_xfers[FTDI_MAX_OUT_XFERS]; // Bulk OUT transfer pool
+        uint8_t out_xfer_count;           // Number of allocated OUT transfers
+        QueueHandle_t out_free_queue;     // Idle OUT transfers (usb_transfer_t *)
+        esp_err_t out_last_error;         // First error reported by out_xfer_cb since last reset
+        usb_transfer_t *in_xfers[FTDI_MAX_IN_XFERS]; // Bulk IN transfers (kept queued on the endpoint)
+        uint8_t in_xfer_count;            // Number of allocated IN transfers
+        SemaphoreHandle_t out_mux;        // Serializes submitters (keeps chunks of one write in order)
         uint16_t in_mps;                  // IN endpoint max packet size
-        uint8_t *in_data_buffer_base;     // Base pointer for IN buffer (for freeing)
         const usb_intf_desc_t *intf_desc; // Interface descriptor
         uint8_t bulk_in_ep;               // Bulk IN endpoint address
         uint8_t bulk_out_ep;              // Bulk OUT endpoint address
+        bool compact_rx;                  // Deliver one compacted span per IN transfer
     } data;
 
     // Control transfer
@@ -52,6 +68,7 @@ struct ftdi_dev_s {
     // Callbacks
     ftdi_sio_data_callback_t data_cb;
     ftdi_sio_host_dev_callback_t event_cb;
+    ftdi_sio_tx_done_callback_t tx_done_cb;
     void *cb_arg;
 
     // Current modem status (cached from Bulk IN packets)
@@ -85,6 +102,18 @@ static inline ftdi_chip_type_t ftdi_host_get_chip_type(ftdi_sio_dev_hdl_t ftdi_h
     return ftdi_dev->chip_type;
 }
 
+/**
+ * @brief Get the port number used in control requests
+ *
+ * @param[in] ftdi_hdl FTDI device handle
+ * @return 0 for single-port chips, 1 for port A, 2 for port B, ...
+ */
+static inline uint8_t ftdi_host_get_port(ftdi_sio_dev_hdl_t ftdi_hdl)
+{
+    ftdi_dev_t *ftdi_dev = (ftdi_dev_t *)ftdi_hdl;
+    return ftdi_dev->port;
+}
+
 /**
  * @brief Get current modem status from FTDI handle
  *
@@ -83,6 +83,16 @@ typedef enum {
     FTDI_PARITY_SPACE = 4,
 } ftdi_parity_t;
 
+/**
+ * @brief Flow control (handshake done by the chip itself)
+ */
+typedef enum {
+    FTDI_FLOW_NONE = 0,     // No handshake
+    FTDI_FLOW_RTS_CTS,      // Hardware: transmit while CTS is asserted, RTS follows the RX buffer
+    FTDI_FLOW_DTR_DSR,      // Hardware: transmit while DSR is asserted, DTR follows the RX buffer
+    FTDI_FLOW_XON_XOFF,     // Software: the XOFF / XON characters stop and resume transmit
+} ftdi_flow_control_t;
+
 /**
  * @brief Modem status structure
  *
@@ -120,12 +130,27 @@ typedef enum {
 /**
  * @brief Data receive callback
  *
+ * In compact RX mode, data points into the transfer buffer and is only
+ * valid until the callback returns.
+ *
  * @param[in] data Pointer to received data (modem status bytes already stripped)
  * @param[in] data_len Length of received data
  * @param[in] user_arg User argument provided during device open
  */
 typedef void (*ftdi_sio_data_callback_t)(const uint8_t *data, size_t data_len, void *user_arg);
 
+/**
+ * @brief Transmit completion callback
+ *
+ * Called from the driver task each time a bulk OUT transfer finishes.
+ * Transfers complete in submission order.
+ *
+ * @param[in] status ESP_OK if the transfer completed, error code otherwise
+ * @param[in] data_len Number of bytes in the finished transfer
+ * @param[in] user_arg User argument provided during device open
+ */
+typedef void (*ftdi_sio_tx_done_callback_t)(esp_err_t status, size_t data_len, void *user_arg);
+
 /**
  * @brief Device event callback
  *
@@ -161,10 +186,14 @@ typedef struct {
  */
 typedef struct {
     uint32_t connection_timeout_ms;    // Timeout for device connection (0 = default)
-    size_t out_buffer_size;            // Bulk OUT buffer size (0 = default)
-    size_t in_buffer_size;             // Bulk IN buffer size (0 = default)
+    size_t out_buffer_size;            // Bulk OUT buffer size per transfer (0 = default)
+    uint8_t out_xfer_count;            // Bulk OUT transfers in the TX pool (0 = default, max 8)
+    size_t in_buffer_size;             // Bulk IN buffer size per transfer (0 = default)
+    uint8_t in_xfer_count;             // Bulk IN transfers kept in flight (0 = default, max 8)
+    bool compact_rx;                   // One data_cb per transfer with all status headers stripped in place
     ftdi_sio_host_dev_callback_t event_cb; // Event callback (can be NULL)
     ftdi_sio_data_callback_t data_cb;  // Data receive callback (can be NULL)
+    ftdi_sio_tx_done_callback_t tx_done_cb; // Transmit completion callback (can be NULL)
     void *user_arg;                    // User argument for callbacks
 } ftdi_sio_host_device_config_t;
 
@@ -185,9 +214,13 @@ typedef struct {
 #define FTDI_SIO_HOST_DEVICE_CONFIG_DEFAULT() { \
     .connection_timeout_ms = 5000, \
     .out_buffer_size = 512, \
+    .out_xfer_count = 1, \
     .in_buffer_size = 512, \
+    .in_xfer_count = 1, \
+    .compact_rx = false, \
     .event_cb = NULL, \
     .data_cb = NULL, \
+    .tx_done_cb = NULL, \
     .user_arg = NULL, \
 }
 
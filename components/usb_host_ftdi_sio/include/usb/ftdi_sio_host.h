@@ -45,7 +45,9 @@ esp_err_t ftdi_sio_host_uninstall(void);
  *
  * @param[in] vid USB Vendor ID (use FTDI_VID for FTDI devices)
  * @param[in] pid USB Product ID (use FTDI_PID_* constants)
- * @param[in] interface_idx Interface index (0 for single port, 1-3 for multi-port)
+ * @param[in] interface_idx Interface index (0 for single port, 1-3 for multi-port).
+ *                          Chips with the same VID/PID are matched in turn: a
+ *                          device whose interface is already open is skipped
  * @param[in] dev_config Device configuration (NULL for defaults)
  * @param[out] ftdi_hdl_ret FTDI device handle
  * @return ESP_OK on success
@@ -56,6 +58,17 @@ esp_err_t ftdi_sio_host_open(uint16_t vid,
                               const ftdi_sio_host_device_config_t *dev_config,
                               ftdi_sio_dev_hdl_t *ftdi_hdl_ret);
 
+/**
+ * @brief Number of serial ports of an FTDI chip
+ *
+ * Each port is a separate interface, opened with its index as
+ * interface_idx in ftdi_sio_host_open().
+ *
+ * @param[in] pid USB Product ID
+ * @return 2 for FT2232, 4 for FT4232H, 1 for single-port chips
+ */
+uint8_t ftdi_sio_host_get_port_count(uint16_t pid);
+
 /**
  * @brief Close FTDI device
  *
@@ -66,17 +79,58 @@ esp_err_t ftdi_sio_host_open(uint16_t vid,
  */
 esp_err_t ftdi_sio_host_close(ftdi_sio_dev_hdl_t ftdi_hdl);
 
+/**
+ * @brief Transmit data (asynchronous)
+ *
+ * Copies data into idle bulk OUT transfers from the TX pool and submits
+ * them, then returns without waiting for completion. Data longer than
+ * the OUT buffer size is split across several transfers. Transfers
+ * complete in submission order; completion is reported through
+ * tx_done_cb when set.
+ *
+ * The timeout only bounds the wait for idle transfers. The USB host
+ * stack does not time out bulk transfers, so a submitted transfer stays
+ * pending while the device holds off (flow control) and completes once
+ * it accepts the data; use ftdi_sio_host_data_tx_flush() to wait for
+ * completion with a timeout.
+ *
+ * @param[in] ftdi_hdl FTDI device handle
+ * @param[in] data Pointer to data to send (may be reused after return)
+ * @param[in] data_len Length of data to send
+ * @param[in] timeout_ms Time to wait for idle transfers (0 = wait forever)
+ * @return ESP_OK on success, ESP_ERR_TIMEOUT if the pool stayed busy
+ *         (any chunks before the timeout are already submitted)
+ */
+esp_err_t ftdi_sio_host_data_tx_async(ftdi_sio_dev_hdl_t ftdi_hdl,
+                                       const uint8_t *data,
+                                       size_t data_len,
+                                       uint32_t timeout_ms);
+
+/**
+ * @brief Wait until all submitted bulk OUT transfers have completed
+ *
+ * On timeout the transfers stay submitted and the data is still sent
+ * once the device accepts it.
+ *
+ * @param[in] ftdi_hdl FTDI device handle
+ * @param[in] timeout_ms Timeout in milliseconds (0 = wait forever)
+ * @return ESP_OK when the TX pool is idle, ESP_ERR_TIMEOUT otherwise
+ */
+esp_err_t ftdi_sio_host_data_tx_flush(ftdi_sio_dev_hdl_t ftdi_hdl, uint32_t timeout_ms);
+
 /**
  * @brief Transmit data (blocking)
  *
  * Sends data to the FTDI device. This function blocks until all data
- * is transmitted or timeout occurs.
+ * is transmitted or timeout occurs. The timeout applies separately to
+ * queuing the data and to waiting for completion.
  *
  * @param[in] ftdi_hdl FTDI device handle
  * @param[in] data Pointer to data to send
  * @param[in] data_len Length of data to send
  * @param[in] timeout_ms Timeout in milliseconds (0 = wait forever)
- * @return ESP_OK on success
+ * @return ESP_OK on success, ESP_ERR_TIMEOUT on timeout, ESP_FAIL if a transfer
+ *         failed since the previous blocking call
  */
 esp_err_t ftdi_sio_host_data_tx_blocking(ftdi_sio_dev_hdl_t ftdi_hdl,
                                           const uint8_t *data,
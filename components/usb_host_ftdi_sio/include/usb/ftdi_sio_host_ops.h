@@ -56,6 +56,20 @@ esp_err_t ftdi_sio_host_set_modem_control(ftdi_sio_dev_hdl_t ftdi_hdl,
                                            bool dtr,
                                            bool rts);
 
+/**
+ * @brief Set flow control
+ *
+ * The chip does the handshake itself: with RTS/CTS (or DTR/DSR) it only
+ * transmits while CTS (DSR) is asserted and drives RTS (DTR) from its RX
+ * buffer level; with XON/XOFF it stops transmitting on DC3 from the
+ * target and resumes on DC1. Writes then back up in the OUT transfers.
+ *
+ * @param[in] ftdi_hdl FTDI device handle
+ * @param[in] flow Flow control mode
+ * @return ESP_OK on success
+ */
+esp_err_t ftdi_sio_host_set_flow_control(ftdi_sio_dev_hdl_t ftdi_hdl, ftdi_flow_control_t flow);
+
 /**
  * @brief Reset device
  *
@@ -8,6 +8,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "esp_err.h"
 #include "usb/ftdi_host_types.h"
 
@@ -46,6 +47,20 @@ extern "C" {
 #define FTDI_SIO_SET_RTS_HIGH       0x0202
 #define FTDI_SIO_SET_RTS_LOW        0x0200
 
+/**
+ * @brief FTDI flow control handshake bits (high byte of wIndex)
+ */
+#define FTDI_SIO_DISABLE_FLOW_CTRL  0x0000
+#define FTDI_SIO_RTS_CTS_HS         0x0100
+#define FTDI_SIO_DTR_DSR_HS         0x0200
+#define FTDI_SIO_XON_XOFF_HS        0x0400
+
+/**
+ * @brief Default software flow control characters
+ */
+#define FTDI_SIO_XON_CHAR           0x11    // DC1
+#define FTDI_SIO_XOFF_CHAR          0x13    // DC3
+
 /**
  * @brief FTDI control request structure
  *
@@ -105,6 +120,24 @@ esp_err_t ftdi_protocol_build_set_modem_ctrl(ftdi_control_request_t *req_out,
                                               bool dtr,
                                               bool rts);
 
+/**
+ * @brief Build FTDI set flow control request
+ *
+ * The handshake is selected in the high byte of wIndex (the low byte
+ * addresses the port). For XON/XOFF, wValue carries the XOFF character in
+ * the high byte and the XON character in the low byte.
+ *
+ * @param[out] req_out Output control request structure
+ * @param[in] flow Flow control mode
+ * @param[in] xon XON character (used with FTDI_FLOW_XON_XOFF)
+ * @param[in] xoff XOFF character (used with FTDI_FLOW_XON_XOFF)
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for an unknown mode
+ */
+esp_err_t ftdi_protocol_build_set_flow_ctrl(ftdi_control_request_t *req_out,
+                                             ftdi_flow_control_t flow,
+                                             uint8_t xon,
+                                             uint8_t xoff);
+
 /**
  * @brief Build FTDI set latency timer control request
  *
@@ -118,6 +151,27 @@ esp_err_t ftdi_protocol_build_set_modem_ctrl(ftdi_control_request_t *req_out,
 esp_err_t ftdi_protocol_build_set_latency_timer(ftdi_control_request_t *req_out,
                                                  uint8_t latency_ms);
 
+/**
+ * @brief Address a control request to one port of a multi-port chip
+ *
+ * Multi-port chips (FT2232, FT4232) select the port in the low byte of
+ * wIndex (1 = port A). The baud rate request carries divisor bits in
+ * wIndex, which move to the high byte. Port 0 (single-port chips) leaves
+ * the request unchanged.
+ *
+ * @param[in,out] req Control request built by one of the functions above
+ * @param[in] port Port number (0 for single-port chips, 1 for port A, ...)
+ */
+void ftdi_protocol_set_port(ftdi_control_request_t *req, uint8_t port);
+
+/**
+ * @brief Number of serial ports of a chip type
+ *
+ * @param[in] chip_type FTDI chip type
+ * @return 2 for FT2232, 4 for FT4232H, 1 otherwise
+ */
+uint8_t ftdi_protocol_port_count(ftdi_chip_type_t chip_type);
+
 /**
  * @brief Parse modem status from FTDI bulk IN packet
  *
@@ -130,6 +184,30 @@ esp_err_t ftdi_protocol_build_set_latency_timer(ftdi_control_request_t *req_out,
 esp_err_t ftdi_protocol_parse_modem_status(const uint8_t data[2],
                                             ftdi_modem_status_t *status_out);
 
+/**
+ * @brief Strip modem status headers from a bulk IN transfer in place
+ *
+ * A bulk IN transfer may contain several packets, each starting with
+ * 2 modem status bytes. Payload bytes of all packets are packed to the
+ * start of the buffer so that they form one contiguous span.
+ *
+ * status_out receives the line state (CTS/DSR/RI/RLSD, TX empty) of the
+ * last packet, while the error bits (overrun, parity, framing, break) are
+ * ORed over all packets so none is lost.
+ *
+ * @param[in,out] buf Transfer buffer, payload is packed to its start
+ * @param[in] len Number of bytes received in the transfer
+ * @param[in] mps Max packet size of the bulk IN endpoint
+ * @param[out] payload_len_out Number of payload bytes at the start of buf
+ * @param[out] status_out Merged modem status of the transfer
+ * @return ESP_OK on success, ESP_ERR_INVALID_SIZE if no status header was received
+ */
+esp_err_t ftdi_protocol_compact_bulk_in(uint8_t *buf,
+                                        size_t len,
+                                        uint16_t mps,
+                                        size_t *payload_len_out,
+                                        ftdi_modem_status_t *status_out);
+
 /**
  * @brief Calculate FTDI baud rate divisor
  *
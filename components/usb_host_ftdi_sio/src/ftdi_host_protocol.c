@@ -104,6 +104,42 @@ esp_err_t ftdi_protocol_build_set_modem_ctrl(ftdi_control_request_t *req_out,
     return ESP_OK;
 }
 
+esp_err_t ftdi_protocol_build_set_flow_ctrl(ftdi_control_request_t *req_out,
+                                             ftdi_flow_control_t flow,
+                                             uint8_t xon,
+                                             uint8_t xoff)
+{
+    if (req_out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint16_t value = 0;
+    uint16_t handshake;
+    switch (flow) {
+        case FTDI_FLOW_NONE:
+            handshake = FTDI_SIO_DISABLE_FLOW_CTRL;
+            break;
+        case FTDI_FLOW_RTS_CTS:
+            handshake = FTDI_SIO_RTS_CTS_HS;
+            break;
+        case FTDI_FLOW_DTR_DSR:
+            handshake = FTDI_SIO_DTR_DSR_HS;
+            break;
+        case FTDI_FLOW_XON_XOFF:
+            handshake = FTDI_SIO_XON_XOFF_HS;
+            value = (uint16_t)((xoff << 8) | xon);
+            break;
+        default:
+            return ESP_ERR_INVALID_ARG;
+    }
+
+    req_out->request = FTDI_SIO_SET_FLOW_CTRL;
+    req_out->value = value;
+    req_out->index = handshake;
+
+    return ESP_OK;
+}
+
 esp_err_t ftdi_protocol_build_set_latency_timer(ftdi_control_request_t *req_out,
                                                  uint8_t latency_ms)
 {
@@ -122,6 +158,31 @@ esp_err_t ftdi_protocol_build_set_latency_timer(ftdi_control_request_t *req_out,
     return ESP_OK;
 }
 
+void ftdi_protocol_set_port(ftdi_control_request_t *req, uint8_t port)
+{
+    if (req == NULL || port == 0) {
+        return;
+    }
+
+    if (req->request == FTDI_SIO_SET_BAUDRATE) {
+        req->index = (uint16_t)((req->index << 8) | port);
+    } else {
+        req->index = (uint16_t)((req->index & 0xFF00) | port);
+    }
+}
+
+uint8_t ftdi_protocol_port_count(ftdi_chip_type_t chip_type)
+{
+    switch (chip_type) {
+    case FTDI_CHIP_TYPE_2232D:
+        return 2;
+    case FTDI_CHIP_TYPE_4232H:
+        return 4;
+    default:
+        return 1;
+    }
+}
+
 esp_err_t ftdi_protocol_parse_modem_status(const uint8_t data[2],
                                             ftdi_modem_status_t *status_out)
 {
@@ -150,6 +211,51 @@ esp_err_t ftdi_protocol_parse_modem_status(const uint8_t data[2],
     return ESP_OK;
 }
 
+esp_err_t ftdi_protocol_compact_bulk_in(uint8_t *buf,
+                                        size_t len,
+                                        uint16_t mps,
+                                        size_t *payload_len_out,
+                                        ftdi_modem_status_t *status_out)
+{
+    if (buf == NULL || payload_len_out == NULL || status_out == NULL || mps <= 2) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *payload_len_out = 0;
+    if (len < 2) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Error bits of B0 that must survive merging (overrun, parity, framing, break)
+    uint8_t error_bits = 0;
+    uint8_t last_header[2] = {0, 0};
+    size_t out = 0;
+
+    for (size_t offset = 0; offset < len; offset += mps) {
+        size_t chunk_size = (len - offset) > mps ? mps : (len - offset);
+        if (chunk_size < 2) {
+            break;
+        }
+
+        // Copy the header first: packing this packet's payload may overwrite it
+        last_header[0] = buf[offset];
+        last_header[1] = buf[offset + 1];
+        error_bits |= last_header[0] & 0x1E;
+
+        size_t data_len = chunk_size - 2;
+        if (data_len > 0) {
+            memmove(buf + out, buf + offset + 2, data_len);
+        }
+        out += data_len;
+    }
+
+    last_header[0] |= error_bits;
+    ftdi_protocol_parse_modem_status(last_header, status_out);
+
+    *payload_len_out = out;
+    return ESP_OK;
+}
+
 esp_err_t ftdi_calculate_baudrate_divisor(uint32_t baudrate,
                                           ftdi_chip_type_t chip_type,
                                           uint16_t *value_out,
@@ -11,6 +11,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
+#include "freertos/queue.h"
 #include "freertos/event_groups.h"
 #include "esp_log.h"
 #include "esp_check.h"
@@ -31,6 +32,8 @@ static const char *TAG = "ftdi_sio";
 // Default buffer sizes
 #define FTDI_DEFAULT_IN_BUFFER_SIZE  (512)
 #define FTDI_DEFAULT_OUT_BUFFER_SIZE (512)
+#define FTDI_DEFAULT_IN_XFER_COUNT   (1)
+#define FTDI_DEFAULT_OUT_XFER_COUNT  (1)
 
 // FTDI spinlock
 static portMUX_TYPE ftdi_sio_lock = portMUX_INITIALIZER_UNLOCKED;
@@ -65,21 +68,9 @@ static const ftdi_sio_host_driver_config_t ftdi_driver_config_default = {
 // Forward declarations
 static void in_xfer_cb(usb_transfer_t *transfer);
 static void out_xfer_cb(usb_transfer_t *transfer);
+static void ctrl_xfer_cb(usb_transfer_t *transfer);
 static void usb_event_cb(const usb_host_client_event_msg_t *event_msg, void *arg);
 
-/**
- * @brief Reset IN transfer to defaults
- */
-static void ftdi_reset_in_transfer(ftdi_dev_t *ftdi_dev)
-{
-    assert(ftdi_dev->data.in_xfer);
-    usb_transfer_t *transfer = ftdi_dev->data.in_xfer;
-    uint8_t **ptr = (uint8_t **)(&(transfer->data_buffer));
-    *ptr = ftdi_dev->data.in_data_buffer_base;
-    transfer->num_bytes = transfer->data_buffer_size;
-    transfer->num_bytes -= transfer->data_buffer_size % ftdi_dev->data.in_mps;
-}
-
 /**
  * @brief FTDI driver handling task
  */
@@ -123,13 +114,34 @@ static esp_err_t ftdi_reset_transfer_endpoint(usb_device_handle_t dev_hdl, usb_t
  * IMPORTANT: FTDI devices include modem status in the first 2 bytes of EVERY packet.
  * Each USB packet is in_mps bytes in size. We must process each packet separately
  * to strip the modem status bytes from each packet.
+ *
+ * In compact RX mode the headers are stripped in place and the whole transfer
+ * is delivered as one contiguous span with a single callback.
  */
 static void in_xfer_cb(usb_transfer_t *transfer)
 {
     ftdi_dev_t *ftdi_dev = (ftdi_dev_t *)transfer->context;
     assert(ftdi_dev);
 
-    if (transfer->status == USB_TRANSFER_STATUS_COMPLETED) {
+    if (transfer->status == USB_TRANSFER_STATUS_COMPLETED && ftdi_dev->data.compact_rx) {
+        // Compact mode: strip all status headers in place and hand out one span
+        size_t data_len;
+        ftdi_modem_status_t new_status;
+        if (ftdi_protocol_compact_bulk_in(transfer->data_buffer, transfer->actual_num_bytes,
+                                          ftdi_dev->data.in_mps, &data_len, &new_status) == ESP_OK) {
+            // Report modem status change once per transfer
+            if (memcmp(&new_status, &ftdi_dev->modem_status_current, sizeof(ftdi_modem_status_t)) != 0) {
+                ftdi_dev->modem_status_current = new_status;
+                if (ftdi_dev->event_cb) {
+                    ftdi_dev->event_cb(FTDI_SIO_HOST_MODEM_STATUS, ftdi_dev->cb_arg);
+                }
+            }
+
+            if (data_len > 0 && ftdi_dev->data_cb) {
+                ftdi_dev->data_cb(transfer->data_buffer, data_len, ftdi_dev->cb_arg);
+            }
+        }
+    } else if (transfer->status == USB_TRANSFER_STATUS_COMPLETED) {
         size_t total_bytes = transfer->actual_num_bytes;
         size_t offset = 0;
         const uint16_t mps = ftdi_dev->data.in_mps;
@@ -178,13 +190,37 @@ static void in_xfer_cb(usb_transfer_t *transfer)
 }
 
 /**
- * @brief Data send callback (Bulk OUT and Control)
+ * @brief Data send callback (Bulk OUT)
+ *
+ * Returns the transfer to the TX pool and reports completion.
  */
 static void out_xfer_cb(usb_transfer_t *transfer)
 {
     ftdi_dev_t *ftdi_dev = (ftdi_dev_t *)transfer->context;
     assert(ftdi_dev);
 
+    esp_err_t status = ESP_OK;
+    if (transfer->status != USB_TRANSFER_STATUS_COMPLETED) {
+        ESP_LOGD(TAG, "Transfer failed: status %d", transfer->status);
+        status = ESP_FAIL;
+        FTDI_SIO_ENTER_CRITICAL();
+        ftdi_dev->data.out_last_error = status;
+        FTDI_SIO_EXIT_CRITICAL();
+    }
+
+    size_t data_len = transfer->num_bytes;
+    xQueueSend(ftdi_dev->data.out_free_queue, &transfer, 0);
+
+    if (ftdi_dev->tx_done_cb) {
+        ftdi_dev->tx_done_cb(status, data_len, ftdi_dev->cb_arg);
+    }
+}
+
+/**
+ * @brief Control transfer callback
+ */
+static void ctrl_xfer_cb(usb_transfer_t *transfer)
+{
     if (transfer->status != USB_TRANSFER_STATUS_COMPLETED) {
         ESP_LOGD(TAG, "Transfer failed: status %d", transfer->status);
     }
@@ -218,8 +254,10 @@ static void usb_event_cb(const usb_host_client_event_msg_t *event_msg, void *arg
     case USB_HOST_CLIENT_EVENT_DEV_GONE: {
         ESP_LOGD(TAG, "USB device removed");
         ftdi_dev_t *ftdi_dev;
-        FTDI_SIO_ENTER_CRITICAL();
-        SLIST_FOREACH(ftdi_dev, &p_ftdi_sio_obj->ftdi_devices_list, list_entry) {
+        ftdi_dev_t *next_dev;
+        // Every opened port of the device is notified. The safe iteration
+        // lets the callback close its port, which removes it from the list.
+        SLIST_FOREACH_SAFE(ftdi_dev, &p_ftdi_sio_obj->ftdi_devices_list, list_entry, next_dev) {
             // ESP-IDF v6.0: dev_gone now provides dev_hdl directly
             if (event_msg->dev_gone.dev_hdl == ftdi_dev->dev_hdl) {
                 if (ftdi_dev->event_cb) {
@@ -227,7 +265,6 @@ static void usb_event_cb(const usb_host_client_event_msg_t *event_msg, void *arg
                 }
             }
         }
-        FTDI_SIO_EXIT_CRITICAL();
         break;
     }
     default:
@@ -240,13 +277,23 @@ static void usb_event_cb(const usb_host_client_event_msg_t *event_msg, void *arg
  */
 static void ftdi_transfers_free(ftdi_dev_t *ftdi_dev)
 {
-    if (ftdi_dev->data.in_xfer) {
-        usb_host_transfer_free(ftdi_dev->data.in_xfer);
-        ftdi_dev->data.in_xfer = NULL;
+    for (int i = 0; i < FTDI_MAX_IN_XFERS; i++) {
+        if (ftdi_dev->data.in_xfers[i]) {
+            usb_host_transfer_free(ftdi_dev->data.in_xfers[i]);
+            ftdi_dev->data.in_xfers[i] = NULL;
+        }
+    }
+    ftdi_dev->data.in_xfer_count = 0;
+    for (int i = 0; i < FTDI_MAX_OUT_XFERS; i++) {
+        if (ftdi_dev->data.out_xfers[i]) {
+            usb_host_transfer_free(ftdi_dev->data.out_xfers[i]);
+            ftdi_dev->data.out_xfers[i] = NULL;
+        }
     }
-    if (ftdi_dev->data.out_xfer) {
-        usb_host_transfer_free(ftdi_dev->data.out_xfer);
-        ftdi_dev->data.out_xfer = NULL;
+    ftdi_dev->data.out_xfer_count = 0;
+    if (ftdi_dev->data.out_free_queue) {
+        vQueueDelete(ftdi_dev->data.out_free_queue);
+        ftdi_dev->data.out_free_queue = NULL;
     }
     if (ftdi_dev->ctrl_transfer) {
         usb_host_transfer_free(ftdi_dev->ctrl_transfer);
@@ -265,37 +312,55 @@ static void ftdi_transfers_free(ftdi_dev_t *ftdi_dev)
 /**
  * @brief Allocate transfers for FTDI device
  */
-static esp_err_t ftdi_transfers_allocate(ftdi_dev_t *ftdi_dev, size_t in_buf_size, size_t out_buf_size)
+static esp_err_t ftdi_transfers_allocate(ftdi_dev_t *ftdi_dev, size_t in_buf_size, uint8_t in_xfer_count,
+                                         size_t out_buf_size, uint8_t out_xfer_count)
 {
     esp_err_t ret;
 
-    // Allocate Bulk IN transfer
-    ESP_GOTO_ON_ERROR(
-        usb_host_transfer_alloc(in_buf_size, 0, &ftdi_dev->data.in_xfer),
-        err, TAG, "Unable to allocate IN transfer");
-    ftdi_dev->data.in_xfer->device_handle = ftdi_dev->dev_hdl;  // ESP-IDF v6.0: Set device handle
-    ftdi_dev->data.in_xfer->callback = in_xfer_cb;
-    ftdi_dev->data.in_xfer->context = ftdi_dev;
-    ftdi_dev->data.in_xfer->bEndpointAddress = ftdi_dev->data.bulk_in_ep;
-    ftdi_dev->data.in_xfer->num_bytes = in_buf_size;
-    ftdi_dev->data.in_data_buffer_base = ftdi_dev->data.in_xfer->data_buffer;
-
-    // Allocate Bulk OUT transfer
-    ESP_GOTO_ON_ERROR(
-        usb_host_transfer_alloc(out_buf_size, 0, &ftdi_dev->data.out_xfer),
-        err, TAG, "Unable to allocate OUT transfer");
-    ftdi_dev->data.out_xfer->device_handle = ftdi_dev->dev_hdl;  // ESP-IDF v6.0: Set device handle
-    ftdi_dev->data.out_xfer->callback = out_xfer_cb;
-    ftdi_dev->data.out_xfer->context = ftdi_dev;
-    ftdi_dev->data.out_xfer->bEndpointAddress = ftdi_dev->data.bulk_out_ep;
-    ftdi_dev->data.out_xfer->timeout_ms = 1000;
+    // IN transfer length must be a multiple of MPS
+    const uint16_t mps = ftdi_dev->data.in_mps;
+    size_t in_num_bytes = in_buf_size - (in_buf_size % mps);
+    ESP_RETURN_ON_FALSE(in_num_bytes > 0, ESP_ERR_INVALID_SIZE, TAG, "IN buffer smaller than MPS");
+
+    // Allocate Bulk IN transfers. All of them are queued on the endpoint so
+    // one is always pending on the host controller while others are processed.
+    // The host library completes them in submission order, so data order is kept.
+    for (int i = 0; i < in_xfer_count; i++) {
+        ESP_GOTO_ON_ERROR(
+            usb_host_transfer_alloc(in_buf_size, 0, &ftdi_dev->data.in_xfers[i]),
+            err, TAG, "Unable to allocate IN transfer");
+        usb_transfer_t *in_xfer = ftdi_dev->data.in_xfers[i];
+        in_xfer->device_handle = ftdi_dev->dev_hdl;  // ESP-IDF v6.0: Set device handle
+        in_xfer->callback = in_xfer_cb;
+        in_xfer->context = ftdi_dev;
+        in_xfer->bEndpointAddress = ftdi_dev->data.bulk_in_ep;
+        in_xfer->num_bytes = in_num_bytes;
+        ftdi_dev->data.in_xfer_count++;
+    }
+
+    // Allocate Bulk OUT transfer pool; idle transfers wait in out_free_queue
+    ftdi_dev->data.out_free_queue = xQueueCreate(out_xfer_count, sizeof(usb_transfer_t *));
+    ESP_GOTO_ON_FALSE(ftdi_dev->data.out_free_queue, ESP_ERR_NO_MEM, err, TAG, "Unable to create OUT queue");
+    for (int i = 0; i < out_xfer_count; i++) {
+        ESP_GOTO_ON_ERROR(
+            usb_host_transfer_alloc(out_buf_size, 0, &ftdi_dev->data.out_xfers[i]),
+            err, TAG, "Unable to allocate OUT transfer");
+        usb_transfer_t *out_xfer = ftdi_dev->data.out_xfers[i];
+        out_xfer->device_handle = ftdi_dev->dev_hdl;  // ESP-IDF v6.0: Set device handle
+        out_xfer->callback = out_xfer_cb;
+        out_xfer->context = ftdi_dev;
+        out_xfer->bEndpointAddress = ftdi_dev->data.bulk_out_ep;
+        ftdi_dev->data.out_xfer_count++;
+        xQueueSend(ftdi_dev->data.out_free_queue, &out_xfer, 0);
+    }
+    ftdi_dev->data.out_last_error = ESP_OK;
 
     // Allocate Control transfer
     ESP_GOTO_ON_ERROR(
         usb_host_transfer_alloc(FTDI_CTRL_TRANSFER_SIZE, 0, &ftdi_dev->ctrl_transfer),
         err, TAG, "Unable to allocate CTRL transfer");
     ftdi_dev->ctrl_transfer->device_handle = ftdi_dev->dev_hdl;  // ESP-IDF v6.0: Set device handle
-    ftdi_dev->ctrl_transfer->callback = out_xfer_cb;
+    ftdi_dev->ctrl_transfer->callback = ctrl_xfer_cb;
     ftdi_dev->ctrl_transfer->context = ftdi_dev;
     ftdi_dev->ctrl_transfer->bEndpointAddress = 0;
     ftdi_dev->ctrl_transfer->timeout_ms = FTDI_CTRL_TIMEOUT_MS;
@@ -331,9 +396,9 @@ static esp_err_t ftdi_start(ftdi_dev_t *ftdi_dev)
         TAG, "Could not claim interface");
 
     // Start polling IN endpoint
-    if (ftdi_dev->data.in_xfer) {
-        ESP_LOGD(TAG, "Submitting poll for BULK IN transfer");
-        ESP_ERROR_CHECK(usb_host_transfer_submit(ftdi_dev->data.in_xfer));
+    ESP_LOGD(TAG, "Submitting %d BULK IN transfers", ftdi_dev->data.in_xfer_count);
+    for (int i = 0; i < ftdi_dev->data.in_xfer_count; i++) {
+        ESP_ERROR_CHECK(usb_host_transfer_submit(ftdi_dev->data.in_xfers[i]));
     }
 
     // Add device to list
@@ -351,14 +416,48 @@ static void ftdi_device_remove(ftdi_dev_t *ftdi_dev)
 {
     assert(ftdi_dev);
     ftdi_transfers_free(ftdi_dev);
-    usb_host_device_close(p_ftdi_sio_obj->ftdi_client_hdl, ftdi_dev->dev_hdl);
+
+    // Ports of a multi-port chip share one device handle; the last one closes it
+    bool shared = false;
+    ftdi_dev_t *other;
+    FTDI_SIO_ENTER_CRITICAL();
+    SLIST_FOREACH(other, &p_ftdi_sio_obj->ftdi_devices_list, list_entry) {
+        if (other != ftdi_dev && other->dev_hdl == ftdi_dev->dev_hdl) {
+            shared = true;
+            break;
+        }
+    }
+    FTDI_SIO_EXIT_CRITICAL();
+    if (!shared) {
+        usb_host_device_close(p_ftdi_sio_obj->ftdi_client_hdl, ftdi_dev->dev_hdl);
+    }
     free(ftdi_dev);
 }
 
+/**
+ * @brief Check whether an interface of an opened device is already in use
+ */
+static bool ftdi_interface_is_open(usb_device_handle_t dev_hdl, uint8_t interface_idx)
+{
+    ftdi_dev_t *ftdi_dev;
+    SLIST_FOREACH(ftdi_dev, &p_ftdi_sio_obj->ftdi_devices_list, list_entry) {
+        if (ftdi_dev->dev_hdl == dev_hdl &&
+            ftdi_dev->data.intf_desc->bInterfaceNumber == interface_idx) {
+            return true;
+        }
+    }
+    return false;
+}
+
 /**
  * @brief Find and open USB device
+ *
+ * Another port of an already opened multi-port chip reuses its device
+ * handle. A device whose requested interface is taken is skipped, so
+ * several chips with the same VID/PID are opened one after another.
  */
-static esp_err_t ftdi_find_and_open_usb_device(uint16_t vid, uint16_t pid, int timeout_ms, ftdi_dev_t **dev)
+static esp_err_t ftdi_find_and_open_usb_device(uint16_t vid, uint16_t pid, uint8_t interface_idx,
+                                               int timeout_ms, ftdi_dev_t **dev)
 {
     assert(dev);
 
@@ -373,7 +472,8 @@ static esp_err_t ftdi_find_and_open_usb_device(uint16_t vid, uint16_t pid, int t
         const usb_device_desc_t *device_desc;
         ESP_ERROR_CHECK(usb_host_get_device_descriptor(ftdi_dev->dev_hdl, &device_desc));
         if ((vid == FTDI_HOST_ANY_VID || vid == device_desc->idVendor) &&
-            (pid == FTDI_HOST_ANY_PID || pid == device_desc->idProduct)) {
+            (pid == FTDI_HOST_ANY_PID || pid == device_desc->idProduct) &&
+            !ftdi_interface_is_open(ftdi_dev->dev_hdl, interface_idx)) {
             (*dev)->dev_hdl = ftdi_dev->dev_hdl;
             (*dev)->vid = device_desc->idVendor;
             (*dev)->pid = device_desc->idProduct;
@@ -531,7 +631,7 @@ esp_err_t ftdi_sio_host_open(uint16_t vid, uint16_t pid, uint8_t interface_idx,
 
     // Find and open USB device
     ESP_GOTO_ON_ERROR(
-        ftdi_find_and_open_usb_device(vid, pid, dev_config->connection_timeout_ms, &ftdi_dev),
+        ftdi_find_and_open_usb_device(vid, pid, interface_idx, dev_config->connection_timeout_ms, &ftdi_dev),
         err, TAG, "Failed to find FTDI device");
 
     // Detect chip type
@@ -551,20 +651,28 @@ esp_err_t ftdi_sio_host_open(uint16_t vid, uint16_t pid, uint8_t interface_idx,
         err, TAG, "Failed to parse interface descriptor");
 
     ftdi_dev->data.intf_desc = intf_info.intf_desc;
+    ftdi_dev->port = ftdi_protocol_port_count(ftdi_dev->chip_type) > 1
+                     ? intf_info.intf_desc->bInterfaceNumber + 1 : 0;
     ftdi_dev->data.bulk_in_ep = intf_info.bulk_in_ep;
     ftdi_dev->data.bulk_out_ep = intf_info.bulk_out_ep;
     ftdi_dev->data.in_mps = intf_info.bulk_in_mps;
+    ftdi_dev->data.compact_rx = dev_config->compact_rx;
 
     // Set callbacks
     ftdi_dev->data_cb = dev_config->data_cb;
     ftdi_dev->event_cb = dev_config->event_cb;
+    ftdi_dev->tx_done_cb = dev_config->tx_done_cb;
     ftdi_dev->cb_arg = dev_config->user_arg;
 
     // Allocate transfers
     size_t in_buf_size = dev_config->in_buffer_size > 0 ? dev_config->in_buffer_size : FTDI_DEFAULT_IN_BUFFER_SIZE;
     size_t out_buf_size = dev_config->out_buffer_size > 0 ? dev_config->out_buffer_size : FTDI_DEFAULT_OUT_BUFFER_SIZE;
+    uint8_t in_xfer_count = dev_config->in_xfer_count > 0 ? dev_config->in_xfer_count : FTDI_DEFAULT_IN_XFER_COUNT;
+    uint8_t out_xfer_count = dev_config->out_xfer_count > 0 ? dev_config->out_xfer_count : FTDI_DEFAULT_OUT_XFER_COUNT;
+    ESP_GOTO_ON_FALSE(in_xfer_count <= FTDI_MAX_IN_XFERS, ESP_ERR_INVALID_ARG, err, TAG, "Too many IN transfers");
+    ESP_GOTO_ON_FALSE(out_xfer_count <= FTDI_MAX_OUT_XFERS, ESP_ERR_INVALID_ARG, err, TAG, "Too many OUT transfers");
     ESP_GOTO_ON_ERROR(
-        ftdi_transfers_allocate(ftdi_dev, in_buf_size, out_buf_size),
+        ftdi_transfers_allocate(ftdi_dev, in_buf_size, in_xfer_count, out_buf_size, out_xfer_count),
         err, TAG, "Failed to allocate transfers");
 
     // Start device
@@ -575,18 +683,21 @@ esp_err_t ftdi_sio_host_open(uint16_t vid, uint16_t pid, uint8_t interface_idx,
 
     // Reset device
     ftdi_protocol_build_reset(&req, FTDI_SIO_RESET_SIO);
+    ftdi_protocol_set_port(&req, ftdi_dev->port);
     ftdi_sio_host_send_custom_request((ftdi_sio_dev_hdl_t)ftdi_dev,
                                       USB_BM_REQUEST_TYPE_DIR_OUT | USB_BM_REQUEST_TYPE_TYPE_VENDOR | USB_BM_REQUEST_TYPE_RECIP_DEVICE,
                                       req.request, req.value, req.index, 0, NULL);
 
     // Set latency timer to 16ms (default)
     ftdi_protocol_build_set_latency_timer(&req, 16);
+    ftdi_protocol_set_port(&req, ftdi_dev->port);
     ftdi_sio_host_send_custom_request((ftdi_sio_dev_hdl_t)ftdi_dev,
                                       USB_BM_REQUEST_TYPE_DIR_OUT | USB_BM_REQUEST_TYPE_TYPE_VENDOR | USB_BM_REQUEST_TYPE_RECIP_DEVICE,
                                       req.request, req.value, req.index, 0, NULL);
 
     // Clear DTR/RTS
     ftdi_protocol_build_set_modem_ctrl(&req, false, false);
+    ftdi_protocol_set_port(&req, ftdi_dev->port);
     ftdi_sio_host_send_custom_request((ftdi_sio_dev_hdl_t)ftdi_dev,
                                       USB_BM_REQUEST_TYPE_DIR_OUT | USB_BM_REQUEST_TYPE_TYPE_VENDOR | USB_BM_REQUEST_TYPE_RECIP_DEVICE,
                                       req.request, req.value, req.index, 0, NULL);
@@ -604,6 +715,11 @@ err:
     return ret;
 }
 
+uint8_t ftdi_sio_host_get_port_count(uint16_t pid)
+{
+    return ftdi_protocol_port_count(ftdi_parse_chip_type(pid));
+}
+
 esp_err_t ftdi_sio_host_close(ftdi_sio_dev_hdl_t ftdi_hdl)
 {
     ESP_RETURN_ON_FALSE(p_ftdi_sio_obj, ESP_ERR_INVALID_STATE, TAG, "Driver not installed");
@@ -618,9 +734,27 @@ esp_err_t ftdi_sio_host_close(ftdi_sio_dev_hdl_t ftdi_hdl)
     SLIST_REMOVE(&p_ftdi_sio_obj->ftdi_devices_list, ftdi_dev, ftdi_dev_s, list_entry);
     FTDI_SIO_EXIT_CRITICAL();
 
-    // Cancel and free transfers
-    if (ftdi_dev->data.in_xfer) {
-        ftdi_reset_transfer_endpoint(ftdi_dev->dev_hdl, ftdi_dev->data.in_xfer);
+    // Cancel and free transfers (halt/flush retires every queued IN transfer)
+    if (ftdi_dev->data.in_xfers[0]) {
+        ftdi_reset_transfer_endpoint(ftdi_dev->dev_hdl, ftdi_dev->data.in_xfers[0]);
+    }
+
+    // OUT transfers may still be submitted while the device holds off (RTS/CTS
+    // or XOFF). Halt/flush retires them; wait until the whole pool is back in
+    // out_free_queue before the interface is released and the transfers freed.
+    // A writer may grab a returned transfer and resubmit it, so flush again
+    // until every transfer has been collected. The collected transfers are
+    // kept out of the queue so nothing can be submitted before they are freed.
+    if (ftdi_dev->data.out_xfer_count > 0) {
+        usb_transfer_t *idle_xfers[FTDI_MAX_OUT_XFERS];
+        int taken = 0;
+        while (taken < ftdi_dev->data.out_xfer_count) {
+            ftdi_reset_transfer_endpoint(ftdi_dev->dev_hdl, ftdi_dev->data.out_xfers[0]);
+            while (taken < ftdi_dev->data.out_xfer_count &&
+                    xQueueReceive(ftdi_dev->data.out_free_queue, &idle_xfers[taken], pdMS_TO_TICKS(100)) == pdTRUE) {
+                taken++;
+            }
+        }
     }
 
     // Release interface
@@ -635,27 +769,113 @@ esp_err_t ftdi_sio_host_close(ftdi_sio_dev_hdl_t ftdi_hdl)
     return ESP_OK;
 }
 
-esp_err_t ftdi_sio_host_data_tx_blocking(ftdi_sio_dev_hdl_t ftdi_hdl,
-        const uint8_t *data,
-        size_t data_len,
-        uint32_t timeout_ms)
+esp_err_t ftdi_sio_host_data_tx_async(ftdi_sio_dev_hdl_t ftdi_hdl,
+                                       const uint8_t *data,
+                                       size_t data_len,
+                                       uint32_t timeout_ms)
 {
     ESP_RETURN_ON_FALSE(ftdi_hdl && data && data_len > 0, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
 
     ftdi_dev_t *ftdi_dev = (ftdi_dev_t *)ftdi_hdl;
+    TickType_t timeout_ticks = (timeout_ms == 0) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    TimeOut_t timeout;
+    vTaskSetTimeOutState(&timeout);
 
+    // Hold out_mux for the whole write so chunks of concurrent writers do not interleave
     xSemaphoreTake(ftdi_dev->data.out_mux, portMAX_DELAY);
 
-    memcpy(ftdi_dev->data.out_xfer->data_buffer, data, data_len);
-    ftdi_dev->data.out_xfer->num_bytes = data_len;
-    ftdi_dev->data.out_xfer->timeout_ms = timeout_ms;
+    esp_err_t err = ESP_OK;
+    size_t offset = 0;
+    while (offset < data_len) {
+        usb_transfer_t *out_xfer;
+        if (xQueueReceive(ftdi_dev->data.out_free_queue, &out_xfer, timeout_ticks) != pdTRUE) {
+            err = ESP_ERR_TIMEOUT;
+            break;
+        }
+
+        size_t chunk_size = data_len - offset;
+        if (chunk_size > out_xfer->data_buffer_size) {
+            chunk_size = out_xfer->data_buffer_size;
+        }
+        memcpy(out_xfer->data_buffer, data + offset, chunk_size);
+        out_xfer->num_bytes = chunk_size;
+
+        err = usb_host_transfer_submit(out_xfer);
+        if (err != ESP_OK) {
+            xQueueSend(ftdi_dev->data.out_free_queue, &out_xfer, 0);
+            break;
+        }
+        offset += chunk_size;
+
+        if (xTaskCheckForTimeOut(&timeout, &timeout_ticks) == pdTRUE) {
+            timeout_ticks = 0;
+        }
+    }
+
+    xSemaphoreGive(ftdi_dev->data.out_mux);
+    return err;
+}
+
+esp_err_t ftdi_sio_host_data_tx_flush(ftdi_sio_dev_hdl_t ftdi_hdl, uint32_t timeout_ms)
+{
+    ESP_RETURN_ON_FALSE(ftdi_hdl, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    ftdi_dev_t *ftdi_dev = (ftdi_dev_t *)ftdi_hdl;
+    TickType_t timeout_ticks = (timeout_ms == 0) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    TimeOut_t timeout;
+    vTaskSetTimeOutState(&timeout);
 
-    esp_err_t err = usb_host_transfer_submit(ftdi_dev->data.out_xfer);
+    // The pool is idle once every transfer is back in out_free_queue:
+    // collect them all (blocking new submitters via out_mux), then return them
+    xSemaphoreTake(ftdi_dev->data.out_mux, portMAX_DELAY);
+
+    esp_err_t err = ESP_OK;
+    usb_transfer_t *xfers[FTDI_MAX_OUT_XFERS];
+    int taken = 0;
+    while (taken < ftdi_dev->data.out_xfer_count) {
+        if (xQueueReceive(ftdi_dev->data.out_free_queue, &xfers[taken], timeout_ticks) != pdTRUE) {
+            err = ESP_ERR_TIMEOUT;
+            break;
+        }
+        taken++;
+        if (xTaskCheckForTimeOut(&timeout, &timeout_ticks) == pdTRUE) {
+            timeout_ticks = 0;
+        }
+    }
+    for (int i = 0; i < taken; i++) {
+        xQueueSend(ftdi_dev->data.out_free_queue, &xfers[i], 0);
+    }
 
     xSemaphoreGive(ftdi_dev->data.out_mux);
     return err;
 }
 
+esp_err_t ftdi_sio_host_data_tx_blocking(ftdi_sio_dev_hdl_t ftdi_hdl,
+        const uint8_t *data,
+        size_t data_len,
+        uint32_t timeout_ms)
+{
+    ftdi_dev_t *ftdi_dev = (ftdi_dev_t *)ftdi_hdl;
+
+    esp_err_t err = ftdi_sio_host_data_tx_async(ftdi_hdl, data, data_len, timeout_ms);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // Wait for the transfers to actually finish on the bus
+    err = ftdi_sio_host_data_tx_flush(ftdi_hdl, timeout_ms);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // Report (and clear) any transfer failure seen since the last check
+    FTDI_SIO_ENTER_CRITICAL();
+    err = ftdi_dev->data.out_last_error;
+    ftdi_dev->data.out_last_error = ESP_OK;
+    FTDI_SIO_EXIT_CRITICAL();
+    return err;
+}
+
 esp_err_t ftdi_sio_host_send_custom_request(ftdi_sio_dev_hdl_t ftdi_hdl,
         uint8_t bmRequestType,
         uint8_t bRequest,
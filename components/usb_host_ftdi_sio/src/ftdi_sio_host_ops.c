@@ -23,6 +23,7 @@ esp_err_t ftdi_sio_host_set_baudrate(ftdi_sio_dev_hdl_t ftdi_hdl, uint32_t baudr
     ESP_RETURN_ON_ERROR(
         ftdi_protocol_build_set_baudrate(&req, baudrate, ftdi_dev->chip_type),
         TAG, "Failed to build baudrate request");
+    ftdi_protocol_set_port(&req, ftdi_host_get_port(ftdi_hdl));
 
     return ftdi_sio_host_send_custom_request(
                ftdi_hdl,
@@ -46,6 +47,7 @@ esp_err_t ftdi_sio_host_set_line_property(ftdi_sio_dev_hdl_t ftdi_hdl,
     ESP_RETURN_ON_ERROR(
         ftdi_protocol_build_set_line_property(&req, bits, stype, parity),
         TAG, "Failed to build line property request");
+    ftdi_protocol_set_port(&req, ftdi_host_get_port(ftdi_hdl));
 
     return ftdi_sio_host_send_custom_request(
                ftdi_hdl,
@@ -66,6 +68,28 @@ esp_err_t ftdi_sio_host_set_modem_control(ftdi_sio_dev_hdl_t ftdi_hdl, bool dtr,
     ESP_RETURN_ON_ERROR(
         ftdi_protocol_build_set_modem_ctrl(&req, dtr, rts),
         TAG, "Failed to build modem control request");
+    ftdi_protocol_set_port(&req, ftdi_host_get_port(ftdi_hdl));
+
+    return ftdi_sio_host_send_custom_request(
+               ftdi_hdl,
+               USB_BM_REQUEST_TYPE_DIR_OUT | USB_BM_REQUEST_TYPE_TYPE_VENDOR | USB_BM_REQUEST_TYPE_RECIP_DEVICE,
+               req.request,
+               req.value,
+               req.index,
+               0,
+               NULL);
+}
+
+esp_err_t ftdi_sio_host_set_flow_control(ftdi_sio_dev_hdl_t ftdi_hdl, ftdi_flow_control_t flow)
+{
+    ESP_RETURN_ON_FALSE(ftdi_hdl, ESP_ERR_INVALID_ARG, TAG, "Invalid handle");
+
+    ftdi_control_request_t req;
+
+    ESP_RETURN_ON_ERROR(
+        ftdi_protocol_build_set_flow_ctrl(&req, flow, FTDI_SIO_XON_CHAR, FTDI_SIO_XOFF_CHAR),
+        TAG, "Failed to build flow control request");
+    ftdi_protocol_set_port(&req, ftdi_host_get_port(ftdi_hdl));
 
     return ftdi_sio_host_send_custom_request(
                ftdi_hdl,
@@ -86,6 +110,7 @@ esp_err_t ftdi_sio_host_reset(ftdi_sio_dev_hdl_t ftdi_hdl)
     ESP_RETURN_ON_ERROR(
         ftdi_protocol_build_reset(&req, FTDI_SIO_RESET_SIO),
         TAG, "Failed to build reset request");
+    ftdi_protocol_set_port(&req, ftdi_host_get_port(ftdi_hdl));
 
     return ftdi_sio_host_send_custom_request(
                ftdi_hdl,
@@ -106,6 +131,7 @@ esp_err_t ftdi_sio_host_purge_rx_buffer(ftdi_sio_dev_hdl_t ftdi_hdl)
     ESP_RETURN_ON_ERROR(
         ftdi_protocol_build_reset(&req, FTDI_SIO_RESET_PURGE_RX),
         TAG, "Failed to build purge RX request");
+    ftdi_protocol_set_port(&req, ftdi_host_get_port(ftdi_hdl));
 
     return ftdi_sio_host_send_custom_request(
                ftdi_hdl,
@@ -126,6 +152,7 @@ esp_err_t ftdi_sio_host_purge_tx_buffer(ftdi_sio_dev_hdl_t ftdi_hdl)
     ESP_RETURN_ON_ERROR(
         ftdi_protocol_build_reset(&req, FTDI_SIO_RESET_PURGE_TX),
         TAG, "Failed to build purge TX request");
+    ftdi_protocol_set_port(&req, ftdi_host_get_port(ftdi_hdl));
 
     return ftdi_sio_host_send_custom_request(
                ftdi_hdl,
@@ -146,6 +173,7 @@ esp_err_t ftdi_sio_host_set_latency_timer(ftdi_sio_dev_hdl_t ftdi_hdl, uint8_t l
     ESP_RETURN_ON_ERROR(
         ftdi_protocol_build_set_latency_timer(&req, latency_ms),
         TAG, "Failed to build latency timer request");
+    ftdi_protocol_set_port(&req, ftdi_host_get_port(ftdi_hdl));
 
     return ftdi_sio_host_send_custom_request(
                ftdi_hdl,
@@ -0,0 +1,91 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Fixed pool of data buffers for the TCP → USB queue
+ */
+
+#include "buffer_pool.h"
+#include "esp_log.h"
+
+static const char *TAG = "buffer_pool";
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+esp_err_t buffer_pool_init(buffer_pool_t *pool, data_buffer_t *buffers, size_t count)
+{
+    pool->mutex = xSemaphoreCreateMutex();
+    if (pool->mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create buffer pool mutex");
+        return ESP_ERR_NO_MEM;
+    }
+
+    pool->buffers = buffers;
+    pool->count = count;
+
+    // Initialize all buffers as free
+    for (size_t i = 0; i < count; i++) {
+        buffers[i].in_use = false;
+        buffers[i].len = 0;
+    }
+
+    ESP_LOGI(TAG, "Buffer pool initialized with %u buffers", (unsigned)count);
+    return ESP_OK;
+}
+
+data_buffer_t *buffer_pool_alloc(buffer_pool_t *pool)
+{
+    data_buffer_t *buf = NULL;
+
+    xSemaphoreTake(pool->mutex, portMAX_DELAY);
+
+    // Find first free buffer
+    for (size_t i = 0; i < pool->count; i++) {
+        if (!pool->buffers[i].in_use) {
+            pool->buffers[i].in_use = true;
+            buf = &pool->buffers[i];
+            break;
+        }
+    }
+
+    xSemaphoreGive(pool->mutex);
+
+    // Exhaustion is not logged: the data port pauses its clients on it
+    return buf;
+}
+
+void buffer_pool_free(buffer_pool_t *pool, data_buffer_t *buf)
+{
+    if (buf == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(pool->mutex, portMAX_DELAY);
+
+    // Verify buffer is from our pool
+    if (buf >= pool->buffers && buf < pool->buffers + pool->count) {
+        buf->in_use = false;
+        buf->len = 0;
+    } else {
+        ESP_LOGE(TAG, "Attempted to free buffer not from pool");
+    }
+
+    xSemaphoreGive(pool->mutex);
+}
+
+size_t buffer_pool_available(buffer_pool_t *pool)
+{
+    size_t available = 0;
+
+    xSemaphoreTake(pool->mutex, portMAX_DELAY);
+    for (size_t i = 0; i < pool->count; i++) {
+        if (!pool->buffers[i].in_use) {
+            available++;
+        }
+    }
+    xSemaphoreGive(pool->mutex);
+
+    return available;
+}
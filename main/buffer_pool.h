@@ -0,0 +1,79 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Fixed pool of data buffers for the TCP → USB queue
+ *
+ * Storage is caller-provided so the pool has no allocator dependency;
+ * allocation and release are safe from any task.
+ */
+
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BUFFER_POOL_DATA_SIZE   512
+
+// Data buffer for TCP → USB queue items
+typedef struct {
+    uint8_t data[BUFFER_POOL_DATA_SIZE];    // Data buffer
+    size_t len;                             // Data length
+    bool in_use;                            // Buffer in use flag
+} data_buffer_t;
+
+// Buffer pool management
+typedef struct {
+    data_buffer_t *buffers;
+    size_t count;
+    SemaphoreHandle_t mutex;
+} buffer_pool_t;
+
+/**
+ * @brief Initialize a pool over caller-provided buffers
+ *
+ * @param pool Pool
+ * @param buffers Buffer storage
+ * @param count Number of buffers
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the mutex cannot be created
+ */
+esp_err_t buffer_pool_init(buffer_pool_t *pool, data_buffer_t *buffers, size_t count);
+
+/**
+ * @brief Allocate a buffer from the pool
+ *
+ * @param pool Pool
+ * @return Pointer to allocated buffer, or NULL if pool is full
+ */
+data_buffer_t *buffer_pool_alloc(buffer_pool_t *pool);
+
+/**
+ * @brief Free a buffer back to the pool
+ *
+ * @param pool Pool
+ * @param buf Pointer to buffer to free (NULL is ignored)
+ */
+void buffer_pool_free(buffer_pool_t *pool, data_buffer_t *buf);
+
+/**
+ * @brief Count the free buffers
+ *
+ * @param pool Pool
+ * @return Number of buffers buffer_pool_alloc() can still return
+ */
+size_t buffer_pool_available(buffer_pool_t *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BUFFER_POOL_H
@@ -0,0 +1,215 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Timestamped capture of the USB RX stream
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "capture_buffer.h"
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static inline bool is_power_of_two(size_t n)
+{
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+static inline size_t held_bytes(const capture_buffer_t *cap)
+{
+    return cap->head < cap->size ? cap->head : cap->size;
+}
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+esp_err_t capture_buffer_init(capture_buffer_t *cap, uint8_t *data, size_t size,
+                              capture_mark_t *marks, size_t mark_count,
+                              int64_t mark_interval_us)
+{
+    if (cap == NULL || data == NULL || marks == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!is_power_of_two(size) || !is_power_of_two(mark_count)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    cap->data = data;
+    cap->size = size;
+    cap->mask = size - 1;
+    cap->head = 0;
+    cap->marks = marks;
+    cap->mark_count = mark_count;
+    cap->mark_head = 0;
+    cap->mark_interval_us = mark_interval_us;
+    atomic_init(&cap->published, 0);
+    atomic_init(&cap->writing, 0);
+    return ESP_OK;
+}
+
+void capture_buffer_append(capture_buffer_t *cap, const uint8_t *data, size_t len, int64_t time_us)
+{
+    if (len == 0) {
+        return;
+    }
+
+    if (cap->mark_head == 0 ||
+        time_us - cap->marks[(cap->mark_head - 1) & (cap->mark_count - 1)].time_us >= cap->mark_interval_us) {
+        capture_mark_t *mark = &cap->marks[cap->mark_head & (cap->mark_count - 1)];
+        mark->pos = cap->head;
+        mark->time_us = time_us;
+        cap->mark_head++;
+    }
+
+    // Readers in other tasks discard what this append overwrites
+    atomic_store_explicit(&cap->writing, cap->head + len, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    // Only the last size bytes can be held
+    if (len > cap->size) {
+        cap->head += len - cap->size;
+        data += len - cap->size;
+        len = cap->size;
+    }
+
+    size_t offset = cap->head & cap->mask;
+    size_t first = cap->size - offset;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(cap->data + offset, data, first);
+    memcpy(cap->data, data + first, len - first);
+    cap->head += len;
+    atomic_store_explicit(&cap->published, cap->head, memory_order_release);
+}
+
+size_t capture_buffer_head(const capture_buffer_t *cap)
+{
+    return cap->head;
+}
+
+size_t capture_buffer_oldest(const capture_buffer_t *cap)
+{
+    return cap->head - held_bytes(cap);
+}
+
+size_t capture_buffer_pos_for_bytes(const capture_buffer_t *cap, size_t bytes)
+{
+    size_t held = held_bytes(cap);
+    return cap->head - (bytes < held ? bytes : held);
+}
+
+size_t capture_buffer_pos_for_age(const capture_buffer_t *cap, int64_t now_us, int64_t age_us)
+{
+    int64_t cutoff_us = now_us - age_us;
+    size_t held = held_bytes(cap);
+    size_t valid_marks = cap->mark_head < cap->mark_count ? cap->mark_head : cap->mark_count;
+    size_t start = cap->head;
+
+    // Walk back from the newest mark while marks are inside the window
+    for (size_t i = 0; i < valid_marks; i++) {
+        const capture_mark_t *mark = &cap->marks[(cap->mark_head - 1 - i) & (cap->mark_count - 1)];
+        if (cap->head - mark->pos > held) {
+            break;              // Data of this mark has been overwritten
+        }
+        if (mark->time_us < cutoff_us) {
+            return start;
+        }
+        start = mark->pos;
+    }
+
+    // The window reaches past the oldest usable mark: include everything
+    return start == cap->head ? start : capture_buffer_oldest(cap);
+}
+
+bool capture_buffer_time_at(const capture_buffer_t *cap, size_t pos, int64_t *time_us, size_t *next)
+{
+    size_t valid_marks = cap->mark_head < cap->mark_count ? cap->mark_head : cap->mark_count;
+    size_t want = cap->head - pos;
+
+    // Marks are in position order: find the newest one at or before pos
+    // (distances to head shrink from the oldest mark to the newest)
+    size_t lo = 0;              // Marks back from the newest, known to start after pos
+    size_t hi = valid_marks;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const capture_mark_t *mark = &cap->marks[(cap->mark_head - 1 - mid) & (cap->mark_count - 1)];
+        if (cap->head - mark->pos >= want) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    if (lo == valid_marks) {
+        return false;
+    }
+
+    *time_us = cap->marks[(cap->mark_head - 1 - lo) & (cap->mark_count - 1)].time_us;
+    *next = lo == 0 ? cap->head : cap->marks[(cap->mark_head - lo) & (cap->mark_count - 1)].pos;
+    return true;
+}
+
+size_t capture_buffer_peek_from(const capture_buffer_t *cap, size_t pos, const uint8_t **data)
+{
+    size_t avail = cap->head - pos;
+    if (avail == 0 || avail > held_bytes(cap)) {
+        return 0;
+    }
+
+    size_t offset = pos & cap->mask;
+    size_t contiguous = cap->size - offset;
+    *data = cap->data + offset;
+    return avail < contiguous ? avail : contiguous;
+}
+
+size_t capture_buffer_published(const capture_buffer_t *cap)
+{
+    return atomic_load_explicit(&cap->published, memory_order_acquire);
+}
+
+size_t capture_buffer_read(const capture_buffer_t *cap, size_t *pos, uint8_t *out, size_t len)
+{
+    size_t head = atomic_load_explicit(&cap->published, memory_order_acquire);
+    if (head - *pos >= SIZE_MAX / 2) {
+        return 0;               // Skipped ahead of an append not yet published
+    }
+    if (head - *pos > cap->size) {
+        *pos = head - cap->size;
+    }
+    size_t avail = head - *pos;
+    if (len > avail) {
+        len = avail;
+    }
+    if (len == 0) {
+        return 0;
+    }
+
+    size_t offset = *pos & cap->mask;
+    size_t first = cap->size - offset;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(out, cap->data + offset, first);
+    memcpy(out + first, cap->data, len - first);
+
+    // Bytes before writing - size may have been overwritten during the copy
+    atomic_thread_fence(memory_order_acquire);
+    size_t writing = atomic_load_explicit(&cap->writing, memory_order_relaxed);
+    size_t stale = writing - cap->size - *pos;      // Free-running: "negative" means none
+    if (stale != 0 && stale < SIZE_MAX / 2) {
+        if (stale >= len) {
+            *pos += stale;
+            return 0;
+        }
+        memmove(out, out + stale, len - stale);
+        *pos += stale;
+        len -= stale;
+    }
+    *pos += len;
+    return len;
+}
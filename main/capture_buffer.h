@@ -0,0 +1,174 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Timestamped capture of the USB RX stream
+ *
+ * Keeps the most recent USB data in an overwrite-oldest byte ring, plus a
+ * ring of time marks that map capture positions to arrival times. A client
+ * that connects late can then be sent the last N bytes or N seconds.
+ * Positions are free-running byte counts, like stream_ring, so a reader can
+ * tell whether the data it is about to read has been overwritten.
+ *
+ * Single-threaded: the writer and all readers run in the network loop,
+ * except capture_buffer_published() and capture_buffer_read(), which other
+ * tasks may call while the writer runs (seqlock style: the copy is checked
+ * afterwards and bytes overwritten meanwhile are discarded). Storage is
+ * caller-provided, so the module has no allocator or RTOS dependencies.
+ */
+
+#ifndef CAPTURE_BUFFER_H
+#define CAPTURE_BUFFER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Capture State
+// ============================================================================
+
+typedef struct {
+    size_t pos;                 // Capture position of the first byte recorded at time_us
+    int64_t time_us;            // Arrival time
+} capture_mark_t;
+
+typedef struct {
+    uint8_t *data;              // Byte storage (size bytes)
+    size_t size;                // Capacity in bytes (power of two)
+    size_t mask;                // size - 1
+    size_t head;                // Total bytes captured
+    capture_mark_t *marks;      // Time mark storage (mark_count entries)
+    size_t mark_count;          // Capacity in marks (power of two)
+    size_t mark_head;           // Total marks written
+    int64_t mark_interval_us;   // Minimum spacing between marks
+    atomic_size_t published;    // head as seen by other tasks (stored after the data)
+    atomic_size_t writing;      // End of the append in progress (stored before the data)
+} capture_buffer_t;
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+/**
+ * @brief Initialize a capture buffer over caller-provided storage
+ *
+ * @param cap Capture buffer to initialize
+ * @param data Byte storage
+ * @param size Size of data in bytes, must be a power of two
+ * @param marks Time mark storage
+ * @param mark_count Number of marks, must be a power of two
+ * @param mark_interval_us Minimum spacing between marks; data arriving
+ *        within one interval shares the time of its first byte
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG / ESP_ERR_INVALID_SIZE on bad input
+ */
+esp_err_t capture_buffer_init(capture_buffer_t *cap, uint8_t *data, size_t size,
+                              capture_mark_t *marks, size_t mark_count,
+                              int64_t mark_interval_us);
+
+/**
+ * @brief Record data, overwriting the oldest data when full
+ *
+ * @param cap Capture buffer
+ * @param data Data to record
+ * @param len Length of data in bytes
+ * @param time_us Arrival time of the data
+ */
+void capture_buffer_append(capture_buffer_t *cap, const uint8_t *data, size_t len, int64_t time_us);
+
+/**
+ * @brief Position after the newest captured byte
+ *
+ * @param cap Capture buffer
+ * @return Total bytes captured
+ */
+size_t capture_buffer_head(const capture_buffer_t *cap);
+
+/**
+ * @brief Position of the oldest byte still held
+ *
+ * @param cap Capture buffer
+ * @return Oldest valid position
+ */
+size_t capture_buffer_oldest(const capture_buffer_t *cap);
+
+/**
+ * @brief Position that leaves the last bytes of the capture
+ *
+ * @param cap Capture buffer
+ * @param bytes Number of bytes wanted
+ * @return Start position (clamped to the oldest byte held)
+ */
+size_t capture_buffer_pos_for_bytes(const capture_buffer_t *cap, size_t bytes);
+
+/**
+ * @brief Position of the first byte that arrived within a time window
+ *
+ * Resolution is the mark interval. When the window reaches past the
+ * oldest mark still held, everything held is included.
+ *
+ * @param cap Capture buffer
+ * @param now_us Current time in microseconds
+ * @param age_us Length of the window in microseconds
+ * @return Start position (head if nothing arrived within the window)
+ */
+size_t capture_buffer_pos_for_age(const capture_buffer_t *cap, int64_t now_us, int64_t age_us);
+
+/**
+ * @brief Arrival time of a captured byte
+ *
+ * Resolution is the mark interval.
+ *
+ * @param cap Capture buffer
+ * @param pos Position at or after capture_buffer_oldest()
+ * @param[out] time_us Arrival time of the mark covering pos
+ * @param[out] next Position of the following mark (head if there is none)
+ * @return true if a mark covers pos
+ */
+bool capture_buffer_time_at(const capture_buffer_t *cap, size_t pos, int64_t *time_us, size_t *next);
+
+/**
+ * @brief Get the contiguous span starting at a position
+ *
+ * @param cap Capture buffer
+ * @param pos Position at or after capture_buffer_oldest()
+ * @param[out] data Pointer to the span
+ * @return Length of the span (0 when pos is at head or no longer held)
+ */
+size_t capture_buffer_peek_from(const capture_buffer_t *cap, size_t pos, const uint8_t **data);
+
+/**
+ * @brief Position after the newest byte readable from another task
+ *
+ * @param cap Capture buffer
+ * @return Total bytes captured before the last completed append
+ */
+size_t capture_buffer_published(const capture_buffer_t *cap);
+
+/**
+ * @brief Copy captured data out, safe to call from another task
+ *
+ * Copies from *pos up to the published head. When data at *pos is no
+ * longer held, or is overwritten while being copied, the missing bytes
+ * are skipped: the caller can tell by *pos advancing by more than the
+ * returned length.
+ *
+ * @param cap Capture buffer
+ * @param[in,out] pos Read position, advanced past the skipped and copied bytes
+ * @param[out] out Destination buffer
+ * @param len Size of out in bytes
+ * @return Number of bytes copied to out (0 when *pos is at the published head)
+ */
+size_t capture_buffer_read(const capture_buffer_t *cap, size_t *pos, uint8_t *out, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CAPTURE_BUFFER_H
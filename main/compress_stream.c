@@ -0,0 +1,183 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Streaming LZ4 compression for the raw data port
+ */
+
+#include "compress_stream.h"
+
+#include <string.h>
+
+#define MIN_MATCH       4
+#define MFLIMIT         12      // A match must start at least this far before the block end
+#define LAST_LITERALS   5       // The block always ends with this many literals
+#define MAX_OFFSET      65535
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static inline uint32_t read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t hash32(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - COMPRESS_STREAM_HASH_BITS);
+}
+
+static uint8_t *write_length(uint8_t *o, size_t n)
+{
+    while (n >= 255) {
+        *o++ = 255;
+        n -= 255;
+    }
+    *o++ = (uint8_t)n;
+    return o;
+}
+
+static uint8_t *write_literals(uint8_t *o, uint8_t *token, const uint8_t *src, size_t len)
+{
+    if (len >= 15) {
+        *token = 15 << 4;
+        o = write_length(o, len - 15);
+    } else {
+        *token = (uint8_t)(len << 4);
+    }
+    memcpy(o, src, len);
+    return o + len;
+}
+
+// Greedy LZ4 block compression of buf[start, end), matching back into history
+static size_t compress_block(compress_stream_t *cs, size_t start, size_t end, uint8_t *out)
+{
+    const uint8_t *buf = cs->buf;
+    uint8_t *o = out;
+    size_t anchor = start;
+    size_t ip = start;
+
+    if (end - start >= MFLIMIT + 1) {
+        const size_t mflimit = end - MFLIMIT;
+        const size_t matchlimit = end - LAST_LITERALS;
+
+        while (ip <= mflimit) {
+            uint32_t seq = read32(buf + ip);
+            uint32_t h = hash32(seq);
+            size_t ref = cs->hash[h];
+            cs->hash[h] = (uint16_t)(ip + 1);
+
+            if (ref == 0 || ip - (ref - 1) > MAX_OFFSET || read32(buf + ref - 1) != seq) {
+                // Step faster through data that does not compress
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+            ref--;
+
+            // Extend backwards over pending literals, then forwards
+            while (ip > anchor && ref > 0 && buf[ip - 1] == buf[ref - 1]) {
+                ip--;
+                ref--;
+            }
+            size_t match_len = MIN_MATCH;
+            while (ip + match_len < matchlimit && buf[ip + match_len] == buf[ref + match_len]) {
+                match_len++;
+            }
+
+            uint8_t *token = o++;
+            o = write_literals(o, token, buf + anchor, ip - anchor);
+            size_t offset = ip - ref;
+            *o++ = (uint8_t)(offset & 0xFF);
+            *o++ = (uint8_t)(offset >> 8);
+            size_t extra = match_len - MIN_MATCH;
+            if (extra >= 15) {
+                *token |= 15;
+                o = write_length(o, extra - 15);
+            } else {
+                *token |= (uint8_t)extra;
+            }
+
+            ip += match_len;
+            anchor = ip;
+        }
+    }
+
+    uint8_t *token = o++;
+    o = write_literals(o, token, buf + anchor, end - anchor);
+    return o - out;
+}
+
+// Keep only the last window of history and move the hash positions with it
+static void slide_window(compress_stream_t *cs)
+{
+    if (cs->hist_len <= COMPRESS_STREAM_WINDOW_SIZE) {
+        return;
+    }
+
+    size_t shift = cs->hist_len - COMPRESS_STREAM_WINDOW_SIZE;
+    memmove(cs->buf, cs->buf + shift, COMPRESS_STREAM_WINDOW_SIZE);
+    cs->hist_len = COMPRESS_STREAM_WINDOW_SIZE;
+    for (size_t i = 0; i < (1u << COMPRESS_STREAM_HASH_BITS); i++) {
+        cs->hash[i] = cs->hash[i] > shift ? (uint16_t)(cs->hash[i] - shift) : 0;
+    }
+}
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+void compress_stream_reset(compress_stream_t *cs)
+{
+    memset(cs->hash, 0, sizeof(cs->hash));
+    cs->hist_len = 0;
+    cs->in_bytes = 0;
+    cs->out_bytes = 0;
+}
+
+size_t compress_stream_header(compress_stream_t *cs, uint8_t *out)
+{
+    memcpy(out, COMPRESS_STREAM_MAGIC, 4);
+    out[4] = COMPRESS_STREAM_VERSION;
+    out[5] = 0;
+    out[6] = (uint8_t)(COMPRESS_STREAM_WINDOW_SIZE & 0xFF);
+    out[7] = (uint8_t)(COMPRESS_STREAM_WINDOW_SIZE >> 8);
+    cs->out_bytes += COMPRESS_STREAM_HEADER_SIZE;
+    return COMPRESS_STREAM_HEADER_SIZE;
+}
+
+size_t compress_stream_max_input(size_t out_space)
+{
+    if (out_space <= COMPRESS_STREAM_FRAME_HEADER + COMPRESS_STREAM_BLOCK_BOUND(0)) {
+        return 0;
+    }
+    // Inverse of COMPRESS_STREAM_BLOCK_BOUND; the estimate is at most one short
+    size_t room = out_space - COMPRESS_STREAM_FRAME_HEADER - COMPRESS_STREAM_BLOCK_BOUND(0);
+    size_t n = room * 255 / 256;
+    if (n + 1 + (n + 1) / 255 <= room) {
+        n++;
+    }
+    return n < COMPRESS_STREAM_BLOCK_MAX ? n : COMPRESS_STREAM_BLOCK_MAX;
+}
+
+size_t compress_stream_frame(compress_stream_t *cs, const uint8_t *in, size_t len, uint8_t *out)
+{
+    size_t start = cs->hist_len;
+    memcpy(cs->buf + start, in, len);
+
+    size_t block_len = compress_block(cs, start, start + len, out + COMPRESS_STREAM_FRAME_HEADER);
+    out[0] = (uint8_t)(len & 0xFF);
+    out[1] = (uint8_t)(len >> 8);
+    out[2] = (uint8_t)(block_len & 0xFF);
+    out[3] = (uint8_t)(block_len >> 8);
+
+    cs->hist_len += len;
+    slide_window(cs);
+
+    size_t frame_len = COMPRESS_STREAM_FRAME_HEADER + block_len;
+    cs->in_bytes += len;
+    cs->out_bytes += frame_len;
+    return frame_len;
+}
@@ -0,0 +1,104 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Streaming LZ4 compression for the raw data port
+ *
+ * A compressed stream starts with an 8-byte stream header, followed by
+ * frames of
+ *   u16 raw_len, u16 block_len (little endian), LZ4 block (block_len bytes)
+ * Blocks are in the standard LZ4 block format, but matches may reach back
+ * into the previous COMPRESS_STREAM_WINDOW_SIZE bytes of the stream, so a
+ * decoder must keep that much decoded history (like LZ4 with a moving
+ * dictionary).
+ *
+ * State is a fixed-size struct owned by the caller, so the module has no
+ * allocator or RTOS dependencies. One state per stream, single-threaded.
+ */
+
+#ifndef COMPRESS_STREAM_H
+#define COMPRESS_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Format
+// ============================================================================
+
+#define COMPRESS_STREAM_MAGIC           "SLZ4"
+#define COMPRESS_STREAM_VERSION         1
+#define COMPRESS_STREAM_HEADER_SIZE     8       // Magic, version, reserved, u16 window size
+#define COMPRESS_STREAM_FRAME_HEADER    4
+
+#define COMPRESS_STREAM_WINDOW_SIZE     4096    // History matches may refer to
+#define COMPRESS_STREAM_BLOCK_MAX       2048    // Largest input per frame
+#define COMPRESS_STREAM_HASH_BITS       12
+
+// Worst case LZ4 block size for n input bytes
+#define COMPRESS_STREAM_BLOCK_BOUND(n)  ((n) + (n) / 255 + 16)
+// Worst case frame size
+#define COMPRESS_STREAM_FRAME_MAX       (COMPRESS_STREAM_FRAME_HEADER + \
+                                         COMPRESS_STREAM_BLOCK_BOUND(COMPRESS_STREAM_BLOCK_MAX))
+
+// ============================================================================
+// State
+// ============================================================================
+
+typedef struct {
+    uint8_t buf[COMPRESS_STREAM_WINDOW_SIZE + COMPRESS_STREAM_BLOCK_MAX];  // History, then the block
+    uint16_t hash[1 << COMPRESS_STREAM_HASH_BITS];  // Last buf position + 1 per hash (0 = none)
+    size_t hist_len;            // Bytes of history at the start of buf
+    uint64_t in_bytes;          // Total input
+    uint64_t out_bytes;         // Total output including headers
+} compress_stream_t;
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+/**
+ * @brief Start a new stream
+ *
+ * @param cs Compressor state
+ */
+void compress_stream_reset(compress_stream_t *cs);
+
+/**
+ * @brief Write the stream header
+ *
+ * @param cs Compressor state
+ * @param[out] out Buffer of COMPRESS_STREAM_HEADER_SIZE bytes
+ * @return COMPRESS_STREAM_HEADER_SIZE
+ */
+size_t compress_stream_header(compress_stream_t *cs, uint8_t *out);
+
+/**
+ * @brief Largest input whose frame is guaranteed to fit in a given space
+ *
+ * @param out_space Space available for the frame in bytes
+ * @return Input bytes (at most COMPRESS_STREAM_BLOCK_MAX, 0 if nothing fits)
+ */
+size_t compress_stream_max_input(size_t out_space);
+
+/**
+ * @brief Compress data into one frame
+ *
+ * @param cs Compressor state
+ * @param in Input data
+ * @param len Input length (1 to COMPRESS_STREAM_BLOCK_MAX bytes)
+ * @param[out] out Buffer of at least COMPRESS_STREAM_FRAME_HEADER +
+ *             COMPRESS_STREAM_BLOCK_BOUND(len) bytes
+ * @return Frame length in bytes
+ */
+size_t compress_stream_frame(compress_stream_t *cs, const uint8_t *in, size_t len, uint8_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMPRESS_STREAM_H
@@ -0,0 +1,89 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Flush policy for the USB → network senders
+ */
+
+#include <string.h>
+#include "flush_policy.h"
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+void flush_policy_init(flush_policy_t *policy, flush_mode_t mode,
+                       size_t bulk_threshold, uint32_t bulk_deadline_us)
+{
+    policy->mode = mode;
+    policy->bulk_threshold = bulk_threshold > 0 ? bulk_threshold : 1;
+    policy->bulk_deadline_us = bulk_deadline_us;
+    policy->pending_since_us = -1;
+}
+
+void flush_policy_set_mode(flush_policy_t *policy, flush_mode_t mode)
+{
+    policy->mode = mode;
+}
+
+bool flush_policy_should_flush(flush_policy_t *policy, size_t pending, int64_t now_us)
+{
+    if (pending == 0) {
+        policy->pending_since_us = -1;
+        return false;
+    }
+    if (policy->pending_since_us < 0) {
+        policy->pending_since_us = now_us;
+    }
+
+    if (policy->mode == FLUSH_MODE_LOWLAT) {
+        return true;
+    }
+    if (pending >= policy->bulk_threshold) {
+        return true;
+    }
+    return (now_us - policy->pending_since_us) >= (int64_t)policy->bulk_deadline_us;
+}
+
+int64_t flush_policy_time_left_us(const flush_policy_t *policy, int64_t now_us)
+{
+    if (policy->pending_since_us < 0) {
+        return -1;
+    }
+    if (policy->mode == FLUSH_MODE_LOWLAT) {
+        return 0;
+    }
+
+    int64_t left = policy->pending_since_us + (int64_t)policy->bulk_deadline_us - now_us;
+    return left > 0 ? left : 0;
+}
+
+void flush_policy_flushed(flush_policy_t *policy)
+{
+    policy->pending_since_us = -1;
+}
+
+bool flush_policy_parse_mode(const char *name, flush_mode_t *mode)
+{
+    if (strcmp(name, "LOWLAT") == 0) {
+        *mode = FLUSH_MODE_LOWLAT;
+        return true;
+    }
+    if (strcmp(name, "BULK") == 0) {
+        *mode = FLUSH_MODE_BULK;
+        return true;
+    }
+    return false;
+}
+
+const char *flush_policy_mode_name(flush_mode_t mode)
+{
+    switch (mode) {
+    case FLUSH_MODE_LOWLAT:
+        return "LOWLAT";
+    case FLUSH_MODE_BULK:
+        return "BULK";
+    default:
+        return "UNKNOWN";
+    }
+}
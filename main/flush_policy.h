@@ -0,0 +1,112 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Flush policy for the USB → network senders
+ *
+ * Decides when buffered USB data should be pushed to a socket. LOWLAT
+ * sends every byte as soon as it arrives; BULK holds data back until a
+ * byte threshold is reached or the oldest pending byte exceeds a deadline.
+ * Time is passed in by the caller, so the module has no RTOS dependencies.
+ */
+
+#ifndef FLUSH_POLICY_H
+#define FLUSH_POLICY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Policy State
+// ============================================================================
+
+typedef enum {
+    FLUSH_MODE_LOWLAT = 0,      // Send immediately (interactive consoles)
+    FLUSH_MODE_BULK,            // Coalesce up to threshold / deadline (logging)
+} flush_mode_t;
+
+typedef struct {
+    flush_mode_t mode;          // Active mode
+    size_t bulk_threshold;      // BULK: pending bytes that force a flush
+    uint32_t bulk_deadline_us;  // BULK: max age of the oldest pending byte
+    int64_t pending_since_us;   // Time pending data was first seen (-1 = none)
+} flush_policy_t;
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+/**
+ * @brief Initialize a policy
+ *
+ * @param policy Policy to initialize
+ * @param mode Initial mode
+ * @param bulk_threshold Byte threshold used in BULK mode (0 is treated as 1)
+ * @param bulk_deadline_us Deadline in microseconds used in BULK mode
+ */
+void flush_policy_init(flush_policy_t *policy, flush_mode_t mode,
+                       size_t bulk_threshold, uint32_t bulk_deadline_us);
+
+/**
+ * @brief Switch mode, keeping any pending deadline
+ *
+ * @param policy Policy
+ * @param mode New mode
+ */
+void flush_policy_set_mode(flush_policy_t *policy, flush_mode_t mode);
+
+/**
+ * @brief Decide whether pending data should be sent now
+ *
+ * Starts the deadline clock the first time pending data is seen.
+ *
+ * @param policy Policy
+ * @param pending Bytes buffered but not yet sent
+ * @param now_us Current time in microseconds
+ * @return true if the caller should flush all pending bytes
+ */
+bool flush_policy_should_flush(flush_policy_t *policy, size_t pending, int64_t now_us);
+
+/**
+ * @brief Time until the pending deadline expires
+ *
+ * @param policy Policy
+ * @param now_us Current time in microseconds
+ * @return Microseconds until the deadline, 0 if already due, -1 if nothing is pending
+ */
+int64_t flush_policy_time_left_us(const flush_policy_t *policy, int64_t now_us);
+
+/**
+ * @brief Record that all pending bytes were sent
+ *
+ * @param policy Policy
+ */
+void flush_policy_flushed(flush_policy_t *policy);
+
+/**
+ * @brief Parse a mode name ("LOWLAT" or "BULK")
+ *
+ * @param name Mode name
+ * @param[out] mode Parsed mode
+ * @return true on success
+ */
+bool flush_policy_parse_mode(const char *name, flush_mode_t *mode);
+
+/**
+ * @brief Get the name of a mode
+ *
+ * @param mode Mode
+ * @return "LOWLAT", "BULK" or "UNKNOWN"
+ */
+const char *flush_policy_mode_name(flush_mode_t mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FLUSH_POLICY_H
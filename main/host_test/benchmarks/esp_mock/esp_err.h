@@ -0,0 +1,32 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Mock header for Linux benchmarks of the protocol and bridge layers
+ *
+ * This is a minimal mock of ESP-IDF's esp_err.h for cross-platform compilation.
+ * The original esp_err.h is:
+ * SPDX-FileCopyrightText: 2015-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ESP-IDF error type
+typedef int esp_err_t;
+
+// Error codes used by the benchmarked modules
+#define ESP_OK               0      /*!< Success (no error) */
+#define ESP_FAIL             -1     /*!< Generic esp_err_t code indicating failure */
+#define ESP_ERR_NO_MEM       0x101  /*!< Out of memory */
+#define ESP_ERR_INVALID_ARG  0x102  /*!< Invalid argument */
+#define ESP_ERR_INVALID_SIZE 0x104  /*!< Invalid size */
+
+#ifdef __cplusplus
+}
+#endif
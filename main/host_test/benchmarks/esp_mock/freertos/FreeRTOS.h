@@ -0,0 +1,18 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Mock header for Linux benchmarks: the FreeRTOS types the buffer pool uses
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+
+#define portMAX_DELAY   ((TickType_t)0xFFFFFFFFu)
+#define pdTRUE          1
+#define pdFALSE         0
@@ -0,0 +1,43 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Mock header for Linux benchmarks: mutexes backed by pthreads, so an
+ * uncontended take/give costs about what it does on the target
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+
+typedef pthread_mutex_t *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    SemaphoreHandle_t m = (SemaphoreHandle_t)malloc(sizeof(pthread_mutex_t));
+    if (m != NULL && pthread_mutex_init(m, NULL) != 0) {
+        free(m);
+        m = NULL;
+    }
+    return m;
+}
+
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t m, TickType_t ticks)
+{
+    (void)ticks;
+    return pthread_mutex_lock(m) == 0 ? pdTRUE : pdFALSE;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t m)
+{
+    return pthread_mutex_unlock(m) == 0 ? pdTRUE : pdFALSE;
+}
+
+static inline void vSemaphoreDelete(SemaphoreHandle_t m)
+{
+    pthread_mutex_destroy(m);
+    free(m);
+}
@@ -0,0 +1,589 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host benchmarks for the protocol and bridge layers
+ *
+ * Measures ns/byte (ns/op for the buffer pool) of the RFC2217 parser and
+ * escaper, FTDI bulk IN header stripping, the USB RX ring, line timestamp
+ * framing, the data port pattern filter and the TCP → USB buffer pool over
+ * all-0xFF, text and random payloads, and compares the
+ * results with a stored baseline. Comparisons are relative to a plain
+ * byte loop over the same payload, so clock scaling and a baseline taken
+ * on another host do not show up as regressions.
+ *
+ * Usage:
+ *   host_benchmarks [--quick] [--filter TEXT] [--baseline FILE] [--save FILE]
+ *                   [--tolerance PCT]
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "rfc2217_protocol.h"
+#include "stream_ring.h"
+#include "buffer_pool.h"
+#include "ftdi_host_protocol.h"
+#include "line_framer.h"
+#include "stream_filter.h"
+
+#define PAYLOAD_SIZE        4096
+#define FTDI_MPS            64
+#define RING_SIZE           32768
+#define POOL_SIZE           64
+#define POOL_HELD           16      // Buffers kept allocated, so alloc scans past them
+#define REPEATS             9       // Best of
+#define MAX_RESULTS         64
+#define DEFAULT_TOLERANCE   50.0    // Percent slower than baseline that fails
+
+// ============================================================================
+// Payloads
+// ============================================================================
+
+typedef enum {
+    MIX_FF = 0,     // All IAC: worst case for escaping and parsing
+    MIX_TEXT,       // Log lines: typical console traffic
+    MIX_RANDOM,     // Uniform bytes: binary transfers (about 1 IAC in 256)
+    MIX_COUNT
+} payload_mix_t;
+
+static const char *const s_mix_names[MIX_COUNT] = {"ff", "text", "random"};
+
+typedef struct {
+    uint8_t payload[PAYLOAD_SIZE];
+    uint8_t wire[PAYLOAD_SIZE * 2];     // Payload with IAC doubled
+    size_t wire_len;
+    uint8_t ftdi[PAYLOAD_SIZE];         // Bulk IN transfer: 2 status bytes per packet
+    size_t ftdi_len;
+} bench_data_t;
+
+static uint32_t s_rng = 1;
+
+static uint32_t rng_next(void)
+{
+    // xorshift32: fixed sequence so every run measures the same data
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+static void make_payload(payload_mix_t mix, uint8_t *out, size_t len)
+{
+    static const char *const words[] = {
+        "I (12345) ", "wifi:", "connected", "rssi=-52", "task ", "heap ", "free=182340",
+        "usb ", "rx ", "tx ", "0x3fc9a120", "OK", "ERROR", "boot: ", "esp32s3 ",
+    };
+    size_t pos = 0;
+
+    s_rng = 1;
+    while (pos < len) {
+        switch (mix) {
+        case MIX_FF:
+            out[pos++] = 0xFF;
+            break;
+        case MIX_RANDOM:
+            out[pos++] = (uint8_t)rng_next();
+            break;
+        case MIX_TEXT:
+        default: {
+            const char *w = words[rng_next() % (sizeof(words) / sizeof(words[0]))];
+            while (*w != '\0' && pos < len) {
+                out[pos++] = (uint8_t)*w++;
+            }
+            if (rng_next() % 8 == 0) {
+                if (pos < len) out[pos++] = '\r';
+                if (pos < len) out[pos++] = '\n';
+            }
+            break;
+        }
+        }
+    }
+}
+
+static void bench_data_init(bench_data_t *d, payload_mix_t mix)
+{
+    make_payload(mix, d->payload, sizeof(d->payload));
+
+    d->wire_len = rfc2217_escape_data(d->payload, sizeof(d->payload), d->wire, sizeof(d->wire));
+
+    // One full transfer: every 64-byte packet starts with the modem/line status
+    size_t src = 0;
+    d->ftdi_len = 0;
+    while (d->ftdi_len + FTDI_MPS <= sizeof(d->ftdi)) {
+        d->ftdi[d->ftdi_len++] = 0x01;     // Modem status
+        d->ftdi[d->ftdi_len++] = 0x60;     // Line status: THRE, TEMT
+        memcpy(&d->ftdi[d->ftdi_len], &d->payload[src], FTDI_MPS - 2);
+        d->ftdi_len += FTDI_MPS - 2;
+        src += FTDI_MPS - 2;
+    }
+}
+
+// ============================================================================
+// Benchmarks
+// ============================================================================
+
+static volatile size_t s_sink;  // Keeps results alive
+
+static uint8_t s_out[PAYLOAD_SIZE * 2];
+static uint8_t s_ring_storage[RING_SIZE];
+static data_buffer_t s_pool_storage[POOL_SIZE];
+
+// Each benchmark runs once over the prepared data and returns the units
+// processed (bytes, or operations for the buffer pool)
+typedef size_t (*bench_fn_t)(const bench_data_t *d);
+
+static size_t bench_reference(const bench_data_t *d)
+{
+    // Scalar byte loop with a dependency chain: tracks the host's clock and
+    // core speed without depending on any code under test
+    uint32_t h = 0;
+    for (size_t i = 0; i < sizeof(d->payload); i++) {
+        h = h * 31 + d->payload[i];
+    }
+    s_sink += h;
+    return sizeof(d->payload);
+}
+
+static size_t bench_parse_byte(const bench_data_t *d)
+{
+    static rfc2217_session_t session;
+    rfc2217_session_init(&session, NULL);
+    size_t out_total = 0;
+    for (size_t i = 0; i < d->wire_len; i++) {
+        size_t n = 0;
+        rfc2217_parse_byte(&session, d->wire[i], s_out + out_total, &n);
+        out_total += n;
+    }
+    s_sink += out_total;
+    return d->wire_len;
+}
+
+static size_t bench_parse_chunk(const bench_data_t *d)
+{
+    static rfc2217_session_t session;
+    rfc2217_session_init(&session, NULL);
+    size_t out_total = 0;
+    size_t offset = 0;
+    while (offset < d->wire_len) {
+        size_t out_len = 0;
+        size_t consumed = 0;
+        rfc2217_parse_chunk(&session, d->wire + offset, d->wire_len - offset,
+                            s_out + out_total, &out_len, &consumed);
+        offset += consumed;
+        out_total += out_len;
+    }
+    s_sink += out_total;
+    return d->wire_len;
+}
+
+static size_t bench_escape_data(const bench_data_t *d)
+{
+    s_sink += rfc2217_escape_data(d->payload, sizeof(d->payload), s_out, sizeof(s_out));
+    return sizeof(d->payload);
+}
+
+static size_t bench_escape_spans(const bench_data_t *d)
+{
+    rfc2217_span_t spans[16];
+    size_t offset = 0;
+    while (offset < sizeof(d->payload)) {
+        size_t consumed = 0;
+        s_sink += rfc2217_escape_spans(d->payload + offset, sizeof(d->payload) - offset,
+                                       spans, 16, &consumed);
+        offset += consumed;
+    }
+    return sizeof(d->payload);
+}
+
+static size_t bench_ftdi_compact(const bench_data_t *d)
+{
+    // Compaction is in place, so the transfer is refilled every run
+    memcpy(s_out, d->ftdi, d->ftdi_len);
+    size_t payload_len = 0;
+    ftdi_modem_status_t status;
+    ftdi_protocol_compact_bulk_in(s_out, d->ftdi_len, FTDI_MPS, &payload_len, &status);
+    s_sink += payload_len;
+    return d->ftdi_len;
+}
+
+static size_t ring_pass(const bench_data_t *d, size_t chunk)
+{
+    static stream_ring_t ring;
+    static bool initialized;
+    if (!initialized) {
+        stream_ring_init(&ring, s_ring_storage, sizeof(s_ring_storage));
+        initialized = true;
+    }
+
+    // Producer writes USB-sized chunks, consumer drains contiguous spans
+    for (size_t off = 0; off < sizeof(d->payload); off += chunk) {
+        stream_ring_write(&ring, d->payload + off, chunk);
+    }
+    const uint8_t *span;
+    size_t n;
+    while ((n = stream_ring_peek(&ring, &span)) > 0) {
+        s_sink += span[0];
+        stream_ring_consume(&ring, n);
+    }
+    return sizeof(d->payload);
+}
+
+static size_t bench_ring_64(const bench_data_t *d)
+{
+    return ring_pass(d, 64);
+}
+
+static size_t bench_ring_512(const bench_data_t *d)
+{
+    return ring_pass(d, 512);
+}
+
+static size_t frame_pass(const bench_data_t *d, line_framer_format_t format)
+{
+    static line_framer_t lf;
+    line_framer_reset(&lf, format);
+
+    // One arrival time per 512-byte USB transfer, like the data port
+    for (size_t off = 0; off < sizeof(d->payload); off += 512) {
+        size_t done = 0;
+        while (done < 512) {
+            size_t used;
+            s_sink += line_framer_encode(&lf, d->payload + off + done, 512 - done,
+                                         (int64_t)off * 100, s_out, 2048, &used);
+            done += used;
+        }
+    }
+    return sizeof(d->payload);
+}
+
+static size_t bench_frame_text(const bench_data_t *d)
+{
+    return frame_pass(d, LINE_FRAMER_TEXT);
+}
+
+static size_t bench_frame_binary(const bench_data_t *d)
+{
+    return frame_pass(d, LINE_FRAMER_BINARY);
+}
+
+static const stream_filter_t *filter_setup(stream_filter_mode_t mode)
+{
+    // Three patterns, one of them common in the text payload; compiled once
+    static stream_filter_t filters[STREAM_FILTER_TRIGGER + 1];
+    static bool initialized[STREAM_FILTER_TRIGGER + 1];
+    stream_filter_t *sf = &filters[mode];
+    if (!initialized[mode]) {
+        stream_filter_init(sf);
+        stream_filter_add(sf, "ERROR");
+        stream_filter_add(sf, "panic");
+        stream_filter_add(sf, "rssi=-9");
+        stream_filter_set_mode(sf, mode, 0, 256);
+        initialized[mode] = true;
+    }
+    return sf;
+}
+
+static size_t bench_filter_lines(const bench_data_t *d)
+{
+    static stream_filter_stream_t st;
+    const stream_filter_t *sf = filter_setup(STREAM_FILTER_LINES);
+    stream_filter_stream_init(&st, sf);
+
+    for (size_t off = 0; off < sizeof(d->payload); off += 512) {
+        size_t done = 0;
+        while (done < 512) {
+            done += stream_filter_lines(&st, sf, d->payload + off + done, 512 - done, 0);
+            if (st.ready) {
+                s_sink += st.line_len;
+            }
+        }
+    }
+    return sizeof(d->payload);
+}
+
+static size_t bench_filter_trigger(const bench_data_t *d)
+{
+    static stream_filter_stream_t st;
+    const stream_filter_t *sf = filter_setup(STREAM_FILTER_TRIGGER);
+    stream_filter_stream_init(&st, sf);
+
+    for (size_t off = 0; off < sizeof(d->payload); off += 512) {
+        size_t done = 0;
+        while (done < 512) {
+            stream_filter_span_t span;
+            stream_filter_trigger(&st, sf, d->payload + off + done, 512 - done, &span);
+            done += span.skip + span.pass;
+            s_sink += span.pass;
+        }
+    }
+    return sizeof(d->payload);
+}
+
+static size_t bench_buffer_pool(const bench_data_t *d)
+{
+    static buffer_pool_t pool;
+    static bool initialized;
+    (void)d;
+    if (!initialized) {
+        buffer_pool_init(&pool, s_pool_storage, POOL_SIZE);
+        for (int i = 0; i < POOL_HELD; i++) {
+            buffer_pool_alloc(&pool);
+        }
+        initialized = true;
+    }
+
+    enum { OPS = 256 };
+    for (int i = 0; i < OPS; i++) {
+        data_buffer_t *buf = buffer_pool_alloc(&pool);
+        s_sink += (size_t)buf;
+        buffer_pool_free(&pool, buf);
+    }
+    return OPS;
+}
+
+typedef struct {
+    const char *name;
+    bench_fn_t fn;
+    const char *unit;
+    bool per_mix;               // Run for every payload mix
+} bench_t;
+
+// The first entry is the reference: comparisons use each result relative to
+// it, which cancels out host speed and clock scaling between runs
+static const bench_t s_benches[] = {
+    {"reference",            bench_reference,      "ns/byte", false},
+    {"rfc2217_parse_byte",   bench_parse_byte,   "ns/byte", true},
+    {"rfc2217_parse_chunk",  bench_parse_chunk,  "ns/byte", true},
+    {"rfc2217_escape_data",  bench_escape_data,  "ns/byte", true},
+    {"rfc2217_escape_spans", bench_escape_spans, "ns/byte", true},
+    {"ftdi_compact_bulk_in", bench_ftdi_compact, "ns/byte", true},
+    {"stream_ring_64B",      bench_ring_64,      "ns/byte", true},
+    {"stream_ring_512B",     bench_ring_512,     "ns/byte", true},
+    {"line_framer_text",     bench_frame_text,   "ns/byte", true},
+    {"line_framer_binary",   bench_frame_binary, "ns/byte", true},
+    {"stream_filter_lines",  bench_filter_lines, "ns/byte", true},
+    {"stream_filter_trigger", bench_filter_trigger, "ns/byte", true},
+    {"buffer_pool_cycle",    bench_buffer_pool,  "ns/op",   false},
+};
+
+// ============================================================================
+// Measurement
+// ============================================================================
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/**
+ * @brief Best-of-REPEATS time per unit
+ *
+ * The iteration count is calibrated so one repeat lasts about target_ns;
+ * the minimum is the least disturbed by other load on the host.
+ */
+static double measure(bench_fn_t fn, const bench_data_t *d, double target_ns)
+{
+    size_t iterations = 1;
+    for (;;) {
+        double start = now_ns();
+        for (size_t i = 0; i < iterations; i++) {
+            fn(d);
+        }
+        double elapsed = now_ns() - start;
+        if (elapsed >= target_ns / 4 || iterations > ((size_t)1 << 30)) {
+            iterations = (size_t)(iterations * target_ns / (elapsed > 1 ? elapsed : 1)) + 1;
+            break;
+        }
+        iterations *= 4;
+    }
+
+    double best = -1;
+    for (int r = 0; r < REPEATS; r++) {
+        size_t units = 0;
+        double start = now_ns();
+        for (size_t i = 0; i < iterations; i++) {
+            units += fn(d);
+        }
+        double per_unit = (now_ns() - start) / (double)units;
+        if (best < 0 || per_unit < best) {
+            best = per_unit;
+        }
+    }
+    return best;
+}
+
+// ============================================================================
+// Baseline
+// ============================================================================
+
+typedef struct {
+    char key[64];               // "<benchmark>/<mix>"
+    double value;
+    const char *unit;
+} result_t;
+
+/**
+ * @brief Look up key in a baseline file
+ *
+ * Lines are "<benchmark>/<mix> <value> <unit>"; '#' starts a comment.
+ *
+ * @return true and *value when found
+ */
+static bool baseline_lookup(FILE *f, const char *key, double *value)
+{
+    char line[128];
+    rewind(f);
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char name[64];
+        double v;
+        if (line[0] == '#' || sscanf(line, "%63s %lf", name, &v) != 2) {
+            continue;
+        }
+        if (strcmp(name, key) == 0) {
+            *value = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [--quick] [--filter TEXT] [--baseline FILE] [--save FILE] [--tolerance PCT]\n"
+            "  --quick         Short runs (smoke test, numbers are noisy)\n"
+            "  --filter TEXT   Only run benchmarks whose name contains TEXT (plus the reference)\n"
+            "  --baseline FILE Compare with FILE, exit 1 on a regression\n"
+            "  --save FILE     Write the results as a new baseline\n"
+            "  --tolerance PCT Slowdown allowed before failing (default %.0f)\n",
+            prog, DEFAULT_TOLERANCE);
+}
+
+int main(int argc, char **argv)
+{
+    bool quick = false;
+    const char *filter = NULL;
+    const char *baseline_path = NULL;
+    const char *save_path = NULL;
+    double tolerance = DEFAULT_TOLERANCE;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+            save_path = argv[++i];
+        } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            tolerance = atof(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    FILE *baseline = NULL;
+    if (baseline_path != NULL) {
+        baseline = fopen(baseline_path, "r");
+        if (baseline == NULL) {
+            fprintf(stderr, "Cannot open baseline %s\n", baseline_path);
+            return 2;
+        }
+    }
+
+    static bench_data_t data[MIX_COUNT];
+    for (int m = 0; m < MIX_COUNT; m++) {
+        bench_data_init(&data[m], (payload_mix_t)m);
+    }
+
+    const double target_ns = quick ? 2e6 : 50e6;
+    static result_t results[MAX_RESULTS];
+    size_t result_count = 0;
+    int regressions = 0;
+    double reference = 0;           // This run's reference
+    double base_reference = 0;      // The baseline's
+
+    printf("%-32s %10s %-8s %10s %8s\n", "benchmark", "value", "unit", "baseline", "change");
+    for (size_t b = 0; b < sizeof(s_benches) / sizeof(s_benches[0]); b++) {
+        const bench_t *bench = &s_benches[b];
+        if (b != 0 && filter != NULL && strstr(bench->name, filter) == NULL) {
+            continue;
+        }
+
+        int mixes = bench->per_mix ? MIX_COUNT : 1;
+        for (int m = 0; m < mixes && result_count < MAX_RESULTS; m++) {
+            result_t *r = &results[result_count++];
+            if (bench->per_mix) {
+                snprintf(r->key, sizeof(r->key), "%s/%s", bench->name, s_mix_names[m]);
+            } else {
+                snprintf(r->key, sizeof(r->key), "%s", bench->name);
+            }
+            r->value = measure(bench->fn, &data[m], target_ns);
+            r->unit = bench->unit;
+
+            if (b == 0) {
+                reference = r->value;
+                if (baseline != NULL && !baseline_lookup(baseline, r->key, &base_reference)) {
+                    base_reference = 0;
+                }
+            }
+
+            double base;
+            if (baseline != NULL && baseline_lookup(baseline, r->key, &base) && base > 0) {
+                double change;
+                if (b != 0 && reference > 0 && base_reference > 0) {
+                    change = ((r->value / reference) / (base / base_reference) - 1.0) * 100.0;
+                } else {
+                    change = (r->value - base) / base * 100.0;
+                }
+                const char *verdict = "";
+                if (b == 0) {
+                    verdict = "  (host speed)";
+                } else if (change > tolerance) {
+                    verdict = "  REGRESSION";
+                    regressions++;
+                } else if (change < -tolerance) {
+                    verdict = "  faster (update baseline?)";
+                }
+                printf("%-32s %10.3f %-8s %10.3f %+7.1f%%%s\n",
+                       r->key, r->value, r->unit, base, change, verdict);
+            } else {
+                printf("%-32s %10.3f %-8s %10s %8s\n", r->key, r->value, r->unit,
+                       baseline != NULL ? "-" : "", baseline != NULL ? "new" : "");
+            }
+        }
+    }
+
+    if (baseline != NULL) {
+        fclose(baseline);
+        printf("\n%d regression(s) beyond %.0f%% (change is relative to reference)\n",
+               regressions, tolerance);
+    }
+
+    if (save_path != NULL) {
+        FILE *f = fopen(save_path, "w");
+        if (f == NULL) {
+            fprintf(stderr, "Cannot write %s\n", save_path);
+            return 2;
+        }
+        fprintf(f, "# Host benchmark baseline (best of %d, lower is better)\n", REPEATS);
+        fprintf(f, "# Regenerate: host_benchmarks --save baseline.txt\n");
+        for (size_t i = 0; i < result_count; i++) {
+            fprintf(f, "%s %.3f %s\n", results[i].key, results[i].value, results[i].unit);
+        }
+        fclose(f);
+        printf("Saved %u results to %s\n", (unsigned)result_count, save_path);
+    }
+
+    return regressions > 0 ? 1 : 0;
+}
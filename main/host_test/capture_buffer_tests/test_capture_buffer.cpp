@@ -0,0 +1,296 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * USB RX capture buffer: overwrite-oldest, lapped and racing readers, and
+ * the time mark lookups across the wrap of the mark array
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// capture_buffer.h has its own extern "C" guard; <stdatomic.h> must stay outside it
+#include "capture_buffer.h"
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+template <size_t SIZE, size_t MARKS>
+struct capture_fixture_t {
+    uint8_t data[SIZE];
+    capture_mark_t marks[MARKS];
+    capture_buffer_t cap;
+
+    explicit capture_fixture_t(int64_t mark_interval_us)
+    {
+        REQUIRE(capture_buffer_init(&cap, data, SIZE, marks, MARKS, mark_interval_us) == ESP_OK);
+    }
+};
+
+// Byte at capture position pos of the stream written by append_stream()
+static uint8_t stream_byte(size_t pos)
+{
+    return (uint8_t)(pos * 7 + 3);
+}
+
+static void append_stream(capture_buffer_t *cap, size_t len, int64_t time_us)
+{
+    std::vector<uint8_t> chunk(len);
+    size_t head = capture_buffer_head(cap);
+    for (size_t i = 0; i < len; i++) {
+        chunk[i] = stream_byte(head + i);
+    }
+    capture_buffer_append(cap, chunk.data(), len, time_us);
+}
+
+static bool holds_stream(const std::vector<uint8_t> &out, size_t pos)
+{
+    for (size_t i = 0; i < out.size(); i++) {
+        if (out[i] != stream_byte(pos + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// Initialization
+// ============================================================================
+
+TEST_CASE("Init rejects bad arguments", "[capture_buffer]")
+{
+    uint8_t data[64];
+    capture_mark_t marks[4];
+    capture_buffer_t cap;
+
+    CHECK(capture_buffer_init(nullptr, data, 64, marks, 4, 10) == ESP_ERR_INVALID_ARG);
+    CHECK(capture_buffer_init(&cap, nullptr, 64, marks, 4, 10) == ESP_ERR_INVALID_ARG);
+    CHECK(capture_buffer_init(&cap, data, 64, nullptr, 4, 10) == ESP_ERR_INVALID_ARG);
+    CHECK(capture_buffer_init(&cap, data, 48, marks, 4, 10) == ESP_ERR_INVALID_SIZE);
+    CHECK(capture_buffer_init(&cap, data, 64, marks, 3, 10) == ESP_ERR_INVALID_SIZE);
+    CHECK(capture_buffer_init(&cap, data, 64, marks, 4, 10) == ESP_OK);
+}
+
+// ============================================================================
+// Overwrite Oldest
+// ============================================================================
+
+TEST_CASE("Appends overwrite the oldest data when full", "[capture_buffer]")
+{
+    capture_fixture_t<64, 8> f(10);
+
+    append_stream(&f.cap, 40, 0);
+    CHECK(capture_buffer_oldest(&f.cap) == 0);
+    CHECK(capture_buffer_head(&f.cap) == 40);
+
+    append_stream(&f.cap, 60, 10);
+    CHECK(capture_buffer_head(&f.cap) == 100);
+    CHECK(capture_buffer_oldest(&f.cap) == 36);
+    CHECK(capture_buffer_pos_for_bytes(&f.cap, 10) == 90);
+    CHECK(capture_buffer_pos_for_bytes(&f.cap, 1000) == 36);
+
+    // Overwritten positions have no span; held ones wrap at the storage end
+    const uint8_t *data;
+    CHECK(capture_buffer_peek_from(&f.cap, 35, &data) == 0);
+    REQUIRE(capture_buffer_peek_from(&f.cap, 36, &data) == 28);
+    CHECK(holds_stream(std::vector<uint8_t>(data, data + 28), 36));
+    REQUIRE(capture_buffer_peek_from(&f.cap, 64, &data) == 36);
+    CHECK(data == f.data);
+    CHECK(holds_stream(std::vector<uint8_t>(data, data + 36), 64));
+    CHECK(capture_buffer_peek_from(&f.cap, 100, &data) == 0);
+}
+
+TEST_CASE("An append larger than the buffer keeps only its tail", "[capture_buffer]")
+{
+    capture_fixture_t<64, 8> f(10);
+
+    append_stream(&f.cap, 10, 0);
+    append_stream(&f.cap, 150, 10);
+    CHECK(capture_buffer_head(&f.cap) == 160);
+    CHECK(capture_buffer_oldest(&f.cap) == 96);
+
+    std::vector<uint8_t> out(64);
+    size_t pos = 96;
+    REQUIRE(capture_buffer_read(&f.cap, &pos, out.data(), out.size()) == 64);
+    CHECK(holds_stream(out, 96));
+}
+
+// ============================================================================
+// Readers In Other Tasks
+// ============================================================================
+
+TEST_CASE("Read copies up to the published head", "[capture_buffer]")
+{
+    capture_fixture_t<64, 8> f(10);
+    append_stream(&f.cap, 30, 0);
+
+    std::vector<uint8_t> out(20);
+    size_t pos = 0;
+    REQUIRE(capture_buffer_read(&f.cap, &pos, out.data(), out.size()) == 20);
+    CHECK(pos == 20);
+    CHECK(holds_stream(out, 0));
+
+    REQUIRE(capture_buffer_read(&f.cap, &pos, out.data(), out.size()) == 10);
+    CHECK(pos == 30);
+    CHECK(capture_buffer_read(&f.cap, &pos, out.data(), out.size()) == 0);
+    CHECK(pos == 30);
+}
+
+TEST_CASE("A lapped reader skips ahead to the oldest held byte", "[capture_buffer]")
+{
+    capture_fixture_t<64, 8> f(10);
+    append_stream(&f.cap, 100, 0);
+
+    std::vector<uint8_t> out(64);
+    size_t pos = 10;
+    size_t n = capture_buffer_read(&f.cap, &pos, out.data(), out.size());
+    REQUIRE(n == 64);
+    CHECK(pos == 100);
+    out.resize(n);
+    CHECK(holds_stream(out, 36));
+}
+
+TEST_CASE("Bytes overwritten during the copy are discarded", "[capture_buffer]")
+{
+    capture_fixture_t<64, 8> f(10);
+    append_stream(&f.cap, 64, 0);
+
+    // An append of 10 bytes has started but not been published: the first
+    // 10 bytes the reader copies may already hold the new data
+    atomic_store(&f.cap.writing, (size_t)74);
+
+    std::vector<uint8_t> out(64);
+    size_t pos = 0;
+    size_t n = capture_buffer_read(&f.cap, &pos, out.data(), out.size());
+    REQUIRE(n == 54);
+    CHECK(pos == 64);
+    out.resize(n);
+    CHECK(holds_stream(out, 10));
+
+    // A short read entirely inside the overwritten range returns nothing
+    // but still moves past it
+    pos = 0;
+    CHECK(capture_buffer_read(&f.cap, &pos, out.data(), 8) == 0);
+    CHECK(pos == 10);
+}
+
+TEST_CASE("A reader ahead of the published head reads nothing", "[capture_buffer]")
+{
+    capture_fixture_t<64, 8> f(10);
+    append_stream(&f.cap, 20, 0);
+
+    std::vector<uint8_t> out(16);
+    size_t pos = 30;
+    CHECK(capture_buffer_read(&f.cap, &pos, out.data(), out.size()) == 0);
+    CHECK(pos == 30);
+}
+
+// ============================================================================
+// Time Marks
+// ============================================================================
+
+TEST_CASE("Data within one mark interval shares a mark", "[capture_buffer]")
+{
+    capture_fixture_t<256, 8> f(10);
+    append_stream(&f.cap, 10, 100);
+    append_stream(&f.cap, 10, 105);
+    append_stream(&f.cap, 10, 110);
+
+    int64_t time_us;
+    size_t next;
+    REQUIRE(capture_buffer_time_at(&f.cap, 15, &time_us, &next));
+    CHECK(time_us == 100);
+    CHECK(next == 20);
+    REQUIRE(capture_buffer_time_at(&f.cap, 20, &time_us, &next));
+    CHECK(time_us == 110);
+    CHECK(next == 30);
+}
+
+TEST_CASE("Time lookups across the wrap of the mark array", "[capture_buffer]")
+{
+    // Four marks: after six appends only the marks at 20..50 are held
+    capture_fixture_t<256, 4> f(10);
+    for (int i = 0; i < 6; i++) {
+        append_stream(&f.cap, 10, i * 10);
+    }
+
+    int64_t time_us;
+    size_t next;
+    CHECK_FALSE(capture_buffer_time_at(&f.cap, 19, &time_us, &next));
+    REQUIRE(capture_buffer_time_at(&f.cap, 20, &time_us, &next));
+    CHECK(time_us == 20);
+    CHECK(next == 30);
+    REQUIRE(capture_buffer_time_at(&f.cap, 35, &time_us, &next));
+    CHECK(time_us == 30);
+    CHECK(next == 40);
+    REQUIRE(capture_buffer_time_at(&f.cap, 59, &time_us, &next));
+    CHECK(time_us == 50);
+    CHECK(next == 60);
+
+    SECTION("Window after the last mark is empty") {
+        CHECK(capture_buffer_pos_for_age(&f.cap, 60, 5) == 60);
+    }
+    SECTION("Window starts at the first mark inside it") {
+        CHECK(capture_buffer_pos_for_age(&f.cap, 60, 15) == 50);
+        CHECK(capture_buffer_pos_for_age(&f.cap, 60, 30) == 30);
+    }
+    SECTION("Window before the first mark includes everything held") {
+        CHECK(capture_buffer_pos_for_age(&f.cap, 60, 1000) == 0);
+    }
+}
+
+TEST_CASE("Age lookups stop at marks whose data is overwritten", "[capture_buffer]")
+{
+    capture_fixture_t<32, 8> f(10);
+    for (int i = 0; i < 6; i++) {
+        append_stream(&f.cap, 10, i * 10);
+    }
+    REQUIRE(capture_buffer_oldest(&f.cap) == 28);
+
+    CHECK(capture_buffer_pos_for_age(&f.cap, 60, 1000) == 28);
+    CHECK(capture_buffer_pos_for_age(&f.cap, 60, 25) == 40);
+}
+
+TEST_CASE("Time lookup matches a linear search over random appends", "[capture_buffer]")
+{
+    constexpr size_t MARKS = 16;
+    capture_fixture_t<1024, MARKS> f(20);
+    std::mt19937 rng(42);
+    std::vector<capture_mark_t> all_marks;
+    int64_t t = 0;
+
+    for (int step = 0; step < 500; step++) {
+        t += rng() % 30;
+        size_t head = capture_buffer_head(&f.cap);
+        if (all_marks.empty() || t - all_marks.back().time_us >= 20) {
+            all_marks.push_back({head, t});
+        }
+        append_stream(&f.cap, 1 + rng() % 40, t);
+
+        size_t first_mark = all_marks.size() > MARKS ? all_marks.size() - MARKS : 0;
+        size_t new_head = capture_buffer_head(&f.cap);
+        for (size_t pos = capture_buffer_oldest(&f.cap); pos < new_head; pos++) {
+            // Newest held mark at or before pos
+            size_t found = all_marks.size();
+            for (size_t i = all_marks.size(); i-- > first_mark;) {
+                if (all_marks[i].pos <= pos) {
+                    found = i;
+                    break;
+                }
+            }
+
+            int64_t time_us;
+            size_t next;
+            bool ok = capture_buffer_time_at(&f.cap, pos, &time_us, &next);
+            REQUIRE(ok == (found != all_marks.size()));
+            if (ok) {
+                REQUIRE(time_us == all_marks[found].time_us);
+                REQUIRE(next == (found + 1 < all_marks.size() ? all_marks[found + 1].pos : new_head));
+            }
+        }
+    }
+}
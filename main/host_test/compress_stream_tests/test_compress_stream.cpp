@@ -0,0 +1,296 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Round trip of the SLZ4 compressed data port stream through a reference
+ * decoder that follows tools/compressed_client.py
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+extern "C" {
+#include "compress_stream.h"
+}
+
+// ============================================================================
+// Reference Decoder
+// ============================================================================
+
+// Same as StreamDecoder in tools/compressed_client.py, plus the LZ4 block
+// rules the Python decoder does not check (last literals, match limit)
+class StreamDecoder {
+public:
+    std::vector<uint8_t> feed(const uint8_t *data, size_t len)
+    {
+        buffer_.insert(buffer_.end(), data, data + len);
+        std::vector<uint8_t> out;
+
+        if (window_ == 0) {
+            if (buffer_.size() < COMPRESS_STREAM_HEADER_SIZE) {
+                return out;
+            }
+            if (memcmp(buffer_.data(), "SLZ4", 4) != 0 || buffer_[4] != 1) {
+                throw std::runtime_error("bad stream header");
+            }
+            window_ = buffer_[6] | (buffer_[7] << 8);
+            buffer_.erase(buffer_.begin(), buffer_.begin() + COMPRESS_STREAM_HEADER_SIZE);
+        }
+
+        while (buffer_.size() >= COMPRESS_STREAM_FRAME_HEADER) {
+            size_t raw_len = buffer_[0] | (buffer_[1] << 8);
+            size_t block_len = buffer_[2] | (buffer_[3] << 8);
+            if (buffer_.size() < COMPRESS_STREAM_FRAME_HEADER + block_len) {
+                break;
+            }
+            std::vector<uint8_t> block(buffer_.begin() + COMPRESS_STREAM_FRAME_HEADER,
+                                       buffer_.begin() + COMPRESS_STREAM_FRAME_HEADER + block_len);
+            buffer_.erase(buffer_.begin(), buffer_.begin() + COMPRESS_STREAM_FRAME_HEADER + block_len);
+            std::vector<uint8_t> data = decode_block(block, raw_len);
+            out.insert(out.end(), data.begin(), data.end());
+        }
+        return out;
+    }
+
+    size_t window() const { return window_; }
+
+private:
+    static size_t read_length(const std::vector<uint8_t> &block, size_t &i, size_t n)
+    {
+        if (n != 15) {
+            return n;
+        }
+        while (true) {
+            if (i >= block.size()) {
+                throw std::runtime_error("truncated length");
+            }
+            uint8_t b = block[i++];
+            n += b;
+            if (b != 255) {
+                return n;
+            }
+        }
+    }
+
+    std::vector<uint8_t> decode_block(const std::vector<uint8_t> &block, size_t raw_len)
+    {
+        size_t start = hist_.size();
+        size_t i = 0;
+        while (i < block.size()) {
+            uint8_t token = block[i++];
+            size_t literal_len = read_length(block, i, token >> 4);
+            if (i + literal_len > block.size()) {
+                throw std::runtime_error("literals past the block end");
+            }
+            hist_.insert(hist_.end(), block.begin() + i, block.begin() + i + literal_len);
+            i += literal_len;
+            if (i >= block.size()) {
+                break;      // Last sequence has literals only
+            }
+
+            if (i + 2 > block.size()) {
+                throw std::runtime_error("truncated offset");
+            }
+            size_t offset = block[i] | (block[i + 1] << 8);
+            i += 2;
+            size_t match_len = read_length(block, i, token & 0x0F) + 4;
+            if (offset == 0 || offset > hist_.size()) {
+                throw std::runtime_error("bad match offset");
+            }
+            if ((hist_.size() - start) + match_len + 5 > raw_len) {
+                throw std::runtime_error("match within the last literals");
+            }
+            size_t pos = hist_.size() - offset;
+            for (size_t k = 0; k < match_len; k++) {    // Matches may overlap their own output
+                hist_.push_back(hist_[pos + k]);
+            }
+        }
+
+        if (hist_.size() - start != raw_len) {
+            throw std::runtime_error("decoded length differs from the frame header");
+        }
+        std::vector<uint8_t> data(hist_.begin() + start, hist_.end());
+        // Only the window is referenced by later blocks
+        if (hist_.size() > window_) {
+            hist_.erase(hist_.begin(), hist_.end() - window_);
+        }
+        return data;
+    }
+
+    std::vector<uint8_t> buffer_;
+    std::vector<uint8_t> hist_;
+    size_t window_ = 0;
+};
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static std::vector<uint8_t> make_text(size_t len, unsigned seed)
+{
+    static const char *const words[] = {
+        "I (12345) ", "wifi:", "connected", "rssi=-52", "task ", "heap ", "free=182340", "\r\n",
+    };
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> data;
+    while (data.size() < len) {
+        const char *w = words[rng() % (sizeof(words) / sizeof(words[0]))];
+        data.insert(data.end(), w, w + strlen(w));
+    }
+    data.resize(len);
+    return data;
+}
+
+static std::vector<uint8_t> make_random(size_t len, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> data(len);
+    for (auto &b : data) {
+        b = static_cast<uint8_t>(rng());
+    }
+    return data;
+}
+
+// Compress data in frames of the given sizes (cycled) and return the wire stream
+static std::vector<uint8_t> compress(const std::vector<uint8_t> &data, const std::vector<size_t> &sizes)
+{
+    static compress_stream_t cs;
+    compress_stream_reset(&cs);
+
+    std::vector<uint8_t> wire(COMPRESS_STREAM_HEADER_SIZE);
+    REQUIRE(compress_stream_header(&cs, wire.data()) == COMPRESS_STREAM_HEADER_SIZE);
+
+    uint8_t frame[COMPRESS_STREAM_FRAME_MAX];
+    size_t offset = 0;
+    for (size_t k = 0; offset < data.size(); k++) {
+        size_t n = std::min(sizes[k % sizes.size()], data.size() - offset);
+        size_t frame_len = compress_stream_frame(&cs, data.data() + offset, n, frame);
+        REQUIRE(frame_len <= COMPRESS_STREAM_FRAME_HEADER + COMPRESS_STREAM_BLOCK_BOUND(n));
+        wire.insert(wire.end(), frame, frame + frame_len);
+        offset += n;
+    }
+
+    REQUIRE(cs.in_bytes == data.size());
+    REQUIRE(cs.out_bytes == wire.size());
+    return wire;
+}
+
+// Decode the wire stream fed in random pieces, as it arrives from a socket
+static std::vector<uint8_t> decode(const std::vector<uint8_t> &wire, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    StreamDecoder decoder;
+    std::vector<uint8_t> out;
+    size_t offset = 0;
+    while (offset < wire.size()) {
+        size_t n = std::min<size_t>(1 + rng() % 1500, wire.size() - offset);
+        std::vector<uint8_t> data = decoder.feed(wire.data() + offset, n);
+        out.insert(out.end(), data.begin(), data.end());
+        offset += n;
+    }
+    REQUIRE(decoder.window() == COMPRESS_STREAM_WINDOW_SIZE);
+    return out;
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+TEST_CASE("Compress Stream - Header", "[compress_stream]")
+{
+    static compress_stream_t cs;
+    compress_stream_reset(&cs);
+    uint8_t header[COMPRESS_STREAM_HEADER_SIZE];
+    REQUIRE(compress_stream_header(&cs, header) == COMPRESS_STREAM_HEADER_SIZE);
+    REQUIRE(memcmp(header, "SLZ4", 4) == 0);
+    REQUIRE(header[4] == COMPRESS_STREAM_VERSION);
+    REQUIRE(header[5] == 0);
+    REQUIRE((header[6] | (header[7] << 8)) == COMPRESS_STREAM_WINDOW_SIZE);
+}
+
+TEST_CASE("Compress Stream - Text round trip", "[compress_stream]")
+{
+    // Longer than the window, so matches reach into slid history
+    std::vector<uint8_t> data = make_text(64 * 1024, 1);
+
+    SECTION("Frames at the block size limit") {
+        std::vector<uint8_t> wire = compress(data, {COMPRESS_STREAM_BLOCK_MAX});
+        REQUIRE(decode(wire, 1) == data);
+        REQUIRE(wire.size() < data.size() / 2);
+    }
+    SECTION("Frames just around the block size limit") {
+        std::vector<uint8_t> wire = compress(data, {COMPRESS_STREAM_BLOCK_MAX - 1, COMPRESS_STREAM_BLOCK_MAX, 1});
+        REQUIRE(decode(wire, 2) == data);
+    }
+    SECTION("Random frame sizes") {
+        std::mt19937 rng(3);
+        std::vector<size_t> sizes;
+        for (int i = 0; i < 97; i++) {
+            sizes.push_back(1 + rng() % COMPRESS_STREAM_BLOCK_MAX);
+        }
+        std::vector<uint8_t> wire = compress(data, sizes);
+        REQUIRE(decode(wire, 3) == data);
+    }
+    SECTION("Frames shorter than a match needs") {
+        std::vector<uint8_t> wire = compress(data, {1, 5, 12, 13, 17});
+        REQUIRE(decode(wire, 4) == data);
+    }
+}
+
+TEST_CASE("Compress Stream - Incompressible input", "[compress_stream]")
+{
+    std::vector<uint8_t> data = make_random(32 * 1024, 5);
+
+    std::vector<uint8_t> wire = compress(data, {COMPRESS_STREAM_BLOCK_MAX});
+    REQUIRE(decode(wire, 5) == data);
+
+    // Output grows by at most the worst-case bound
+    size_t frames = data.size() / COMPRESS_STREAM_BLOCK_MAX;
+    REQUIRE(wire.size() <= COMPRESS_STREAM_HEADER_SIZE + frames * COMPRESS_STREAM_FRAME_MAX);
+}
+
+TEST_CASE("Compress Stream - Long runs", "[compress_stream]")
+{
+    // Overlapping matches (offset 1) and length bytes of 255
+    std::vector<uint8_t> data(20000, 'A');
+    for (size_t i = 5000; i < 6000; i++) {
+        data[i] = static_cast<uint8_t>(i);
+    }
+
+    std::vector<uint8_t> wire = compress(data, {COMPRESS_STREAM_BLOCK_MAX, 300, COMPRESS_STREAM_BLOCK_MAX});
+    REQUIRE(decode(wire, 6) == data);
+    REQUIRE(wire.size() < data.size() / 4);
+}
+
+TEST_CASE("Compress Stream - Max input fits the space", "[compress_stream]")
+{
+    REQUIRE(compress_stream_max_input(0) == 0);
+    REQUIRE(compress_stream_max_input(COMPRESS_STREAM_FRAME_HEADER + COMPRESS_STREAM_BLOCK_BOUND(0)) == 0);
+    REQUIRE(compress_stream_max_input(COMPRESS_STREAM_FRAME_MAX) == COMPRESS_STREAM_BLOCK_MAX);
+    REQUIRE(compress_stream_max_input(SIZE_MAX / 512) == COMPRESS_STREAM_BLOCK_MAX);
+
+    for (size_t space = 0; space <= COMPRESS_STREAM_FRAME_MAX + 16; space++) {
+        size_t n = compress_stream_max_input(space);
+        if (n > 0) {
+            REQUIRE(COMPRESS_STREAM_FRAME_HEADER + COMPRESS_STREAM_BLOCK_BOUND(n) <= space);
+        }
+        // ... and is the largest that does
+        if (n < COMPRESS_STREAM_BLOCK_MAX) {
+            REQUIRE(COMPRESS_STREAM_FRAME_HEADER + COMPRESS_STREAM_BLOCK_BOUND(n + 1) > space);
+        }
+    }
+
+    // Even incompressible input of that size stays within the space
+    std::vector<uint8_t> data = make_random(COMPRESS_STREAM_BLOCK_MAX, 7);
+    static compress_stream_t cs;
+    uint8_t frame[COMPRESS_STREAM_FRAME_MAX];
+    for (size_t space : {size_t(64), size_t(1000), size_t(1460), size_t(COMPRESS_STREAM_FRAME_MAX)}) {
+        compress_stream_reset(&cs);
+        size_t n = compress_stream_max_input(space);
+        REQUIRE(compress_stream_frame(&cs, data.data(), n, frame) <= space);
+    }
+}
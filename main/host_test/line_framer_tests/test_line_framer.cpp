@@ -0,0 +1,462 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Text and binary timestamp framing of the data port, decoded back with
+ * the same rules as tools/framed_client.py
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "line_framer.h"
+}
+
+// ============================================================================
+// Reference Decoders
+// ============================================================================
+
+struct line_t {
+    int64_t time_us;
+    std::string text;
+
+    bool operator==(const line_t &other) const
+    {
+        return time_us == other.time_us && text == other.text;
+    }
+};
+
+// Same as RecordDecoder in tools/framed_client.py. Keeps the arrival time
+// of every payload byte and checks the CONTINUED flag against line starts.
+class RecordDecoder {
+public:
+    void feed(const uint8_t *data, size_t len)
+    {
+        buffer_.insert(buffer_.end(), data, data + len);
+
+        if (!header_seen_) {
+            if (buffer_.size() < LINE_FRAMER_HEADER_SIZE) {
+                return;
+            }
+            if (memcmp(buffer_.data(), LINE_FRAMER_MAGIC, 4) != 0 || buffer_[4] != LINE_FRAMER_VERSION) {
+                throw std::runtime_error("bad stream header");
+            }
+            boot_us_ = get_le(buffer_.data() + 8, 8);
+            buffer_.erase(buffer_.begin(), buffer_.begin() + LINE_FRAMER_HEADER_SIZE);
+            header_seen_ = true;
+        }
+
+        while (buffer_.size() >= LINE_FRAMER_RECORD_HEADER) {
+            uint16_t len_flags = static_cast<uint16_t>(get_le(buffer_.data(), 2));
+            size_t length = len_flags & LINE_FRAMER_LEN_MASK;
+            if (buffer_.size() < LINE_FRAMER_RECORD_HEADER + length) {
+                break;
+            }
+            if (length == 0) {
+                throw std::runtime_error("empty record");
+            }
+            int64_t stamp = static_cast<int64_t>(get_le(buffer_.data() + 2, 6));
+            std::string payload(buffer_.begin() + LINE_FRAMER_RECORD_HEADER,
+                                buffer_.begin() + LINE_FRAMER_RECORD_HEADER + length);
+            buffer_.erase(buffer_.begin(), buffer_.begin() + LINE_FRAMER_RECORD_HEADER + length);
+
+            bool continued = (len_flags & LINE_FRAMER_CONTINUED) != 0;
+            if (continued != !line_.text.empty()) {
+                throw std::runtime_error("CONTINUED flag does not match the line start");
+            }
+            if (!continued) {
+                line_.time_us = stamp;
+            }
+            line_.text += payload;
+            byte_times_.insert(byte_times_.end(), length, stamp);
+            records_.push_back(len_flags);
+            if (line_.text.back() == '\n') {
+                lines_.push_back(line_);
+                line_.text.clear();
+            }
+        }
+    }
+
+    // Lines including a trailing one without '\n'
+    std::vector<line_t> lines() const
+    {
+        std::vector<line_t> all = lines_;
+        if (!line_.text.empty()) {
+            all.push_back(line_);
+        }
+        return all;
+    }
+
+    const std::vector<int64_t> &byte_times() const { return byte_times_; }
+    const std::vector<uint16_t> &records() const { return records_; }
+    bool header_seen() const { return header_seen_; }
+    uint64_t boot_us() const { return boot_us_; }
+    size_t pending() const { return buffer_.size(); }
+
+private:
+    static uint64_t get_le(const uint8_t *p, size_t n)
+    {
+        uint64_t v = 0;
+        for (size_t i = 0; i < n; i++) {
+            v |= static_cast<uint64_t>(p[i]) << (8 * i);
+        }
+        return v;
+    }
+
+    std::vector<uint8_t> buffer_;
+    bool header_seen_ = false;
+    uint64_t boot_us_ = 0;
+    line_t line_ = {0, {}};
+    std::vector<line_t> lines_;
+    std::vector<int64_t> byte_times_;
+    std::vector<uint16_t> records_;
+};
+
+// Parses "[<seconds>.<microseconds>] " at every line start
+static int64_t parse_prefix(const std::string &s, size_t &pos)
+{
+    if (s.size() - pos < 16 || s[pos] != '[') {
+        throw std::runtime_error("missing prefix");
+    }
+    size_t close = s.find("] ", pos);
+    size_t dot = s.find('.', pos);
+    if (close == std::string::npos || dot == std::string::npos || dot > close) {
+        throw std::runtime_error("malformed prefix");
+    }
+    std::string sec = s.substr(pos + 1, dot - pos - 1);
+    std::string frac = s.substr(dot + 1, close - dot - 1);
+    if (sec.size() < 5 || frac.size() != 6) {
+        throw std::runtime_error("prefix field width");
+    }
+    size_t lead = sec.find_first_not_of(' ');
+    if (lead == std::string::npos || sec.find_first_not_of("0123456789", lead) != std::string::npos ||
+        frac.find_first_not_of("0123456789") != std::string::npos) {
+        throw std::runtime_error("prefix digits");
+    }
+    if (lead > 0 && sec.size() != 5) {
+        throw std::runtime_error("prefix padding");
+    }
+    pos = close + 2;
+    return std::stoll(sec.substr(lead)) * 1000000 + std::stoll(frac);
+}
+
+static std::vector<line_t> decode_text(const std::string &s)
+{
+    std::vector<line_t> lines;
+    size_t pos = 0;
+    while (pos < s.size()) {
+        int64_t t = parse_prefix(s, pos);
+        size_t nl = s.find('\n', pos);
+        size_t end = nl == std::string::npos ? s.size() : nl + 1;
+        lines.push_back({t, s.substr(pos, end - pos)});
+        pos = end;
+    }
+    return lines;
+}
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+struct chunk_t {
+    std::string data;
+    int64_t time_us;
+};
+
+// Serial-like input: lines of varying length, cut into USB-sized chunks
+// whose boundaries fall anywhere within the lines
+static std::vector<chunk_t> make_chunks(unsigned seed, size_t total, size_t max_line)
+{
+    std::mt19937 rng(seed);
+    std::string text;
+    while (text.size() < total) {
+        size_t n = rng() % max_line;
+        for (size_t i = 0; i < n; i++) {
+            text += static_cast<char>(' ' + rng() % 95);
+        }
+        text += rng() % 8 == 0 ? "\r\n" : "\n";
+        if (rng() % 16 == 0) {
+            text += "\n";   // Empty line
+        }
+    }
+    text.resize(total);     // Last line may be unterminated
+
+    std::vector<chunk_t> chunks;
+    int64_t t = 12000000 + rng() % 1000000;
+    for (size_t pos = 0; pos < text.size();) {
+        size_t n = std::min<size_t>(1 + rng() % 300, text.size() - pos);
+        chunks.push_back({text.substr(pos, n), t});
+        pos += n;
+        t += 1 + rng() % 5000;
+    }
+    return chunks;
+}
+
+// Lines with the arrival time of their first byte
+static std::vector<line_t> expected_lines(const std::vector<chunk_t> &chunks)
+{
+    std::vector<line_t> lines;
+    bool line_start = true;
+    for (const chunk_t &c : chunks) {
+        for (char ch : c.data) {
+            if (line_start) {
+                lines.push_back({c.time_us, {}});
+            }
+            lines.back().text += ch;
+            line_start = ch == '\n';
+        }
+    }
+    return lines;
+}
+
+// Frames every chunk into output buffers of random size, like the data
+// port task does with the TCP send space
+static std::string encode_all(line_framer_t *lf, const std::vector<chunk_t> &chunks,
+                              std::mt19937 &rng, size_t min_space, size_t max_space)
+{
+    std::string out;
+    std::vector<uint8_t> buf(max_space);
+    for (const chunk_t &c : chunks) {
+        const uint8_t *in = reinterpret_cast<const uint8_t *>(c.data.data());
+        size_t pos = 0;
+        while (pos < c.data.size()) {
+            size_t space = min_space + rng() % (max_space - min_space + 1);
+            size_t consumed = 0;
+            size_t n = line_framer_encode(lf, in + pos, c.data.size() - pos, c.time_us,
+                                          buf.data(), space, &consumed);
+            REQUIRE(n <= space);
+            REQUIRE(consumed > 0);
+            out.append(reinterpret_cast<const char *>(buf.data()), n);
+            pos += consumed;
+        }
+    }
+    return out;
+}
+
+static std::string prefix_of(int64_t time_us)
+{
+    line_framer_t lf;
+    line_framer_reset(&lf, LINE_FRAMER_TEXT);
+    uint8_t out[LINE_FRAMER_PREFIX_MAX + 1];
+    size_t consumed = 0;
+    size_t n = line_framer_encode(&lf, reinterpret_cast<const uint8_t *>("x"), 1, time_us,
+                                  out, sizeof(out), &consumed);
+    REQUIRE(consumed == 1);
+    REQUIRE(n >= 1);
+    return std::string(reinterpret_cast<const char *>(out), n - 1);
+}
+
+// ============================================================================
+// Text Format
+// ============================================================================
+
+TEST_CASE("Line Framer - Text prefix", "[line_framer]")
+{
+    REQUIRE(prefix_of(0) == "[    0.000000] ");
+    REQUIRE(prefix_of(12345678) == "[   12.345678] ");
+    REQUIRE(prefix_of(99999999999) == "[99999.999999] ");
+    REQUIRE(prefix_of(123456000001) == "[123456.000001] ");
+    REQUIRE(prefix_of(-5) == "[    0.000000] ");
+    REQUIRE(prefix_of(INT64_MAX).size() <= LINE_FRAMER_PREFIX_MAX);
+}
+
+TEST_CASE("Line Framer - Text round trip", "[line_framer]")
+{
+    for (unsigned seed = 1; seed <= 20; seed++) {
+        std::vector<chunk_t> chunks = make_chunks(seed, 50000, seed % 2 ? 80 : 1000);
+        std::mt19937 rng(seed);
+        line_framer_t lf;
+        line_framer_reset(&lf, LINE_FRAMER_TEXT);
+
+        uint8_t header[LINE_FRAMER_HEADER_SIZE];
+        REQUIRE(line_framer_header(&lf, 1000, header) == 0);
+
+        std::string out = encode_all(&lf, chunks, rng, LINE_FRAMER_PREFIX_MAX + 1, 400);
+        std::vector<line_t> expected = expected_lines(chunks);
+        INFO("seed " << seed);
+        REQUIRE(decode_text(out) == expected);
+        REQUIRE(lf.lines == expected.size());
+        REQUIRE(lf.in_bytes == 50000);
+        REQUIRE(lf.out_bytes == out.size());
+    }
+}
+
+TEST_CASE("Line Framer - Text output space edge", "[line_framer]")
+{
+    const uint8_t in[] = "ab\ncd";
+    const size_t prefix_len = prefix_of(5000000).size();
+    uint8_t out[64];
+    size_t consumed = 99;
+    line_framer_t lf;
+    line_framer_reset(&lf, LINE_FRAMER_TEXT);
+
+    SECTION("Only the prefix fits") {
+        // A prefix is never sent without at least one byte of its line
+        REQUIRE(line_framer_encode(&lf, in, 5, 5000000, out, prefix_len, &consumed) == 0);
+        REQUIRE(consumed == 0);
+        REQUIRE(lf.line_start);
+        REQUIRE(lf.lines == 0);
+
+        REQUIRE(line_framer_encode(&lf, in, 5, 5000000, out, prefix_len + 1, &consumed) == prefix_len + 1);
+        REQUIRE(consumed == 1);
+        REQUIRE(std::string(reinterpret_cast<char *>(out), prefix_len + 1) == "[    5.000000] a");
+        REQUIRE_FALSE(lf.line_start);
+        REQUIRE(lf.lines == 1);
+    }
+    SECTION("Line ends exactly at the end of the space") {
+        REQUIRE(line_framer_encode(&lf, in, 5, 5000000, out, prefix_len + 3, &consumed) == prefix_len + 3);
+        REQUIRE(consumed == 3);
+        REQUIRE(lf.line_start);
+
+        // The next line's prefix does not fit in what is left
+        REQUIRE(line_framer_encode(&lf, in, 5, 5000000, out, prefix_len + 3 + prefix_len, &consumed) ==
+                prefix_len + 3);
+        REQUIRE(consumed == 3);
+    }
+    SECTION("Continuation needs no prefix") {
+        REQUIRE(line_framer_encode(&lf, in, 1, 5000000, out, sizeof(out), &consumed) == prefix_len + 1);
+        REQUIRE(line_framer_encode(&lf, in + 1, 4, 6000000, out, 1, &consumed) == 1);
+        REQUIRE(consumed == 1);
+        REQUIRE(out[0] == 'b');
+    }
+}
+
+// ============================================================================
+// Binary Format
+// ============================================================================
+
+TEST_CASE("Line Framer - Binary stream header", "[line_framer]")
+{
+    line_framer_t lf;
+    line_framer_reset(&lf, LINE_FRAMER_BINARY);
+    uint8_t header[LINE_FRAMER_HEADER_SIZE];
+    REQUIRE(line_framer_header(&lf, 0x123456789a, header) == LINE_FRAMER_HEADER_SIZE);
+    REQUIRE(lf.out_bytes == LINE_FRAMER_HEADER_SIZE);
+
+    RecordDecoder dec;
+    dec.feed(header, sizeof(header));
+    REQUIRE(dec.header_seen());
+    REQUIRE(dec.boot_us() == 0x123456789a);
+    REQUIRE(header[5] == 0);
+    REQUIRE(header[6] == 0);
+    REQUIRE(header[7] == 0);
+}
+
+TEST_CASE("Line Framer - Binary round trip", "[line_framer]")
+{
+    for (unsigned seed = 1; seed <= 20; seed++) {
+        std::vector<chunk_t> chunks = make_chunks(seed, 50000, seed % 2 ? 80 : 1000);
+        std::mt19937 rng(seed);
+        line_framer_t lf;
+        line_framer_reset(&lf, LINE_FRAMER_BINARY);
+
+        uint8_t header[LINE_FRAMER_HEADER_SIZE];
+        std::string out(reinterpret_cast<char *>(header), line_framer_header(&lf, 1000, header));
+        out += encode_all(&lf, chunks, rng, LINE_FRAMER_RECORD_HEADER + 1, 400);
+
+        // The decoder throws when a CONTINUED flag does not match a fragment
+        RecordDecoder dec;
+        std::mt19937 split(seed);
+        for (size_t pos = 0; pos < out.size();) {
+            size_t n = std::min<size_t>(1 + split() % 100, out.size() - pos);
+            dec.feed(reinterpret_cast<const uint8_t *>(out.data() + pos), n);
+            pos += n;
+        }
+        INFO("seed " << seed);
+        REQUIRE(dec.pending() == 0);
+        REQUIRE(dec.lines() == expected_lines(chunks));
+
+        // Records never span input chunks, so every byte has its own arrival time
+        std::vector<int64_t> times;
+        for (const chunk_t &c : chunks) {
+            times.insert(times.end(), c.data.size(), c.time_us);
+        }
+        REQUIRE(dec.byte_times() == times);
+        REQUIRE(lf.lines == dec.lines().size());
+        REQUIRE(lf.in_bytes == 50000);
+        REQUIRE(lf.out_bytes == out.size());
+    }
+}
+
+TEST_CASE("Line Framer - Binary split lines", "[line_framer]")
+{
+    const uint8_t in[] = "hello\nworld";
+    uint8_t out[64];
+    size_t consumed = 0;
+    line_framer_t lf;
+    line_framer_reset(&lf, LINE_FRAMER_BINARY);
+    RecordDecoder dec;
+    uint8_t header[LINE_FRAMER_HEADER_SIZE];
+    dec.feed(header, line_framer_header(&lf, 0, header));
+
+    // "hel" | "lo\nwor" | "ld": the line tails become CONTINUED records
+    size_t n = line_framer_encode(&lf, in, 3, 100, out, sizeof(out), &consumed);
+    dec.feed(out, n);
+    n = line_framer_encode(&lf, in + 3, 6, 200, out, sizeof(out), &consumed);
+    dec.feed(out, n);
+    n = line_framer_encode(&lf, in + 9, 2, 300, out, sizeof(out), &consumed);
+    dec.feed(out, n);
+
+    REQUIRE(dec.records() == std::vector<uint16_t>{
+        3, LINE_FRAMER_CONTINUED | 3, 3, LINE_FRAMER_CONTINUED | 2});
+    REQUIRE(dec.lines() == std::vector<line_t>{{100, "hello\n"}, {200, "world"}});
+    REQUIRE(lf.lines == 2);
+}
+
+TEST_CASE("Line Framer - Binary length clamp", "[line_framer]")
+{
+    // One line longer than LEN_MASK is cut into continued records
+    std::string line(LINE_FRAMER_LEN_MASK * 2 + 100, 'x');
+    line += '\n';
+    std::vector<uint8_t> out(line.size() + 10 * LINE_FRAMER_RECORD_HEADER);
+    size_t consumed = 0;
+    line_framer_t lf;
+    line_framer_reset(&lf, LINE_FRAMER_BINARY);
+    RecordDecoder dec;
+    uint8_t header[LINE_FRAMER_HEADER_SIZE];
+    dec.feed(header, line_framer_header(&lf, 0, header));
+
+    size_t n = line_framer_encode(&lf, reinterpret_cast<const uint8_t *>(line.data()), line.size(), 42,
+                                  out.data(), out.size(), &consumed);
+    REQUIRE(consumed == line.size());
+    REQUIRE(n == line.size() + 3 * LINE_FRAMER_RECORD_HEADER);
+    dec.feed(out.data(), n);
+
+    REQUIRE(dec.records() == std::vector<uint16_t>{
+        LINE_FRAMER_LEN_MASK, LINE_FRAMER_CONTINUED | LINE_FRAMER_LEN_MASK, LINE_FRAMER_CONTINUED | 101});
+    REQUIRE(dec.lines() == std::vector<line_t>{{42, line}});
+}
+
+TEST_CASE("Line Framer - Binary output space edge", "[line_framer]")
+{
+    const uint8_t in[] = "ab\n";
+    uint8_t out[32];
+    size_t consumed = 99;
+    line_framer_t lf;
+    line_framer_reset(&lf, LINE_FRAMER_BINARY);
+
+    // A record header alone is never written
+    REQUIRE(line_framer_encode(&lf, in, 3, 7, out, LINE_FRAMER_RECORD_HEADER, &consumed) == 0);
+    REQUIRE(consumed == 0);
+    REQUIRE(lf.lines == 0);
+
+    REQUIRE(line_framer_encode(&lf, in, 3, 7, out, LINE_FRAMER_RECORD_HEADER + 1, &consumed) ==
+            LINE_FRAMER_RECORD_HEADER + 1);
+    REQUIRE(consumed == 1);
+    REQUIRE(out[0] == 1);
+    REQUIRE(out[1] == 0);
+    REQUIRE(out[2] == 7);
+
+    REQUIRE(line_framer_encode(&lf, in + 1, 2, 8, out, sizeof(out), &consumed) == LINE_FRAMER_RECORD_HEADER + 2);
+    REQUIRE(consumed == 2);
+    REQUIRE(out[1] == (LINE_FRAMER_CONTINUED >> 8));
+    REQUIRE(lf.line_start);
+    REQUIRE(lf.lines == 1);
+}
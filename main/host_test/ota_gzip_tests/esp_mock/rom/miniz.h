@@ -0,0 +1,94 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Mock of the ROM inflater (rom/miniz.h) for Linux testing of ota_gzip
+ *
+ * The tinfl_decompress() subset ota_gzip uses, built on zlib's raw
+ * inflate. Like the miniz 1.x inflater in ROM, it reads ahead: when the
+ * deflate stream ends it has consumed up to MOCK_TINFL_READ_AHEAD bytes
+ * past the end, and does not give them back.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <zlib.h>
+
+#define TINFL_LZ_DICT_SIZE      32768
+#define MOCK_TINFL_READ_AHEAD   3
+
+enum {
+    TINFL_FLAG_PARSE_ZLIB_HEADER = 1,
+    TINFL_FLAG_HAS_MORE_INPUT = 2,
+    TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4,
+    TINFL_FLAG_COMPUTE_ADLER32 = 8,
+};
+
+typedef enum {
+    TINFL_STATUS_BAD_PARAM = -3,
+    TINFL_STATUS_ADLER32_MISMATCH = -2,
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2,
+} tinfl_status;
+
+typedef struct {
+    uint32_t m_state;           // 0 = not started, 1 = inflating, 2 = done, 3 = failed
+    z_stream zs;
+} tinfl_decompressor;
+
+#define tinfl_init(r) do { (r)->m_state = 0; } while (0)
+
+static inline tinfl_status tinfl_decompress(tinfl_decompressor *r, const uint8_t *pIn_buf_next,
+                                            size_t *pIn_buf_size, uint8_t *pOut_buf_start,
+                                            uint8_t *pOut_buf_next, size_t *pOut_buf_size,
+                                            const uint32_t decomp_flags)
+{
+    (void)pOut_buf_start;
+    (void)decomp_flags;
+
+    if (r->m_state == 0) {
+        memset(&r->zs, 0, sizeof(r->zs));
+        if (inflateInit2(&r->zs, -15) != Z_OK) {
+            return TINFL_STATUS_BAD_PARAM;
+        }
+        r->m_state = 1;
+    }
+    if (r->m_state != 1) {
+        *pIn_buf_size = 0;
+        *pOut_buf_size = 0;
+        return r->m_state == 2 ? TINFL_STATUS_DONE : TINFL_STATUS_FAILED;
+    }
+
+    r->zs.next_in = (Bytef *)pIn_buf_next;
+    r->zs.avail_in = (uInt)*pIn_buf_size;
+    r->zs.next_out = pOut_buf_next;
+    r->zs.avail_out = (uInt)*pOut_buf_size;
+    int ret = inflate(&r->zs, Z_NO_FLUSH);
+    size_t in_used = *pIn_buf_size - r->zs.avail_in;
+    size_t out_used = *pOut_buf_size - r->zs.avail_out;
+    *pOut_buf_size = out_used;
+
+    if (ret == Z_STREAM_END) {
+        size_t extra = r->zs.avail_in < MOCK_TINFL_READ_AHEAD ? r->zs.avail_in : MOCK_TINFL_READ_AHEAD;
+        *pIn_buf_size = in_used + extra;
+        inflateEnd(&r->zs);
+        r->m_state = 2;
+        return TINFL_STATUS_DONE;
+    }
+    *pIn_buf_size = in_used;
+    if (ret != Z_OK && ret != Z_BUF_ERROR) {
+        inflateEnd(&r->zs);
+        r->m_state = 3;
+        return TINFL_STATUS_FAILED;
+    }
+    if (r->zs.avail_out == 0) {
+        return TINFL_STATUS_HAS_MORE_OUTPUT;
+    }
+    return TINFL_STATUS_NEEDS_MORE_INPUT;
+}
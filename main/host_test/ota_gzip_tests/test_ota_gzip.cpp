@@ -0,0 +1,227 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Round trip of gzip OTA uploads through ota_gzip: optional header fields,
+ * inflate and trailer, with the upload split at random points
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <zlib.h>
+
+extern "C" {
+#include "ota_gzip.h"
+}
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+// Firmware-like image: compressible code with some random-looking tables
+static std::vector<uint8_t> make_image(size_t len, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> image(len);
+    for (size_t i = 0; i < len; i++) {
+        image[i] = (i / 4096) % 3 == 2 ? static_cast<uint8_t>(rng()) : static_cast<uint8_t>((i * 7) ^ (i >> 5));
+    }
+    image[0] = 0xE9;    // ESP image magic
+    return image;
+}
+
+static std::vector<uint8_t> raw_deflate(const std::vector<uint8_t> &data, int level)
+{
+    z_stream zs = {};
+    REQUIRE(deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+    std::vector<uint8_t> out(deflateBound(&zs, data.size()));
+    zs.next_in = const_cast<Bytef *>(data.data());
+    zs.avail_in = static_cast<uInt>(data.size());
+    zs.next_out = out.data();
+    zs.avail_out = static_cast<uInt>(out.size());
+    REQUIRE(deflate(&zs, Z_FINISH) == Z_STREAM_END);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return out;
+}
+
+static void put_le32(std::vector<uint8_t> &out, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) {
+        out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+}
+
+// gzip member as written by gzip(1), optionally with every optional header field
+static std::vector<uint8_t> make_gzip(const std::vector<uint8_t> &image, uint8_t flags, int level = 9)
+{
+    std::vector<uint8_t> out = {GZIP_ID1, GZIP_ID2, GZIP_CM_DEFLATE, flags, 0, 0, 0, 0, 0, 3};
+    if (flags & GZIP_FEXTRA) {
+        out.insert(out.end(), {6, 0, 'A', 'P', 2, 0, 'x', 'y'});
+    }
+    if (flags & GZIP_FNAME) {
+        const char name[] = "serial_wifi_logger.bin";
+        out.insert(out.end(), name, name + sizeof(name));
+    }
+    if (flags & GZIP_FCOMMENT) {
+        const char comment[] = "test image";
+        out.insert(out.end(), comment, comment + sizeof(comment));
+    }
+    if (flags & GZIP_FHCRC) {
+        uint32_t crc = crc32(0, out.data(), static_cast<uInt>(out.size()));
+        out.push_back(static_cast<uint8_t>(crc));
+        out.push_back(static_cast<uint8_t>(crc >> 8));
+    }
+    std::vector<uint8_t> body = raw_deflate(image, level);
+    out.insert(out.end(), body.begin(), body.end());
+    put_le32(out, crc32(0, image.data(), static_cast<uInt>(image.size())));
+    put_le32(out, static_cast<uint32_t>(image.size()));
+    return out;
+}
+
+struct decode_result_t {
+    esp_err_t feed_err;
+    esp_err_t finish_err;
+    std::vector<uint8_t> image;
+};
+
+static esp_err_t collect(void *ctx, const uint8_t *data, size_t len)
+{
+    auto *image = static_cast<std::vector<uint8_t> *>(ctx);
+    image->insert(image->end(), data, data + len);
+    return ESP_OK;
+}
+
+// Feed the upload in pieces of 1..max_piece bytes, like httpd_req_recv()
+static decode_result_t decode(const std::vector<uint8_t> &upload, unsigned seed, size_t max_piece)
+{
+    static ota_gzip_t gz;
+    decode_result_t result = {ESP_OK, ESP_OK, {}};
+    REQUIRE(ota_gzip_init(&gz, upload.size(), collect, &result.image) == ESP_OK);
+
+    std::mt19937 rng(seed);
+    size_t offset = 0;
+    while (offset < upload.size() && result.feed_err == ESP_OK) {
+        size_t n = std::min<size_t>(1 + rng() % max_piece, upload.size() - offset);
+        result.feed_err = ota_gzip_feed(&gz, upload.data() + offset, n);
+        offset += n;
+    }
+    result.finish_err = ota_gzip_finish(&gz);
+    return result;
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+TEST_CASE("OTA gzip - Round trip with random splits", "[ota_gzip]")
+{
+    std::vector<uint8_t> image = make_image(200 * 1024, 1);
+
+    for (uint8_t flags : {uint8_t(0), uint8_t(GZIP_FNAME),
+                          uint8_t(GZIP_FEXTRA | GZIP_FNAME | GZIP_FCOMMENT | GZIP_FHCRC)}) {
+        std::vector<uint8_t> upload = make_gzip(image, flags);
+        for (unsigned seed = 1; seed <= 20; seed++) {
+            // Small pieces split every header field and the trailer
+            size_t max_piece = seed % 2 ? 7 : 4096;
+            decode_result_t r = decode(upload, seed, max_piece);
+            INFO("flags " << int(flags) << ", seed " << seed);
+            REQUIRE(r.feed_err == ESP_OK);
+            REQUIRE(r.finish_err == ESP_OK);
+            REQUIRE(r.image == image);
+        }
+    }
+}
+
+TEST_CASE("OTA gzip - Trailer split from the deflate stream", "[ota_gzip]")
+{
+    // The inflater reads ahead past the end of the deflate stream; the
+    // trailer must still be found wherever the upload is split
+    std::vector<uint8_t> image = make_image(5000, 2);
+    std::vector<uint8_t> upload = make_gzip(image, 0);
+
+    static ota_gzip_t gz;
+    for (size_t split = upload.size() - 12; split < upload.size(); split++) {
+        std::vector<uint8_t> out;
+        REQUIRE(ota_gzip_init(&gz, upload.size(), collect, &out) == ESP_OK);
+        REQUIRE(ota_gzip_feed(&gz, upload.data(), split) == ESP_OK);
+        REQUIRE(ota_gzip_feed(&gz, upload.data() + split, upload.size() - split) == ESP_OK);
+        REQUIRE(ota_gzip_finish(&gz) == ESP_OK);
+        REQUIRE(out == image);
+    }
+
+    // The whole upload in one piece
+    decode_result_t r = decode(upload, 1, upload.size());
+    REQUIRE(r.finish_err == ESP_OK);
+    REQUIRE(r.image == image);
+}
+
+TEST_CASE("OTA gzip - Stored and empty images", "[ota_gzip]")
+{
+    std::vector<uint8_t> image = make_image(70000, 3);
+    decode_result_t r = decode(make_gzip(image, 0, 0), 4, 3000);
+    REQUIRE(r.finish_err == ESP_OK);
+    REQUIRE(r.image == image);
+
+    r = decode(make_gzip({}, 0), 5, 5);
+    REQUIRE(r.feed_err == ESP_OK);
+    REQUIRE(r.finish_err == ESP_OK);
+    REQUIRE(r.image.empty());
+}
+
+TEST_CASE("OTA gzip - Malformed uploads", "[ota_gzip]")
+{
+    std::vector<uint8_t> image = make_image(30000, 4);
+    std::vector<uint8_t> good = make_gzip(image, GZIP_FNAME);
+
+    SECTION("Too short for a gzip member") {
+        static ota_gzip_t gz;
+        std::vector<uint8_t> out;
+        REQUIRE(ota_gzip_init(&gz, GZIP_HEADER_SIZE + GZIP_TRAILER_SIZE - 1, collect, &out) == ESP_ERR_INVALID_SIZE);
+    }
+    SECTION("Bad header") {
+        std::vector<uint8_t> upload = good;
+        upload[2] = 7;
+        REQUIRE(decode(upload, 1, 100).feed_err == ESP_ERR_INVALID_ARG);
+        upload = good;
+        upload[3] |= 0x80;
+        REQUIRE(decode(upload, 1, 100).feed_err == ESP_ERR_INVALID_ARG);
+    }
+    SECTION("Truncated upload") {
+        std::vector<uint8_t> upload(good.begin(), good.end() - 20);
+        decode_result_t r = decode(upload, 2, 1000);
+        REQUIRE(r.finish_err == ESP_ERR_INVALID_SIZE);
+    }
+    SECTION("Wrong ISIZE") {
+        std::vector<uint8_t> upload = good;
+        upload[upload.size() - 4] ^= 1;
+        REQUIRE(decode(upload, 3, 1000).feed_err == ESP_ERR_INVALID_ARG);
+    }
+    SECTION("Data after the deflate stream") {
+        std::vector<uint8_t> upload = good;
+        upload.insert(upload.end() - GZIP_TRAILER_SIZE, {0, 0, 0, 0, 0});
+        decode_result_t r = decode(upload, 4, 1000);
+        REQUIRE(r.feed_err == ESP_ERR_INVALID_ARG);
+        REQUIRE(r.finish_err == ESP_ERR_INVALID_SIZE);
+    }
+    SECTION("Corrupt deflate data") {
+        std::vector<uint8_t> upload = make_gzip(image, 0, 0);
+        upload[GZIP_HEADER_SIZE + 1] ^= 0xFF;     // Stored block length
+        decode_result_t r = decode(upload, 5, 1000);
+        REQUIRE(r.feed_err == ESP_ERR_INVALID_ARG);
+    }
+}
+
+TEST_CASE("OTA gzip - Write errors stop the decoder", "[ota_gzip]")
+{
+    std::vector<uint8_t> image = make_image(100000, 5);
+    std::vector<uint8_t> upload = make_gzip(image, 0);
+
+    static ota_gzip_t gz;
+    auto fail = [](void *, const uint8_t *, size_t) -> esp_err_t { return ESP_ERR_NO_MEM; };
+    REQUIRE(ota_gzip_init(&gz, upload.size(), fail, nullptr) == ESP_OK);
+    REQUIRE(ota_gzip_feed(&gz, upload.data(), upload.size()) == ESP_ERR_NO_MEM);
+}
@@ -0,0 +1,19 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Mock header for Linux testing of RFC2217 protocol layer
+ *
+ * Logging is compiled out; the tag is still referenced to avoid unused warnings.
+ */
+
+#pragma once
+
+#define ESP_LOG_MOCK(tag, format, ...) do { (void)(tag); } while (0)
+
+#define ESP_LOGE(tag, format, ...) ESP_LOG_MOCK(tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_LOG_MOCK(tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_MOCK(tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_LOG_MOCK(tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_LOG_MOCK(tag, format, ##__VA_ARGS__)
@@ -0,0 +1,406 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Include RFC2217 protocol header (esp_err.h / esp_log.h are mocked in esp_mock/)
+extern "C" {
+#include "rfc2217_protocol.h"
+}
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+// Random payload with roughly one IAC per iac_every bytes (0 = no IAC)
+static std::vector<uint8_t> make_payload(size_t len, unsigned iac_every, unsigned seed = 1)
+{
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> data(len);
+    for (size_t i = 0; i < len; i++) {
+        uint8_t b = static_cast<uint8_t>(rng() % 0xFF);  // 0x00-0xFE
+        if (iac_every > 0 && rng() % iac_every == 0) {
+            b = TELNET_IAC;
+        }
+        data[i] = b;
+    }
+    return data;
+}
+
+// Reference escape: per-byte loop
+static std::vector<uint8_t> escape_reference(const std::vector<uint8_t> &in)
+{
+    std::vector<uint8_t> out;
+    for (uint8_t b : in) {
+        out.push_back(b);
+        if (b == TELNET_IAC) {
+            out.push_back(TELNET_IAC);
+        }
+    }
+    return out;
+}
+
+// Reference parse: per-byte state machine, data only
+static std::vector<uint8_t> parse_reference(rfc2217_session_t *session, const std::vector<uint8_t> &in)
+{
+    std::vector<uint8_t> out;
+    uint8_t byte_out[1];
+    for (uint8_t b : in) {
+        size_t n = 0;
+        rfc2217_parse_byte(session, b, byte_out, &n);
+        if (n > 0) {
+            out.push_back(byte_out[0]);
+        }
+    }
+    return out;
+}
+
+// Bulk parse of the whole input, data only
+static std::vector<uint8_t> parse_bulk(rfc2217_session_t *session, const std::vector<uint8_t> &in)
+{
+    std::vector<uint8_t> out(in.size());
+    size_t out_total = 0;
+    size_t offset = 0;
+    while (offset < in.size()) {
+        size_t out_len = 0;
+        size_t consumed = 0;
+        rfc2217_parse_chunk(session, in.data() + offset, in.size() - offset,
+                            out.data() + out_total, &out_len, &consumed);
+        offset += consumed;
+        out_total += out_len;
+    }
+    out.resize(out_total);
+    return out;
+}
+
+// ============================================================================
+// IAC scan
+// ============================================================================
+
+TEST_CASE("RFC2217 Protocol - Find IAC", "[rfc2217_protocol]")
+{
+    SECTION("Empty input") {
+        uint8_t data[1] = {TELNET_IAC};
+        REQUIRE(rfc2217_find_iac(data, 0) == 0);
+    }
+
+    SECTION("No IAC") {
+        std::vector<uint8_t> data(100, 0x55);
+        REQUIRE(rfc2217_find_iac(data.data(), data.size()) == data.size());
+    }
+
+    SECTION("IAC at every position and alignment") {
+        std::vector<uint8_t> buf(80, 0xFE);
+        for (size_t start = 0; start < 16; start++) {
+            for (size_t pos = 0; pos < 48; pos++) {
+                std::fill(buf.begin(), buf.end(), 0xFE);
+                buf[start + pos] = TELNET_IAC;
+                REQUIRE(rfc2217_find_iac(buf.data() + start, 48) == pos);
+            }
+        }
+    }
+
+    SECTION("First of several IAC bytes") {
+        uint8_t data[16] = {0};
+        data[9] = TELNET_IAC;
+        data[12] = TELNET_IAC;
+        REQUIRE(rfc2217_find_iac(data, sizeof(data)) == 9);
+    }
+}
+
+// ============================================================================
+// Escaping
+// ============================================================================
+
+TEST_CASE("RFC2217 Protocol - Escape Data", "[rfc2217_protocol]")
+{
+    SECTION("Plain data is copied") {
+        const uint8_t in[] = {'h', 'e', 'l', 'l', 'o'};
+        uint8_t out[16];
+        REQUIRE(rfc2217_escape_data(in, sizeof(in), out, sizeof(out)) == sizeof(in));
+        REQUIRE(memcmp(out, in, sizeof(in)) == 0);
+    }
+
+    SECTION("IAC is doubled") {
+        const uint8_t in[] = {0x01, TELNET_IAC, 0x02, TELNET_IAC};
+        const uint8_t expected[] = {0x01, TELNET_IAC, TELNET_IAC, 0x02, TELNET_IAC, TELNET_IAC};
+        uint8_t out[16];
+        REQUIRE(rfc2217_escape_data(in, sizeof(in), out, sizeof(out)) == sizeof(expected));
+        REQUIRE(memcmp(out, expected, sizeof(expected)) == 0);
+    }
+
+    SECTION("All IAC fits in 2x buffer") {
+        std::vector<uint8_t> in(512, TELNET_IAC);
+        std::vector<uint8_t> out(1024);
+        REQUIRE(rfc2217_escape_data(in.data(), in.size(), out.data(), out.size()) == 1024);
+        REQUIRE(std::all_of(out.begin(), out.end(), [](uint8_t b) { return b == TELNET_IAC; }));
+    }
+
+    SECTION("IAC pair is never split when output is full") {
+        const uint8_t in[] = {0x01, 0x02, TELNET_IAC};
+        uint8_t out[3];
+        REQUIRE(rfc2217_escape_data(in, sizeof(in), out, sizeof(out)) == 2);
+    }
+
+    SECTION("Matches reference on random data") {
+        for (unsigned iac_every : {0u, 2u, 16u, 256u}) {
+            std::vector<uint8_t> in = make_payload(4099, iac_every, iac_every);
+            std::vector<uint8_t> expected = escape_reference(in);
+            std::vector<uint8_t> out(in.size() * 2);
+            size_t n = rfc2217_escape_data(in.data(), in.size(), out.data(), out.size());
+            out.resize(n);
+            REQUIRE(out == expected);
+        }
+    }
+}
+
+// Concatenate escape spans over the whole input, max_spans per call
+static std::vector<uint8_t> escape_via_spans(const std::vector<uint8_t> &in, size_t max_spans)
+{
+    std::vector<uint8_t> out;
+    std::vector<rfc2217_span_t> spans(max_spans);
+    size_t offset = 0;
+    while (offset < in.size()) {
+        size_t consumed = 0;
+        size_t n = rfc2217_escape_spans(in.data() + offset, in.size() - offset,
+                                        spans.data(), max_spans, &consumed);
+        REQUIRE(n > 0);
+        REQUIRE(consumed > 0);
+        for (size_t i = 0; i < n; i++) {
+            out.insert(out.end(), spans[i].base, spans[i].base + spans[i].len);
+        }
+        offset += consumed;
+    }
+    return out;
+}
+
+TEST_CASE("RFC2217 Protocol - Escape Spans", "[rfc2217_protocol]")
+{
+    rfc2217_span_t spans[8];
+    size_t consumed;
+
+    SECTION("Plain data is a single span over the input") {
+        const uint8_t in[] = {'a', 'b', 'c'};
+        REQUIRE(rfc2217_escape_spans(in, sizeof(in), spans, 8, &consumed) == 1);
+        REQUIRE(spans[0].base == in);
+        REQUIRE(spans[0].len == 3);
+        REQUIRE(consumed == 3);
+    }
+
+    SECTION("IAC run is followed by a fill span") {
+        const uint8_t in[] = {'a', TELNET_IAC, TELNET_IAC, 'b'};
+        REQUIRE(rfc2217_escape_spans(in, sizeof(in), spans, 8, &consumed) == 3);
+        REQUIRE(spans[0].base == in);
+        REQUIRE(spans[0].len == 3);
+        REQUIRE(spans[1].len == 2);
+        REQUIRE(spans[1].base[0] == TELNET_IAC);
+        REQUIRE(spans[1].base[1] == TELNET_IAC);
+        REQUIRE(spans[2].base == in + 3);
+        REQUIRE(consumed == 4);
+    }
+
+    SECTION("Fill span is never separated from its IAC run") {
+        const uint8_t in[] = {'a', TELNET_IAC, 'b'};
+        REQUIRE(rfc2217_escape_spans(in, sizeof(in), spans, 1, &consumed) == 1);
+        REQUIRE(spans[0].len == 1);
+        REQUIRE(consumed == 1);
+    }
+
+    SECTION("Matches reference on random and IAC-only data") {
+        for (unsigned iac_every : {0u, 1u, 2u, 16u, 256u}) {
+            std::vector<uint8_t> in = make_payload(4099, iac_every, iac_every);
+            for (size_t max_spans : {2u, 3u, 16u}) {
+                REQUIRE(escape_via_spans(in, max_spans) == escape_reference(in));
+            }
+        }
+    }
+}
+
+// ============================================================================
+// Bulk parsing
+// ============================================================================
+
+TEST_CASE("RFC2217 Protocol - Parse Chunk", "[rfc2217_protocol]")
+{
+    rfc2217_session_t session;
+    rfc2217_session_init(&session, nullptr);
+    uint8_t out[64];
+    size_t out_len;
+    size_t consumed;
+
+    SECTION("Plain data") {
+        const uint8_t in[] = {'a', 'b', 'c'};
+        REQUIRE(rfc2217_parse_chunk(&session, in, sizeof(in), out, &out_len, &consumed) == RFC2217_RESULT_DATA);
+        REQUIRE(out_len == 3);
+        REQUIRE(consumed == 3);
+        REQUIRE(memcmp(out, "abc", 3) == 0);
+    }
+
+    SECTION("Escaped IAC is unescaped") {
+        const uint8_t in[] = {'a', TELNET_IAC, TELNET_IAC, 'b'};
+        REQUIRE(rfc2217_parse_chunk(&session, in, sizeof(in), out, &out_len, &consumed) == RFC2217_RESULT_DATA);
+        REQUIRE(out_len == 3);
+        REQUIRE(out[1] == TELNET_IAC);
+        REQUIRE(consumed == 4);
+    }
+
+    SECTION("Stops after a command") {
+        const uint8_t in[] = {'x', TELNET_IAC, TELNET_WILL, TELNET_OPTION_BINARY, 'y', 'z'};
+        REQUIRE(rfc2217_parse_chunk(&session, in, sizeof(in), out, &out_len, &consumed) == RFC2217_RESULT_COMMAND);
+        REQUIRE(out_len == 1);
+        REQUIRE(out[0] == 'x');
+        REQUIRE(consumed == 4);
+        REQUIRE(session.need_option_response);
+
+        REQUIRE(rfc2217_parse_chunk(&session, in + consumed, sizeof(in) - consumed, out, &out_len, &consumed) == RFC2217_RESULT_DATA);
+        REQUIRE(out_len == 2);
+        REQUIRE(memcmp(out, "yz", 2) == 0);
+    }
+
+    SECTION("Subnegotiation sets baudrate") {
+        const uint8_t in[] = {TELNET_IAC, TELNET_SB, TELNET_COM_PORT_OPTION, RFC2217_SET_BAUDRATE,
+                              0x00, 0x0E, 0x10, 0x00, TELNET_IAC, TELNET_SE};
+        REQUIRE(rfc2217_parse_chunk(&session, in, sizeof(in), out, &out_len, &consumed) == RFC2217_RESULT_COMMAND);
+        REQUIRE(out_len == 0);
+        REQUIRE(consumed == sizeof(in));
+        REQUIRE(session.baudrate == 921600);
+        REQUIRE(session.line_coding_changed);
+    }
+
+    SECTION("SET-CONTROL selects flow control") {
+        const uint8_t in[] = {TELNET_IAC, TELNET_SB, TELNET_COM_PORT_OPTION, RFC2217_SET_CONTROL,
+                              RFC2217_CONTROL_FLOW_HARDWARE, TELNET_IAC, TELNET_SE};
+        REQUIRE(rfc2217_parse_chunk(&session, in, sizeof(in), out, &out_len, &consumed) == RFC2217_RESULT_COMMAND);
+        REQUIRE(session.flowcontrol == RFC2217_CONTROL_FLOW_HARDWARE);
+        REQUIRE(session.flow_control_changed);
+        REQUIRE_FALSE(session.modem_control_changed);
+
+        // A query changes nothing
+        session.flow_control_changed = false;
+        const uint8_t query[] = {TELNET_IAC, TELNET_SB, TELNET_COM_PORT_OPTION, RFC2217_SET_CONTROL,
+                                 RFC2217_CONTROL_FLOW_REQUEST, TELNET_IAC, TELNET_SE};
+        REQUIRE(rfc2217_parse_chunk(&session, query, sizeof(query), out, &out_len, &consumed) == RFC2217_RESULT_COMMAND);
+        REQUIRE(session.flowcontrol == RFC2217_CONTROL_FLOW_HARDWARE);
+        REQUIRE_FALSE(session.flow_control_changed);
+    }
+
+    SECTION("Vendor options set latency and transfer size") {
+        const uint8_t latency[] = {TELNET_IAC, TELNET_SB, TELNET_COM_PORT_OPTION, RFC2217_VENDOR_SET_LATENCY,
+                                   TELNET_IAC, TELNET_IAC, TELNET_IAC, TELNET_SE};
+        REQUIRE(rfc2217_parse_chunk(&session, latency, sizeof(latency), out, &out_len, &consumed) == RFC2217_RESULT_COMMAND);
+        REQUIRE(session.latency == RFC2217_LATENCY_AUTO);
+        REQUIRE(session.latency_changed);
+
+        const uint8_t xfer[] = {TELNET_IAC, TELNET_SB, TELNET_COM_PORT_OPTION, RFC2217_VENDOR_SET_XFER_SIZE,
+                                0x20, 0x00, TELNET_IAC, TELNET_SE};
+        REQUIRE(rfc2217_parse_chunk(&session, xfer, sizeof(xfer), out, &out_len, &consumed) == RFC2217_RESULT_COMMAND);
+        REQUIRE(session.xfer_size == 8192);
+        REQUIRE(session.xfer_size_changed);
+
+        // Out of range sizes are ignored
+        session.xfer_size_changed = false;
+        const uint8_t small[] = {TELNET_IAC, TELNET_SB, TELNET_COM_PORT_OPTION, RFC2217_VENDOR_SET_XFER_SIZE,
+                                 0x00, 0x40, TELNET_IAC, TELNET_SE};
+        REQUIRE(rfc2217_parse_chunk(&session, small, sizeof(small), out, &out_len, &consumed) == RFC2217_RESULT_COMMAND);
+        REQUIRE(session.xfer_size == 8192);
+        REQUIRE_FALSE(session.xfer_size_changed);
+    }
+
+    SECTION("IAC split across chunks") {
+        const uint8_t first[] = {'a', TELNET_IAC};
+        const uint8_t second[] = {TELNET_IAC, 'b'};
+        REQUIRE(rfc2217_parse_chunk(&session, first, sizeof(first), out, &out_len, &consumed) == RFC2217_RESULT_DATA);
+        REQUIRE(out_len == 1);
+        REQUIRE(rfc2217_parse_chunk(&session, second, sizeof(second), out, &out_len, &consumed) == RFC2217_RESULT_DATA);
+        REQUIRE(out_len == 2);
+        REQUIRE(out[0] == TELNET_IAC);
+        REQUIRE(out[1] == 'b');
+    }
+
+    SECTION("Matches per-byte parser on escaped random data") {
+        std::vector<uint8_t> payload = make_payload(8191, 8);
+        std::vector<uint8_t> wire = escape_reference(payload);
+
+        rfc2217_session_t ref_session;
+        rfc2217_session_init(&ref_session, nullptr);
+        REQUIRE(parse_reference(&ref_session, wire) == payload);
+        REQUIRE(parse_bulk(&session, wire) == payload);
+    }
+}
+
+// ============================================================================
+// Throughput benchmarks (hidden; run with: ./rfc2217_protocol_tests "[benchmark]")
+// ============================================================================
+
+TEST_CASE("RFC2217 Protocol - Escape Throughput", "[.][benchmark]")
+{
+    std::vector<uint8_t> in = make_payload(4096, 256);
+    std::vector<uint8_t> out(in.size() * 2);
+
+    BENCHMARK("escape 4KB (bulk)") {
+        return rfc2217_escape_data(in.data(), in.size(), out.data(), out.size());
+    };
+
+    BENCHMARK("escape 4KB (per-byte reference)") {
+        size_t j = 0;
+        for (size_t i = 0; i < in.size(); i++) {
+            out[j++] = in[i];
+            if (in[i] == TELNET_IAC) {
+                out[j++] = TELNET_IAC;
+            }
+        }
+        return j;
+    };
+
+    rfc2217_span_t spans[16];
+    BENCHMARK("escape 4KB (spans, no copy)") {
+        size_t total = 0;
+        size_t offset = 0;
+        while (offset < in.size()) {
+            size_t consumed = 0;
+            total += rfc2217_escape_spans(in.data() + offset, in.size() - offset, spans, 16, &consumed);
+            offset += consumed;
+        }
+        return total;
+    };
+}
+
+TEST_CASE("RFC2217 Protocol - Parse Throughput", "[.][benchmark]")
+{
+    std::vector<uint8_t> wire = escape_reference(make_payload(4096, 256));
+    std::vector<uint8_t> out(wire.size());
+    rfc2217_session_t session;
+    rfc2217_session_init(&session, nullptr);
+
+    BENCHMARK("parse 4KB (bulk)") {
+        size_t out_total = 0;
+        size_t offset = 0;
+        while (offset < wire.size()) {
+            size_t out_len = 0;
+            size_t consumed = 0;
+            rfc2217_parse_chunk(&session, wire.data() + offset, wire.size() - offset,
+                                out.data() + out_total, &out_len, &consumed);
+            offset += consumed;
+            out_total += out_len;
+        }
+        return out_total;
+    };
+
+    BENCHMARK("parse 4KB (per-byte parse_byte)") {
+        size_t out_total = 0;
+        for (uint8_t b : wire) {
+            size_t n = 0;
+            rfc2217_parse_byte(&session, b, out.data() + out_total, &n);
+            out_total += n;
+        }
+        return out_total;
+    };
+}
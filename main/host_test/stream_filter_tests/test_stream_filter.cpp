@@ -0,0 +1,442 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Data port pattern filter checked against naive strstr references, with
+ * the input split into chunks at random points
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "stream_filter.h"
+}
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+struct chunk_t {
+    size_t start;       // Offset in the whole text
+    size_t len;
+    int64_t time_us;
+};
+
+// Log-like text over a small alphabet so that random patterns match often,
+// with some lines longer than STREAM_FILTER_LINE_MAX
+static std::string make_text(std::mt19937 &rng, size_t total)
+{
+    static const char alphabet[] = "abcde \r";
+    std::string text;
+    while (text.size() < total) {
+        size_t n = rng() % 16 == 0 ? 200 + rng() % 400 : rng() % 80;
+        for (size_t i = 0; i < n; i++) {
+            text += alphabet[rng() % (sizeof(alphabet) - 1)];
+        }
+        text += '\n';
+    }
+    text.resize(total);
+    return text;
+}
+
+static std::vector<chunk_t> make_chunks(std::mt19937 &rng, size_t total, size_t max_chunk)
+{
+    std::vector<chunk_t> chunks;
+    int64_t t = 1000;
+    for (size_t pos = 0; pos < total;) {
+        size_t n = std::min<size_t>(1 + rng() % max_chunk, total - pos);
+        chunks.push_back({pos, n, t});
+        pos += n;
+        t += 1 + rng() % 100;
+    }
+    return chunks;
+}
+
+static std::vector<std::string> make_patterns(std::mt19937 &rng, int count)
+{
+    static const char alphabet[] = "abcde ";
+    std::vector<std::string> patterns;
+    for (int p = 0; p < count; p++) {
+        std::string s;
+        size_t n = 2 + rng() % 5;
+        for (size_t i = 0; i < n; i++) {
+            s += alphabet[rng() % (sizeof(alphabet) - 1)];
+        }
+        patterns.push_back(s);
+    }
+    return patterns;
+}
+
+static void compile_filter(stream_filter_t *sf, const std::vector<std::string> &patterns,
+                           stream_filter_mode_t mode, size_t post_context)
+{
+    stream_filter_init(sf);
+    for (const std::string &p : patterns) {
+        REQUIRE(stream_filter_add(sf, p.c_str()) == ESP_OK);
+    }
+    stream_filter_set_mode(sf, mode, 0, post_context);
+}
+
+// Whether a pattern ends at end (exclusive) without starting before begin
+static bool match_ends_at(const std::string &text, size_t begin, size_t end,
+                          const std::vector<std::string> &patterns)
+{
+    for (const std::string &p : patterns) {
+        if (end - begin >= p.size() && text.compare(end - p.size(), p.size(), p) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ============================================================================
+// LINES Reference
+// ============================================================================
+
+struct line_t {
+    int64_t time_us;
+    std::string text;
+
+    bool operator==(const line_t &other) const
+    {
+        return time_us == other.time_us && text == other.text;
+    }
+};
+
+// Complete lines that contain a pattern, cut to LINE_MAX - 1 bytes plus '\n'
+static std::vector<line_t> reference_lines(const std::string &text, const std::vector<chunk_t> &chunks,
+                                           const std::vector<std::string> &patterns)
+{
+    std::vector<line_t> lines;
+    size_t c = 0;
+    for (size_t pos = 0; pos < text.size();) {
+        size_t nl = text.find('\n', pos);
+        if (nl == std::string::npos) {
+            break;      // Unterminated, still held
+        }
+        std::string line = text.substr(pos, nl + 1 - pos);
+        bool matched = false;
+        for (const std::string &p : patterns) {
+            matched |= strstr(line.c_str(), p.c_str()) != nullptr;
+        }
+        if (matched) {
+            while (chunks[c].start + chunks[c].len <= pos) {
+                c++;
+            }
+            if (line.size() > STREAM_FILTER_LINE_MAX - 1) {
+                line = line.substr(0, STREAM_FILTER_LINE_MAX - 1) + "\n";
+            }
+            lines.push_back({chunks[c].time_us, line});
+        }
+        pos = nl + 1;
+    }
+    return lines;
+}
+
+static std::vector<line_t> run_lines(stream_filter_stream_t *st, const stream_filter_t *sf,
+                                     const std::string &text, const std::vector<chunk_t> &chunks)
+{
+    std::vector<line_t> lines;
+    for (const chunk_t &c : chunks) {
+        const uint8_t *in = reinterpret_cast<const uint8_t *>(text.data() + c.start);
+        for (size_t pos = 0; pos < c.len;) {
+            pos += stream_filter_lines(st, sf, in + pos, c.len - pos, c.time_us);
+            if (st->ready) {
+                lines.push_back({st->line_time_us, std::string(reinterpret_cast<char *>(st->line), st->line_len)});
+                st->line_sent = st->line_len;
+            } else {
+                REQUIRE(pos == c.len);
+            }
+        }
+    }
+    return lines;
+}
+
+// ============================================================================
+// TRIGGER Reference
+// ============================================================================
+
+/*
+ * Byte-by-byte model of a dump: it starts at the line of the first match
+ * and runs until the first line end at or after post_context bytes past
+ * the last match, or LINE_MAX bytes past that point. The line start is
+ * included when it was held (at most LINE_MAX bytes before the chunk of
+ * the match), otherwise the dump starts with that chunk.
+ */
+static std::string reference_trigger(const std::string &text, const std::vector<chunk_t> &chunks,
+                                     const std::vector<std::string> &patterns, size_t post_context,
+                                     uint64_t *dumps)
+{
+    std::string out;
+    size_t line_begin = 0;
+    size_t q = 0;
+    *dumps = 0;
+    while (q < text.size()) {
+        // Idle: find the first match
+        q++;
+        if (!match_ends_at(text, line_begin, q, patterns)) {
+            if (text[q - 1] == '\n') {
+                line_begin = q;
+            }
+            continue;
+        }
+
+        size_t c = 0;
+        while (chunks[c].start + chunks[c].len < q) {
+            c++;
+        }
+        size_t piece_begin = std::max(line_begin, chunks[c].start);
+        size_t dump_begin = piece_begin - line_begin <= STREAM_FILTER_LINE_MAX ? line_begin : piece_begin;
+        (*dumps)++;
+
+        // Passing: the byte that completed the match is already consumed
+        size_t pass_end = q + post_context;
+        for (;;) {
+            if (text[q - 1] == '\n') {
+                line_begin = q;
+                if (q >= pass_end) {
+                    break;
+                }
+            } else if (q >= pass_end && q - pass_end == STREAM_FILTER_LINE_MAX) {
+                line_begin = q;
+                break;
+            }
+            if (q == text.size()) {
+                break;
+            }
+            q++;
+            if (match_ends_at(text, line_begin, q, patterns)) {
+                pass_end = std::max(pass_end, q + post_context);
+            }
+        }
+        out += text.substr(dump_begin, q - dump_begin);
+    }
+    return out;
+}
+
+static std::string run_trigger(stream_filter_stream_t *st, const stream_filter_t *sf,
+                               const std::string &text, const std::vector<chunk_t> &chunks)
+{
+    std::string out;
+    for (const chunk_t &c : chunks) {
+        const char *in = text.data() + c.start;
+        for (size_t pos = 0; pos < c.len;) {
+            stream_filter_span_t span;
+            stream_filter_trigger(st, sf, reinterpret_cast<const uint8_t *>(in + pos), c.len - pos, &span);
+            REQUIRE(span.skip + span.pass > 0);
+            REQUIRE(span.skip + span.pass <= c.len - pos);
+            if (span.triggered && st->ready) {
+                out.append(reinterpret_cast<char *>(st->line), st->line_len);
+            }
+            out.append(in + pos + span.skip, span.pass);
+            pos += span.skip + span.pass;
+        }
+    }
+    return out;
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+TEST_CASE("Stream Filter - Pattern set", "[stream_filter]")
+{
+    stream_filter_t sf;
+    stream_filter_init(&sf);
+    REQUIRE(sf.mode == STREAM_FILTER_OFF);
+
+    SECTION("Invalid patterns") {
+        std::string too_long(STREAM_FILTER_PATTERN_MAX + 1, 'x');
+        REQUIRE(stream_filter_add(&sf, "") == ESP_ERR_INVALID_ARG);
+        REQUIRE(stream_filter_add(&sf, "a\nb") == ESP_ERR_INVALID_ARG);
+        REQUIRE(stream_filter_add(&sf, too_long.c_str()) == ESP_ERR_INVALID_ARG);
+        too_long.pop_back();
+        REQUIRE(stream_filter_add(&sf, too_long.c_str()) == ESP_OK);
+    }
+    SECTION("Too many patterns") {
+        for (int i = 0; i < STREAM_FILTER_MAX_PATTERNS; i++) {
+            std::string p = "p" + std::to_string(i);
+            REQUIRE(stream_filter_add(&sf, p.c_str()) == ESP_OK);
+        }
+        REQUIRE(stream_filter_add(&sf, "extra") == ESP_ERR_NO_MEM);
+        REQUIRE(sf.pattern_count == STREAM_FILTER_MAX_PATTERNS);
+    }
+    SECTION("Full automaton keeps the previous patterns") {
+        // Distinct bytes overflow the byte classes, long patterns the states
+        std::string classes;
+        for (int i = 0; i < STREAM_FILTER_MAX_CLASSES - 1; i++) {
+            classes += static_cast<char>('0' + i);
+        }
+        REQUIRE(stream_filter_add(&sf, classes.substr(0, 40).c_str()) == ESP_OK);
+        uint32_t generation = sf.generation;
+        REQUIRE(stream_filter_add(&sf, (classes.substr(40) + "~").c_str()) == ESP_ERR_NO_MEM);
+        REQUIRE(stream_filter_add(&sf, std::string(STREAM_FILTER_PATTERN_MAX, 'z').c_str()) == ESP_OK);
+        REQUIRE(stream_filter_add(&sf, std::string(STREAM_FILTER_PATTERN_MAX, 'y').c_str()) == ESP_ERR_NO_MEM);
+        REQUIRE(sf.pattern_count == 2);
+        REQUIRE(sf.generation == generation + 1);
+
+        uint8_t state = 0;
+        std::string text = "--" + classes.substr(0, 40);
+        REQUIRE(stream_filter_scan(&sf, &state, reinterpret_cast<const uint8_t *>(text.data()), text.size()) ==
+                text.size());
+        REQUIRE(sf.accept[state]);
+        state = 0;
+        text = std::string(STREAM_FILTER_PATTERN_MAX, 'y');
+        stream_filter_scan(&sf, &state, reinterpret_cast<const uint8_t *>(text.data()), text.size());
+        REQUIRE_FALSE(sf.accept[state]);
+    }
+    SECTION("Clear") {
+        REQUIRE(stream_filter_add(&sf, "abc") == ESP_OK);
+        stream_filter_set_mode(&sf, STREAM_FILTER_LINES, 0, 0);
+        stream_filter_clear(&sf);
+        REQUIRE(sf.pattern_count == 0);
+        REQUIRE(sf.mode == STREAM_FILTER_OFF);
+        uint8_t state = 0;
+        stream_filter_scan(&sf, &state, reinterpret_cast<const uint8_t *>("abc"), 3);
+        REQUIRE_FALSE(sf.accept[state]);
+    }
+}
+
+TEST_CASE("Stream Filter - Scan", "[stream_filter]")
+{
+    stream_filter_t sf;
+    compile_filter(&sf, {"he", "she", "his", "hers"}, STREAM_FILTER_LINES, 0);
+
+    // Overlapping patterns: scanning stops at the end of every match
+    const std::string text = "ushers";
+    const uint8_t *in = reinterpret_cast<const uint8_t *>(text.data());
+    uint8_t state = 0;
+    REQUIRE(stream_filter_scan(&sf, &state, in, text.size()) == 4);     // "she" and "he"
+    REQUIRE(sf.accept[state]);
+    REQUIRE(stream_filter_scan(&sf, &state, in + 4, text.size() - 4) == 2);   // "hers"
+    REQUIRE(sf.accept[state]);
+}
+
+TEST_CASE("Stream Filter - LINES against strstr", "[stream_filter]")
+{
+    size_t passed = 0;
+    for (unsigned seed = 1; seed <= 40; seed++) {
+        std::mt19937 rng(seed);
+        std::string text = make_text(rng, 30000);
+        std::vector<chunk_t> chunks = make_chunks(rng, text.size(), seed % 2 ? 8 : 600);
+        std::vector<std::string> patterns = make_patterns(rng, 1 + seed % STREAM_FILTER_MAX_PATTERNS);
+
+        stream_filter_t sf;
+        compile_filter(&sf, patterns, STREAM_FILTER_LINES, 0);
+        stream_filter_stream_t st;
+        stream_filter_stream_init(&st, &sf);
+
+        std::vector<line_t> expected = reference_lines(text, chunks, patterns);
+        INFO("seed " << seed);
+        REQUIRE(run_lines(&st, &sf, text, chunks) == expected);
+        REQUIRE(st.matches == expected.size());
+        passed += expected.size();
+        REQUIRE(st.in_bytes == text.size());
+    }
+    REQUIRE(passed > 1000);
+}
+
+TEST_CASE("Stream Filter - TRIGGER against a reference", "[stream_filter]")
+{
+    for (unsigned seed = 1; seed <= 40; seed++) {
+        std::mt19937 rng(seed);
+        std::string text = make_text(rng, 30000);
+        std::vector<chunk_t> chunks = make_chunks(rng, text.size(), seed % 2 ? 8 : 600);
+        // A rare pattern and a short post-context, so dumps end and restart;
+        // longer ones run into the LINE_MAX bound
+        std::vector<std::string> patterns = {std::string(1, 'a' + seed % 5) + "eee"[seed % 3] + "dc"};
+        size_t post_context = seed % 4 == 0 ? 0 : rng() % (seed % 3 ? 40 : 1000);
+
+        stream_filter_t sf;
+        compile_filter(&sf, patterns, STREAM_FILTER_TRIGGER, post_context);
+        stream_filter_stream_t st;
+        stream_filter_stream_init(&st, &sf);
+
+        uint64_t dumps = 0;
+        std::string expected = reference_trigger(text, chunks, patterns, post_context, &dumps);
+        INFO("seed " << seed << ", post-context " << post_context);
+        REQUIRE(run_trigger(&st, &sf, text, chunks) == expected);
+        REQUIRE(st.matches == dumps);
+        REQUIRE(dumps > 2);
+        REQUIRE(st.out_bytes == expected.size());
+        REQUIRE(st.in_bytes == text.size());
+    }
+}
+
+TEST_CASE("Stream Filter - TRIGGER window", "[stream_filter]")
+{
+    stream_filter_t sf;
+    stream_filter_stream_t st;
+    std::vector<chunk_t> whole;
+
+    SECTION("Matching line only") {
+        compile_filter(&sf, {"ERR"}, STREAM_FILTER_TRIGGER, 0);
+        stream_filter_stream_init(&st, &sf);
+        std::string text = "ok\nan ERR here\nok\n";
+        whole = {{0, text.size(), 0}};
+        REQUIRE(run_trigger(&st, &sf, text, whole) == "an ERR here\n");
+    }
+    SECTION("Post-context runs to the end of its line") {
+        compile_filter(&sf, {"ERR"}, STREAM_FILTER_TRIGGER, 5);
+        stream_filter_stream_init(&st, &sf);
+        std::string text = "ERR!\nnext line\nlast\n";
+        whole = {{0, text.size(), 0}};
+        REQUIRE(run_trigger(&st, &sf, text, whole) == "ERR!\nnext line\n");
+
+        // Ending exactly at a newline does not take the next line
+        stream_filter_stream_init(&st, &sf);
+        text = "ERR\nabcd\nlast\n";
+        REQUIRE(run_trigger(&st, &sf, text, whole) == "ERR\nabcd\n");
+    }
+    SECTION("Overrun without a line end") {
+        compile_filter(&sf, {"ERR"}, STREAM_FILTER_TRIGGER, 10);
+        stream_filter_stream_init(&st, &sf);
+        std::string text = "xERR" + std::string(1000, '.');
+        std::string expected = text.substr(0, 4 + 10 + STREAM_FILTER_LINE_MAX);
+        whole = {{0, text.size(), 0}};
+        REQUIRE(run_trigger(&st, &sf, text, whole) == expected);
+
+        // The same bound when the input arrives byte by byte
+        stream_filter_stream_init(&st, &sf);
+        std::vector<chunk_t> bytes;
+        for (size_t i = 0; i < text.size(); i++) {
+            bytes.push_back({i, 1, 0});
+        }
+        REQUIRE(run_trigger(&st, &sf, text, bytes) == expected);
+    }
+    SECTION("Matches extend the dump") {
+        compile_filter(&sf, {"ERR"}, STREAM_FILTER_TRIGGER, 3);
+        stream_filter_stream_init(&st, &sf);
+        std::string text = "ERR\nERR\nok\nx\nERR\nok\ny\n";
+        whole = {{0, text.size(), 0}};
+        REQUIRE(run_trigger(&st, &sf, text, whole) == "ERR\nERR\nok\nERR\nok\n");
+        REQUIRE(st.matches == 2);
+        REQUIRE_FALSE(st.passing);
+    }
+    SECTION("Held line start") {
+        compile_filter(&sf, {"ERR"}, STREAM_FILTER_TRIGGER, 0);
+        stream_filter_stream_init(&st, &sf);
+        // "ER" | "R" splits the pattern, "start of " was held in an earlier call
+        std::string text = "old\nstart of ER" "R line\nok\n";
+        std::vector<chunk_t> chunks = {{0, 7, 0}, {7, 8, 0}, {15, text.size() - 15, 0}};
+        REQUIRE(run_trigger(&st, &sf, text, chunks) == "start of ERR line\n");
+
+        // A start longer than LINE_MAX is dropped, the dump starts with the chunk
+        stream_filter_stream_init(&st, &sf);
+        std::string start(STREAM_FILTER_LINE_MAX + 1, '.');
+        text = start + "ERR\n";
+        chunks = {{0, start.size(), 0}, {start.size(), 4, 0}};
+        REQUIRE(run_trigger(&st, &sf, text, chunks) == "ERR\n");
+
+        stream_filter_stream_init(&st, &sf);
+        start.pop_back();
+        text = start + "ERR\n";
+        chunks = {{0, start.size(), 0}, {start.size(), 4, 0}};
+        REQUIRE(run_trigger(&st, &sf, text, chunks) == text);
+    }
+}
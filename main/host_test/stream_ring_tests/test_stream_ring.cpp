@@ -0,0 +1,279 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * USB to TCP stream ring: wraparound, split spans, per-sink cursors and
+ * the full / empty boundaries, checked against a std::deque reference
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <vector>
+
+// stream_ring.h has its own extern "C" guard; <stdatomic.h> must stay outside it
+#include "stream_ring.h"
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static constexpr size_t RING_SIZE = 64;
+
+struct ring_fixture_t {
+    uint8_t storage[RING_SIZE];
+    stream_ring_t ring;
+
+    ring_fixture_t()
+    {
+        REQUIRE(stream_ring_init(&ring, storage, sizeof(storage)) == ESP_OK);
+    }
+};
+
+static std::vector<uint8_t> make_bytes(size_t len, uint8_t first)
+{
+    std::vector<uint8_t> bytes(len);
+    for (size_t i = 0; i < len; i++) {
+        bytes[i] = (uint8_t)(first + i);
+    }
+    return bytes;
+}
+
+// Everything readable from pos, joining the spans across the wrap
+static std::vector<uint8_t> read_from(stream_ring_t *ring, size_t pos)
+{
+    std::vector<uint8_t> out;
+    const uint8_t *data;
+    size_t len;
+    while ((len = stream_ring_peek_from(ring, pos, &data)) > 0) {
+        out.insert(out.end(), data, data + len);
+        pos += len;
+    }
+    return out;
+}
+
+// ============================================================================
+// Initialization
+// ============================================================================
+
+TEST_CASE("Init rejects bad arguments", "[stream_ring]")
+{
+    uint8_t storage[RING_SIZE];
+    stream_ring_t ring;
+
+    CHECK(stream_ring_init(nullptr, storage, sizeof(storage)) == ESP_ERR_INVALID_ARG);
+    CHECK(stream_ring_init(&ring, nullptr, sizeof(storage)) == ESP_ERR_INVALID_ARG);
+    CHECK(stream_ring_init(&ring, storage, 0) == ESP_ERR_INVALID_SIZE);
+    CHECK(stream_ring_init(&ring, storage, 48) == ESP_ERR_INVALID_SIZE);
+    CHECK(stream_ring_init(&ring, storage, sizeof(storage)) == ESP_OK);
+}
+
+// ============================================================================
+// Full / Empty Boundaries
+// ============================================================================
+
+TEST_CASE("Empty ring has nothing to peek", "[stream_ring]")
+{
+    ring_fixture_t f;
+    const uint8_t *data = nullptr;
+
+    CHECK(stream_ring_used(&f.ring) == 0);
+    CHECK(stream_ring_free(&f.ring) == RING_SIZE);
+    CHECK(stream_ring_peek(&f.ring, &data) == 0);
+    CHECK(stream_ring_peek_from(&f.ring, stream_ring_head(&f.ring), &data) == 0);
+}
+
+TEST_CASE("Write stops at full and resumes after consume", "[stream_ring]")
+{
+    ring_fixture_t f;
+    auto bytes = make_bytes(RING_SIZE + 10, 0);
+
+    CHECK(stream_ring_write(&f.ring, bytes.data(), bytes.size()) == RING_SIZE);
+    CHECK(stream_ring_used(&f.ring) == RING_SIZE);
+    CHECK(stream_ring_free(&f.ring) == 0);
+    CHECK(stream_ring_write(&f.ring, bytes.data(), 1) == 0);
+
+    // A full ring is one span covering the whole storage
+    const uint8_t *data;
+    REQUIRE(stream_ring_peek(&f.ring, &data) == RING_SIZE);
+    CHECK(std::memcmp(data, bytes.data(), RING_SIZE) == 0);
+
+    stream_ring_consume(&f.ring, 1);
+    CHECK(stream_ring_free(&f.ring) == 1);
+    CHECK(stream_ring_write(&f.ring, bytes.data() + RING_SIZE, 10) == 1);
+    CHECK(stream_ring_free(&f.ring) == 0);
+
+    // Drain to empty
+    stream_ring_consume(&f.ring, RING_SIZE);
+    CHECK(stream_ring_used(&f.ring) == 0);
+    CHECK(stream_ring_peek(&f.ring, &data) == 0);
+}
+
+TEST_CASE("Reset discards buffered data", "[stream_ring]")
+{
+    ring_fixture_t f;
+    auto bytes = make_bytes(20, 0);
+
+    stream_ring_write(&f.ring, bytes.data(), bytes.size());
+    stream_ring_reset(&f.ring);
+    CHECK(stream_ring_used(&f.ring) == 0);
+    CHECK(stream_ring_head(&f.ring) == 0);
+}
+
+// ============================================================================
+// Wraparound
+// ============================================================================
+
+TEST_CASE("Write wraps at the end of storage", "[stream_ring]")
+{
+    ring_fixture_t f;
+    auto first = make_bytes(50, 0);
+    auto second = make_bytes(40, 100);
+
+    stream_ring_write(&f.ring, first.data(), first.size());
+    stream_ring_consume(&f.ring, first.size());
+
+    // 14 bytes up to the end of storage, 26 from the start
+    REQUIRE(stream_ring_write(&f.ring, second.data(), second.size()) == second.size());
+    CHECK(std::memcmp(f.storage + 50, second.data(), 14) == 0);
+    CHECK(std::memcmp(f.storage, second.data() + 14, 26) == 0);
+}
+
+TEST_CASE("Peek splits a wrapped span and consume moves to the remainder", "[stream_ring]")
+{
+    ring_fixture_t f;
+    auto first = make_bytes(50, 0);
+    auto second = make_bytes(40, 100);
+
+    stream_ring_write(&f.ring, first.data(), first.size());
+    stream_ring_consume(&f.ring, first.size());
+    stream_ring_write(&f.ring, second.data(), second.size());
+
+    const uint8_t *data;
+    REQUIRE(stream_ring_peek(&f.ring, &data) == 14);
+    CHECK(data == f.storage + 50);
+    CHECK(std::memcmp(data, second.data(), 14) == 0);
+
+    // Partial consume keeps the rest of the first span
+    stream_ring_consume(&f.ring, 4);
+    REQUIRE(stream_ring_peek(&f.ring, &data) == 10);
+    CHECK(std::memcmp(data, second.data() + 4, 10) == 0);
+
+    stream_ring_consume(&f.ring, 10);
+    REQUIRE(stream_ring_peek(&f.ring, &data) == 26);
+    CHECK(data == f.storage);
+    CHECK(std::memcmp(data, second.data() + 14, 26) == 0);
+
+    stream_ring_consume(&f.ring, 26);
+    CHECK(stream_ring_peek(&f.ring, &data) == 0);
+}
+
+TEST_CASE("Random writes and reads match a reference queue", "[stream_ring]")
+{
+    ring_fixture_t f;
+    std::mt19937 rng(1234);
+    std::deque<uint8_t> expected;
+    uint8_t next = 0;
+
+    for (int step = 0; step < 20000; step++) {
+        if (rng() % 2) {
+            std::vector<uint8_t> chunk(rng() % (RING_SIZE + 8));
+            for (auto &b : chunk) {
+                b = next++;
+            }
+            size_t written = stream_ring_write(&f.ring, chunk.data(), chunk.size());
+            REQUIRE(written == std::min(chunk.size(), RING_SIZE - expected.size()));
+            next = (uint8_t)(next - (chunk.size() - written));
+            expected.insert(expected.end(), chunk.begin(), chunk.begin() + written);
+        } else {
+            const uint8_t *data;
+            size_t len = stream_ring_peek(&f.ring, &data);
+            REQUIRE(len <= expected.size());
+            REQUIRE((len > 0 || expected.empty()));
+            size_t take = len == 0 ? 0 : rng() % (len + 1);
+            for (size_t i = 0; i < take; i++) {
+                REQUIRE(data[i] == expected.front());
+                expected.pop_front();
+            }
+            stream_ring_consume(&f.ring, take);
+        }
+        REQUIRE(stream_ring_used(&f.ring) == expected.size());
+    }
+}
+
+// ============================================================================
+// Per-Sink Cursors
+// ============================================================================
+
+TEST_CASE("Sinks read independently from their own cursors", "[stream_ring]")
+{
+    ring_fixture_t f;
+    auto bytes = make_bytes(30, 0);
+    stream_ring_write(&f.ring, bytes.data(), bytes.size());
+
+    size_t fast = 0;
+    size_t slow = 0;
+    const uint8_t *data;
+
+    REQUIRE(stream_ring_peek_from(&f.ring, fast, &data) == 30);
+    fast += 30;
+    REQUIRE(stream_ring_peek_from(&f.ring, slow, &data) == 30);
+    slow += 10;
+
+    CHECK(stream_ring_peek_from(&f.ring, fast, &data) == 0);
+    REQUIRE(stream_ring_peek_from(&f.ring, slow, &data) == 20);
+    CHECK(std::memcmp(data, bytes.data() + 10, 20) == 0);
+}
+
+TEST_CASE("The slowest sink decides the free space", "[stream_ring]")
+{
+    ring_fixture_t f;
+    auto bytes = make_bytes(RING_SIZE, 0);
+    stream_ring_write(&f.ring, bytes.data(), bytes.size());
+
+    size_t cursors[3] = {RING_SIZE, 40, 12};
+    stream_ring_consume_to(&f.ring, *std::min_element(cursors, cursors + 3));
+    CHECK(stream_ring_free(&f.ring) == 12);
+
+    // Only the space before the slowest cursor may be reused; the lagging
+    // sink still sees its unread data intact
+    auto more = make_bytes(20, 200);
+    REQUIRE(stream_ring_write(&f.ring, more.data(), more.size()) == 12);
+    CHECK(stream_ring_free(&f.ring) == 0);
+    auto unread = read_from(&f.ring, cursors[2]);
+    REQUIRE(unread.size() == RING_SIZE);
+    CHECK(std::memcmp(unread.data(), bytes.data() + 12, RING_SIZE - 12) == 0);
+    CHECK(std::memcmp(unread.data() + RING_SIZE - 12, more.data(), 12) == 0);
+
+    // Once the slow sink catches up the next slowest decides
+    cursors[2] = stream_ring_head(&f.ring);
+    stream_ring_consume_to(&f.ring, *std::min_element(cursors, cursors + 3));
+    CHECK(stream_ring_free(&f.ring) == RING_SIZE - (stream_ring_head(&f.ring) - cursors[1]));
+}
+
+TEST_CASE("Cursor spans split across the wrap", "[stream_ring]")
+{
+    ring_fixture_t f;
+    auto first = make_bytes(60, 0);
+    stream_ring_write(&f.ring, first.data(), first.size());
+
+    // The sink has read up to 58, so new data wraps while it lags behind
+    size_t pos = 58;
+    stream_ring_consume_to(&f.ring, pos);
+    auto second = make_bytes(20, 100);
+    REQUIRE(stream_ring_write(&f.ring, second.data(), second.size()) == second.size());
+
+    const uint8_t *data;
+    REQUIRE(stream_ring_peek_from(&f.ring, pos, &data) == 6);
+    CHECK(data == f.storage + 58);
+    pos += 6;
+    REQUIRE(stream_ring_peek_from(&f.ring, pos, &data) == 16);
+    CHECK(data == f.storage);
+    CHECK(std::memcmp(data, second.data() + 4, 16) == 0);
+    pos += 16;
+    CHECK(stream_ring_peek_from(&f.ring, pos, &data) == 0);
+    CHECK(pos == stream_ring_head(&f.ring));
+}
@@ -0,0 +1,184 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Line-aware timestamp framing for the raw data port
+ */
+
+#include "line_framer.h"
+
+#include <string.h>
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static inline void put_le(uint8_t *p, uint64_t v, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+// "[<seconds>.<microseconds>] ", seconds at least 5 digits wide like dmesg
+static size_t format_prefix(uint8_t *out, int64_t time_us)
+{
+    uint64_t t = time_us > 0 ? (uint64_t)time_us : 0;
+    uint32_t frac = (uint32_t)(t % 1000000);
+    uint64_t sec = t / 1000000;
+
+    char digits[20];
+    size_t n = 0;
+    do {
+        digits[n++] = (char)('0' + sec % 10);
+        sec /= 10;
+    } while (sec > 0);
+
+    uint8_t *o = out;
+    *o++ = '[';
+    for (size_t pad = n; pad < 5; pad++) {
+        *o++ = ' ';
+    }
+    while (n > 0) {
+        *o++ = (uint8_t)digits[--n];
+    }
+    *o++ = '.';
+    for (int i = 5; i >= 0; i--) {
+        o[i] = (uint8_t)('0' + frac % 10);
+        frac /= 10;
+    }
+    o += 6;
+    *o++ = ']';
+    *o++ = ' ';
+    return (size_t)(o - out);
+}
+
+// Length of the line piece starting at in: up to and including '\n'
+static inline size_t line_piece(const uint8_t *in, size_t len, bool *ends_line)
+{
+    const uint8_t *nl = memchr(in, '\n', len);
+    *ends_line = nl != NULL;
+    return nl != NULL ? (size_t)(nl - in) + 1 : len;
+}
+
+static size_t encode_text(line_framer_t *lf, const uint8_t *in, size_t len, int64_t time_us,
+                          uint8_t *out, size_t out_space, size_t *consumed)
+{
+    uint8_t prefix[LINE_FRAMER_PREFIX_MAX];
+    size_t prefix_len = 0;
+    size_t i = 0;
+    size_t o = 0;
+
+    while (i < len) {
+        if (lf->line_start) {
+            // All lines of one call share the prefix
+            if (prefix_len == 0) {
+                prefix_len = format_prefix(prefix, time_us);
+            }
+            if (out_space - o <= prefix_len) {
+                break;
+            }
+            memcpy(out + o, prefix, prefix_len);
+            o += prefix_len;
+            lf->line_start = false;
+            lf->lines++;
+        }
+
+        bool ends_line;
+        size_t n = line_piece(in + i, len - i, &ends_line);
+        if (n > out_space - o) {
+            n = out_space - o;
+            ends_line = false;
+        }
+        if (n == 0) {
+            break;
+        }
+        memcpy(out + o, in + i, n);
+        o += n;
+        i += n;
+        lf->line_start = ends_line;
+    }
+
+    *consumed = i;
+    return o;
+}
+
+static size_t encode_binary(line_framer_t *lf, const uint8_t *in, size_t len, int64_t time_us,
+                            uint8_t *out, size_t out_space, size_t *consumed)
+{
+    uint64_t stamp = time_us > 0 ? (uint64_t)time_us : 0;
+    size_t i = 0;
+    size_t o = 0;
+
+    while (i < len && out_space - o > LINE_FRAMER_RECORD_HEADER) {
+        bool ends_line;
+        size_t n = line_piece(in + i, len - i, &ends_line);
+        size_t room = out_space - o - LINE_FRAMER_RECORD_HEADER;
+        if (room > LINE_FRAMER_LEN_MASK) {
+            room = LINE_FRAMER_LEN_MASK;
+        }
+        if (n > room) {
+            n = room;
+            ends_line = false;
+        }
+
+        uint16_t len_flags = (uint16_t)n;
+        if (lf->line_start) {
+            lf->lines++;
+        } else {
+            len_flags |= LINE_FRAMER_CONTINUED;
+        }
+        put_le(out + o, len_flags, 2);
+        put_le(out + o + 2, stamp, 6);
+        memcpy(out + o + LINE_FRAMER_RECORD_HEADER, in + i, n);
+        o += LINE_FRAMER_RECORD_HEADER + n;
+        i += n;
+        lf->line_start = ends_line;
+    }
+
+    *consumed = i;
+    return o;
+}
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+void line_framer_reset(line_framer_t *lf, line_framer_format_t format)
+{
+    lf->format = format;
+    lf->line_start = true;
+    lf->lines = 0;
+    lf->in_bytes = 0;
+    lf->out_bytes = 0;
+}
+
+size_t line_framer_header(line_framer_t *lf, int64_t now_us, uint8_t *out)
+{
+    if (lf->format != LINE_FRAMER_BINARY) {
+        return 0;
+    }
+
+    memcpy(out, LINE_FRAMER_MAGIC, 4);
+    out[4] = LINE_FRAMER_VERSION;
+    out[5] = 0;
+    out[6] = 0;
+    out[7] = 0;
+    put_le(out + 8, now_us > 0 ? (uint64_t)now_us : 0, 8);
+    lf->out_bytes += LINE_FRAMER_HEADER_SIZE;
+    return LINE_FRAMER_HEADER_SIZE;
+}
+
+size_t line_framer_encode(line_framer_t *lf, const uint8_t *in, size_t len, int64_t time_us,
+                          uint8_t *out, size_t out_space, size_t *consumed)
+{
+    size_t out_len;
+    if (lf->format == LINE_FRAMER_BINARY) {
+        out_len = encode_binary(lf, in, len, time_us, out, out_space, consumed);
+    } else {
+        out_len = encode_text(lf, in, len, time_us, out, out_space, consumed);
+    }
+    lf->in_bytes += *consumed;
+    lf->out_bytes += out_len;
+    return out_len;
+}
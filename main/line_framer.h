@@ -0,0 +1,114 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Line-aware timestamp framing for the raw data port
+ *
+ * Splits the USB stream at '\n' and tags each line with the arrival time
+ * of its first byte. Two output formats:
+ *
+ * Text: every line starts with "[<seconds>.<microseconds>] ", the time
+ * since boot, like the kernel log. Everything else passes unchanged.
+ *
+ * Binary: a 16-byte stream header ("SLTS", version, reserved, u64 time
+ * since boot in microseconds at connect), followed by records of
+ *   u16 len_flags, u48 time_us (little endian), payload (len bytes)
+ * A record carries at most one line. Data that is sent before its line is
+ * complete becomes a fragment; a record whose LINE_FRAMER_CONTINUED flag is
+ * set continues the line of the previous record. time_us is the arrival
+ * time of the record's first byte.
+ *
+ * Lines are found with memchr() over whole spans, so the cost is per line
+ * and not per byte. State is a small struct owned by the caller, so the
+ * module has no allocator or RTOS dependencies. One state per stream,
+ * single-threaded.
+ */
+
+#ifndef LINE_FRAMER_H
+#define LINE_FRAMER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Format
+// ============================================================================
+
+#define LINE_FRAMER_MAGIC               "SLTS"
+#define LINE_FRAMER_VERSION             1
+#define LINE_FRAMER_HEADER_SIZE         16      // Magic, version, reserved (3), u64 time_us
+#define LINE_FRAMER_RECORD_HEADER       8       // u16 len_flags, u48 time_us
+
+#define LINE_FRAMER_LEN_MASK            0x3fff  // Payload length bits of len_flags
+#define LINE_FRAMER_CONTINUED           0x8000  // Record continues the previous line
+
+#define LINE_FRAMER_PREFIX_MAX          32      // Longest text prefix
+
+typedef enum {
+    LINE_FRAMER_NONE = 0,       // Raw stream (framer unused)
+    LINE_FRAMER_TEXT,           // Timestamp prefix per line
+    LINE_FRAMER_BINARY,         // Length and timestamp record per line
+} line_framer_format_t;
+
+// ============================================================================
+// State
+// ============================================================================
+
+typedef struct {
+    line_framer_format_t format;
+    bool line_start;            // The next byte starts a line
+    uint64_t lines;             // Lines started
+    uint64_t in_bytes;          // Total input
+    uint64_t out_bytes;         // Total output including headers
+} line_framer_t;
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+/**
+ * @brief Start a new stream
+ *
+ * @param lf Framer state
+ * @param format LINE_FRAMER_TEXT or LINE_FRAMER_BINARY
+ */
+void line_framer_reset(line_framer_t *lf, line_framer_format_t format);
+
+/**
+ * @brief Write the stream header
+ *
+ * @param lf Framer state
+ * @param now_us Current time since boot in microseconds
+ * @param[out] out Buffer of LINE_FRAMER_HEADER_SIZE bytes
+ * @return Header length (0 for the text format, which has none)
+ */
+size_t line_framer_header(line_framer_t *lf, int64_t now_us, uint8_t *out);
+
+/**
+ * @brief Frame data that shares one arrival time
+ *
+ * Only complete prefixes and records are written, so the output never
+ * ends inside a frame header.
+ *
+ * @param lf Framer state
+ * @param in Input data
+ * @param len Input length in bytes
+ * @param time_us Arrival time of every byte of in
+ * @param[out] out Output buffer
+ * @param out_space Size of out in bytes
+ * @param[out] consumed Input bytes framed
+ * @return Output length in bytes
+ */
+size_t line_framer_encode(line_framer_t *lf, const uint8_t *in, size_t len, int64_t time_us,
+                          uint8_t *out, size_t out_space, size_t *consumed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LINE_FRAMER_H
@@ -0,0 +1,393 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Persistent spooling of the USB RX stream to the "log" flash partition
+ */
+
+#include "log_spool.h"
+
+#include <string.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include "stream_ring.h"
+#include "metrics.h"
+
+static const char *TAG = "log_spool";
+
+#define LOG_SPOOL_PARTITION_LABEL   "log"
+#define LOG_SPOOL_TASK_STACK        3072
+#define LOG_SPOOL_TASK_PRIORITY     2
+#define LOG_SPOOL_MAX_PAYLOAD       1024        // Longer data is split into several records
+#define LOG_SPOOL_MMAP_WINDOW       (64 * 1024) // Mapped per step when reading
+
+#define LOG_SPOOL_DATA_CAPACITY     (LOG_SPOOL_SECTOR_SIZE - sizeof(log_spool_sector_header_t))
+
+#ifndef CONFIG_LOG_SPOOL_QUEUE_SIZE_KB
+#define CONFIG_LOG_SPOOL_QUEUE_SIZE_KB      32
+#endif
+#ifndef CONFIG_LOG_SPOOL_FLUSH_INTERVAL_S
+#define CONFIG_LOG_SPOOL_FLUSH_INTERVAL_S   30
+#endif
+
+// ============================================================================
+// State
+// ============================================================================
+
+typedef struct {
+    const esp_partition_t *partition;
+    uint32_t sector_count;
+    uint16_t boot;                      // Boot counter written to every sector
+
+    // Network loop → spool task; entries are record header + payload
+    stream_ring_t queue;
+    uint8_t *queue_storage;
+    TaskHandle_t task;
+
+    // Owned by the spool task
+    uint8_t sector[LOG_SPOOL_SECTOR_SIZE];
+    size_t sector_len;                  // Record bytes in sector
+    int64_t sector_started_us;          // When the first record of sector arrived
+
+    _Atomic uint32_t write_seq;         // Sequence number of the next sector to write
+    atomic_bool flush_requested;
+    bool running;
+} log_spool_state_t;
+
+static log_spool_state_t s_spool;
+
+// Record staging for log_spool_append(); only the network loop appends
+static uint8_t s_record[sizeof(log_spool_record_header_t) + LOG_SPOOL_MAX_PAYLOAD];
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static inline uint32_t sector_offset(uint32_t seq)
+{
+    return (seq % s_spool.sector_count) * LOG_SPOOL_SECTOR_SIZE;
+}
+
+static inline uint32_t oldest_seq(uint32_t write_seq)
+{
+    return write_seq > s_spool.sector_count ? write_seq - s_spool.sector_count : 0;
+}
+
+static bool header_valid(const log_spool_sector_header_t *header)
+{
+    return header->magic == LOG_SPOOL_MAGIC &&
+           header->version == LOG_SPOOL_VERSION &&
+           header->data_len <= LOG_SPOOL_DATA_CAPACITY;
+}
+
+static void queue_copy(size_t pos, uint8_t *dst, size_t len)
+{
+    while (len > 0) {
+        const uint8_t *span;
+        size_t n = stream_ring_peek_from(&s_spool.queue, pos, &span);
+        if (n > len) {
+            n = len;
+        }
+        memcpy(dst, span, n);
+        dst += n;
+        pos += n;
+        len -= n;
+    }
+}
+
+// Find the newest sector and continue after it
+static void recover_position(void)
+{
+    bool found = false;
+    uint32_t newest_seq = 0;
+    uint16_t newest_boot = 0;
+
+    for (uint32_t i = 0; i < s_spool.sector_count; i++) {
+        log_spool_sector_header_t header;
+        if (esp_partition_read(s_spool.partition, i * LOG_SPOOL_SECTOR_SIZE,
+                               &header, sizeof(header)) != ESP_OK) {
+            continue;
+        }
+        // Sector i only ever holds sequence numbers congruent to i
+        if (!header_valid(&header) || header.seq % s_spool.sector_count != i) {
+            continue;
+        }
+        if (!found || header.seq > newest_seq) {
+            found = true;
+            newest_seq = header.seq;
+            newest_boot = header.boot;
+        }
+    }
+
+    atomic_store(&s_spool.write_seq, found ? newest_seq + 1 : 0);
+    s_spool.boot = found ? newest_boot + 1 : 0;
+}
+
+static void write_sector(void)
+{
+    if (s_spool.sector_len == 0) {
+        return;
+    }
+
+    uint32_t seq = atomic_load(&s_spool.write_seq);
+    uint32_t offset = sector_offset(seq);
+    log_spool_sector_header_t header = {
+        .magic = LOG_SPOOL_MAGIC,
+        .seq = seq,
+        .version = LOG_SPOOL_VERSION,
+        .boot = s_spool.boot,
+        .data_len = (uint16_t)s_spool.sector_len,
+        .reserved = 0,
+        .crc32 = esp_rom_crc32_le(0, s_spool.sector + sizeof(header), s_spool.sector_len),
+    };
+    memcpy(s_spool.sector, &header, sizeof(header));
+
+    // The sector being replaced is the oldest; readers see it go via write_seq
+    atomic_store(&s_spool.write_seq, seq + 1);
+
+    // Records first, header last: a valid header implies complete records
+    esp_err_t ret = esp_partition_erase_range(s_spool.partition, offset, LOG_SPOOL_SECTOR_SIZE);
+    if (ret == ESP_OK) {
+        ret = esp_partition_write(s_spool.partition, offset + sizeof(header),
+                                  s_spool.sector + sizeof(header), s_spool.sector_len);
+    }
+    if (ret == ESP_OK) {
+        ret = esp_partition_write(s_spool.partition, offset, &header, sizeof(header));
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to write sector %lu: %s", (unsigned long)seq, esp_err_to_name(ret));
+    }
+
+    s_spool.sector_len = 0;
+}
+
+// Move queued records into the RAM sector, writing it out when full
+static void drain_queue(void)
+{
+    const size_t header_size = sizeof(log_spool_record_header_t);
+
+    // Records are queued with a single write, so a visible header means a complete record
+    while (stream_ring_used(&s_spool.queue) >= header_size) {
+        size_t pos = atomic_load(&s_spool.queue.tail);
+        log_spool_record_header_t record;
+        queue_copy(pos, (uint8_t *)&record, header_size);
+        size_t total = header_size + record.len;
+
+        if (s_spool.sector_len + total > LOG_SPOOL_DATA_CAPACITY) {
+            write_sector();
+        }
+        if (s_spool.sector_len == 0) {
+            s_spool.sector_started_us = esp_timer_get_time();
+        }
+        queue_copy(pos, s_spool.sector + sizeof(log_spool_sector_header_t) + s_spool.sector_len, total);
+        s_spool.sector_len += total;
+        stream_ring_consume(&s_spool.queue, total);
+    }
+}
+
+static void log_spool_task(void *arg)
+{
+    const int64_t flush_interval_us = (int64_t)CONFIG_LOG_SPOOL_FLUSH_INTERVAL_S * 1000000;
+
+    while (1) {
+        TickType_t wait = portMAX_DELAY;
+        if (s_spool.sector_len > 0) {
+            int64_t remaining_us = s_spool.sector_started_us + flush_interval_us - esp_timer_get_time();
+            wait = remaining_us > 0 ? pdMS_TO_TICKS(remaining_us / 1000) + 1 : 0;
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        drain_queue();
+
+        bool flush = atomic_exchange(&s_spool.flush_requested, false);
+        if (s_spool.sector_len > 0 &&
+            (flush || esp_timer_get_time() - s_spool.sector_started_us >= flush_interval_us)) {
+            write_sector();
+        }
+    }
+}
+
+static esp_err_t map_window(log_spool_iter_t *iter, uint32_t offset)
+{
+    uint32_t window_offset = offset - offset % LOG_SPOOL_MMAP_WINDOW;
+    if (iter->window != NULL && iter->window_offset == window_offset) {
+        return ESP_OK;
+    }
+    log_spool_iter_end(iter);
+
+    uint32_t size = s_spool.partition->size - window_offset;
+    if (size > LOG_SPOOL_MMAP_WINDOW) {
+        size = LOG_SPOOL_MMAP_WINDOW;
+    }
+    const void *ptr;
+    esp_partition_mmap_handle_t handle;
+    esp_err_t ret = esp_partition_mmap(s_spool.partition, window_offset, size,
+                                       ESP_PARTITION_MMAP_DATA, &ptr, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    iter->window = ptr;
+    iter->window_offset = window_offset;
+    iter->window_size = size;
+    iter->mmap_handle = handle;
+    return ESP_OK;
+}
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+esp_err_t log_spool_init(void)
+{
+    if (s_spool.running) {
+        return ESP_OK;
+    }
+
+    s_spool.partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                 LOG_SPOOL_PARTITION_LABEL);
+    if (s_spool.partition == NULL) {
+        ESP_LOGW(TAG, "No \"%s\" partition, spooling disabled", LOG_SPOOL_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+    s_spool.sector_count = s_spool.partition->size / LOG_SPOOL_SECTOR_SIZE;
+    if (s_spool.sector_count < 2) {
+        ESP_LOGW(TAG, "Partition too small");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    size_t queue_size = 1;
+    while (queue_size * 2 <= (size_t)CONFIG_LOG_SPOOL_QUEUE_SIZE_KB * 1024) {
+        queue_size *= 2;
+    }
+    s_spool.queue_storage = heap_caps_malloc(queue_size, MALLOC_CAP_8BIT);
+    if (s_spool.queue_storage == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t ret = stream_ring_init(&s_spool.queue, s_spool.queue_storage, queue_size);
+    if (ret != ESP_OK) {
+        heap_caps_free(s_spool.queue_storage);
+        s_spool.queue_storage = NULL;
+        return ret;
+    }
+
+    recover_position();
+    s_spool.sector_len = 0;
+    atomic_store(&s_spool.flush_requested, false);
+
+    BaseType_t created = xTaskCreatePinnedToCore(log_spool_task, "log_spool", LOG_SPOOL_TASK_STACK,
+                                                 NULL, LOG_SPOOL_TASK_PRIORITY, &s_spool.task,
+                                                 CONFIG_TASK_NET_CORE);
+    if (created != pdPASS) {
+        heap_caps_free(s_spool.queue_storage);
+        s_spool.queue_storage = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    s_spool.running = true;
+
+    uint32_t write_seq = atomic_load(&s_spool.write_seq);
+    ESP_LOGI(TAG, "Spooling to \"%s\": %lu sectors, %lu held, boot %u",
+             LOG_SPOOL_PARTITION_LABEL, (unsigned long)s_spool.sector_count,
+             (unsigned long)(write_seq - oldest_seq(write_seq)), s_spool.boot);
+    return ESP_OK;
+}
+
+void log_spool_append(const uint8_t *data, size_t len, int64_t time_us)
+{
+    if (!s_spool.running || len == 0) {
+        return;
+    }
+
+    log_spool_record_header_t header = {
+        .reserved = 0,
+        .time_ms = (uint32_t)(time_us / 1000),
+    };
+    while (len > 0) {
+        size_t chunk = len < LOG_SPOOL_MAX_PAYLOAD ? len : LOG_SPOOL_MAX_PAYLOAD;
+        size_t total = sizeof(header) + chunk;
+        if (stream_ring_free(&s_spool.queue) < total) {
+            metrics_add_drop(METRICS_DROP_SPOOL_FULL, len);
+            break;
+        }
+        header.len = (uint16_t)chunk;
+        memcpy(s_record, &header, sizeof(header));
+        memcpy(s_record + sizeof(header), data, chunk);
+        stream_ring_write(&s_spool.queue, s_record, total);
+        data += chunk;
+        len -= chunk;
+    }
+    xTaskNotifyGive(s_spool.task);
+}
+
+esp_err_t log_spool_iter_begin(log_spool_iter_t *iter)
+{
+    if (!s_spool.running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint32_t write_seq = atomic_load(&s_spool.write_seq);
+    iter->next_seq = oldest_seq(write_seq);
+    iter->end_seq = write_seq;
+    iter->window = NULL;
+    return ESP_OK;
+}
+
+esp_err_t log_spool_iter_next(log_spool_iter_t *iter, uint8_t *sector)
+{
+    while (iter->next_seq < iter->end_seq) {
+        uint32_t seq = iter->next_seq++;
+
+        // Fell behind the writer: continue with the oldest sector still held
+        uint32_t oldest = oldest_seq(atomic_load(&s_spool.write_seq));
+        if (seq < oldest) {
+            iter->next_seq = oldest;
+            continue;
+        }
+
+        uint32_t offset = sector_offset(seq);
+        esp_err_t ret = map_window(iter, offset);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        memcpy(sector, iter->window + (offset - iter->window_offset), LOG_SPOOL_SECTOR_SIZE);
+
+        // The sector may have been erased for reuse while it was copied
+        if (seq < oldest_seq(atomic_load(&s_spool.write_seq))) {
+            continue;
+        }
+        const log_spool_sector_header_t *header = (const log_spool_sector_header_t *)sector;
+        if (!header_valid(header) || header->seq != seq) {
+            continue;   // Never written, or lost to a power failure
+        }
+        if (esp_rom_crc32_le(0, sector + sizeof(*header), header->data_len) != header->crc32) {
+            ESP_LOGW(TAG, "CRC mismatch in sector %lu", (unsigned long)seq);
+            continue;
+        }
+        return ESP_OK;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+void log_spool_iter_end(log_spool_iter_t *iter)
+{
+    if (iter->window != NULL) {
+        esp_partition_munmap(iter->mmap_handle);
+        iter->window = NULL;
+    }
+}
+
+esp_err_t log_spool_flush(void)
+{
+    if (!s_spool.running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    atomic_store(&s_spool.flush_requested, true);
+    xTaskNotifyGive(s_spool.task);
+    return ESP_OK;
+}
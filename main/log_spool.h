@@ -0,0 +1,131 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Persistent spooling of the USB RX stream to the "log" flash partition
+ *
+ * The partition is used as a circular, append-only log of 4 KB sectors,
+ * so every sector is erased once per pass over the partition and wear is
+ * spread evenly. Data is collected into a RAM sector and written as a
+ * whole; a partially filled sector is only written after the flush
+ * interval, so there are no per-line flash writes.
+ *
+ * Sector layout (little endian):
+ *   log_spool_sector_header_t, then back-to-back records of
+ *   log_spool_record_header_t + payload. Records never span sectors.
+ *   The sector with the highest seq is the newest; after it come the
+ *   oldest sectors still held.
+ */
+
+#ifndef LOG_SPOOL_H
+#define LOG_SPOOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// On-flash format
+// ============================================================================
+
+#define LOG_SPOOL_SECTOR_SIZE   4096
+#define LOG_SPOOL_MAGIC         0x474F4C53u     // "SLOG"
+#define LOG_SPOOL_VERSION       1
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;             // LOG_SPOOL_MAGIC
+    uint32_t seq;               // Sector sequence number, increases by one per sector written
+    uint16_t version;           // LOG_SPOOL_VERSION
+    uint16_t boot;              // Boot counter (timestamps restart at every boot)
+    uint16_t data_len;          // Bytes of records after the header
+    uint16_t reserved;
+    uint32_t crc32;             // CRC-32 (little endian) of the record bytes
+} log_spool_sector_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t len;               // Payload length in bytes
+    uint16_t reserved;
+    uint32_t time_ms;           // Arrival time, milliseconds since boot
+} log_spool_record_header_t;
+
+// ============================================================================
+// Reader
+// ============================================================================
+
+typedef struct {
+    uint32_t next_seq;          // Sequence number of the next sector to return
+    uint32_t end_seq;           // Sequence number the spooler wrote next when the read began
+    const uint8_t *window;      // Currently mapped part of the partition (NULL = none)
+    uint32_t window_offset;     // Partition offset of window
+    uint32_t window_size;       // Size of window in bytes
+    uint32_t mmap_handle;       // esp_partition_mmap_handle_t of window
+} log_spool_iter_t;
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+/**
+ * @brief Find the log partition, recover the write position and start the spool task
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND without a "log" partition,
+ *         ESP_ERR_NO_MEM on allocation failure
+ */
+esp_err_t log_spool_init(void);
+
+/**
+ * @brief Queue USB data for spooling
+ *
+ * Non-blocking; data is dropped when the spool queue is full. Must be
+ * called from a single task (the network loop).
+ *
+ * @param data Data
+ * @param len Length of data in bytes
+ * @param time_us Arrival time in microseconds since boot
+ */
+void log_spool_append(const uint8_t *data, size_t len, int64_t time_us);
+
+/**
+ * @brief Start reading the spooled sectors, oldest first
+ *
+ * @param[out] iter Iterator
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE when spooling is not running
+ */
+esp_err_t log_spool_iter_begin(log_spool_iter_t *iter);
+
+/**
+ * @brief Copy the next spooled sector
+ *
+ * The sector is read through a memory-mapped window of the partition and
+ * checked again after the copy, so a sector overwritten while being read
+ * is skipped instead of returned torn.
+ *
+ * @param iter Iterator
+ * @param[out] sector Buffer of LOG_SPOOL_SECTOR_SIZE bytes
+ * @return ESP_OK when a sector was copied, ESP_ERR_NOT_FOUND at the end
+ */
+esp_err_t log_spool_iter_next(log_spool_iter_t *iter, uint8_t *sector);
+
+/**
+ * @brief Release the memory mapping held by an iterator
+ *
+ * @param iter Iterator
+ */
+void log_spool_iter_end(log_spool_iter_t *iter);
+
+/**
+ * @brief Write the partially filled sector now
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE when spooling is not running
+ */
+esp_err_t log_spool_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_SPOOL_H
@@ -11,11 +11,16 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
+#include <sys/param.h>
+#include <stdatomic.h>
 #include "esp_system.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -44,6 +49,7 @@
 
 // Provisioning
 #include "provisioning.h"
+#include "wifi_fast_connect.h"
 
 // mDNS
 #include "mdns.h"
@@ -52,12 +58,48 @@
 #include "ota_server.h"
 #include "esp_ota_ops.h"
 
+// USB → TCP byte ring and flush policy
+#include "stream_ring.h"
+#include "flush_policy.h"
+
+// Network event loop
+#include "net_loop.h"
+
+// Device status shared with the RFC2217 server
+#include "serial_control.h"
+
 // RFC2217 server
 #ifdef CONFIG_RFC2217_ENABLE
 #include "rfc2217_server.h"
 #endif
 
-#define EXAMPLE_USB_HOST_PRIORITY   (20)
+// Task statistics
+#include "task_stats.h"
+
+// Throughput / drop / latency counters
+#include "metrics.h"
+
+// Timestamped capture of the USB RX stream
+#include "capture_buffer.h"
+
+// Flash log spool
+#include "log_spool.h"
+
+// Compressed data port streams
+#include "compress_stream.h"
+#include "line_framer.h"
+
+// Data port pattern filter
+#include "stream_filter.h"
+
+// TCP → USB buffers and their placement
+#include "buffer_pool.h"
+#include "mem_layout.h"
+
+// Live serial console in the web UI
+#ifdef CONFIG_WEB_CONSOLE_ENABLE
+#include "web_console.h"
+#endif
 
 static const char *TAG = "USB-AUTO";
 
@@ -77,11 +119,15 @@ typedef enum {
     DEVICE_STATE_DISCONNECTED
 } device_state_t;
 
+typedef struct channel channel_t;
+
 typedef struct {
     device_type_t type;
     device_state_t state;
     uint16_t vid;
     uint16_t pid;
+    uint8_t interface;         // FTDI port (interface) to open
+    channel_t *channel;        // Channel serving the device
     union {
         cdc_acm_dev_hdl_t cdc_hdl;
         ftdi_sio_dev_hdl_t ftdi_hdl;
@@ -89,26 +135,35 @@ typedef struct {
     SemaphoreHandle_t disconnected_sem;
 } device_info_t;
 
-// TCP server management structure
+// Pattern filter state of a data port client
 typedef struct {
-    int listen_sock;           // Listening socket
-    int client_sock;           // Client socket (-1 = not connected)
-    bool connected;            // Connection status
-    SemaphoreHandle_t tx_mutex; // TX mutual exclusion
-} tcp_server_t;
-
-// Data buffer for queue items
+    stream_filter_stream_t stream;
+    size_t pos;                // Stream position after the last filtered byte
+    bool replaying;            // pos is a capture position
+    size_t pass;               // Bytes at pos the filter passed that are not sent yet
+    size_t dump_pos;           // TRIGGER: capture position of the pre-context still to send
+    size_t dump_end;           // TRIGGER: capture position the pre-context ends at
+    size_t passed_to;          // TRIGGER: capture position the last dump reached
+} tcp_client_filter_t;
+
+// Raw data port client slot
 typedef struct {
-    uint8_t data[512];         // Data buffer
-    size_t len;                // Data length
-    bool in_use;               // Buffer in use flag
-} data_buffer_t;
+    channel_t *channel;        // Channel the slot belongs to
+    int slot;                  // Slot index
+    int sock;                  // Client socket (-1 = slot free)
+    bool connected;            // Connection status
+    uint32_t accept_seq;       // Accept order, used to evict the oldest client
+    compress_stream_t *compressor;  // Compressed stream state (NULL = raw stream)
+    line_framer_t *framer;     // Timestamp framing state (NULL = raw stream)
+    tcp_client_filter_t *filter;    // Pattern filter state (NULL = unfiltered)
+} tcp_client_t;
 
-// Buffer pool management
+// TCP server management structure
 typedef struct {
-    data_buffer_t buffers[CONFIG_DATA_BUFFER_POOL_SIZE];
-    SemaphoreHandle_t mutex;
-} buffer_pool_t;
+    int listen_sock;           // Listening socket
+    tcp_client_t clients[CONFIG_TCP_MAX_CLIENTS];
+    int client_count;          // Number of connected clients
+} tcp_server_t;
 
 // Control port server
 typedef struct {
@@ -123,27 +178,204 @@ typedef enum {
     CMD_DTR,
     CMD_RTS,
     CMD_BAUD,
-    CMD_VERSION
+    CMD_VERSION,
+    CMD_MODE,
+    CMD_TASKS,
+    CMD_REPLAY,
+    CMD_COMPRESS,
+    CMD_FRAME,
+    CMD_LATENCY,
+    CMD_XFER,
+    CMD_BOOT,
+    CMD_UDP,
+    CMD_FLOW,
+    CMD_FILTER
 } command_type_t;
 
+// CMD_FILTER operations
+typedef enum {
+    FILTER_OP_ADD,
+    FILTER_OP_CLEAR,
+    FILTER_OP_MODE,
+    FILTER_OP_LIST
+} filter_op_t;
+
 typedef struct {
     command_type_t type;
     int value;
+    int target;                // CMD_MODE: sender index, -1 = all senders; CMD_REPLAY: sender kind;
+                               // CMD_FILTER: filter_op_t
+    bool in_seconds;           // CMD_REPLAY: value is seconds instead of bytes
+    uint32_t addr;             // CMD_UDP: destination address (network byte order, 0 = off)
+    char pattern[STREAM_FILTER_PATTERN_MAX + 1];    // CMD_FILTER ADD: pattern
+    size_t pre_context;        // CMD_FILTER TRIGGER: bytes before the matching line
+    size_t post_context;       // CMD_FILTER TRIGGER: bytes after the last match
 } parsed_command_t;
 
+// USB → network senders fed from the USB RX ring
+#define USB_TX_SINK_RFC2217     0                                   // RFC2217 port
+#define USB_TX_SINK_TCP_FIRST   1                                   // First raw data port client
+#define USB_TX_SINK_UDP         (USB_TX_SINK_TCP_FIRST + CONFIG_TCP_MAX_CLIENTS)  // UDP stream
+#define USB_TX_SINK_COUNT       (USB_TX_SINK_UDP + 1)
+
+// Unsent bytes a lossy sender may hold before its oldest data is dropped
+#define USB_TX_MAX_BACKLOG(ch)  ((ch)->usb_rx_ring.size / 2)
+
+// TCP → USB queue depth (buffers)
+#define TCP_TO_USB_QUEUE_LENGTH     32
+#define USB_TX_BATCH_SIZE           CONFIG_CDC_OUT_BUFFER_SIZE  // Largest gathered USB OUT write
+
+// TCP → USB buffers per channel (the pool is split evenly between channels)
+#define CHANNEL_BUFFER_POOL_SIZE    (CONFIG_DATA_BUFFER_POOL_SIZE / CONFIG_USB_CHANNEL_COUNT)
+
+// Free buffers (and queue slots) needed before paused data port clients are read again
+#define TCP_RX_RESUME_BUFFERS       ((CHANNEL_BUFFER_POOL_SIZE + 3) / 4)
+#define TCP_RX_READ_SIZE            MIN(CONFIG_TCP_RX_BUFFER_SIZE, BUFFER_POOL_DATA_SIZE)
+
+// FTDI OUT transfer size; the TCP → USB task writes one transfer at a time,
+// so a write that times out while the device holds off can simply be retried
+#define FTDI_OUT_CHUNK_SIZE         512
+
+// USB arrival times kept for framed data port clients (power of two); when
+// all are in use, further USB transfers share the time of the newest one
+#define USB_RX_STAMP_COUNT          128
+
+// Largest framed output built per send (also bounds one compressed frame)
+#define TCP_FRAME_CHUNK_SIZE        COMPRESS_STREAM_BLOCK_MAX
+
+// Timestamp framing of data port connections not preceded by a FRAME command
+#if defined(CONFIG_TCP_FRAME_DEFAULT_TEXT)
+#define TCP_FRAME_DEFAULT           LINE_FRAMER_TEXT
+#elif defined(CONFIG_TCP_FRAME_DEFAULT_BINARY)
+#define TCP_FRAME_DEFAULT           LINE_FRAMER_BINARY
+#else
+#define TCP_FRAME_DEFAULT           LINE_FRAMER_NONE
+#endif
+
+#ifdef CONFIG_UDP_STREAM_ENABLE
+// UDP stream datagrams (little endian): magic, version, channel, u16 payload
+// length, u32 sequence number, u32 stream offset of the first payload byte,
+// u64 arrival time of the first payload byte since boot (us), payload
+#define UDP_STREAM_MAGIC            "SLUD"
+#define UDP_STREAM_VERSION          1
+#define UDP_STREAM_HEADER_SIZE      24
+#define UDP_STREAM_PAYLOAD_MAX      (CONFIG_UDP_STREAM_DATAGRAM_SIZE - UDP_STREAM_HEADER_SIZE)
+#endif
+
+// Capture time marks: at most one per interval, one mark per this many bytes of capture
+#define CAPTURE_MARK_INTERVAL_US    (10 * 1000)
+#define CAPTURE_BYTES_PER_MARK      128
+
+// Interval for refreshing the metrics summary in the mDNS TXT records
+#define MDNS_METRICS_INTERVAL_US    (30 * 1000 * 1000LL)
+
+// Per-socket write queues in the network loop (powers of two)
+#define TCP_CLIENT_TX_QUEUE_SIZE    2048
+#define CONTROL_TX_QUEUE_SIZE       2048
+
+// Control port response buffer (holds the TASKS table)
+#define CONTROL_RESPONSE_SIZE       1536
+
+typedef struct usb_tx_sink usb_tx_sink_t;
+
+// Arrival time of the USB transfer starting at a ring position
+typedef struct {
+    size_t pos;
+    int64_t time_us;
+} usb_rx_stamp_t;
+
+// Per-sender flush state (owned by the network loop)
+struct usb_tx_sink {
+    const char *name;                 // Name used by the MODE command
+    char label[12];                   // Client label in the metrics ("rfc2217", "data0", "1:data0", ...)
+    channel_t *channel;               // Channel the sender belongs to
+    int slot;                         // Data port client slot (-1 = not a data port client)
+    bool lossy;                       // Drop oldest data instead of holding back the ring
+    size_t batch;                     // BULK: send whole batches of this size until the deadline (0 = any)
+    bool (*is_connected)(const usb_tx_sink_t *sink);
+    size_t (*send)(usb_tx_sink_t *sink, const uint8_t *data, size_t len);  // Returns bytes accepted
+    flush_policy_t policy;            // When to push pending data
+    atomic_int mode_request;          // Mode requested via the control port
+    size_t cursor;                    // Ring position sent up to
+    uint32_t session;                 // accept_seq of the client the cursor belongs to
+    int64_t last_progress_us;         // Last time the sender was idle or accepted data
+    int64_t stalled_since_us;         // Start of the current send stall (-1 = none)
+    bool lagging;                     // Currently losing data (for log rate limiting)
+    bool active;                      // A client was seen connected in the previous pass
+    bool replaying;                   // Sending capture history before live data
+    size_t replay_pos;                // Capture position the replay has sent up to
+};
+
+// One USB serial device with its own ports and data path
+struct channel {
+    int index;                        // Channel number (0 to CONFIG_USB_CHANNEL_COUNT - 1)
+    uint16_t data_port;               // Raw data port
+    uint16_t control_port;            // Control port
+    uint16_t rfc2217_port;            // RFC2217 port
+    uint16_t udp_port;                // UDP stream destination port (when the UDP command has none)
+    device_info_t *device;            // Currently connected USB device
+    stream_ring_t usb_rx_ring;        // USB → TCP ring (USB callback writes, network loop drains)
+    SemaphoreHandle_t usb_rx_space_sem;     // Given by the network loop when it frees ring space
+    atomic_bool usb_rx_producer_waiting;    // Set while a USB callback waits for ring space
+    usb_rx_stamp_t usb_rx_stamps[USB_RX_STAMP_COUNT];  // Arrival times of ring data
+    atomic_size_t usb_rx_stamp_head;  // Stamps written (USB callback)
+    atomic_size_t usb_rx_stamp_tail;  // Stamps released (network loop)
+    atomic_bool usb_rx_stamping;      // A framed client or the UDP stream needs USB arrival times
+    usb_tx_sink_t usb_tx_sinks[USB_TX_SINK_COUNT];  // Senders drained by the network loop
+    esp_timer_handle_t usb_flush_timer;     // Wakes the network loop at the next flush deadline
+    capture_buffer_t usb_capture;     // History of USB RX data (size 0 = capture disabled)
+    size_t usb_capture_cursor;        // Ring position captured and spooled up to (network loop)
+    tcp_server_t tcp_server;
+    control_server_t control_server;
+    bool tcp_compress_next;           // Compress the next data port connection (COMPRESS command)
+    line_framer_format_t tcp_frame_next;    // Framing of the next data port connection (FRAME command)
+    int tcp_framed_clients;           // Connected clients with timestamp framing
+    stream_filter_t *filter;          // Data port pattern filter (NULL until the first FILTER command)
+    int udp_sock;                     // UDP stream socket (-1 = UDP stream disabled)
+    struct sockaddr_in udp_dest;      // UDP stream destination (port 0 = stream off)
+    uint32_t udp_seq;                 // Sequence number of the next datagram
+    bool udp_failing;                 // Sends are failing (for log rate limiting)
+    QueueHandle_t tcp_to_usb_queue;   // TCP → USB queue (stores buffer pointers)
+    uint32_t tcp_rx_paused;           // Data port clients not read until buffers free up (slot mask, network loop)
+    atomic_bool tcp_rx_blocked;       // Clients are paused; the TCP → USB task wakes the loop when it frees buffers
+    uint32_t tcp_to_usb_syncs;        // Sync markers queued (network loop)
+    atomic_uint tcp_to_usb_synced;    // Sync markers reached, the data before them is on the device (TCP → USB task)
+    buffer_pool_t buffer_pool;        // TCP → USB buffer pool
+    data_buffer_t *buffer_storage;    // CHANNEL_BUFFER_POOL_SIZE pool buffers (bulk memory)
+    uint8_t *usb_tx_batch;            // Gathered USB OUT write, USB_TX_BATCH_SIZE bytes (TCP → USB task)
+    char mdns_instance[40];           // mDNS _serial._tcp instance name
+    struct {
+        bool connected;
+        uint16_t vid, pid;
+        const char *type;
+    } mdns_usb_status;                // Last USB status given to update_mdns_usb_status()
+};
+
 // ============= GLOBAL VARIABLES =============
 
-static QueueHandle_t device_queue;
-static tcp_server_t tcp_server;
-static control_server_t control_server;
-static QueueHandle_t usb_to_tcp_queue;  // USB → TCP queue (stores buffer pointers)
-static QueueHandle_t tcp_to_usb_queue;  // TCP → USB queue (stores buffer pointers)
-device_info_t *current_device = NULL;  // Currently connected USB device (non-static for serial_control access)
+static QueueHandle_t device_queue;  // Detected devices, taken by the first free channel
+static channel_t channels[CONFIG_USB_CHANNEL_COUNT];
 static EventGroupHandle_t wifi_event_group;
 static int s_retry_num = 0;
-static buffer_pool_t buffer_pool;  // Static buffer pool
-static char mdns_instance_name[32];  // mDNS service instance name
-SemaphoreHandle_t device_mutex;  // Device mutex for thread-safe access (non-static for serial_control access)
+static char mdns_hostname[32];  // mDNS hostname, also the instance name of channel 0
+static atomic_bool mdns_ready;  // mDNS is up (after WiFi connects)
+
+// Boot phases, in milliseconds since reset (0 = not reached yet)
+typedef enum {
+    BOOT_PHASE_USB_HOST,        // USB host and class drivers installed
+    BOOT_PHASE_NET_LOOP,        // Servers listening, capture running
+    BOOT_PHASE_USB_DEVICE,      // First USB serial device opened
+    BOOT_PHASE_USB_FIRST_RX,    // First byte from the device
+    BOOT_PHASE_WIFI_ASSOC,      // Associated with the AP
+    BOOT_PHASE_WIFI_IP,         // Got an IP address
+    BOOT_PHASE_SERVICES,        // mDNS and OTA server up
+    BOOT_PHASE_COUNT
+} boot_phase_t;
+
+static const char *const boot_phase_names[BOOT_PHASE_COUNT] = {
+    "usb_host", "net_loop", "usb_device", "usb_first_rx", "wifi_assoc", "wifi_ip", "services",
+};
+static _Atomic uint32_t boot_phase_ms[BOOT_PHASE_COUNT];
 
 #define WIFI_CONNECTED_BIT BIT0
 #define WIFI_FAIL_BIT      BIT1
@@ -156,33 +388,102 @@ SemaphoreHandle_t device_mutex;  // Device mutex for thread-safe access (non-sta
 static void usb_lib_task(void *arg);
 static void cdc_new_device_callback(usb_device_handle_t usb_dev);
 static void ftdi_new_device_callback(uint16_t vid, uint16_t pid, void *user_arg);
-static void cdc_handle_rx(uint8_t *data, size_t data_len, void *arg);
+static bool cdc_handle_rx(const uint8_t *data, size_t data_len, void *arg);
 static void ftdi_handle_rx(const uint8_t *data, size_t data_len, void *arg);
 static void cdc_handle_event(const cdc_acm_host_dev_event_data_t *event, void *user_ctx);
 static void ftdi_handle_event(ftdi_sio_host_dev_event_t event, void *user_ctx);
-static void handle_cdc_device(device_info_t *dev_info);
-static void handle_ftdi_device(device_info_t *dev_info);
+static esp_err_t handle_cdc_device(device_info_t *dev_info);
+static esp_err_t handle_ftdi_device(device_info_t *dev_info);
 static void handle_device(device_info_t *dev_info);
-
-// Buffer pool management functions
-static void buffer_pool_init(void);
-static data_buffer_t* buffer_alloc(void);
-static void buffer_free(data_buffer_t *buf);
+static void usb_device_task(void *pvParameters);
+
+// USB → TCP ring functions
+static esp_err_t usb_rx_ring_init(channel_t *ch);
+static void usb_rx_ring_push(channel_t *ch, const uint8_t *data, size_t data_len, const char *tag);
+
+// USB → network sender functions
+static esp_err_t usb_tx_sinks_init(channel_t *ch);
+static bool tcp_sink_is_connected(const usb_tx_sink_t *sink);
+static size_t tcp_sink_send(usb_tx_sink_t *sink, const uint8_t *data, size_t len);
+static void tcp_client_send_framed(tcp_client_t *client, const uint8_t *data, size_t len);
+static void tcp_client_filter_attach(channel_t *ch, tcp_client_t *client);
+#ifdef CONFIG_UDP_STREAM_ENABLE
+static bool udp_sink_is_connected(const usb_tx_sink_t *sink);
+static size_t udp_sink_send(usb_tx_sink_t *sink, const uint8_t *data, size_t len);
+#endif
 
 // WiFi and TCP functions
-static void tcp_server_task(void *pvParameters);
-static void usb_to_tcp_bridge_task(void *pvParameters);
+static esp_err_t tcp_server_start(channel_t *ch);
+#ifdef CONFIG_UDP_STREAM_ENABLE
+static esp_err_t udp_stream_start(channel_t *ch);
+static void udp_stream_set_dest(channel_t *ch, uint32_t addr, uint16_t port);
+#endif
+static int64_t usb_tx_poll(int64_t now_us, void *ctx);
+static int64_t tcp_rx_poll(int64_t now_us, void *ctx);
+static esp_err_t usb_tx_sink_start_replay(usb_tx_sink_t *sink, size_t pos);
 static void tcp_to_usb_bridge_task(void *pvParameters);
 
+// Channel functions
+static esp_err_t channel_init(channel_t *ch, int index);
+static void channels_metrics_init(void);
+
+// Boot functions
+static void boot_phase_mark(boot_phase_t phase);
+static void network_start_task(void *pvParameters);
+
 // mDNS functions
 static void init_mdns(void);
-static void update_mdns_usb_status(bool connected, uint16_t vid, uint16_t pid, const char *type);
-static void update_mdns_tcp_status(bool connected);
+static void update_mdns_usb_status(channel_t *ch, bool connected, uint16_t vid, uint16_t pid, const char *type);
+static void update_mdns_tcp_status(channel_t *ch, int clients);
+static int64_t update_mdns_metrics(int64_t now_us, void *ctx);
 
 // Control port functions
-static bool parse_command(const char *cmd_str, parsed_command_t *cmd);
-static esp_err_t execute_command(const parsed_command_t *cmd, char *response_buffer, size_t buffer_size);
-static void control_server_task(void *pvParameters);
+static bool parse_command(const channel_t *ch, const char *cmd_str, parsed_command_t *cmd);
+static esp_err_t execute_command(channel_t *ch, const parsed_command_t *cmd,
+                                 char *response_buffer, size_t buffer_size);
+static esp_err_t control_server_start(channel_t *ch);
+
+// ============= BOOT TIMING =============
+
+/**
+ * @brief Record when a boot phase was first reached
+ *
+ * @param phase Boot phase (later calls for the same phase are ignored)
+ */
+static void boot_phase_mark(boot_phase_t phase)
+{
+    uint32_t expected = 0;
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    atomic_compare_exchange_strong(&boot_phase_ms[phase], &expected, now_ms > 0 ? now_ms : 1);
+}
+
+/**
+ * @brief Format the boot phase timings
+ *
+ * One "<phase> <ms>" line per phase ("-" if not reached), then the
+ * WiFi connection path.
+ *
+ * @param out Output buffer
+ * @param size Output buffer size
+ * @return Length written
+ */
+static size_t boot_phase_format(char *out, size_t size)
+{
+    size_t len = 0;
+    for (int i = 0; i < BOOT_PHASE_COUNT && len < size; i++) {
+        uint32_t ms = atomic_load(&boot_phase_ms[i]);
+        if (ms > 0) {
+            len += snprintf(out + len, size - len, "%-13s %" PRIu32 "\n", boot_phase_names[i], ms);
+        } else {
+            len += snprintf(out + len, size - len, "%-13s -\n", boot_phase_names[i]);
+        }
+    }
+    if (len < size) {
+        len += snprintf(out + len, size - len, "%-13s %s\n", "wifi_path",
+                        wifi_fast_connect_used() ? "cached_ap" : "scan");
+    }
+    return len < size ? len : size - 1;
+}
 
 // ============= USB HOST TASK =============
 
@@ -207,79 +508,401 @@ static void usb_lib_task(void *arg)
     }
 }
 
-// ============= BUFFER POOL MANAGEMENT =============
+// ============= USB RX RING =============
 
 /**
- * @brief Initialize buffer pool
+ * @brief Allocate and initialize the USB → TCP ring of a channel
+ *
+ * The configured size is rounded down to a power of two. When PSRAM
+ * placement is enabled and PSRAM allocation fails, internal RAM is used.
+ *
+ * @param ch Channel
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if storage cannot be allocated
  */
-static void buffer_pool_init(void)
+static esp_err_t usb_rx_ring_init(channel_t *ch)
 {
-    buffer_pool.mutex = xSemaphoreCreateMutex();
-    if (buffer_pool.mutex == NULL) {
-        ESP_LOGE(TAG, "Failed to create buffer pool mutex");
-        return;
+    size_t size = 1;
+    while (size * 2 <= (size_t)CONFIG_USB_RX_RING_SIZE_KB * 1024) {
+        size *= 2;
+    }
+
+    uint8_t *storage = NULL;
+#ifdef CONFIG_USB_RX_RING_IN_PSRAM
+    storage = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (storage == NULL) {
+        ESP_LOGW(TAG, "PSRAM allocation for USB RX ring failed, using internal RAM");
     }
+#endif
+    if (storage == NULL) {
+        storage = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (storage == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate USB RX ring (%u bytes)", (unsigned)size);
+        return ESP_ERR_NO_MEM;
+    }
+
+    ch->usb_rx_space_sem = xSemaphoreCreateBinary();
+    if (ch->usb_rx_space_sem == NULL) {
+        heap_caps_free(storage);
+        return ESP_ERR_NO_MEM;
+    }
+    atomic_init(&ch->usb_rx_producer_waiting, false);
+    atomic_init(&ch->usb_rx_stamp_head, 0);
+    atomic_init(&ch->usb_rx_stamp_tail, 0);
+    atomic_init(&ch->usb_rx_stamping, false);
 
-    // Initialize all buffers as free
-    for (int i = 0; i < CONFIG_DATA_BUFFER_POOL_SIZE; i++) {
-        buffer_pool.buffers[i].in_use = false;
-        buffer_pool.buffers[i].len = 0;
+    esp_err_t err = stream_ring_init(&ch->usb_rx_ring, storage, size);
+    if (err != ESP_OK) {
+        vSemaphoreDelete(ch->usb_rx_space_sem);
+        ch->usb_rx_space_sem = NULL;
+        heap_caps_free(storage);
+        return err;
     }
 
-    ESP_LOGI(TAG, "Buffer pool initialized with %d buffers", CONFIG_DATA_BUFFER_POOL_SIZE);
+    ESP_LOGI(TAG, "[ch%d] USB RX ring initialized (%u bytes)", ch->index, (unsigned)size);
+    return ESP_OK;
 }
 
 /**
- * @brief Allocate a buffer from the pool
+ * @brief Allocate and initialize the capture buffer of a channel
  *
- * @return Pointer to allocated buffer, or NULL if pool is full
+ * The configured size is rounded down to a power of two. A size of 0
+ * leaves capture disabled. Only channel 0 is captured, like the log
+ * spool, so the other channels always run without.
+ *
+ * @param ch Channel
+ * @return ESP_OK on success (also when disabled), ESP_ERR_NO_MEM if storage
+ *         cannot be allocated
  */
-static data_buffer_t* buffer_alloc(void)
+static esp_err_t usb_capture_init(channel_t *ch)
 {
-    data_buffer_t *buf = NULL;
+    if (ch->index != 0) {
+        return ESP_OK;
+    }
+    if (CONFIG_CAPTURE_BUFFER_SIZE_KB == 0) {
+        ESP_LOGI(TAG, "USB capture disabled");
+        return ESP_OK;
+    }
+
+    size_t size = 1;
+    while (size * 2 <= (size_t)CONFIG_CAPTURE_BUFFER_SIZE_KB * 1024) {
+        size *= 2;
+    }
+    size_t mark_count = size / CAPTURE_BYTES_PER_MARK;
+    size_t mark_bytes = mark_count * sizeof(capture_mark_t);
+
+    uint8_t *storage = NULL;
+    capture_mark_t *marks = NULL;
+#ifdef CONFIG_CAPTURE_IN_PSRAM
+    storage = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    marks = heap_caps_malloc(mark_bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (storage == NULL || marks == NULL) {
+        ESP_LOGW(TAG, "PSRAM allocation for USB capture failed, using internal RAM");
+    }
+#endif
+    if (storage == NULL) {
+        storage = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (marks == NULL) {
+        marks = heap_caps_malloc(mark_bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (storage == NULL || marks == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate USB capture (%u bytes)", (unsigned)(size + mark_bytes));
+        heap_caps_free(storage);
+        heap_caps_free(marks);
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = capture_buffer_init(&ch->usb_capture, storage, size, marks, mark_count,
+                                        CAPTURE_MARK_INTERVAL_US);
+    if (err != ESP_OK) {
+        return err;
+    }
+    ch->usb_capture_cursor = stream_ring_head(&ch->usb_rx_ring);
+
+    ESP_LOGI(TAG, "USB capture initialized (%u bytes, %u time marks)",
+             (unsigned)size, (unsigned)mark_count);
+    return ESP_OK;
+}
 
-    xSemaphoreTake(buffer_pool.mutex, portMAX_DELAY);
+/**
+ * @brief Write received USB data into the ring (producer side)
+ *
+ * Called from the USB driver callbacks. When the ring is full, blocks up
+ * to 2s per wait to propagate backpressure to the USB device (flow control)
+ * and drops the remainder if the network loop makes no progress.
+ *
+ * @param ch Channel of the device
+ * @param data Received data
+ * @param data_len Length of received data in bytes
+ * @param tag Driver name for log messages
+ */
+static void usb_rx_ring_push(channel_t *ch, const uint8_t *data, size_t data_len, const char *tag)
+{
+    int64_t start_us = esp_timer_get_time();
+    metrics_add_bytes(METRICS_BYTES_USB_RX, data_len);
+    if (atomic_load_explicit(&boot_phase_ms[BOOT_PHASE_USB_FIRST_RX], memory_order_relaxed) == 0) {
+        boot_phase_mark(BOOT_PHASE_USB_FIRST_RX);
+    }
+
+    // Stamp the transfer for framed clients (the head is ours as the producer)
+    if (atomic_load_explicit(&ch->usb_rx_stamping, memory_order_relaxed)) {
+        size_t stamp_head = atomic_load_explicit(&ch->usb_rx_stamp_head, memory_order_relaxed);
+        if (stamp_head - atomic_load_explicit(&ch->usb_rx_stamp_tail, memory_order_acquire) <
+            USB_RX_STAMP_COUNT) {
+            usb_rx_stamp_t *stamp = &ch->usb_rx_stamps[stamp_head & (USB_RX_STAMP_COUNT - 1)];
+            stamp->pos = stream_ring_head(&ch->usb_rx_ring);
+            stamp->time_us = start_us;
+            atomic_store_explicit(&ch->usb_rx_stamp_head, stamp_head + 1, memory_order_release);
+        }
+    }
+
+    size_t offset = 0;
+    while (offset < data_len) {
+        size_t written = stream_ring_write(&ch->usb_rx_ring, data + offset, data_len - offset);
+        if (written > 0) {
+            offset += written;
+            metrics_queue_level(METRICS_QUEUE_USB_RX_RING, stream_ring_used(&ch->usb_rx_ring));
+            net_loop_wake();
+            continue;
+        }
 
-    // Find first free buffer
-    for (int i = 0; i < CONFIG_DATA_BUFFER_POOL_SIZE; i++) {
-        if (!buffer_pool.buffers[i].in_use) {
-            buffer_pool.buffers[i].in_use = true;
-            buf = &buffer_pool.buffers[i];
+        // Ring full: announce we are waiting, then re-check so a consume that
+        // raced with the announcement is not missed
+        atomic_store(&ch->usb_rx_producer_waiting, true);
+        bool got_space = stream_ring_free(&ch->usb_rx_ring) > 0 ||
+                         xSemaphoreTake(ch->usb_rx_space_sem, pdMS_TO_TICKS(2000)) == pdTRUE;
+        atomic_store(&ch->usb_rx_producer_waiting, false);
+        if (!got_space) {
+            ESP_LOGW(TAG, "[ch%d][%s] USB→TCP ring full after 2s, dropped %u bytes",
+                     ch->index, tag, (unsigned)(data_len - offset));
+            metrics_add_drop(METRICS_DROP_USB_RING_FULL, data_len - offset);
             break;
         }
     }
 
-    xSemaphoreGive(buffer_pool.mutex);
+    metrics_record_latency(METRICS_LATENCY_USB_RX, (uint32_t)(esp_timer_get_time() - start_us));
+}
 
-    if (buf == NULL) {
-        ESP_LOGW(TAG, "Buffer pool exhausted");
+/**
+ * @brief Arrival time of ring data for a framed client
+ *
+ * Network loop only. Stamps are in position order, so the newest one at
+ * or before pos covers it.
+ *
+ * @param ch Channel
+ * @param pos Ring position at or after the ring tail
+ * @param end End of the data being framed
+ * @param[out] next End of the data sharing the returned time (at most end)
+ * @return Arrival time in microseconds (now for data received before
+ *         stamping started)
+ */
+static int64_t usb_rx_stamp_time(channel_t *ch, size_t pos, size_t end, size_t *next)
+{
+    size_t head = atomic_load_explicit(&ch->usb_rx_stamp_head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&ch->usb_rx_stamp_tail, memory_order_relaxed);
+    int64_t time_us = -1;
+
+    *next = end;
+    for (size_t i = tail; i != head; i++) {
+        const usb_rx_stamp_t *stamp = &ch->usb_rx_stamps[i & (USB_RX_STAMP_COUNT - 1)];
+        if ((ptrdiff_t)(stamp->pos - pos) <= 0) {
+            time_us = stamp->time_us;
+            continue;
+        }
+        if ((ptrdiff_t)(stamp->pos - end) < 0) {
+            *next = stamp->pos;
+        }
+        break;
     }
+    return time_us >= 0 ? time_us : esp_timer_get_time();
+}
 
-    return buf;
+/**
+ * @brief Stamp USB transfers only while someone needs their arrival times
+ *
+ * Network loop only.
+ *
+ * @param ch Channel
+ */
+static void usb_rx_stamping_update(channel_t *ch)
+{
+    atomic_store(&ch->usb_rx_stamping, ch->tcp_framed_clients > 0 || ch->udp_dest.sin_port != 0);
+}
+
+/**
+ * @brief Drop the stamps of data the ring has released
+ *
+ * Network loop only. While nobody needs stamps every stamp is dropped.
+ *
+ * @param ch Channel
+ * @param release New ring tail
+ */
+static void usb_rx_stamps_release(channel_t *ch, size_t release)
+{
+    size_t head = atomic_load_explicit(&ch->usb_rx_stamp_head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&ch->usb_rx_stamp_tail, memory_order_relaxed);
+
+    if (!atomic_load_explicit(&ch->usb_rx_stamping, memory_order_relaxed)) {
+        tail = head;
+    }
+    // A stamp is no longer needed once the next one starts inside released data
+    while (head - tail > 1 &&
+           (ptrdiff_t)(ch->usb_rx_stamps[(tail + 1) & (USB_RX_STAMP_COUNT - 1)].pos - release) <= 0) {
+        tail++;
+    }
+    atomic_store_explicit(&ch->usb_rx_stamp_tail, tail, memory_order_release);
 }
 
+// ============= USB TX SINKS =============
+
 /**
- * @brief Free a buffer back to the pool
+ * @brief Flush deadline timer callback
  *
- * @param buf Pointer to buffer to free
+ * Runs in the esp_timer task and only wakes the network loop, which
+ * re-evaluates every sender's policy. A timer is used because select()
+ * timeouts are limited to the FreeRTOS tick.
+ *
+ * @param arg Unused
  */
-static void buffer_free(data_buffer_t *buf)
+static void usb_flush_timer_cb(void *arg)
 {
-    if (buf == NULL) {
-        return;
+    net_loop_wake();
+}
+
+#ifdef CONFIG_RFC2217_ENABLE
+static bool rfc2217_sink_is_connected(const usb_tx_sink_t *sink)
+{
+    return rfc2217_server_is_connected(sink->channel->index);
+}
+
+static size_t rfc2217_sink_send(usb_tx_sink_t *sink, const uint8_t *data, size_t len)
+{
+    return rfc2217_server_send_data(sink->channel->index, data, len);
+}
+#endif
+
+/**
+ * @brief Initialize the USB → network senders and the flush timer of a channel
+ *
+ * Every sender starts in the mode selected in Kconfig. The BULK
+ * threshold is capped to the backlog a data port client may hold, so
+ * reaching it always flushes before old data is dropped.
+ *
+ * @param ch Channel
+ * @return ESP_OK on success
+ */
+static esp_err_t usb_tx_sinks_init(channel_t *ch)
+{
+#ifdef CONFIG_TCP_FLUSH_DEFAULT_BULK
+    const flush_mode_t default_mode = FLUSH_MODE_BULK;
+#else
+    const flush_mode_t default_mode = FLUSH_MODE_LOWLAT;
+#endif
+    size_t threshold = CONFIG_TCP_FLUSH_BULK_THRESHOLD;
+    if (threshold > USB_TX_MAX_BACKLOG(ch)) {
+        threshold = USB_TX_MAX_BACKLOG(ch);
+    }
+    usb_tx_sink_t *sinks = ch->usb_tx_sinks;
+
+    // RFC2217 is lossless (it holds back the ring and thus the USB device);
+    // data port clients are lossy so a slow reader only hurts itself
+    sinks[USB_TX_SINK_RFC2217].name = "RFC2217";
+    sinks[USB_TX_SINK_RFC2217].slot = -1;
+    sinks[USB_TX_SINK_RFC2217].lossy = false;
+#ifdef CONFIG_RFC2217_ENABLE
+    sinks[USB_TX_SINK_RFC2217].is_connected = rfc2217_sink_is_connected;
+    sinks[USB_TX_SINK_RFC2217].send = rfc2217_sink_send;
+#endif
+    for (int i = 0; i < CONFIG_TCP_MAX_CLIENTS; i++) {
+        usb_tx_sink_t *sink = &sinks[USB_TX_SINK_TCP_FIRST + i];
+        sink->name = "DATA";
+        sink->slot = i;
+        sink->lossy = true;
+        sink->is_connected = tcp_sink_is_connected;
+        sink->send = tcp_sink_send;
     }
 
-    xSemaphoreTake(buffer_pool.mutex, portMAX_DELAY);
+    // The UDP stream is lossy as well: listeners cannot hold back anything
+    sinks[USB_TX_SINK_UDP].name = "UDP";
+    sinks[USB_TX_SINK_UDP].slot = -1;
+    sinks[USB_TX_SINK_UDP].lossy = true;
+#ifdef CONFIG_UDP_STREAM_ENABLE
+    sinks[USB_TX_SINK_UDP].is_connected = udp_sink_is_connected;
+    sinks[USB_TX_SINK_UDP].send = udp_sink_send;
+#endif
 
-    // Verify buffer is from our pool
-    if (buf >= buffer_pool.buffers && buf < buffer_pool.buffers + CONFIG_DATA_BUFFER_POOL_SIZE) {
-        buf->in_use = false;
-        buf->len = 0;
-    } else {
-        ESP_LOGE(TAG, "Attempted to free buffer not from pool");
+    for (int i = 0; i < USB_TX_SINK_COUNT; i++) {
+        usb_tx_sink_t *sink = &sinks[i];
+        sink->channel = ch;
+        flush_policy_init(&sink->policy, default_mode, threshold, CONFIG_TCP_FLUSH_BULK_DEADLINE_US);
+        atomic_init(&sink->mode_request, default_mode);
+        sink->cursor = 0;
+        sink->session = 0;
+        sink->last_progress_us = 0;
+        sink->stalled_since_us = -1;
+        sink->lagging = false;
+        sink->active = false;
+        sink->replaying = false;
+        sink->batch = 0;
+        // Channel 0 keeps the plain labels; the others are prefixed with their number
+        char prefix[4] = "";
+        if (ch->index != 0) {
+            snprintf(prefix, sizeof(prefix), "%d:", ch->index);
+        }
+        if (sink->slot >= 0) {
+            snprintf(sink->label, sizeof(sink->label), "%sdata%d", prefix, sink->slot);
+        } else {
+            snprintf(sink->label, sizeof(sink->label), "%s%s", prefix,
+                     i == USB_TX_SINK_UDP ? "udp" : "rfc2217");
+        }
+    }
+
+#ifdef CONFIG_UDP_STREAM_ENABLE
+    // The UDP stream always starts in BULK and fills whole datagrams
+    usb_tx_sink_t *udp = &sinks[USB_TX_SINK_UDP];
+    flush_policy_init(&udp->policy, FLUSH_MODE_BULK, UDP_STREAM_PAYLOAD_MAX, CONFIG_UDP_STREAM_DEADLINE_US);
+    atomic_init(&udp->mode_request, FLUSH_MODE_BULK);
+    udp->batch = UDP_STREAM_PAYLOAD_MAX;
+#endif
+
+    serial_control_set_profile(ch->index, default_mode == FLUSH_MODE_BULK ? SERIAL_PROFILE_BULK
+                                                                          : SERIAL_PROFILE_INTERACTIVE);
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = usb_flush_timer_cb,
+        .name = "usb_flush",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &ch->usb_flush_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create flush timer: %s", esp_err_to_name(err));
+        return err;
     }
 
-    xSemaphoreGive(buffer_pool.mutex);
+    ESP_LOGI(TAG, "[ch%d] USB TX flush: default %s, BULK threshold %u bytes / deadline %d us",
+             ch->index, flush_policy_mode_name(default_mode), (unsigned)threshold,
+             CONFIG_TCP_FLUSH_BULK_DEADLINE_US);
+    return ESP_OK;
+}
+
+/**
+ * @brief Register every sender of every channel with the metrics
+ *
+ * The metrics client index of a sender is its channel number times
+ * USB_TX_SINK_COUNT plus its index in the channel. Queue levels are
+ * tracked as high-water marks over all channels.
+ */
+static void channels_metrics_init(void)
+{
+    const char *labels[CONFIG_USB_CHANNEL_COUNT * USB_TX_SINK_COUNT];
+    for (int c = 0; c < CONFIG_USB_CHANNEL_COUNT; c++) {
+        for (int i = 0; i < USB_TX_SINK_COUNT; i++) {
+            labels[c * USB_TX_SINK_COUNT + i] = channels[c].usb_tx_sinks[i].label;
+        }
+    }
+    metrics_init(labels, CONFIG_USB_CHANNEL_COUNT * USB_TX_SINK_COUNT);
+    metrics_set_queue_capacity(METRICS_QUEUE_USB_RX_RING, channels[0].usb_rx_ring.size);
+    metrics_set_queue_capacity(METRICS_QUEUE_TCP_TO_USB, TCP_TO_USB_QUEUE_LENGTH);
 }
 
 // ============= WIFI INITIALIZATION =============
@@ -293,7 +916,16 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t e
 {
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
         esp_wifi_connect();
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        boot_phase_mark(BOOT_PHASE_WIFI_ASSOC);
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+#ifdef CONFIG_WIFI_FAST_CONNECT
+        // A stale cached AP costs one attempt, not a retry
+        if (wifi_fast_connect_fallback()) {
+            esp_wifi_connect();
+            return;
+        }
+#endif
         if (s_retry_num < CONFIG_WIFI_MAXIMUM_RETRY) {
             esp_wifi_connect();
             s_retry_num++;
@@ -305,6 +937,7 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t e
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
         ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
+        boot_phase_mark(BOOT_PHASE_WIFI_IP);
         s_retry_num = 0;
         xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
     }
@@ -312,10 +945,35 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t e
 
 // ============= mDNS FUNCTIONS =============
 
+/**
+ * @brief Set a TXT item of a channel's _serial._tcp instance
+ *
+ * @param ch Channel
+ * @param key TXT key
+ * @param value TXT value
+ */
+static void mdns_txt_set(const channel_t *ch, const char *key, const char *value)
+{
+    mdns_service_txt_item_set_for_host(ch->mdns_instance, "_serial", "_tcp", NULL, key, value);
+}
+
+/**
+ * @brief Remove a TXT item from a channel's _serial._tcp instance
+ *
+ * @param ch Channel
+ * @param key TXT key
+ */
+static void mdns_txt_remove(const channel_t *ch, const char *key)
+{
+    mdns_service_txt_item_remove_for_host(ch->mdns_instance, "_serial", "_tcp", NULL, key);
+}
+
 /**
  * @brief Initialize mDNS service
  *
- * Registers the device as a _serial._tcp service with dynamic TXT records
+ * Registers one _serial._tcp instance per channel with dynamic TXT records:
+ * serial-XXXXXX for channel 0 and serial-XXXXXX-<n> for the others. The
+ * device-wide metrics summary is only published on channel 0.
  */
 static void init_mdns(void)
 {
@@ -325,12 +983,12 @@ static void init_mdns(void)
     // Generate instance name from MAC address
     uint8_t mac[6];
     esp_wifi_get_mac(WIFI_IF_STA, mac);
-    snprintf(mdns_instance_name, sizeof(mdns_instance_name),
+    snprintf(mdns_hostname, sizeof(mdns_hostname),
              "serial-%02X%02X%02X", mac[3], mac[4], mac[5]);
 
     // Set mDNS hostname (appears as serial-XXXXXX.local)
-    ESP_ERROR_CHECK(mdns_hostname_set(mdns_instance_name));
-    ESP_LOGI(TAG, "mDNS hostname set to: %s.local", mdns_instance_name);
+    ESP_ERROR_CHECK(mdns_hostname_set(mdns_hostname));
+    ESP_LOGI(TAG, "mDNS hostname set to: %s.local", mdns_hostname);
 
     // Get IP address for TXT record
     esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
@@ -343,34 +1001,54 @@ static void init_mdns(void)
     char mac_str[18];
     snprintf(mac_str, sizeof(mac_str), MACSTR, MAC2STR(mac));
 
-    char port_str[6];
-    snprintf(port_str, sizeof(port_str), "%d", CONFIG_TCP_SERVER_PORT);
+    char ota_url[64];
+    snprintf(ota_url, sizeof(ota_url), "http://%s.local/", mdns_hostname);
 
-    char control_port_str[6];
-    snprintf(control_port_str, sizeof(control_port_str), "%d", CONFIG_TCP_CONTROL_PORT);
+    for (int i = 0; i < CONFIG_USB_CHANNEL_COUNT; i++) {
+        channel_t *ch = &channels[i];
+        if (ch->index == 0) {
+            snprintf(ch->mdns_instance, sizeof(ch->mdns_instance), "%s", mdns_hostname);
+        } else {
+            snprintf(ch->mdns_instance, sizeof(ch->mdns_instance), "%s-%d", mdns_hostname, ch->index);
+        }
 
-    char ota_url[64];
-    snprintf(ota_url, sizeof(ota_url), "http://%s.local/", mdns_instance_name);
-
-    // Initial TXT records for _serial._tcp
-    mdns_txt_item_t txt_data[] = {
-        {"mac", mac_str},
-        {"ip", ip_str},
-        {"port", port_str},
-        {"control_port", control_port_str},
-        {"usb_connected", "0"},
-        {"tcp_connected", "0"},
-        {"ota_enabled", "1"},
-        {"ota_url", ota_url}
-    };
+        char port_str[6];
+        snprintf(port_str, sizeof(port_str), "%u", ch->data_port);
+
+        char control_port_str[6];
+        snprintf(control_port_str, sizeof(control_port_str), "%u", ch->control_port);
+
+        char channel_str[4];
+        snprintf(channel_str, sizeof(channel_str), "%d", ch->index);
+
+        // Initial TXT records for _serial._tcp (the metrics summary comes last)
+        mdns_txt_item_t txt_data[] = {
+            {"mac", mac_str},
+            {"ip", ip_str},
+            {"port", port_str},
+            {"control_port", control_port_str},
+            {"channel", channel_str},
+            {"usb_connected", "0"},
+            {"tcp_connected", "0"},
+            {"tcp_clients", "0"},
+            {"ota_enabled", "1"},
+            {"ota_url", ota_url},
+            {"usb_rx_kb", "0"},
+            {"usb_tx_kb", "0"},
+            {"drops", "0"}
+        };
+        size_t txt_count = sizeof(txt_data) / sizeof(txt_data[0]);
+        if (ch->index != 0) {
+            txt_count -= 3;
+        }
 
-    // Register _serial._tcp service
-    ESP_ERROR_CHECK(mdns_service_add(mdns_instance_name, "_serial", "_tcp",
-                                      CONFIG_TCP_SERVER_PORT, txt_data,
-                                      sizeof(txt_data) / sizeof(txt_data[0])));
+        // Register _serial._tcp service
+        ESP_ERROR_CHECK(mdns_service_add_for_host(ch->mdns_instance, "_serial", "_tcp", NULL,
+                                                  ch->data_port, txt_data, txt_count));
 
-    ESP_LOGI(TAG, "mDNS service registered: %s._serial._tcp.local:%d",
-             mdns_instance_name, CONFIG_TCP_SERVER_PORT);
+        ESP_LOGI(TAG, "mDNS service registered: %s._serial._tcp.local:%u",
+                 ch->mdns_instance, ch->data_port);
+    }
 
     // Register _http._tcp service for OTA
     mdns_txt_item_t http_txt_data[] = {
@@ -379,55 +1057,118 @@ static void init_mdns(void)
         {"version", get_version_string()}
     };
 
-    ESP_ERROR_CHECK(mdns_service_add(mdns_instance_name, "_http", "_tcp",
+    ESP_ERROR_CHECK(mdns_service_add(mdns_hostname, "_http", "_tcp",
                                       CONFIG_OTA_HTTP_SERVER_PORT, http_txt_data,
                                       sizeof(http_txt_data) / sizeof(http_txt_data[0])));
 
     ESP_LOGI(TAG, "mDNS HTTP service registered: %s._http._tcp.local:%d",
-             mdns_instance_name, CONFIG_OTA_HTTP_SERVER_PORT);
+             mdns_hostname, CONFIG_OTA_HTTP_SERVER_PORT);
 }
 
 /**
  * @brief Update mDNS TXT records with USB device status
  *
+ * @param ch Channel of the device
  * @param connected Whether USB device is connected
  * @param vid USB Vendor ID (ignored if not connected)
  * @param pid USB Product ID (ignored if not connected)
  * @param type USB device type string (ignored if not connected)
  */
-static void update_mdns_usb_status(bool connected, uint16_t vid, uint16_t pid, const char *type)
+static void update_mdns_usb_status(channel_t *ch, bool connected, uint16_t vid, uint16_t pid, const char *type)
 {
     char vid_str[8], pid_str[8];
 
-    mdns_service_txt_item_set("_serial", "_tcp", "usb_connected", connected ? "1" : "0");
+    // USB comes up before WiFi: network_start_task publishes the last status
+    ch->mdns_usb_status.connected = connected;
+    ch->mdns_usb_status.vid = vid;
+    ch->mdns_usb_status.pid = pid;
+    ch->mdns_usb_status.type = type;
+    if (!atomic_load(&mdns_ready)) {
+        return;
+    }
+
+    mdns_txt_set(ch, "usb_connected", connected ? "1" : "0");
 
     if (connected) {
         snprintf(vid_str, sizeof(vid_str), "0x%04X", vid);
         snprintf(pid_str, sizeof(pid_str), "0x%04X", pid);
 
-        mdns_service_txt_item_set("_serial", "_tcp", "usb_vid", vid_str);
-        mdns_service_txt_item_set("_serial", "_tcp", "usb_pid", pid_str);
-        mdns_service_txt_item_set("_serial", "_tcp", "usb_type", type);
+        mdns_txt_set(ch, "usb_vid", vid_str);
+        mdns_txt_set(ch, "usb_pid", pid_str);
+        mdns_txt_set(ch, "usb_type", type);
 
-        ESP_LOGI(TAG, "mDNS: USB connected (VID=0x%04X, PID=0x%04X, Type=%s)", vid, pid, type);
+        ESP_LOGI(TAG, "mDNS: [ch%d] USB connected (VID=0x%04X, PID=0x%04X, Type=%s)",
+                 ch->index, vid, pid, type);
     } else {
-        mdns_service_txt_item_remove("_serial", "_tcp", "usb_vid");
-        mdns_service_txt_item_remove("_serial", "_tcp", "usb_pid");
-        mdns_service_txt_item_remove("_serial", "_tcp", "usb_type");
+        mdns_txt_remove(ch, "usb_vid");
+        mdns_txt_remove(ch, "usb_pid");
+        mdns_txt_remove(ch, "usb_type");
 
-        ESP_LOGI(TAG, "mDNS: USB disconnected");
+        ESP_LOGI(TAG, "mDNS: [ch%d] USB disconnected", ch->index);
     }
 }
 
 /**
  * @brief Update mDNS TXT records with TCP client status
  *
- * @param connected Whether TCP client is connected
+ * @param ch Channel
+ * @param clients Number of connected data port clients
  */
-static void update_mdns_tcp_status(bool connected)
+static void update_mdns_tcp_status(channel_t *ch, int clients)
 {
-    mdns_service_txt_item_set("_serial", "_tcp", "tcp_connected", connected ? "1" : "0");
-    ESP_LOGI(TAG, "mDNS: TCP client %s", connected ? "connected" : "disconnected");
+    char clients_str[8];
+    if (!atomic_load(&mdns_ready)) {
+        return;
+    }
+    snprintf(clients_str, sizeof(clients_str), "%d", clients);
+    mdns_txt_set(ch, "tcp_connected", clients > 0 ? "1" : "0");
+    mdns_txt_set(ch, "tcp_clients", clients_str);
+    ESP_LOGI(TAG, "mDNS: [ch%d] %d TCP client(s) connected", ch->index, clients);
+}
+
+/**
+ * @brief Refresh the metrics summary in the mDNS TXT records (network loop poll callback)
+ *
+ * Publishes KiB received from / written to the USB device and the total
+ * number of drop events every MDNS_METRICS_INTERVAL_US, skipping updates
+ * when nothing changed. Full metrics are served at /api/metrics.
+ *
+ * @param now_us Current time in microseconds
+ * @param ctx Unused
+ * @return Microseconds until the next refresh
+ */
+static int64_t update_mdns_metrics(int64_t now_us, void *ctx)
+{
+    static int64_t next_us = 0;
+    static uint64_t last_rx_kb = 0, last_tx_kb = 0, last_drops = 0;
+
+    if (now_us < next_us) {
+        return next_us - now_us;
+    }
+    next_us = now_us + MDNS_METRICS_INTERVAL_US;
+    if (!atomic_load(&mdns_ready)) {
+        return MDNS_METRICS_INTERVAL_US;
+    }
+
+    uint64_t rx_kb = metrics_bytes(METRICS_BYTES_USB_RX) / 1024;
+    uint64_t tx_kb = metrics_bytes(METRICS_BYTES_USB_TX) / 1024;
+    uint64_t drops = metrics_drops_total();
+    if (rx_kb == last_rx_kb && tx_kb == last_tx_kb && drops == last_drops) {
+        return MDNS_METRICS_INTERVAL_US;
+    }
+    last_rx_kb = rx_kb;
+    last_tx_kb = tx_kb;
+    last_drops = drops;
+
+    // The counters cover every channel and are published on channel 0
+    char value[24];
+    snprintf(value, sizeof(value), "%llu", (unsigned long long)rx_kb);
+    mdns_txt_set(&channels[0], "usb_rx_kb", value);
+    snprintf(value, sizeof(value), "%llu", (unsigned long long)tx_kb);
+    mdns_txt_set(&channels[0], "usb_tx_kb", value);
+    snprintf(value, sizeof(value), "%llu", (unsigned long long)drops);
+    mdns_txt_set(&channels[0], "drops", value);
+    return MDNS_METRICS_INTERVAL_US;
 }
 
 // ============= CONTROL PORT FUNCTIONS =============
@@ -435,11 +1176,12 @@ static void update_mdns_tcp_status(bool connected)
 /**
  * @brief Parse control command string
  *
+ * @param ch Channel of the control port
  * @param cmd_str Command string (e.g., "DTR 1\n")
  * @param cmd Parsed command output
  * @return true if parsing succeeded, false otherwise
  */
-static bool parse_command(const char *cmd_str, parsed_command_t *cmd)
+static bool parse_command(const channel_t *ch, const char *cmd_str, parsed_command_t *cmd)
 {
     // Remove trailing newline
     char buffer[64];
@@ -453,48 +1195,283 @@ static bool parse_command(const char *cmd_str, parsed_command_t *cmd)
     char cmd_name[16];
 
     // Check for VERSION command (no parameter)
-    if (sscanf(buffer, "%15s", cmd_name) >= 1) {
-        if (strcmp(cmd_name, "VERSION") == 0) {
-            cmd->type = CMD_VERSION;
-            cmd->value = 0;  // Not used
-            return true;
-        }
+    if (sscanf(buffer, "%15s", cmd_name) < 1) {
+        return false;
+    }
+    if (strcmp(cmd_name, "VERSION") == 0) {
+        cmd->type = CMD_VERSION;
+        cmd->value = 0;  // Not used
+        return true;
+    }
+    if (strcmp(cmd_name, "TASKS") == 0) {
+        cmd->type = CMD_TASKS;
+        cmd->value = 0;  // Not used
+        return true;
+    }
+    if (strcmp(cmd_name, "BOOT") == 0) {
+        cmd->type = CMD_BOOT;
+        cmd->value = 0;  // Not used
+        return true;
     }
 
-    // Parse commands with parameters (DTR, RTS, BAUD)
-    int value;
-    if (sscanf(buffer, "%15s %d", cmd_name, &value) != 2) {
-        return false;
+    // MODE <LOWLAT|BULK> [DATA|RFC2217|UDP]
+    if (strcmp(cmd_name, "MODE") == 0) {
+        char mode_name[16];
+        char target_name[16];
+        int n = sscanf(buffer, "%15s %15s %15s", cmd_name, mode_name, target_name);
+        flush_mode_t mode;
+        if (n < 2 || !flush_policy_parse_mode(mode_name, &mode)) {
+            return false;
+        }
+        cmd->type = CMD_MODE;
+        cmd->value = mode;
+        cmd->target = -1;
+        if (n == 3) {
+            for (int i = 0; i < USB_TX_SINK_COUNT && cmd->target < 0; i++) {
+                if (strcmp(target_name, ch->usb_tx_sinks[i].name) == 0) {
+                    cmd->target = i;
+                }
+            }
+            return cmd->target >= 0;
+        }
+        return true;
     }
 
-    // Identify command type
-    if (strcmp(cmd_name, "DTR") == 0) {
-        cmd->type = CMD_DTR;
-        cmd->value = value;
-        return (value == 0 || value == 1);
-    } else if (strcmp(cmd_name, "RTS") == 0) {
-        cmd->type = CMD_RTS;
-        cmd->value = value;
-        return (value == 0 || value == 1);
-    } else if (strcmp(cmd_name, "BAUD") == 0) {
-        cmd->type = CMD_BAUD;
-        cmd->value = value;
-        // Validate common baudrates
-        return (value >= 300 && value <= 921600);
+    // REPLAY <bytes|<n>K|<n>s> [DATA|RFC2217]
+    if (strcmp(cmd_name, "REPLAY") == 0) {
+        char amount[16];
+        char target_name[16];
+        int n = sscanf(buffer, "%15s %15s %15s", cmd_name, amount, target_name);
+        if (n < 2) {
+            return false;
+        }
+        char *end;
+        long value = strtol(amount, &end, 10);
+        if (value <= 0 || value > INT32_MAX / 1024) {
+            return false;
+        }
+        cmd->type = CMD_REPLAY;
+        cmd->in_seconds = false;
+        if (strcmp(end, "K") == 0 || strcmp(end, "k") == 0) {
+            value *= 1024;
+        } else if (strcmp(end, "s") == 0) {
+            cmd->in_seconds = true;
+        } else if (*end != '\0') {
+            return false;
+        }
+        cmd->value = (int)value;
+        cmd->target = USB_TX_SINK_TCP_FIRST;
+        if (n == 3) {
+            if (strcmp(target_name, "RFC2217") == 0) {
+                cmd->target = USB_TX_SINK_RFC2217;
+            } else if (strcmp(target_name, "DATA") != 0) {
+                return false;
+            }
+        }
+        return true;
     }
 
-    return false;
-}
+    // FRAME <TEXT|BINARY|OFF>
+    if (strcmp(cmd_name, "FRAME") == 0) {
+        char format[16];
+        if (sscanf(buffer, "%15s %15s", cmd_name, format) != 2) {
+            return false;
+        }
+        cmd->type = CMD_FRAME;
+        if (strcmp(format, "TEXT") == 0) {
+            cmd->value = LINE_FRAMER_TEXT;
+        } else if (strcmp(format, "BINARY") == 0) {
+            cmd->value = LINE_FRAMER_BINARY;
+        } else if (strcmp(format, "OFF") == 0) {
+            cmd->value = LINE_FRAMER_NONE;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    // UDP <address>[:<port>]|OFF
+    if (strcmp(cmd_name, "UDP") == 0) {
+        char dest[32];
+        if (sscanf(buffer, "%15s %31s", cmd_name, dest) != 2) {
+            return false;
+        }
+        cmd->type = CMD_UDP;
+        cmd->addr = 0;
+        cmd->value = ch->udp_port;
+        if (strcmp(dest, "OFF") == 0) {
+            return true;
+        }
+        char *colon = strchr(dest, ':');
+        if (colon != NULL) {
+            *colon = '\0';
+            char *end;
+            long port = strtol(colon + 1, &end, 10);
+            if (*end != '\0' || port < 1 || port > 65535) {
+                return false;
+            }
+            cmd->value = (int)port;
+        }
+        struct in_addr addr;
+        if (inet_aton(dest, &addr) == 0 || addr.s_addr == 0) {
+            return false;
+        }
+        cmd->addr = addr.s_addr;
+        return true;
+    }
+
+    // COMPRESS <LZ4|OFF>
+    if (strcmp(cmd_name, "COMPRESS") == 0) {
+        char codec[16];
+        if (sscanf(buffer, "%15s %15s", cmd_name, codec) != 2) {
+            return false;
+        }
+        cmd->type = CMD_COMPRESS;
+        if (strcmp(codec, "LZ4") == 0) {
+            cmd->value = 1;
+        } else if (strcmp(codec, "OFF") == 0) {
+            cmd->value = 0;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    // LATENCY <AUTO|1-255>
+    if (strcmp(cmd_name, "LATENCY") == 0) {
+        char arg[16];
+        if (sscanf(buffer, "%15s %15s", cmd_name, arg) != 2) {
+            return false;
+        }
+        cmd->type = CMD_LATENCY;
+        if (strcmp(arg, "AUTO") == 0) {
+            cmd->value = SERIAL_LATENCY_AUTO;
+            return true;
+        }
+        char *end;
+        long ms = strtol(arg, &end, 10);
+        cmd->value = (int)ms;
+        return *end == '\0' && ms >= 1 && ms <= 255;
+    }
+
+    // FLOW <NONE|RTSCTS|XONXOFF>
+    if (strcmp(cmd_name, "FLOW") == 0) {
+        char arg[16];
+        if (sscanf(buffer, "%15s %15s", cmd_name, arg) != 2) {
+            return false;
+        }
+        cmd->type = CMD_FLOW;
+        if (strcmp(arg, "NONE") == 0) {
+            cmd->value = SERIAL_FLOW_NONE;
+        } else if (strcmp(arg, "RTSCTS") == 0) {
+            cmd->value = SERIAL_FLOW_RTS_CTS;
+        } else if (strcmp(arg, "XONXOFF") == 0) {
+            cmd->value = SERIAL_FLOW_XON_XOFF;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    // FILTER ADD <text>|CLEAR|LINES|TRIGGER [<pre>[K] [<post>[K]]]|OFF|LIST
+    if (strcmp(cmd_name, "FILTER") == 0) {
+        char op[16];
+        char context[2][16];
+        int n = sscanf(buffer, "%15s %15s %15s %15s", cmd_name, op, context[0], context[1]);
+        if (n < 2) {
+            return false;
+        }
+        cmd->type = CMD_FILTER;
+        if (strcmp(op, "ADD") == 0) {
+            // The pattern is the rest of the line, spaces included
+            const char *text = strstr(buffer, "ADD") + 3;
+            if (*text++ != ' ') {
+                return false;
+            }
+            size_t len = strcspn(text, "\r");
+            if (len == 0 || len > STREAM_FILTER_PATTERN_MAX) {
+                return false;
+            }
+            memcpy(cmd->pattern, text, len);
+            cmd->pattern[len] = '\0';
+            cmd->target = FILTER_OP_ADD;
+            return true;
+        }
+        if (strcmp(op, "CLEAR") == 0 || strcmp(op, "LIST") == 0) {
+            cmd->target = op[0] == 'C' ? FILTER_OP_CLEAR : FILTER_OP_LIST;
+            return n == 2;
+        }
+
+        cmd->target = FILTER_OP_MODE;
+        cmd->pre_context = CONFIG_STREAM_FILTER_PRE_CONTEXT;
+        cmd->post_context = CONFIG_STREAM_FILTER_POST_CONTEXT;
+        if (strcmp(op, "OFF") == 0 || strcmp(op, "LINES") == 0) {
+            cmd->value = op[0] == 'O' ? STREAM_FILTER_OFF : STREAM_FILTER_LINES;
+            return n == 2;
+        }
+        if (strcmp(op, "TRIGGER") != 0) {
+            return false;
+        }
+        cmd->value = STREAM_FILTER_TRIGGER;
+        for (int i = 0; i < n - 2; i++) {
+            char *end;
+            long value = strtol(context[i], &end, 10);
+            if (value < 0 || value > INT32_MAX / 1024) {
+                return false;
+            }
+            if (strcmp(end, "K") == 0 || strcmp(end, "k") == 0) {
+                value *= 1024;
+            } else if (*end != '\0' || end == context[i]) {
+                return false;
+            }
+            *(i == 0 ? &cmd->pre_context : &cmd->post_context) = (size_t)value;
+        }
+        return true;
+    }
+
+    // Parse commands with parameters (DTR, RTS, BAUD, XFER)
+    int value;
+    if (sscanf(buffer, "%15s %d", cmd_name, &value) != 2) {
+        return false;
+    }
+
+    // Identify command type
+    if (strcmp(cmd_name, "DTR") == 0) {
+        cmd->type = CMD_DTR;
+        cmd->value = value;
+        return (value == 0 || value == 1);
+    } else if (strcmp(cmd_name, "RTS") == 0) {
+        cmd->type = CMD_RTS;
+        cmd->value = value;
+        return (value == 0 || value == 1);
+    } else if (strcmp(cmd_name, "BAUD") == 0) {
+        cmd->type = CMD_BAUD;
+        cmd->value = value;
+        // Validate common baudrates
+        return (value >= 300 && value <= 921600);
+    } else if (strcmp(cmd_name, "XFER") == 0) {
+        cmd->type = CMD_XFER;
+        cmd->value = value;
+        return (value >= SERIAL_XFER_SIZE_MIN && value <= SERIAL_XFER_SIZE_MAX);
+    }
+
+    return false;
+}
 
 /**
  * @brief Execute control command
  *
+ * Device, stream and tuning commands act on the channel of the control
+ * port; VERSION, TASKS and BOOT report on the whole bridge.
+ *
+ * @param ch Channel of the control port
  * @param cmd Parsed command
- * @param response_buffer Buffer for custom response (used for VERSION command)
+ * @param response_buffer Buffer for custom response (used for VERSION and TASKS commands)
  * @param buffer_size Size of response buffer
  * @return esp_err_t ESP_OK on success
  */
-static esp_err_t execute_command(const parsed_command_t *cmd, char *response_buffer, size_t buffer_size)
+static esp_err_t execute_command(channel_t *ch, const parsed_command_t *cmd,
+                                 char *response_buffer, size_t buffer_size)
 {
     esp_err_t ret = ESP_OK;
 
@@ -505,379 +1482,1678 @@ static esp_err_t execute_command(const parsed_command_t *cmd, char *response_buf
         return ESP_OK;
     }
 
-    // Acquire device mutex
-    if (xSemaphoreTake(device_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        ESP_LOGE(TAG, "Failed to acquire device mutex");
-        return ESP_ERR_TIMEOUT;
+    // TASKS reports per-task CPU load since the previous TASKS (no device needed)
+    if (cmd->type == CMD_TASKS) {
+        static task_stats_t stats;  // Only used from the network loop
+        ret = task_stats_sample(&stats);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        size_t len = task_stats_format(&stats, response_buffer, buffer_size - 3);
+        strcpy(response_buffer + len, "OK\n");
+        return ESP_OK;
     }
 
-    // Check if device is connected
-    if (current_device == NULL) {
-        ESP_LOGW(TAG, "No USB device connected");
-        xSemaphoreGive(device_mutex);
-        return ESP_ERR_INVALID_STATE;
+    // BOOT reports when each boot phase was reached (no device needed)
+    if (cmd->type == CMD_BOOT) {
+        size_t len = boot_phase_format(response_buffer, buffer_size - 3);
+        strcpy(response_buffer + len, "OK\n");
+        return ESP_OK;
     }
 
-    // Static variables to preserve DTR/RTS state
-    static bool current_dtr = false;
-    static bool current_rts = false;
-
-    switch (cmd->type) {
-    case CMD_DTR:
-    case CMD_RTS: {
-        // Update the signal being modified
-        if (cmd->type == CMD_DTR) {
-            current_dtr = (cmd->value == 1);
+    // REPLAY sends capture history to the newest client of the given kind
+    if (cmd->type == CMD_REPLAY) {
+        const tcp_client_t *clients = ch->tcp_server.clients;
+        usb_tx_sink_t *sink = NULL;
+        if (cmd->target == USB_TX_SINK_RFC2217) {
+            sink = &ch->usb_tx_sinks[USB_TX_SINK_RFC2217];
         } else {
-            current_rts = (cmd->value == 1);
+            for (int i = 0; i < CONFIG_TCP_MAX_CLIENTS; i++) {
+                if (clients[i].connected &&
+                    (sink == NULL || clients[i].accept_seq > clients[sink->slot].accept_seq)) {
+                    sink = &ch->usb_tx_sinks[USB_TX_SINK_TCP_FIRST + i];
+                }
+            }
+        }
+        if (sink == NULL || sink->send == NULL || !sink->is_connected(sink)) {
+            ESP_LOGW(TAG, "REPLAY: no client to replay to");
+            return ESP_ERR_INVALID_STATE;
+        }
+
+        size_t pos = cmd->in_seconds
+                     ? capture_buffer_pos_for_age(&ch->usb_capture, esp_timer_get_time(), cmd->value * 1000000LL)
+                     : capture_buffer_pos_for_bytes(&ch->usb_capture, cmd->value);
+        ret = usb_tx_sink_start_replay(sink, pos);
+        net_loop_wake();
+        return ret;
+    }
+
+    // COMPRESS selects the framing of the next data port connection
+    if (cmd->type == CMD_COMPRESS) {
+        ch->tcp_compress_next = cmd->value != 0;
+        ESP_LOGI(TAG, "[ch%d] Next data port connection: %s", ch->index,
+                 ch->tcp_compress_next ? "LZ4" : "raw");
+        return ESP_OK;
+    }
+
+    // FRAME selects the timestamp framing of the next data port connection
+    if (cmd->type == CMD_FRAME) {
+        static const char *const names[] = {"raw", "text timestamps", "binary records"};
+        ch->tcp_frame_next = (line_framer_format_t)cmd->value;
+        ESP_LOGI(TAG, "[ch%d] Next data port connection: %s", ch->index, names[cmd->value]);
+        return ESP_OK;
+    }
+
+    // UDP sets the destination of the channel's UDP stream
+    if (cmd->type == CMD_UDP) {
+#ifdef CONFIG_UDP_STREAM_ENABLE
+        if (ch->udp_sock >= 0) {
+            udp_stream_set_dest(ch, cmd->addr, (uint16_t)cmd->value);
+            return ESP_OK;
         }
+#endif
+        ESP_LOGW(TAG, "UDP: stream not enabled");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
 
-        // Apply to device
-        if (current_device->type == DEVICE_TYPE_CDC) {
-            ret = cdc_acm_host_set_control_line_state(
-                current_device->handle.cdc_hdl, current_dtr, current_rts);
-        } else if (current_device->type == DEVICE_TYPE_FTDI) {
-            ret = ftdi_sio_host_set_modem_control(
-                current_device->handle.ftdi_hdl, current_dtr, current_rts);
+    // FILTER sets the pattern filter of the channel's data port clients
+    if (cmd->type == CMD_FILTER) {
+        static const char *const mode_names[] = { "OFF", "LINES", "TRIGGER" };
+        if (ch->filter == NULL) {
+            // Only patterns need the filter; until then everything passes
+            if (cmd->target == FILTER_OP_LIST) {
+                snprintf(response_buffer, buffer_size, "OFF 0 0\nOK\n");
+                return ESP_OK;
+            }
+            if (cmd->target != FILTER_OP_ADD) {
+                return cmd->target == FILTER_OP_CLEAR || cmd->value == STREAM_FILTER_OFF
+                       ? ESP_OK : ESP_ERR_INVALID_STATE;
+            }
+            ch->filter = heap_caps_malloc(sizeof(stream_filter_t), MALLOC_CAP_8BIT);
+            if (ch->filter == NULL) {
+                ESP_LOGW(TAG, "FILTER: no memory");
+                return ESP_ERR_NO_MEM;
+            }
+            stream_filter_init(ch->filter);
+            for (int i = 0; i < CONFIG_TCP_MAX_CLIENTS; i++) {
+                if (ch->tcp_server.clients[i].connected) {
+                    tcp_client_filter_attach(ch, &ch->tcp_server.clients[i]);
+                }
+            }
         }
 
-        ESP_LOGI(TAG, "Set %s=%d (DTR=%d, RTS=%d): %s",
-                 cmd->type == CMD_DTR ? "DTR" : "RTS", cmd->value,
-                 current_dtr, current_rts,
-                 ret == ESP_OK ? "OK" : "ERROR");
-        break;
+        stream_filter_t *sf = ch->filter;
+        switch (cmd->target) {
+        case FILTER_OP_ADD:
+            ret = stream_filter_add(sf, cmd->pattern);
+            ESP_LOGI(TAG, "[ch%d] FILTER ADD \"%s\": %s", ch->index, cmd->pattern,
+                     ret == ESP_OK ? "OK" : esp_err_to_name(ret));
+            break;
+        case FILTER_OP_CLEAR:
+            stream_filter_clear(sf);
+            ESP_LOGI(TAG, "[ch%d] FILTER cleared", ch->index);
+            break;
+        case FILTER_OP_MODE:
+            if (cmd->value != STREAM_FILTER_OFF && sf->pattern_count == 0) {
+                ESP_LOGW(TAG, "FILTER: no patterns");
+                return ESP_ERR_INVALID_STATE;
+            }
+            stream_filter_set_mode(sf, (stream_filter_mode_t)cmd->value, cmd->pre_context, cmd->post_context);
+            ESP_LOGI(TAG, "[ch%d] FILTER %s (context %u/%u bytes)", ch->index, mode_names[cmd->value],
+                     (unsigned)cmd->pre_context, (unsigned)cmd->post_context);
+            break;
+        default: {
+            int len = snprintf(response_buffer, buffer_size, "%s %u %u\n", mode_names[sf->mode],
+                               (unsigned)sf->pre_context, (unsigned)sf->post_context);
+            for (int i = 0; i < sf->pattern_count; i++) {
+                len += snprintf(response_buffer + len, buffer_size - len, "%d %s\n", i + 1, sf->patterns[i]);
+            }
+            snprintf(response_buffer + len, buffer_size - len, "OK\n");
+            return ESP_OK;
+        }
+        }
+
+        // Data already queued in the ring is filtered from now on
+        net_loop_wake();
+        return ret;
     }
 
-    case CMD_BAUD: {
-        if (current_device->type == DEVICE_TYPE_CDC) {
-            cdc_acm_line_coding_t line_coding;
-            ret = cdc_acm_host_line_coding_get(current_device->handle.cdc_hdl, &line_coding);
-            if (ret == ESP_OK) {
-                line_coding.dwDTERate = cmd->value;
-                ret = cdc_acm_host_line_coding_set(current_device->handle.cdc_hdl, &line_coding);
+    // MODE only changes the network loop's flush policy (no device needed)
+    if (cmd->type == CMD_MODE) {
+        usb_tx_sink_t *sinks = ch->usb_tx_sinks;
+        for (int i = 0; i < USB_TX_SINK_COUNT; i++) {
+            if (cmd->target < 0 || strcmp(sinks[i].name, sinks[cmd->target].name) == 0) {
+                atomic_store(&sinks[i].mode_request, cmd->value);
+                ESP_LOGD(TAG, "[ch%d] Set MODE %s for %s", ch->index,
+                         flush_policy_mode_name(cmd->value), sinks[i].name);
             }
-        } else if (current_device->type == DEVICE_TYPE_FTDI) {
-            ret = ftdi_sio_host_set_baudrate(current_device->handle.ftdi_hdl, cmd->value);
         }
+        // The FTDI latency timer follows the most interactive sender
+        bool interactive = false;
+        for (int i = 0; i < USB_TX_SINK_COUNT; i++) {
+            interactive |= atomic_load(&sinks[i].mode_request) == FLUSH_MODE_LOWLAT;
+        }
+        serial_control_set_profile(ch->index, interactive ? SERIAL_PROFILE_INTERACTIVE
+                                                          : SERIAL_PROFILE_BULK);
 
-        ESP_LOGI(TAG, "Set BAUD=%d: %s", cmd->value, ret == ESP_OK ? "OK" : "ERROR");
-        break;
+        // Apply immediately rather than at the next USB packet
+        net_loop_wake();
+        return ESP_OK;
     }
 
-    default:
-        ret = ESP_ERR_INVALID_ARG;
+    // FTDI tuning is kept across devices (no device needed)
+    if (cmd->type == CMD_LATENCY) {
+        ret = serial_control_set_latency(ch->index, cmd->value);
+        bool is_auto;
+        uint8_t latency = serial_control_get_latency(ch->index, &is_auto);
+        ESP_LOGI(TAG, "[ch%d] Set LATENCY %s (%d ms)", ch->index, is_auto ? "AUTO" : "fixed", latency);
+        return ret;
+    }
+    if (cmd->type == CMD_XFER) {
+        ESP_LOGI(TAG, "[ch%d] FTDI IN transfer size %d from the next connection", ch->index, cmd->value);
+        return serial_control_set_in_xfer_size(ch->index, cmd->value);
+    }
+    if (cmd->type == CMD_FLOW) {
+        static const char *const flow_names[] = { "NONE", "RTSCTS", "XONXOFF" };
+        ret = serial_control_set_flow_control(ch->index, cmd->value);
+        ESP_LOGI(TAG, "[ch%d] Set FLOW %s: %s", ch->index, flow_names[cmd->value],
+                 ret == ESP_OK ? "OK" : esp_err_to_name(ret));
+        return ret;
+    }
+
+    // Device commands are queued to the serial control worker and applied
+    // in order, so the network loop never waits for a control transfer
+    switch (cmd->type) {
+    case CMD_DTR:
+        ret = serial_control_set_dtr(ch->index, cmd->value == 1);
         break;
+    case CMD_RTS:
+        ret = serial_control_set_rts(ch->index, cmd->value == 1);
+        break;
+    case CMD_BAUD:
+        ret = serial_control_set_baudrate(ch->index, cmd->value);
+        break;
+    default:
+        return ESP_ERR_INVALID_ARG;
     }
 
-    xSemaphoreGive(device_mutex);
+    if (ret == ESP_ERR_INVALID_STATE) {
+        ESP_LOGW(TAG, "[ch%d] No USB device connected", ch->index);
+    } else {
+        bool dtr, rts;
+        serial_control_get_dtr(ch->index, &dtr);
+        serial_control_get_rts(ch->index, &rts);
+        ESP_LOGI(TAG, "[ch%d] Set %s=%d (DTR=%d, RTS=%d): %s", ch->index,
+                 cmd->type == CMD_DTR ? "DTR" : cmd->type == CMD_RTS ? "RTS" : "BAUD",
+                 cmd->value, dtr, rts, ret == ESP_OK ? "queued" : "ERROR");
+    }
     return ret;
 }
 
 /**
- * @brief Control server task
+ * @brief Close the control client
  *
- * Listens for control commands on TCP control port
+ * @param ch Channel of the control port
  */
-static void control_server_task(void *pvParameters)
+static void control_client_close(channel_t *ch)
 {
-    struct sockaddr_in dest_addr;
-    dest_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    dest_addr.sin_family = AF_INET;
-    dest_addr.sin_port = htons(CONFIG_TCP_CONTROL_PORT);
+    net_loop_close(ch->control_server.client_sock);
+    ch->control_server.client_sock = -1;
+    ch->control_server.connected = false;
+    ESP_LOGI(TAG, "[ch%d] Control connection closed", ch->index);
+}
 
-    // Create listening socket
-    control_server.listen_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
-    if (control_server.listen_sock < 0) {
-        ESP_LOGE(TAG, "Unable to create control socket: errno %d", errno);
-        vTaskDelete(NULL);
+/**
+ * @brief Receive and execute control commands (network loop callback)
+ *
+ * @param sock Control client socket
+ * @param ctx Channel of the control port
+ */
+static void control_client_receive(int sock, void *ctx)
+{
+    channel_t *ch = ctx;
+    static char rx_buffer[128];
+    int len = recv(sock, rx_buffer, sizeof(rx_buffer) - 1, 0);
+
+    if (len < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return;
+        }
+        ESP_LOGE(TAG, "Control recv failed: errno %d", errno);
+        control_client_close(ch);
+        return;
+    } else if (len == 0) {
+        ESP_LOGI(TAG, "[ch%d] Control client disconnected", ch->index);
+        control_client_close(ch);
         return;
     }
 
-    int opt = 1;
-    setsockopt(control_server.listen_sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    rx_buffer[len] = '\0';
 
-    ESP_LOGI(TAG, "Control server binding to port %d", CONFIG_TCP_CONTROL_PORT);
-    int err = bind(control_server.listen_sock, (struct sockaddr *)&dest_addr, sizeof(dest_addr));
-    if (err != 0) {
-        ESP_LOGE(TAG, "Control socket bind failed: errno %d", errno);
-        close(control_server.listen_sock);
-        vTaskDelete(NULL);
+    // Parse command
+    parsed_command_t cmd;
+    static char response_buffer[CONTROL_RESPONSE_SIZE];
+
+    if (parse_command(ch, rx_buffer, &cmd)) {
+        // Execute command
+        esp_err_t ret = execute_command(ch, &cmd, response_buffer, sizeof(response_buffer));
+
+        // Send response (custom for VERSION, TASKS, BOOT and FILTER LIST, standard for others)
+        bool custom = cmd.type == CMD_VERSION || cmd.type == CMD_TASKS || cmd.type == CMD_BOOT ||
+                      (cmd.type == CMD_FILTER && cmd.target == FILTER_OP_LIST);
+        if (custom && ret == ESP_OK) {
+            net_loop_send(sock, response_buffer, strlen(response_buffer));
+        } else {
+            const char *response = (ret == ESP_OK) ? "OK\n" : "ERROR\n";
+            net_loop_send(sock, response, strlen(response));
+        }
+    } else {
+        // Invalid command
+        ESP_LOGW(TAG, "Invalid command: %s", rx_buffer);
+        const char *response = "ERROR\n";
+        net_loop_send(sock, response, strlen(response));
+    }
+}
+
+/**
+ * @brief Accept a control client (network loop callback)
+ *
+ * @param listen_sock Control listening socket
+ * @param ctx Channel of the control port
+ */
+static void control_client_accept(int listen_sock, void *ctx)
+{
+    channel_t *ch = ctx;
+    struct sockaddr_in source_addr;
+    socklen_t addr_len = sizeof(source_addr);
+
+    int sock = accept(listen_sock, (struct sockaddr *)&source_addr, &addr_len);
+    if (sock < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            ESP_LOGE(TAG, "Unable to accept control connection: errno %d", errno);
+        }
         return;
     }
 
-    err = listen(control_server.listen_sock, 1);
-    if (err != 0) {
-        ESP_LOGE(TAG, "Control socket listen failed: errno %d", errno);
-        close(control_server.listen_sock);
-        vTaskDelete(NULL);
+    // If already connected, close old connection
+    if (ch->control_server.connected && ch->control_server.client_sock >= 0) {
+        ESP_LOGI(TAG, "[ch%d] New control client connecting, closing existing connection", ch->index);
+        control_client_close(ch);
+    }
+
+    if (net_loop_add(sock, CONTROL_TX_QUEUE_SIZE, control_client_receive, ch) != ESP_OK) {
+        ESP_LOGE(TAG, "No room for control connection");
+        close(sock);
         return;
     }
 
-    ESP_LOGI(TAG, "Control server listening on port %d", CONFIG_TCP_CONTROL_PORT);
+    // Set up new connection
+    ch->control_server.client_sock = sock;
+    ch->control_server.connected = true;
 
-    while (1) {
-        struct sockaddr_in source_addr;
-        socklen_t addr_len = sizeof(source_addr);
+    char addr_str[16];
+    inet_ntoa_r(source_addr.sin_addr, addr_str, sizeof(addr_str));
+    ESP_LOGI(TAG, "[ch%d] Control client connected from %s:%d",
+             ch->index, addr_str, ntohs(source_addr.sin_port));
+}
 
-        // Accept new client connection
-        int sock = accept(control_server.listen_sock, (struct sockaddr *)&source_addr, &addr_len);
-        if (sock < 0) {
-            ESP_LOGE(TAG, "Unable to accept control connection: errno %d", errno);
-            continue;
-        }
+/**
+ * @brief Start the control server of a channel
+ *
+ * Listens for control commands on the channel's control port; the
+ * connection is served by the network loop.
+ *
+ * @param ch Channel
+ * @return ESP_OK on success
+ */
+static esp_err_t control_server_start(channel_t *ch)
+{
+    ESP_LOGI(TAG, "[ch%d] Control server binding to port %u", ch->index, ch->control_port);
+    esp_err_t err = net_loop_listen(ch->control_port, 1, control_client_accept, ch,
+                                    &ch->control_server.listen_sock);
+    if (err != ESP_OK) {
+        return err;
+    }
 
-        // If already connected, close old connection
-        if (control_server.connected && control_server.client_sock >= 0) {
-            ESP_LOGI(TAG, "New control client connecting, closing existing connection");
-            shutdown(control_server.client_sock, SHUT_RDWR);
-            close(control_server.client_sock);
-        }
+    ESP_LOGI(TAG, "[ch%d] Control server listening on port %u", ch->index, ch->control_port);
+    return ESP_OK;
+}
 
-        // Set up new connection
-        control_server.client_sock = sock;
-        control_server.connected = true;
+// ============= UDP STREAM =============
 
-        char addr_str[16];
-        inet_ntoa_r(source_addr.sin_addr, addr_str, sizeof(addr_str));
-        ESP_LOGI(TAG, "Control client connected from %s:%d",
-                 addr_str, ntohs(source_addr.sin_port));
+#ifdef CONFIG_UDP_STREAM_ENABLE
+/**
+ * @brief Create the UDP stream socket of a channel and apply the Kconfig destination
+ *
+ * The socket is only used for sending, so it is not added to the network
+ * loop. Sending before WiFi is up fails and the datagrams are counted as
+ * udp_send drops.
+ *
+ * @param ch Channel
+ * @return ESP_OK on success
+ */
+static esp_err_t udp_stream_start(channel_t *ch)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Unable to create UDP socket: errno %d", errno);
+        return ESP_FAIL;
+    }
+    uint8_t ttl = CONFIG_UDP_STREAM_MULTICAST_TTL;
+    if (setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) != 0) {
+        ESP_LOGW(TAG, "[ch%d] Unable to set the multicast TTL: errno %d", ch->index, errno);
+    }
+    ch->udp_sock = sock;
 
-        // Receive loop
-        char rx_buffer[128];
-        while (control_server.connected) {
-            int len = recv(sock, rx_buffer, sizeof(rx_buffer) - 1, 0);
+    struct in_addr addr;
+    if (CONFIG_UDP_STREAM_ADDRESS[0] == '\0') {
+        ESP_LOGI(TAG, "[ch%d] UDP stream off until a UDP command sets the destination", ch->index);
+    } else if (inet_aton(CONFIG_UDP_STREAM_ADDRESS, &addr) && addr.s_addr != 0) {
+        udp_stream_set_dest(ch, addr.s_addr, ch->udp_port);
+    } else {
+        ESP_LOGE(TAG, "Invalid UDP stream address \"%s\"", CONFIG_UDP_STREAM_ADDRESS);
+    }
+    return ESP_OK;
+}
 
-            if (len < 0) {
-                ESP_LOGE(TAG, "Control recv failed: errno %d", errno);
-                break;
-            } else if (len == 0) {
-                ESP_LOGI(TAG, "Control client disconnected");
+/**
+ * @brief Set the destination of a channel's UDP stream
+ *
+ * Network loop only (or before it starts). The sequence number keeps
+ * counting across changes; data received while the stream is off is not
+ * sent, which listeners see as a jump of the stream offset.
+ *
+ * @param ch Channel
+ * @param addr IPv4 unicast or multicast address (network byte order, 0 = stream off)
+ * @param port Destination port
+ */
+static void udp_stream_set_dest(channel_t *ch, uint32_t addr, uint16_t port)
+{
+    ch->udp_dest.sin_family = AF_INET;
+    ch->udp_dest.sin_addr.s_addr = addr;
+    ch->udp_dest.sin_port = addr != 0 ? htons(port) : 0;
+    ch->udp_failing = false;
+    usb_rx_stamping_update(ch);
+
+    if (addr == 0) {
+        ESP_LOGI(TAG, "[ch%d] UDP stream off", ch->index);
+        return;
+    }
+    char addr_str[16];
+    inet_ntoa_r(ch->udp_dest.sin_addr, addr_str, sizeof(addr_str));
+    ESP_LOGI(TAG, "[ch%d] UDP stream to %s:%u (%s, %d-byte datagrams)", ch->index, addr_str, port,
+             IN_MULTICAST(ntohl(addr)) ? "multicast" : "unicast", CONFIG_UDP_STREAM_DATAGRAM_SIZE);
+    net_loop_wake();
+}
+
+static bool udp_sink_is_connected(const usb_tx_sink_t *sink)
+{
+    return sink->channel->udp_dest.sin_port != 0;
+}
+
+/**
+ * @brief Send data as UDP stream datagrams without blocking
+ *
+ * Splits data into datagrams of up to UDP_STREAM_PAYLOAD_MAX bytes. The
+ * flush policy hands over whole datagrams in BULK mode, except at the ring
+ * wrap and when the fill deadline is due. Each datagram takes the arrival
+ * time of its first byte from the USB stamps. A datagram the stack has no
+ * buffer for is retried on the next pass; one that cannot be sent at all
+ * (no route, e.g. before WiFi is up) is dropped and still uses up its
+ * sequence number, so listeners see the gap.
+ *
+ * @param sink UDP stream sender
+ * @param data Data to send
+ * @param len Length of data in bytes
+ * @return Number of bytes sent or dropped
+ */
+static size_t udp_sink_send(usb_tx_sink_t *sink, const uint8_t *data, size_t len)
+{
+    static uint8_t datagram[CONFIG_UDP_STREAM_DATAGRAM_SIZE];  // Only used from the network loop
+    channel_t *ch = sink->channel;
+    size_t sent = 0;
+
+    while (sent < len) {
+        size_t n = len - sent;
+        if (n > UDP_STREAM_PAYLOAD_MAX) {
+            n = UDP_STREAM_PAYLOAD_MAX;
+        }
+        size_t pos = sink->cursor + sent;
+        size_t next;
+        int64_t time_us = usb_rx_stamp_time(ch, pos, pos + n, &next);
+
+        // Header fields are stored in native order (the ESP32-S3 is little endian)
+        uint16_t length = (uint16_t)n;
+        uint32_t offset = (uint32_t)pos;
+        uint64_t stamp = (uint64_t)time_us;
+        memcpy(datagram, UDP_STREAM_MAGIC, 4);
+        datagram[4] = UDP_STREAM_VERSION;
+        datagram[5] = (uint8_t)ch->index;
+        memcpy(datagram + 6, &length, sizeof(length));
+        memcpy(datagram + 8, &ch->udp_seq, sizeof(ch->udp_seq));
+        memcpy(datagram + 12, &offset, sizeof(offset));
+        memcpy(datagram + 16, &stamp, sizeof(stamp));
+        memcpy(datagram + UDP_STREAM_HEADER_SIZE, data + sent, n);
+
+        int ret = sendto(ch->udp_sock, datagram, UDP_STREAM_HEADER_SIZE + n, MSG_DONTWAIT,
+                         (const struct sockaddr *)&ch->udp_dest, sizeof(ch->udp_dest));
+        if (ret < 0) {
+            if (errno == ENOMEM || errno == EAGAIN || errno == EWOULDBLOCK) {
                 break;
-            } else {
-                rx_buffer[len] = '\0';
-
-                // Parse command
-                parsed_command_t cmd;
-                char response_buffer[128];
-
-                if (parse_command(rx_buffer, &cmd)) {
-                    // Execute command
-                    esp_err_t ret = execute_command(&cmd, response_buffer, sizeof(response_buffer));
-
-                    // Send response (custom for VERSION, standard for others)
-                    if (cmd.type == CMD_VERSION) {
-                        send(sock, response_buffer, strlen(response_buffer), 0);
-                    } else {
-                        const char *response = (ret == ESP_OK) ? "OK\n" : "ERROR\n";
-                        send(sock, response, strlen(response), 0);
-                    }
-                } else {
-                    // Invalid command
-                    ESP_LOGW(TAG, "Invalid command: %s", rx_buffer);
-                    const char *response = "ERROR\n";
-                    send(sock, response, strlen(response), 0);
-                }
             }
+            if (!ch->udp_failing) {
+                ESP_LOGW(TAG, "[ch%d] UDP stream send failed: errno %d, dropping datagrams",
+                         ch->index, errno);
+                ch->udp_failing = true;
+            }
+            metrics_add_drop(METRICS_DROP_UDP_SEND, n);
+        } else if (ch->udp_failing) {
+            ESP_LOGI(TAG, "[ch%d] UDP stream sending again", ch->index);
+            ch->udp_failing = false;
         }
-
-        // Connection closed
-        shutdown(sock, SHUT_RDWR);
-        close(sock);
-        control_server.client_sock = -1;
-        control_server.connected = false;
-        ESP_LOGI(TAG, "Control connection closed");
+        ch->udp_seq++;
+        sent += n;
     }
+    return sent;
 }
+#endif
 
 // ============= TCP SERVER AND BRIDGE TASKS =============
 
 /**
- * @brief TCP server task
+ * @brief Give a data port client its own state for the channel's pattern filter
  *
- * Listens for TCP connections and handles client communication
+ * Done when the client connects or the channel gets its first filter; a
+ * client without the state is sent the stream unfiltered.
+ *
+ * @param ch Channel of the data port
+ * @param client Connected client
  */
-static void tcp_server_task(void *pvParameters)
+static void tcp_client_filter_attach(channel_t *ch, tcp_client_t *client)
 {
-    struct sockaddr_in dest_addr;
-    dest_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    dest_addr.sin_family = AF_INET;
-    dest_addr.sin_port = htons(CONFIG_TCP_SERVER_PORT);
-
-    // Create listening socket
-    tcp_server.listen_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
-    if (tcp_server.listen_sock < 0) {
-        ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
-        vTaskDelete(NULL);
+    if (client->filter != NULL) {
         return;
     }
-
-    int opt = 1;
-    setsockopt(tcp_server.listen_sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-
-    ESP_LOGI(TAG, "TCP server binding to port %d", CONFIG_TCP_SERVER_PORT);
-    int err = bind(tcp_server.listen_sock, (struct sockaddr *)&dest_addr, sizeof(dest_addr));
-    if (err != 0) {
-        ESP_LOGE(TAG, "Socket bind failed: errno %d", errno);
-        close(tcp_server.listen_sock);
-        vTaskDelete(NULL);
+    client->filter = heap_caps_malloc(sizeof(tcp_client_filter_t), MALLOC_CAP_8BIT);
+    if (client->filter == NULL) {
+        ESP_LOGW(TAG, "[ch%d] TCP client %d: no memory for the pattern filter, sending unfiltered",
+                 ch->index, (int)(client - ch->tcp_server.clients));
         return;
     }
 
-    err = listen(tcp_server.listen_sock, 1);
-    if (err != 0) {
-        ESP_LOGE(TAG, "Socket listen failed: errno %d", errno);
-        close(tcp_server.listen_sock);
-        vTaskDelete(NULL);
-        return;
+    tcp_client_filter_t *filter = client->filter;
+    stream_filter_stream_init(&filter->stream, ch->filter);
+    filter->pos = 0;
+    filter->replaying = false;
+    filter->pass = 0;
+    filter->dump_pos = 0;
+    filter->dump_end = 0;
+    filter->passed_to = capture_buffer_oldest(&ch->usb_capture);
+}
+
+/**
+ * @brief Close a data port client and free its slot
+ *
+ * @param ch Channel of the data port
+ * @param slot Client slot index
+ */
+static void tcp_client_close(channel_t *ch, int slot)
+{
+    tcp_server_t *server = &ch->tcp_server;
+    tcp_client_t *client = &server->clients[slot];
+
+    net_loop_close(client->sock);
+    client->sock = -1;
+    client->connected = false;
+    ch->tcp_rx_paused &= ~(1u << slot);
+    server->client_count--;
+    ESP_LOGI(TAG, "[ch%d] TCP client %d closed (%d connected)", ch->index, slot, server->client_count);
+
+    if (client->compressor != NULL) {
+        compress_stream_t *cs = client->compressor;
+        ESP_LOGI(TAG, "[ch%d] TCP client %d: %llu bytes sent as %llu compressed bytes", ch->index, slot,
+                 (unsigned long long)cs->in_bytes, (unsigned long long)cs->out_bytes);
+        heap_caps_free(cs);
+        client->compressor = NULL;
+    }
+    if (client->framer != NULL) {
+        line_framer_t *lf = client->framer;
+        ESP_LOGI(TAG, "[ch%d] TCP client %d: %llu lines framed (%llu bytes in, %llu bytes out)",
+                 ch->index, slot, (unsigned long long)lf->lines,
+                 (unsigned long long)lf->in_bytes, (unsigned long long)lf->out_bytes);
+        heap_caps_free(lf);
+        client->framer = NULL;
+        if (--ch->tcp_framed_clients == 0) {
+            usb_rx_stamping_update(ch);
+        }
+    }
+    if (client->filter != NULL) {
+        stream_filter_stream_t *st = &client->filter->stream;
+        ESP_LOGI(TAG, "[ch%d] TCP client %d: %llu filter matches (%llu bytes in, %llu bytes passed)",
+                 ch->index, slot, (unsigned long long)st->matches,
+                 (unsigned long long)st->in_bytes, (unsigned long long)st->out_bytes);
+        heap_caps_free(client->filter);
+        client->filter = NULL;
     }
 
-    ESP_LOGI(TAG, "TCP server listening on port %d", CONFIG_TCP_SERVER_PORT);
+    // Update mDNS status
+    update_mdns_tcp_status(ch, server->client_count);
+}
 
-    while (1) {
-        struct sockaddr_in source_addr;
-        socklen_t addr_len = sizeof(source_addr);
+/**
+ * @brief Take a pool buffer for the TCP → USB queue (network loop)
+ *
+ * Only hands out a buffer when a queue slot is free too. When the path is
+ * full the TCP → USB task is asked to wake the loop once it frees buffers.
+ *
+ * @param ch Channel
+ * @return Buffer, or NULL when the path is full
+ */
+static data_buffer_t *tcp_to_usb_alloc(channel_t *ch)
+{
+    data_buffer_t *buf = NULL;
+    if (uxQueueSpacesAvailable(ch->tcp_to_usb_queue) > 0) {
+        buf = buffer_pool_alloc(&ch->buffer_pool);
+    }
+    if (buf == NULL) {
+        atomic_store(&ch->tcp_rx_blocked, true);
+    }
+    return buf;
+}
 
-        // Accept new client connection
-        int sock = accept(tcp_server.listen_sock, (struct sockaddr *)&source_addr, &addr_len);
-        if (sock < 0) {
-            ESP_LOGE(TAG, "Unable to accept connection: errno %d", errno);
-            continue;
-        }
+/**
+ * @brief Queue a buffer from tcp_to_usb_alloc() for the TCP → USB task
+ *
+ * @param ch Channel
+ * @param buf Buffer (len 0 = sync marker)
+ * @return true when queued, false when dropped
+ */
+static bool tcp_to_usb_send(channel_t *ch, data_buffer_t *buf)
+{
+    // The network loop is the only producer and a slot was free, so this
+    // only fails if the queue was resized under us
+    if (xQueueSend(ch->tcp_to_usb_queue, &buf, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "TCP→USB queue full, data dropped");
+        metrics_add_drop(METRICS_DROP_TCP_TO_USB_QUEUE, buf->len);
+        buffer_pool_free(&ch->buffer_pool, buf);
+        return false;
+    }
+    metrics_queue_level(METRICS_QUEUE_TCP_TO_USB, uxQueueMessagesWaiting(ch->tcp_to_usb_queue));
+    return true;
+}
+
+/**
+ * @brief Receive from a data port client and queue the data for USB
+ *
+ * Data is read straight into a pool buffer. When no buffer or queue slot
+ * is free the client is paused instead of read: its data stays in the
+ * TCP receive window, so the sender is throttled by TCP flow control and
+ * nothing is dropped. tcp_rx_poll() resumes it once the USB side drains.
+ *
+ * @param sock Client socket
+ * @param ctx Client slot (tcp_client_t*)
+ */
+static void tcp_client_receive(int sock, void *ctx)
+{
+    tcp_client_t *client = ctx;
+    channel_t *ch = client->channel;
+    int slot = client->slot;
 
-        // If already connected, close old connection
-        if (tcp_server.connected && tcp_server.client_sock >= 0) {
-            ESP_LOGI(TAG, "New client connecting, closing existing connection");
-            shutdown(tcp_server.client_sock, SHUT_RDWR);
-            close(tcp_server.client_sock);
+    data_buffer_t *buf = tcp_to_usb_alloc(ch);
+    if (buf == NULL) {
+        if (ch->tcp_rx_paused == 0) {
+            ESP_LOGD(TAG, "[ch%d] TCP→USB path full, pausing data port input", ch->index);
         }
+        ch->tcp_rx_paused |= 1u << slot;
+        net_loop_pause_rx(sock, true);
+        return;
+    }
 
-        // Set up new connection
-        tcp_server.client_sock = sock;
-        tcp_server.connected = true;
+    int len = recv(sock, buf->data, TCP_RX_READ_SIZE, 0);
 
-        char addr_str[16];
-        inet_ntoa_r(source_addr.sin_addr, addr_str, sizeof(addr_str));
-        ESP_LOGI(TAG, "TCP client connected from %s:%d",
-                 addr_str, ntohs(source_addr.sin_port));
+    if (len <= 0) {
+        buffer_pool_free(&ch->buffer_pool, buf);
+        if (len == 0) {
+            ESP_LOGI(TAG, "[ch%d] TCP client %d disconnected", ch->index, slot);
+            tcp_client_close(ch, slot);
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            ESP_LOGE(TAG, "TCP recv failed: errno %d", errno);
+            tcp_client_close(ch, slot);
+        }
+        return;
+    }
 
-        // Update mDNS status
-        update_mdns_tcp_status(true);
+    metrics_add_bytes(METRICS_BYTES_NET_RX, len);
+    buf->len = len;
+    tcp_to_usb_send(ch, buf);
+}
 
-        // Receive loop
-        uint8_t rx_buffer[CONFIG_TCP_RX_BUFFER_SIZE];
-        while (tcp_server.connected) {
-            int len = recv(sock, rx_buffer, sizeof(rx_buffer) - 1, 0);
+#ifdef CONFIG_RFC2217_ENABLE
+/**
+ * @brief Queue RFC2217 client data on the channel's TCP → USB path
+ *
+ * Same pool and queue as the data port, so the TCP → USB task does the
+ * USB write and a device that holds off throttles the RFC2217 client
+ * like a data port client (rfc2217_tx_path_t).
+ */
+static size_t rfc2217_tx_write(int channel, const uint8_t *data, size_t len)
+{
+    channel_t *ch = &channels[channel];
+    size_t taken = 0;
 
-            if (len < 0) {
-                ESP_LOGE(TAG, "TCP recv failed: errno %d", errno);
+    while (taken < len) {
+        data_buffer_t *buf = tcp_to_usb_alloc(ch);
+        if (buf == NULL) {
+            break;
+        }
+        buf->len = MIN(len - taken, BUFFER_POOL_DATA_SIZE);
+        memcpy(buf->data, data + taken, buf->len);
+        taken += buf->len;
+        tcp_to_usb_send(ch, buf);
+    }
+    return taken;
+}
+
+static bool rfc2217_tx_sync(int channel, uint32_t *marker)
+{
+    channel_t *ch = &channels[channel];
+    data_buffer_t *buf = tcp_to_usb_alloc(ch);
+    if (buf == NULL) {
+        return false;
+    }
+    buf->len = 0;
+    if (!tcp_to_usb_send(ch, buf)) {
+        return false;
+    }
+    *marker = ++ch->tcp_to_usb_syncs;
+    return true;
+}
+
+static bool rfc2217_tx_synced(int channel, uint32_t marker)
+{
+    return (int32_t)(atomic_load(&channels[channel].tcp_to_usb_synced) - marker) >= 0;
+}
+
+static const rfc2217_tx_path_t rfc2217_tx_path = {
+    .write = rfc2217_tx_write,
+    .sync = rfc2217_tx_sync,
+    .synced = rfc2217_tx_synced,
+};
+#endif
+
+/**
+ * @brief Resume paused data port clients (network loop poll callback)
+ *
+ * Clients stay paused until a quarter of the pool is free again, so the
+ * loop does not wake for every single buffer the USB side releases.
+ *
+ * @param now_us Current time (unused)
+ * @param ctx Unused (one callback serves every channel)
+ * @return -1: driven by wakeups from the TCP → USB tasks
+ */
+static int64_t tcp_rx_poll(int64_t now_us, void *ctx)
+{
+    (void)now_us;
+    (void)ctx;
+
+    for (int i = 0; i < CONFIG_USB_CHANNEL_COUNT; i++) {
+        channel_t *ch = &channels[i];
+        if (ch->tcp_rx_paused == 0) {
+            continue;
+        }
+
+        // Re-arm before checking, so buffers freed from now on wake the loop again
+        atomic_store(&ch->tcp_rx_blocked, true);
+        if (buffer_pool_available(&ch->buffer_pool) < TCP_RX_RESUME_BUFFERS ||
+            uxQueueSpacesAvailable(ch->tcp_to_usb_queue) < TCP_RX_RESUME_BUFFERS) {
+            continue;
+        }
+
+        for (int slot = 0; slot < CONFIG_TCP_MAX_CLIENTS; slot++) {
+            if (ch->tcp_rx_paused & (1u << slot)) {
+                net_loop_pause_rx(ch->tcp_server.clients[slot].sock, false);
+            }
+        }
+        ch->tcp_rx_paused = 0;
+        ESP_LOGD(TAG, "[ch%d] TCP→USB path drained, resuming data port input", ch->index);
+    }
+    return -1;
+}
+
+/**
+ * @brief Accept a data port client into a free slot (network loop callback)
+ *
+ * When every slot is taken the oldest client is evicted, so a peer that
+ * reconnects after losing its link is never locked out by a stale session.
+ *
+ * @param listen_sock Data port listening socket
+ * @param ctx Channel of the data port
+ */
+static void tcp_client_accept(int listen_sock, void *ctx)
+{
+    static uint32_t accept_seq = 1;
+    channel_t *ch = ctx;
+    tcp_server_t *server = &ch->tcp_server;
+    struct sockaddr_in source_addr;
+    socklen_t addr_len = sizeof(source_addr);
+
+    int sock = accept(listen_sock, (struct sockaddr *)&source_addr, &addr_len);
+    if (sock < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            ESP_LOGE(TAG, "Unable to accept connection: errno %d", errno);
+        }
+        return;
+    }
+
+    int slot = -1;
+    int oldest = 0;
+    for (int i = 0; i < CONFIG_TCP_MAX_CLIENTS; i++) {
+        if (server->clients[i].sock < 0) {
+            slot = i;
+            break;
+        }
+        if (server->clients[i].accept_seq < server->clients[oldest].accept_seq) {
+            oldest = i;
+        }
+    }
+    if (slot < 0) {
+        ESP_LOGI(TAG, "[ch%d] All %d client slots in use, closing oldest client",
+                 ch->index, CONFIG_TCP_MAX_CLIENTS);
+        tcp_client_close(ch, oldest);
+        slot = oldest;
+    }
+
+    tcp_client_t *client = &server->clients[slot];
+    if (net_loop_add(sock, TCP_CLIENT_TX_QUEUE_SIZE, tcp_client_receive, client) != ESP_OK) {
+        ESP_LOGE(TAG, "No room for TCP connection");
+        close(sock);
+        return;
+    }
+
+    // Coalescing is done by the flush policy, so Nagle must not add delay
+    int nodelay = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+    // Set up new connection
+    client->accept_seq = accept_seq++;
+    client->sock = sock;
+    client->connected = true;
+    server->client_count++;
+
+    // Compression state is allocated once per connection; the stream header
+    // always fits as the write queue is still empty
+    if (ch->tcp_compress_next) {
+        ch->tcp_compress_next = false;
+        client->compressor = heap_caps_malloc(sizeof(compress_stream_t), MALLOC_CAP_8BIT);
+        if (client->compressor != NULL) {
+            uint8_t header[COMPRESS_STREAM_HEADER_SIZE];
+            compress_stream_reset(client->compressor);
+            net_loop_send(sock, header, compress_stream_header(client->compressor, header));
+            ESP_LOGI(TAG, "[ch%d] TCP client %d: LZ4 compressed stream", ch->index, slot);
+        } else {
+            ESP_LOGW(TAG, "[ch%d] TCP client %d: no memory for compression, sending raw", ch->index, slot);
+        }
+    }
+
+    // Timestamp framing goes inside the compression; its header follows the
+    // compression header (and is compressed like the rest of the stream)
+    line_framer_format_t frame_format = ch->tcp_frame_next;
+    ch->tcp_frame_next = TCP_FRAME_DEFAULT;
+    if (frame_format != LINE_FRAMER_NONE) {
+        client->framer = heap_caps_malloc(sizeof(line_framer_t), MALLOC_CAP_8BIT);
+        if (client->framer != NULL) {
+            uint8_t header[LINE_FRAMER_HEADER_SIZE];
+            line_framer_reset(client->framer, frame_format);
+            size_t header_len = line_framer_header(client->framer, esp_timer_get_time(), header);
+            if (header_len > 0) {
+                tcp_client_send_framed(client, header, header_len);
+            }
+            ch->tcp_framed_clients++;
+            usb_rx_stamping_update(ch);
+            ESP_LOGI(TAG, "[ch%d] TCP client %d: %s timestamp framing", ch->index, slot,
+                     frame_format == LINE_FRAMER_BINARY ? "binary" : "text");
+        } else {
+            ESP_LOGW(TAG, "[ch%d] TCP client %d: no memory for framing, sending raw", ch->index, slot);
+        }
+    }
+    if (ch->filter != NULL) {
+        tcp_client_filter_attach(ch, client);
+    }
+
+    char addr_str[16];
+    inet_ntoa_r(source_addr.sin_addr, addr_str, sizeof(addr_str));
+    ESP_LOGI(TAG, "[ch%d] TCP client %d connected from %s:%d (%d connected)",
+             ch->index, slot, addr_str, ntohs(source_addr.sin_port), server->client_count);
+
+    // Update mDNS status
+    update_mdns_tcp_status(ch, server->client_count);
+}
+
+/**
+ * @brief Start the TCP data server of a channel
+ *
+ * Serves up to CONFIG_TCP_MAX_CLIENTS clients from the network loop.
+ * Every client receives the full USB stream of the channel's device;
+ * data received from any client is forwarded to that device.
+ *
+ * @param ch Channel
+ * @return ESP_OK on success
+ */
+static esp_err_t tcp_server_start(channel_t *ch)
+{
+    ESP_LOGI(TAG, "[ch%d] TCP server binding to port %u", ch->index, ch->data_port);
+    esp_err_t err = net_loop_listen(ch->data_port, CONFIG_TCP_MAX_CLIENTS,
+                                    tcp_client_accept, ch, &ch->tcp_server.listen_sock);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    ESP_LOGI(TAG, "[ch%d] TCP server listening on port %u (max %d clients)",
+             ch->index, ch->data_port, CONFIG_TCP_MAX_CLIENTS);
+    return ESP_OK;
+}
+
+static bool tcp_sink_is_connected(const usb_tx_sink_t *sink)
+{
+    return sink->channel->tcp_server.clients[sink->slot].connected;
+}
+
+/**
+ * @brief Queue framed output to a data port client, compressing it if enabled
+ *
+ * The caller makes sure the output fits: for a compressed stream len is at
+ * most compress_stream_max_input() of the write queue space.
+ *
+ * @param client Connected client
+ * @param data Framed output
+ * @param len Length of data in bytes (1 to COMPRESS_STREAM_BLOCK_MAX)
+ */
+static void tcp_client_send_framed(tcp_client_t *client, const uint8_t *data, size_t len)
+{
+    static uint8_t frame[COMPRESS_STREAM_FRAME_MAX];  // Only used from the network loop
+
+    if (client->compressor == NULL) {
+        net_loop_send(client->sock, data, len);
+        return;
+    }
+    size_t frame_len = compress_stream_frame(client->compressor, data, len, frame);
+    net_loop_send(client->sock, frame, frame_len);
+}
+
+/**
+ * @brief Queue unframed data to a data port client, compressing it if enabled
+ *
+ * For a compressed stream, as much input is taken as its worst-case frame
+ * fits into the socket's write queue, so a frame is never split and the
+ * return value still counts input bytes.
+ *
+ * @param client Connected client
+ * @param data Data to send
+ * @param len Length of data in bytes
+ * @return Number of bytes accepted
+ */
+static size_t tcp_client_send_raw(tcp_client_t *client, const uint8_t *data, size_t len)
+{
+    if (client->compressor == NULL) {
+        return net_loop_send(client->sock, data, len);
+    }
+
+    size_t accepted = 0;
+    while (accepted < len) {
+        size_t n = compress_stream_max_input(net_loop_tx_space(client->sock));
+        if (n == 0) {
+            break;
+        }
+        if (n > len - accepted) {
+            n = len - accepted;
+        }
+        tcp_client_send_framed(client, data + accepted, n);
+        accepted += n;
+    }
+    return accepted;
+}
+
+/**
+ * @brief Frame data that shares one arrival time and queue it to a data port client
+ *
+ * @param client Connected client with timestamp framing
+ * @param data Data to frame
+ * @param len Length of data in bytes
+ * @param time_us Arrival time of every byte of data
+ * @return Number of bytes accepted
+ */
+static size_t tcp_client_send_timed(tcp_client_t *client, const uint8_t *data, size_t len, int64_t time_us)
+{
+    static uint8_t framed[TCP_FRAME_CHUNK_SIZE];  // Only used from the network loop
+
+    size_t accepted = 0;
+    while (accepted < len) {
+        size_t space = net_loop_tx_space(client->sock);
+        if (client->compressor != NULL) {
+            space = compress_stream_max_input(space);
+        }
+        if (space > sizeof(framed)) {
+            space = sizeof(framed);
+        }
+
+        size_t used;
+        size_t out_len = line_framer_encode(client->framer, data + accepted, len - accepted, time_us,
+                                            framed, space, &used);
+        if (used == 0) {
+            break;
+        }
+        tcp_client_send_framed(client, framed, out_len);
+        accepted += used;
+    }
+    return accepted;
+}
+
+/**
+ * @brief Arrival time of data a data port client sends
+ *
+ * Taken from the USB arrival stamps, or from the capture marks for data
+ * read from the capture.
+ *
+ * @param ch Channel
+ * @param start Position of the data
+ * @param[in,out] next End of the data, lowered to the end of the data sharing the time
+ * @param from_capture start is a capture position
+ * @return Arrival time in microseconds
+ */
+static int64_t tcp_client_data_time(channel_t *ch, size_t start, size_t *next, bool from_capture)
+{
+    size_t end = *next;
+    int64_t time_us;
+
+    if (!from_capture) {
+        time_us = usb_rx_stamp_time(ch, start, end, next);
+    } else if (capture_buffer_time_at(&ch->usb_capture, start, &time_us, next)) {
+        if ((ptrdiff_t)(*next - end) > 0) {
+            *next = end;
+        }
+    } else {
+        time_us = esp_timer_get_time();
+        *next = end;
+    }
+    return time_us;
+}
+
+/**
+ * @brief Queue stream data to a data port client: framed, compressed or raw
+ *
+ * A framed stream is framed first, taking each line's time from the USB
+ * arrival stamps (or the capture marks for capture data), then compressed
+ * like an unframed one.
+ *
+ * @param client Connected client
+ * @param data Data to send
+ * @param len Length of data in bytes
+ * @param pos Position of data in the ring, or in the capture
+ * @param from_capture pos is a capture position
+ * @return Number of bytes accepted
+ */
+static size_t tcp_client_send_stream(tcp_client_t *client, const uint8_t *data, size_t len,
+                                     size_t pos, bool from_capture)
+{
+    if (client->framer == NULL) {
+        return tcp_client_send_raw(client, data, len);
+    }
+
+    size_t accepted = 0;
+    while (accepted < len) {
+        size_t start = pos + accepted;
+        size_t next = pos + len;
+        int64_t time_us = tcp_client_data_time(client->channel, start, &next, from_capture);
+        size_t n = next - start;
+        size_t sent = tcp_client_send_timed(client, data + accepted, n, time_us);
+        accepted += sent;
+        if (sent == 0 || sent < n) {
+            break;
+        }
+    }
+    return accepted;
+}
+
+/**
+ * @brief Capture position of data a data port client sends
+ *
+ * @param sink Sender for the client slot
+ * @param pos Position in the ring, or in the capture while replaying
+ * @return Capture position
+ */
+static size_t tcp_sink_capture_pos(const usb_tx_sink_t *sink, size_t pos)
+{
+    const channel_t *ch = sink->channel;
+    if (sink->replaying) {
+        return pos;
+    }
+    // The capture holds everything in the ring up to usb_capture_cursor
+    return capture_buffer_head(&ch->usb_capture) - (ch->usb_capture_cursor - pos);
+}
+
+/**
+ * @brief Send the pre-context of a trigger dump from the capture
+ *
+ * @param client Connected client with a dump pending
+ * @return true once all of it is sent
+ */
+static bool tcp_client_send_dump(tcp_client_t *client)
+{
+    tcp_client_filter_t *filter = client->filter;
+    const capture_buffer_t *capture = &client->channel->usb_capture;
+
+    // What the capture overwrote meanwhile is lost
+    size_t oldest = capture_buffer_oldest(capture);
+    if ((ptrdiff_t)(filter->dump_pos - oldest) < 0) {
+        filter->dump_pos = (ptrdiff_t)(filter->dump_end - oldest) > 0 ? oldest : filter->dump_end;
+    }
+
+    while (filter->dump_pos != filter->dump_end) {
+        const uint8_t *data;
+        size_t len = capture_buffer_peek_from(capture, filter->dump_pos, &data);
+        if (len == 0) {
+            filter->dump_pos = filter->dump_end;
+            break;
+        }
+        if (len > filter->dump_end - filter->dump_pos) {
+            len = filter->dump_end - filter->dump_pos;
+        }
+        size_t sent = tcp_client_send_stream(client, data, len, filter->dump_pos, true);
+        filter->dump_pos += sent;
+        if (sent < len) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Send the line the filter holds
+ *
+ * @param client Connected client
+ * @param time_us Arrival time for the framing
+ * @return true once all of it is sent
+ */
+static bool tcp_client_send_held_line(tcp_client_t *client, int64_t time_us)
+{
+    stream_filter_stream_t *st = &client->filter->stream;
+    if (!st->ready || st->line_sent == st->line_len) {
+        return true;
+    }
+
+    const uint8_t *line = st->line + st->line_sent;
+    size_t n = st->line_len - st->line_sent;
+    st->line_sent += client->framer != NULL ? tcp_client_send_timed(client, line, n, time_us)
+                                            : tcp_client_send_raw(client, line, n);
+    return st->line_sent == st->line_len;
+}
+
+/**
+ * @brief Send data to a data port client through the channel's pattern filter
+ *
+ * LINES sends only the complete lines that contain a pattern, framed with
+ * the arrival time of their first byte. TRIGGER sends nothing until a
+ * pattern matches, then the pre-context from the capture (channel 0;
+ * elsewhere only the start of the matching line) followed by the live
+ * stream until the post-context has passed. Dropped data counts as
+ * accepted, so the filter never holds back the ring; what it passed but
+ * the socket did not take goes first on the next call. A gap in the
+ * client's stream (oldest data dropped, a replay starting) or a change of
+ * the filter restarts it; the end of a replay does not, as live data
+ * continues it.
+ *
+ * @param sink Sender for the client slot
+ * @param data Data to send
+ * @param len Length of data in bytes
+ * @param pos Position of data in the ring, or in the capture while replaying
+ * @return Number of bytes accepted
+ */
+static size_t tcp_sink_send_filtered(usb_tx_sink_t *sink, const uint8_t *data, size_t len, size_t pos)
+{
+    channel_t *ch = sink->channel;
+    const stream_filter_t *sf = ch->filter;
+    tcp_client_t *client = &ch->tcp_server.clients[sink->slot];
+    tcp_client_filter_t *filter = client->filter;
+    stream_filter_stream_t *st = &filter->stream;
+
+    bool replay_ended = filter->replaying && !sink->replaying;
+    bool gap = !replay_ended && (pos != filter->pos || sink->replaying != filter->replaying);
+    if (gap || st->generation != sf->generation) {
+        stream_filter_stream_reset(st, sf);
+        filter->pass = 0;
+        filter->dump_pos = filter->dump_end;
+    }
+
+    size_t accepted = 0;
+    if (sf->mode == STREAM_FILTER_LINES) {
+        while (tcp_client_send_held_line(client, st->line_time_us) && accepted < len) {
+            size_t next = pos + len;
+            int64_t time_us = 0;
+            if (client->framer != NULL) {
+                time_us = tcp_client_data_time(ch, pos + accepted, &next, sink->replaying);
+            }
+            accepted += stream_filter_lines(st, sf, data + accepted, next - (pos + accepted), time_us);
+        }
+    } else {
+        while (true) {
+            if (filter->dump_pos != filter->dump_end && !tcp_client_send_dump(client)) {
                 break;
-            } else if (len == 0) {
-                ESP_LOGI(TAG, "TCP client disconnected");
+            }
+            if (st->ready) {
+                size_t next = pos + len;
+                int64_t time_us = client->framer != NULL
+                                  ? tcp_client_data_time(ch, pos + accepted, &next, sink->replaying) : 0;
+                if (!tcp_client_send_held_line(client, time_us)) {
+                    break;
+                }
+            }
+            if (filter->pass > 0) {
+                size_t n = MIN(filter->pass, len - accepted);
+                size_t sent = tcp_client_send_stream(client, data + accepted, n, pos + accepted,
+                                                     sink->replaying);
+                accepted += sent;
+                filter->pass -= sent;
+                if (ch->usb_capture.size > 0) {
+                    filter->passed_to = tcp_sink_capture_pos(sink, pos + accepted);
+                }
+                if (sent < n) {
+                    break;
+                }
+            }
+            if (accepted == len) {
                 break;
-            } else {
-                // Allocate buffer from pool
-                data_buffer_t *buf = buffer_alloc();
-                if (buf != NULL) {
-                    memcpy(buf->data, rx_buffer, len);
-                    buf->len = len;
-
-                    // Send buffer pointer to queue
-                    if (xQueueSend(tcp_to_usb_queue, &buf, 0) != pdTRUE) {
-                        ESP_LOGW(TAG, "TCP→USB queue full, data dropped");
-                        buffer_free(buf);  // Free buffer if queue is full
-                    }
+            }
+
+            stream_filter_span_t span;
+            stream_filter_trigger(st, sf, data + accepted, len - accepted, &span);
+            accepted += span.skip;
+            filter->pass = span.pass;
+            if (span.triggered && ch->usb_capture.size > 0) {
+                // The capture holds the context before the passed bytes,
+                // the start of the matching line included; a dump never
+                // repeats what the previous one sent
+                size_t end = tcp_sink_capture_pos(sink, pos + accepted);
+                size_t want = MAX(sf->pre_context, st->ready ? st->line_len : 0);
+                size_t start = end - MIN(want, end - capture_buffer_oldest(&ch->usb_capture));
+                if ((ptrdiff_t)(filter->passed_to - start) > 0 && (ptrdiff_t)(end - filter->passed_to) >= 0) {
+                    start = filter->passed_to;
+                }
+                filter->dump_pos = start;
+                filter->dump_end = end;
+                st->ready = false;
+            }
+        }
+    }
+
+    filter->pos = pos + accepted;
+    filter->replaying = sink->replaying;
+    return accepted;
+}
+
+/**
+ * @brief Send data to one raw TCP client (port 8888) without blocking
+ *
+ * Data goes through the channel's pattern filter when one is set, then
+ * timestamp framing and compression as selected for the connection. On
+ * a socket error the network loop shuts the connection down and the slot
+ * is freed on the next read.
+ *
+ * @param sink Sender for the client slot
+ * @param data Data to send
+ * @param len Length of data in bytes
+ * @return Number of bytes accepted (0 when the socket and its write queue are full)
+ */
+static size_t tcp_sink_send(usb_tx_sink_t *sink, const uint8_t *data, size_t len)
+{
+    channel_t *ch = sink->channel;
+    tcp_client_t *client = &ch->tcp_server.clients[sink->slot];
+
+    // Position of data in the ring, or in the capture while replaying
+    size_t pos = sink->replaying ? sink->replay_pos : sink->cursor;
+    if (client->filter != NULL && ch->filter->mode != STREAM_FILTER_OFF) {
+        return tcp_sink_send_filtered(sink, data, len, pos);
+    }
+    return tcp_client_send_stream(client, data, len, pos, sink->replaying);
+}
+
+/**
+ * @brief Close the current send stall of a sender, if any, into the metrics
+ *
+ * @param sink Sender
+ * @param index Sender index (metrics client index)
+ * @param now_us Current time in microseconds
+ */
+static void usb_tx_sink_end_stall(usb_tx_sink_t *sink, int index, int64_t now_us)
+{
+    if (sink->stalled_since_us >= 0) {
+        metrics_client_stall(index, now_us - sink->stalled_since_us);
+        sink->stalled_since_us = -1;
+    }
+}
+
+/**
+ * @brief Start sending capture history to a sender
+ *
+ * Network loop only.
+ *
+ * @param sink Sender with a connected client
+ * @param pos Capture position to replay from
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED when capture is disabled
+ */
+static esp_err_t usb_tx_sink_start_replay(usb_tx_sink_t *sink, size_t pos)
+{
+    capture_buffer_t *capture = &sink->channel->usb_capture;
+    if (capture->size == 0) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    size_t bytes = capture_buffer_head(capture) - pos;
+    ESP_LOGI(TAG, "[ch%d] %s client %d: replaying %u captured bytes",
+             sink->channel->index, sink->name, sink->slot, (unsigned)bytes);
+    sink->replaying = bytes > 0;
+    sink->replay_pos = pos;
+    return ESP_OK;
+}
+
+/**
+ * @brief Send capture history to a replaying sender
+ *
+ * History is sent at network speed, ignoring the flush policy. Meanwhile
+ * the live cursor follows the ring head without holding it back, since
+ * everything that arrives is captured too. The capture head equals the
+ * ring head within one pass, so once the replay reaches it live data
+ * continues without gap or overlap. A replay that falls behind the
+ * capture buffer loses its oldest data.
+ *
+ * @param sink Sender
+ * @param index Sender index (metrics client index)
+ * @param head Ring head of this pass
+ * @param now_us Current time in microseconds
+ * @return true while the replay is still in progress
+ */
+static bool usb_tx_sink_replay(usb_tx_sink_t *sink, int index, size_t head, int64_t now_us)
+{
+    capture_buffer_t *capture = &sink->channel->usb_capture;
+    size_t cap_head = capture_buffer_head(capture);
+    size_t oldest = capture_buffer_oldest(capture);
+    if (cap_head - sink->replay_pos > cap_head - oldest) {
+        metrics_add_drop(METRICS_DROP_CLIENT_LAG, oldest - sink->replay_pos);
+        sink->replay_pos = oldest;
+    }
+
+    while (sink->replay_pos != cap_head) {
+        const uint8_t *data;
+        size_t len = capture_buffer_peek_from(capture, sink->replay_pos, &data);
+        size_t sent = sink->send(sink, data, len);
+        sink->replay_pos += sent;
+        if (sent > 0) {
+            sink->last_progress_us = now_us;
+            metrics_add_bytes(METRICS_BYTES_NET_TX, sent);
+            metrics_client_sent(index, sent);
+        }
+        if (sent < len) {
+            break;
+        }
+    }
+
+    sink->cursor = head;
+    if (sink->replay_pos != cap_head) {
+        return true;
+    }
+
+    ESP_LOGI(TAG, "[ch%d] %s client %d: replay done, streaming live",
+             sink->channel->index, sink->name, sink->slot);
+    sink->replaying = false;
+    flush_policy_flushed(&sink->policy);
+    return false;
+}
+
+/**
+ * @brief USB → TCP bridge (network loop poll callback)
+ *
+ * Forwards data from USB to the TCP clients, the RFC2217 server and the
+ * UDP stream. Each sender keeps its own cursor into the ring and flushes
+ * according to its policy; the ring is released up to the slowest cursor.
+ * Data port clients never block: one that falls more than half a ring
+ * behind loses its oldest data, and one that accepts nothing for
+ * CONFIG_TCP_CLIENT_STALL_TIMEOUT_MS is disconnected. A batching sender
+ * (the UDP stream) sends whole datagrams until its deadline is due. A
+ * one-shot timer wakes the loop at the next flush deadline; a full socket
+ * wakes it once its write queue drains. Everything is first
+ * copied into the capture buffer, which replays are served from. There is
+ * one poll callback per channel.
+ *
+ * @param now_us Current time in microseconds
+ * @param ctx Channel
+ * @return Always -1 (deadlines are handled by the flush timer)
+ */
+static int64_t usb_tx_poll(int64_t now_us, void *ctx)
+{
+    channel_t *ch = ctx;
+    stream_ring_t *ring = &ch->usb_rx_ring;
+    size_t head = stream_ring_head(ring);
+    int64_t wait_us = -1;
+    size_t release = head;
+    int connected = 0;
+
+    // Capture and spool everything new before any sender can release it
+    // (only channel 0 has a capture buffer and the log spool)
+    while (ch->usb_capture_cursor != head) {
+        const uint8_t *data;
+        size_t len = stream_ring_peek_from(ring, ch->usb_capture_cursor, &data);
+        if (len > head - ch->usb_capture_cursor) {
+            len = head - ch->usb_capture_cursor;
+        }
+        if (ch->usb_capture.size > 0) {
+            capture_buffer_append(&ch->usb_capture, data, len, now_us);
+        }
+        if (ch->index == 0) {
+            log_spool_append(data, len, now_us);
+        }
+        ch->usb_capture_cursor += len;
+    }
+
+    for (int i = 0; i < USB_TX_SINK_COUNT; i++) {
+        usb_tx_sink_t *sink = &ch->usb_tx_sinks[i];
+        int index = ch->index * USB_TX_SINK_COUNT + i;  // Metrics client index
+
+        flush_mode_t mode = atomic_load(&sink->mode_request);
+        if (mode != sink->policy.mode) {
+            flush_policy_set_mode(&sink->policy, mode);
+        }
+
+        // Without a client the data is dropped, as before
+        if (sink->send == NULL || !sink->is_connected(sink)) {
+            usb_tx_sink_end_stall(sink, index, now_us);
+            sink->cursor = head;
+            sink->last_progress_us = now_us;
+            sink->lagging = false;
+            sink->active = false;
+            sink->replaying = false;
+            flush_policy_flushed(&sink->policy);
+            continue;
+        }
+        connected++;
+
+        // A new client (also one that took over a slot between two passes)
+        // starts live, after the configured replay of the capture
+        if (!sink->active ||
+            (sink->slot >= 0 && sink->session != ch->tcp_server.clients[sink->slot].accept_seq)) {
+            usb_tx_sink_end_stall(sink, index, now_us);
+            if (sink->slot >= 0) {
+                sink->session = ch->tcp_server.clients[sink->slot].accept_seq;
+            }
+            sink->active = true;
+            sink->cursor = head;
+            sink->last_progress_us = now_us;
+            sink->lagging = false;
+            flush_policy_flushed(&sink->policy);
+            // UDP listeners come and go unseen, so the stream is not replayed
+            if (CONFIG_CAPTURE_REPLAY_ON_CONNECT_KB > 0 && !sink->replaying && i != USB_TX_SINK_UDP) {
+                usb_tx_sink_start_replay(sink, capture_buffer_pos_for_bytes(
+                                             &ch->usb_capture, CONFIG_CAPTURE_REPLAY_ON_CONNECT_KB * 1024));
+            }
+        }
+
+        if (sink->replaying) {
+            if (usb_tx_sink_replay(sink, index, head, now_us)) {
+                if (CONFIG_TCP_CLIENT_STALL_TIMEOUT_MS > 0 && sink->slot >= 0 &&
+                    now_us - sink->last_progress_us > CONFIG_TCP_CLIENT_STALL_TIMEOUT_MS * 1000LL) {
+                    ESP_LOGW(TAG, "[ch%d] %s client %d stalled during replay, disconnecting",
+                             sink->channel->index, sink->name, sink->slot);
+                    tcp_client_close(ch, sink->slot);
+                }
+                continue;   // The cursor is at head, so the ring is not held back
+            }
+        }
+
+        // A lossy sender that fell too far behind skips its oldest data
+        size_t backlog = head - sink->cursor;
+        if (sink->lossy && backlog > USB_TX_MAX_BACKLOG(ch)) {
+            if (!sink->lagging) {
+                if (sink->slot >= 0) {
+                    ESP_LOGW(TAG, "[ch%d] %s client %d is too slow, dropping oldest data",
+                             sink->channel->index, sink->name, sink->slot);
                 } else {
-                    ESP_LOGW(TAG, "No buffer available, TCP data dropped");
+                    ESP_LOGW(TAG, "[ch%d] %s stream is too slow, dropping oldest data",
+                             sink->channel->index, sink->name);
+                }
+                sink->lagging = true;
+            }
+            metrics_add_drop(METRICS_DROP_CLIENT_LAG, backlog - USB_TX_MAX_BACKLOG(ch));
+            sink->cursor = head - USB_TX_MAX_BACKLOG(ch);
+        }
+
+        if (flush_policy_should_flush(&sink->policy, head - sink->cursor, now_us)) {
+            // A batching sender sends whole batches only until the deadline
+            // is due; the partial batch waits for more data
+            size_t end = head;
+            if (sink->batch > 0 && flush_policy_time_left_us(&sink->policy, now_us) > 0) {
+                end = head - (head - sink->cursor) % sink->batch;
+            }
+
+            // Send in the largest contiguous spans available
+            while (sink->cursor != end) {
+                const uint8_t *data;
+                size_t len = stream_ring_peek_from(ring, sink->cursor, &data);
+                if (len > end - sink->cursor) {
+                    len = end - sink->cursor;
+                }
+                size_t sent = sink->send(sink, data, len);
+                sink->cursor += sent;
+                if (sent > 0) {
+                    sink->last_progress_us = now_us;
+                    metrics_add_bytes(METRICS_BYTES_NET_TX, sent);
+                    metrics_client_sent(index, sent);
+                }
+                if (sent < len) {
+                    break;
+                }
+            }
+
+            if (sink->cursor == head) {
+                usb_tx_sink_end_stall(sink, index, now_us);
+                flush_policy_flushed(&sink->policy);
+                sink->last_progress_us = now_us;
+                sink->lagging = false;
+            } else if (sink->cursor == end) {
+                // Partial batch held back: keep its deadline running
+                usb_tx_sink_end_stall(sink, index, now_us);
+                sink->last_progress_us = now_us;
+                sink->lagging = false;
+                int64_t left = flush_policy_time_left_us(&sink->policy, now_us);
+                if (left >= 0 && (wait_us < 0 || left < wait_us)) {
+                    wait_us = left;
                 }
+            } else if (CONFIG_TCP_CLIENT_STALL_TIMEOUT_MS > 0 && sink->slot >= 0 &&
+                       now_us - sink->last_progress_us > CONFIG_TCP_CLIENT_STALL_TIMEOUT_MS * 1000LL) {
+                ESP_LOGW(TAG, "[ch%d] %s client %d stalled, disconnecting",
+                         sink->channel->index, sink->name, sink->slot);
+                metrics_add_drop(METRICS_DROP_CLIENT_STALL, head - sink->cursor);
+                usb_tx_sink_end_stall(sink, index, now_us);
+                tcp_client_close(ch, sink->slot);
+                sink->cursor = head;
+            } else if (sink->stalled_since_us < 0) {
+                // The socket did not take everything: stalled until it catches up
+                sink->stalled_since_us = now_us;
+            }
+        } else {
+            int64_t left = flush_policy_time_left_us(&sink->policy, now_us);
+            if (left >= 0 && (wait_us < 0 || left < wait_us)) {
+                wait_us = left;
             }
         }
 
-        // Connection closed
-        shutdown(sock, SHUT_RDWR);
-        close(sock);
-        tcp_server.client_sock = -1;
-        tcp_server.connected = false;
-        ESP_LOGI(TAG, "TCP connection closed");
+        if (head - sink->cursor > head - release) {
+            release = sink->cursor;
+        }
+    }
 
-        // Update mDNS status
-        update_mdns_tcp_status(false);
+    // With nobody connected, everything released now is lost (tail is ours)
+    size_t released = release - atomic_load(&ring->tail);
+    if (connected == 0 && released > 0) {
+        metrics_add_drop(METRICS_DROP_NO_CLIENT, released);
+    }
+
+    // Release what every sender has sent, then wake a USB callback blocked
+    // on a full ring. The fence orders the tail update before reading the flag.
+    stream_ring_consume_to(ring, release);
+    usb_rx_stamps_release(ch, release);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&ch->usb_rx_producer_waiting)) {
+        xSemaphoreGive(ch->usb_rx_space_sem);
     }
+
+    if (wait_us > 0) {
+        esp_timer_stop(ch->usb_flush_timer);
+        esp_timer_start_once(ch->usb_flush_timer, wait_us);
+    }
+
+    return -1;
 }
 
 /**
- * @brief USB → TCP bridge task
+ * @brief Write one gathered batch to the USB device (TCP → USB task)
+ *
+ * The device is held with serial_control_acquire() for the write, so a
+ * disconnect waits for it before closing the driver handle.
  *
- * Forwards data from USB to TCP client and RFC2217 server
+ * @param ch Channel
+ * @param batch Data
+ * @param len Length of data in bytes
  */
-static void usb_to_tcp_bridge_task(void *pvParameters)
+static void tcp_to_usb_write(channel_t *ch, const uint8_t *batch, size_t len)
 {
-    data_buffer_t *buf;
+    serial_device_type_t type;
+    void *handle;
+    if (!serial_control_acquire(ch->index, &type, &handle)) {
+        metrics_add_drop(METRICS_DROP_NO_DEVICE, len);
+        return;
+    }
 
-    while (1) {
-        if (xQueueReceive(usb_to_tcp_queue, &buf, portMAX_DELAY) == pdTRUE) {
-            // Forward to raw TCP client (port 8888)
-            if (tcp_server.connected && tcp_server.client_sock >= 0) {
-                xSemaphoreTake(tcp_server.tx_mutex, portMAX_DELAY);
-
-                int to_write = buf->len;
-                int written = 0;
-                while (to_write > 0) {
-                    int ret = send(tcp_server.client_sock, buf->data + written, to_write, 0);
-                    if (ret < 0) {
-                        ESP_LOGE(TAG, "TCP send failed: errno %d", errno);
-                        tcp_server.connected = false;
-                        break;
-                    }
-                    written += ret;
-                    to_write -= ret;
-                }
+    esp_err_t err = ESP_OK;
+    size_t sent = 0;
+    int64_t start_us = esp_timer_get_time();
 
-                xSemaphoreGive(tcp_server.tx_mutex);
+    if (type == SERIAL_DEVICE_CDC) {
+        err = cdc_acm_host_data_tx_blocking((cdc_acm_dev_hdl_t)handle, batch, len, 1000);
+        sent = err == ESP_OK ? len : 0;
+    } else {
+        // Queue without waiting for completion so several OUT transfers
+        // stay in flight; the data is copied, so batch can be reused right away.
+        // With flow control the chip holds off and the transfers stop
+        // completing: keep retrying the same chunk while the device is
+        // there, the queue and pool fill up and the data port clients
+        // are paused, so the hold-off reaches the TCP senders
+        bool stalled = false;
+        while (sent < len) {
+            size_t chunk = MIN(len - sent, FTDI_OUT_CHUNK_SIZE);
+            err = ftdi_sio_host_data_tx_async((ftdi_sio_dev_hdl_t)handle, batch + sent, chunk, 1000);
+            if (err == ESP_ERR_TIMEOUT && serial_control_is_connected(ch->index)) {
+                if (!stalled) {
+                    ESP_LOGW(TAG, "[ch%d] USB TX stalled, device is holding off", ch->index);
+                    stalled = true;
+                }
+                continue;
             }
-
-            // Forward to RFC2217 client (port 2217)
-            if (rfc2217_server_is_connected()) {
-                rfc2217_server_send_data(buf->data, buf->len);
+            if (err != ESP_OK) {
+                break;
             }
+            sent += chunk;
+        }
+        if (stalled && err == ESP_OK) {
+            ESP_LOGI(TAG, "[ch%d] USB TX resumed", ch->index);
+        }
+    }
+    serial_control_release(ch->index);
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "USB TX failed: %s", esp_err_to_name(err));
+        metrics_add_drop(METRICS_DROP_USB_TX_ERROR, len - sent);
+    }
+    if (sent > 0) {
+        metrics_record_latency(METRICS_LATENCY_USB_TX,
+                               (uint32_t)(esp_timer_get_time() - start_us));
+        metrics_add_bytes(METRICS_BYTES_USB_TX, sent);
+    }
+}
 
-            // Free buffer after processing
-            buffer_free(buf);
+/**
+ * @brief Wait until the device has taken everything written (TCP → USB task)
+ *
+ * CDC-ACM writes have completed when they return. FTDI writes are
+ * pipelined, so wait for the OUT transfers; a flush that times out while
+ * the device holds off has lost nothing, so keep waiting while it stays
+ * connected.
+ *
+ * @param ch Channel
+ */
+static void tcp_to_usb_flush(channel_t *ch)
+{
+    serial_device_type_t type;
+    void *handle;
+    if (!serial_control_acquire(ch->index, &type, &handle)) {
+        return;
+    }
+    if (type == SERIAL_DEVICE_FTDI) {
+        while (ftdi_sio_host_data_tx_flush((ftdi_sio_dev_hdl_t)handle, 1000) == ESP_ERR_TIMEOUT &&
+               serial_control_is_connected(ch->index)) {
         }
     }
+    serial_control_release(ch->index);
 }
 
 /**
  * @brief TCP → USB bridge task
  *
- * Forwards data from TCP to USB serial device
+ * Forwards data from TCP to the USB serial device of a channel. Buffers
+ * already waiting in the queue are gathered into one transfer of up to
+ * USB_TX_BATCH_SIZE bytes, so a fast device is not limited to one pool
+ * buffer per transfer. There is one task per channel, so a device that
+ * holds off only stalls its own channel, never the network loop.
+ *
+ * An empty buffer is a sync marker: once the data before it is on the
+ * device, tcp_to_usb_synced is advanced and the network loop woken, so
+ * the RFC2217 server can apply settings in order with the data.
+ *
+ * @param pvParameters Channel
  */
 static void tcp_to_usb_bridge_task(void *pvParameters)
 {
-    data_buffer_t *buf;
+    channel_t *ch = pvParameters;
+    uint8_t *batch = ch->usb_tx_batch;
+    data_buffer_t *buf = NULL;
 
     while (1) {
-        if (xQueueReceive(tcp_to_usb_queue, &buf, portMAX_DELAY) == pdTRUE) {
-            if (current_device != NULL && current_device->state == DEVICE_STATE_OPEN) {
-                esp_err_t err;
-
-                if (current_device->type == DEVICE_TYPE_CDC) {
-                    err = cdc_acm_host_data_tx_blocking(current_device->handle.cdc_hdl,
-                                                         buf->data, buf->len, 1000);
-                } else if (current_device->type == DEVICE_TYPE_FTDI) {
-                    err = ftdi_sio_host_data_tx_blocking(current_device->handle.ftdi_hdl,
-                                                          buf->data, buf->len, 1000);
-                } else {
-                    buffer_free(buf);
-                    continue;
-                }
+        if (buf == NULL && xQueueReceive(ch->tcp_to_usb_queue, &buf, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
 
-                if (err != ESP_OK) {
-                    ESP_LOGW(TAG, "USB TX failed: %s", esp_err_to_name(err));
-                }
-            }
+        // Take what is queued; a buffer that does not fit starts the next batch
+        size_t len = 0;
+        while (buf != NULL && buf->len > 0 && len + buf->len <= USB_TX_BATCH_SIZE) {
+            memcpy(batch + len, buf->data, buf->len);
+            len += buf->len;
+            buffer_pool_free(&ch->buffer_pool, buf);
+            buf = NULL;
+            xQueueReceive(ch->tcp_to_usb_queue, &buf, 0);
+        }
+
+        // Buffers were freed: let the network loop read paused clients again
+        if (atomic_exchange(&ch->tcp_rx_blocked, false)) {
+            net_loop_wake();
+        }
+
+        if (len > 0) {
+            tcp_to_usb_write(ch, batch, len);
+        }
 
-            // Free buffer after processing
-            buffer_free(buf);
+        if (buf != NULL && buf->len == 0) {
+            tcp_to_usb_flush(ch);
+            buffer_pool_free(&ch->buffer_pool, buf);
+            buf = NULL;
+            atomic_fetch_add(&ch->tcp_to_usb_synced, 1);
+            net_loop_wake();
         }
     }
 }
@@ -921,7 +3197,8 @@ static void cdc_new_device_callback(usb_device_handle_t usb_dev)
  * @brief FTDI new device callback
  *
  * Called when a new FTDI device is detected (VID filtering already done by FTDI driver).
- * Adds FTDI devices to the queue for handling.
+ * Adds FTDI devices to the queue for handling. Every port of a multi-port
+ * chip is queued separately, as far as there are channels to serve them.
  *
  * @param vid Vendor ID
  * @param pid Product ID
@@ -929,16 +3206,23 @@ static void cdc_new_device_callback(usb_device_handle_t usb_dev)
  */
 static void ftdi_new_device_callback(uint16_t vid, uint16_t pid, void *user_arg)
 {
-    // FTDI driver already filters by VID, so we can trust this is FTDI
-    device_info_t dev_info = {
-        .type = DEVICE_TYPE_FTDI,
-        .state = DEVICE_STATE_DETECTED,
-        .vid = vid,
-        .pid = pid
-    };
-    
-    ESP_LOGI(TAG, "FTDI device detected: VID=0x%04X PID=0x%04X", vid, pid);
-    xQueueSend(device_queue, &dev_info, 0);
+    int ports = ftdi_sio_host_get_port_count(pid);
+    if (ports > CONFIG_USB_CHANNEL_COUNT) {
+        ports = CONFIG_USB_CHANNEL_COUNT;
+    }
+
+    ESP_LOGI(TAG, "FTDI device detected: VID=0x%04X PID=0x%04X (%d port(s) used)", vid, pid, ports);
+    for (int i = 0; i < ports; i++) {
+        // FTDI driver already filters by VID, so we can trust this is FTDI
+        device_info_t dev_info = {
+            .type = DEVICE_TYPE_FTDI,
+            .state = DEVICE_STATE_DETECTED,
+            .vid = vid,
+            .pid = pid,
+            .interface = i
+        };
+        xQueueSend(device_queue, &dev_info, 0);
+    }
 }
 
 // ============= DATA/EVENT CALLBACKS =============
@@ -951,41 +3235,15 @@ static void ftdi_new_device_callback(uint16_t vid, uint16_t pid, void *user_arg)
  * @param arg Argument we passed to the device open function (device_info_t*)
  * @return true: data processed, false: expect more data
  */
-static void cdc_handle_rx(uint8_t *data, size_t data_len, void *arg)
+static bool cdc_handle_rx(const uint8_t *data, size_t data_len, void *arg)
 {
+    device_info_t *dev_info = (device_info_t *)arg;
     ESP_LOGD(TAG, "[CDC] Data received (%d bytes)", data_len);
     //ESP_LOG_BUFFER_HEXDUMP(TAG, data, data_len, ESP_LOG_INFO);
 
-    // Forward data to TCP queue
-    if (usb_to_tcp_queue != NULL) {
-        size_t remaining = data_len;
-        size_t offset = 0;
-
-        while (remaining > 0) {
-            // Allocate buffer from pool
-            data_buffer_t *buf = buffer_alloc();
-            if (buf == NULL) {
-                ESP_LOGW(TAG, "[CDC] Buffer pool exhausted, dropped %d bytes", remaining);
-                break;
-            }
-
-            size_t chunk_size = remaining > sizeof(buf->data) ? sizeof(buf->data) : remaining;
-            memcpy(buf->data, data + offset, chunk_size);
-            buf->len = chunk_size;
-
-            // Send buffer pointer to queue.
-            // Block up to 2s to propagate backpressure to the USB device (flow control).
-            if (xQueueSend(usb_to_tcp_queue, &buf, pdMS_TO_TICKS(2000)) != pdTRUE) {
-                ESP_LOGW(TAG, "[CDC] USB→TCP queue full after 2s, dropped %d bytes", remaining);
-                buffer_free(buf);
-                break;
-            }
-
-            offset += chunk_size;
-            remaining -= chunk_size;
-        }
-    }
-
+    // Forward data to the channel's USB → TCP ring
+    usb_rx_ring_push(dev_info->channel, data, data_len, "CDC");
+    return true;
 }
 
 /**
@@ -997,38 +3255,12 @@ static void cdc_handle_rx(uint8_t *data, size_t data_len, void *arg)
  */
 static void ftdi_handle_rx(const uint8_t *data, size_t data_len, void *arg)
 {
+    device_info_t *dev_info = (device_info_t *)arg;
     ESP_LOGD(TAG, "[FTDI] Data received (%d bytes)", data_len);
     //ESP_LOG_BUFFER_HEXDUMP(TAG, data, data_len, ESP_LOG_INFO);
 
-    // Forward data to TCP queue
-    if (usb_to_tcp_queue != NULL) {
-        size_t remaining = data_len;
-        size_t offset = 0;
-
-        while (remaining > 0) {
-            // Allocate buffer from pool
-            data_buffer_t *buf = buffer_alloc();
-            if (buf == NULL) {
-                ESP_LOGW(TAG, "[FTDI] Buffer pool exhausted, dropped %d bytes", remaining);
-                break;
-            }
-
-            size_t chunk_size = remaining > sizeof(buf->data) ? sizeof(buf->data) : remaining;
-            memcpy(buf->data, data + offset, chunk_size);
-            buf->len = chunk_size;
-
-            // Send buffer pointer to queue.
-            // Block up to 2s to propagate backpressure to the USB device (flow control).
-            if (xQueueSend(usb_to_tcp_queue, &buf, pdMS_TO_TICKS(2000)) != pdTRUE) {
-                ESP_LOGW(TAG, "[FTDI] USB→TCP queue full after 2s, dropped %d bytes", remaining);
-                buffer_free(buf);
-                break;
-            }
-
-            offset += chunk_size;
-            remaining -= chunk_size;
-        }
-    }
+    // Forward data to the channel's USB → TCP ring
+    usb_rx_ring_push(dev_info->channel, data, data_len, "FTDI");
 }
 
 /**
@@ -1040,21 +3272,38 @@ static void ftdi_handle_rx(const uint8_t *data, size_t data_len, void *arg)
 static void cdc_handle_event(const cdc_acm_host_dev_event_data_t *event, void *user_ctx)
 {
     device_info_t *dev_info = (device_info_t *)user_ctx;
+    channel_t *ch = dev_info->channel;
 
     switch (event->type) {
     case CDC_ACM_HOST_ERROR:
         ESP_LOGE(TAG, "[CDC] Error: %i", event->data.error);
         break;
     case CDC_ACM_HOST_DEVICE_DISCONNECTED:
-        ESP_LOGI(TAG, "[CDC] Device disconnected");
+        ESP_LOGI(TAG, "[ch%d][CDC] Device disconnected", ch->index);
+        serial_control_detach(ch->index);
+        serial_control_clear_status(ch->index);
         cdc_acm_host_close(event->data.cdc_hdl);
         // Update mDNS status
-        update_mdns_usb_status(false, 0, 0, NULL);
+        update_mdns_usb_status(ch, false, 0, 0, NULL);
         xSemaphoreGive(dev_info->disconnected_sem);
         break;
-    case CDC_ACM_HOST_SERIAL_STATE:
-        ESP_LOGI(TAG, "[CDC] Serial state: 0x%04X", event->data.serial_state.val);
+    case CDC_ACM_HOST_SERIAL_STATE: {
+        const cdc_acm_uart_state_t *state = &event->data.serial_state;
+        ESP_LOGD(TAG, "[CDC] Serial state: 0x%04X", state->val);
+        // CDC-ACM reports DSR (TxCarrier), DCD (RxCarrier) and RI, but no CTS
+        serial_modem_status_t status = {
+            .cts = false,
+            .dsr = state->bTxCarrier,
+            .ri = state->bRingSignal,
+            .cd = state->bRxCarrier,
+        };
+        uint8_t errors = (state->bOverRun ? SERIAL_LINE_OVERRUN : 0) |
+                         (state->bParity ? SERIAL_LINE_PARITY : 0) |
+                         (state->bFraming ? SERIAL_LINE_FRAMING : 0) |
+                         (state->bBreak ? SERIAL_LINE_BREAK : 0);
+        serial_control_report_status(ch->index, &status, errors);
         break;
+    }
     case CDC_ACM_HOST_NETWORK_CONNECTION:
     default:
         ESP_LOGW(TAG, "[CDC] Unsupported event: %i", event->type);
@@ -1071,27 +3320,41 @@ static void cdc_handle_event(const cdc_acm_host_dev_event_data_t *event, void *u
 static void ftdi_handle_event(ftdi_sio_host_dev_event_t event, void *user_ctx)
 {
     device_info_t *dev_info = (device_info_t *)user_ctx;
+    channel_t *ch = dev_info->channel;
 
     switch (event) {
     case FTDI_SIO_HOST_ERROR:
         ESP_LOGE(TAG, "[FTDI] Error occurred");
         break;
     case FTDI_SIO_HOST_DEVICE_DISCONNECTED:
-        ESP_LOGI(TAG, "[FTDI] Device disconnected");
+        ESP_LOGI(TAG, "[ch%d][FTDI] Device disconnected", ch->index);
+        serial_control_detach(ch->index);
+        serial_control_clear_status(ch->index);
         if (dev_info->handle.ftdi_hdl != NULL) {
             ftdi_sio_host_close(dev_info->handle.ftdi_hdl);
         }
         // Update mDNS status
-        update_mdns_usb_status(false, 0, 0, NULL);
+        update_mdns_usb_status(ch, false, 0, 0, NULL);
         xSemaphoreGive(dev_info->disconnected_sem);
         break;
     case FTDI_SIO_HOST_MODEM_STATUS:
-        ESP_LOGI(TAG, "[FTDI] Modem status changed");
+        // Raised from the IN transfer callback whenever the status bytes change
         if (dev_info->handle.ftdi_hdl != NULL) {
             ftdi_modem_status_t status;
             if (ftdi_sio_host_get_modem_status(dev_info->handle.ftdi_hdl, &status) == ESP_OK) {
-                ESP_LOGI(TAG, "[FTDI] Modem status: CTS=%d DSR=%d RI=%d CD=%d",
+                ESP_LOGD(TAG, "[FTDI] Modem status: CTS=%d DSR=%d RI=%d CD=%d",
                          status.cts, status.dsr, status.ri, status.rlsd);
+                serial_modem_status_t modem = {
+                    .cts = status.cts,
+                    .dsr = status.dsr,
+                    .ri = status.ri,
+                    .cd = status.rlsd,
+                };
+                uint8_t errors = (status.overrun ? SERIAL_LINE_OVERRUN : 0) |
+                                 (status.parity_error ? SERIAL_LINE_PARITY : 0) |
+                                 (status.framing_error ? SERIAL_LINE_FRAMING : 0) |
+                                 (status.break_received ? SERIAL_LINE_BREAK : 0);
+                serial_control_report_status(ch->index, &modem, errors);
             }
         }
         break;
@@ -1109,17 +3372,18 @@ static void ftdi_handle_event(ftdi_sio_host_dev_event_t event, void *user_ctx)
  * Opens and operates a CDC-ACM device based on usb_cdc_example_main.c
  *
  * @param dev_info Device information structure
+ * @return ESP_OK once the device is open, otherwise the open error
  */
-static void handle_cdc_device(device_info_t *dev_info)
+static esp_err_t handle_cdc_device(device_info_t *dev_info)
 {
-    // Acquire device mutex for exclusive access
-    xSemaphoreTake(device_mutex, portMAX_DELAY);
-
-    ESP_LOGI(TAG, "Opening CDC-ACM device (VID=0x%04X, PID=0x%04X)", dev_info->vid, dev_info->pid);
+    channel_t *ch = dev_info->channel;
+    ESP_LOGI(TAG, "[ch%d] Opening CDC-ACM device (VID=0x%04X, PID=0x%04X)",
+             ch->index, dev_info->vid, dev_info->pid);
 
     const cdc_acm_host_device_config_t dev_config = {
         .connection_timeout_ms = 1000,
-        .out_buffer_size = 512,
+        .out_buffer_size = CONFIG_CDC_OUT_BUFFER_SIZE,
+        .in_buffer_size = CONFIG_CDC_IN_BUFFER_SIZE,
         .user_arg = dev_info,  // Pass dev_info for callback access
         .event_cb = cdc_handle_event,
         .data_cb = cdc_handle_rx
@@ -1128,18 +3392,17 @@ static void handle_cdc_device(device_info_t *dev_info)
     esp_err_t err = cdc_acm_host_open(dev_info->vid, dev_info->pid, 0, &dev_config, &dev_info->handle.cdc_hdl);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to open CDC device: %s", esp_err_to_name(err));
-        xSemaphoreGive(device_mutex);
-        return;
+        return err;
     }
 
     dev_info->state = DEVICE_STATE_OPEN;
-    ESP_LOGI(TAG, "[CDC] Device opened successfully");
+    serial_control_attach(ch->index, SERIAL_DEVICE_CDC, dev_info->handle.cdc_hdl);
+    ESP_LOGI(TAG, "[ch%d][CDC] Device opened successfully", ch->index);
 
     // Update mDNS status
-    update_mdns_usb_status(true, dev_info->vid, dev_info->pid, "CDC");
-
-    // Release device mutex
-    xSemaphoreGive(device_mutex);
+    update_mdns_usb_status(ch, true, dev_info->vid, dev_info->pid, "CDC");
+    boot_phase_mark(BOOT_PHASE_USB_DEVICE);
+    return ESP_OK;
 }
 
 /**
@@ -1147,37 +3410,55 @@ static void handle_cdc_device(device_info_t *dev_info)
  *
  * Opens and operates an FTDI device based on usb_ftdi_example_main.c
  *
- * @param dev_info Device information structure
+ * @param dev_info Device information structure (interface selects the port)
+ * @return ESP_OK once the device is open, otherwise the open error
  */
-static void handle_ftdi_device(device_info_t *dev_info)
+static esp_err_t handle_ftdi_device(device_info_t *dev_info)
 {
-    // Acquire device mutex for exclusive access
-    xSemaphoreTake(device_mutex, portMAX_DELAY);
-
-    ESP_LOGI(TAG, "Opening FTDI device (VID=0x%04X, PID=0x%04X)", dev_info->vid, dev_info->pid);
+    channel_t *ch = dev_info->channel;
+    ESP_LOGI(TAG, "[ch%d] Opening FTDI device (VID=0x%04X, PID=0x%04X, port %u)",
+             ch->index, dev_info->vid, dev_info->pid, dev_info->interface);
 
     ftdi_sio_host_device_config_t dev_config = FTDI_SIO_HOST_DEVICE_CONFIG_DEFAULT();
     dev_config.event_cb = ftdi_handle_event;
     dev_config.data_cb = ftdi_handle_rx;
+    dev_config.compact_rx = true;  // One contiguous span per IN transfer
+    dev_config.in_buffer_size = serial_control_get_in_xfer_size(ch->index);
+    dev_config.in_xfer_count = CONFIG_FTDI_IN_XFER_COUNT;
+    dev_config.out_xfer_count = CONFIG_FTDI_OUT_XFER_COUNT;
+    dev_config.out_buffer_size = FTDI_OUT_CHUNK_SIZE;  // One chunk of the TCP → USB task per transfer
     dev_config.user_arg = dev_info;  // Pass dev_info for callback access
 
-    esp_err_t err = ftdi_sio_host_open(dev_info->vid, dev_info->pid, 0, &dev_config, &dev_info->handle.ftdi_hdl);
+    esp_err_t err = ftdi_sio_host_open(dev_info->vid, dev_info->pid, dev_info->interface,
+                                       &dev_config, &dev_info->handle.ftdi_hdl);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to open FTDI device: %s", esp_err_to_name(err));
-        xSemaphoreGive(device_mutex);
-        return;
+        return err;
     }
 
     dev_info->state = DEVICE_STATE_OPEN;
-    ESP_LOGI(TAG, "[FTDI] Device opened successfully");
+    serial_control_attach(ch->index, SERIAL_DEVICE_FTDI, dev_info->handle.ftdi_hdl);
+    ESP_LOGI(TAG, "[ch%d][FTDI] Device opened successfully", ch->index);
+
+    // Latency timer for the current baud rate and traffic profile
+    serial_control_apply_tuning(ch->index);
+
+    // Later changes arrive as FTDI_SIO_HOST_MODEM_STATUS events
+    ftdi_modem_status_t ftdi_status;
+    if (ftdi_sio_host_get_modem_status(dev_info->handle.ftdi_hdl, &ftdi_status) == ESP_OK) {
+        serial_modem_status_t status = {
+            .cts = ftdi_status.cts,
+            .dsr = ftdi_status.dsr,
+            .ri = ftdi_status.ri,
+            .cd = ftdi_status.rlsd,
+        };
+        serial_control_report_status(ch->index, &status, 0);
+    }
 
     // Update mDNS status
-    update_mdns_usb_status(true, dev_info->vid, dev_info->pid, "FTDI");
-
-    vTaskDelay(pdMS_TO_TICKS(100));
-
-    // Release device mutex
-    xSemaphoreGive(device_mutex);
+    update_mdns_usb_status(ch, true, dev_info->vid, dev_info->pid, "FTDI");
+    boot_phase_mark(BOOT_PHASE_USB_DEVICE);
+    return ESP_OK;
 }
 
 /**
@@ -1197,16 +3478,23 @@ static void handle_device(device_info_t *dev_info)
     }
 
     // Set current device pointer for bridge tasks
-    current_device = dev_info;
+    dev_info->channel->device = dev_info;
 
     // Dispatch to appropriate handler
+    esp_err_t err;
     if (dev_info->type == DEVICE_TYPE_CDC) {
-        handle_cdc_device(dev_info);
+        err = handle_cdc_device(dev_info);
     } else if (dev_info->type == DEVICE_TYPE_FTDI) {
-        handle_ftdi_device(dev_info);
+        err = handle_ftdi_device(dev_info);
     } else {
         ESP_LOGE(TAG, "Unknown device type: %d", dev_info->type);
-        current_device = NULL;
+        err = ESP_ERR_NOT_SUPPORTED;
+    }
+
+    // Nothing will signal a disconnection for a device that never opened
+    // (unplugged while queued, already claimed, ...): free the channel now
+    if (err != ESP_OK) {
+        dev_info->channel->device = NULL;
         vSemaphoreDelete(dev_info->disconnected_sem);
         return;
     }
@@ -1217,48 +3505,148 @@ static void handle_device(device_info_t *dev_info)
     vSemaphoreDelete(dev_info->disconnected_sem);
 
     // Clear current device pointer
-    current_device = NULL;
+    dev_info->channel->device = NULL;
 
-    ESP_LOGI(TAG, "Device disconnected, ready for next device");
+    ESP_LOGI(TAG, "[ch%d] Device disconnected, ready for next device", dev_info->channel->index);
 }
 
-// ============= MAIN APPLICATION =============
+/**
+ * @brief Device handling loop of a channel
+ *
+ * Every channel takes the next detected device from the shared queue
+ * while it has none, so devices go to the first free channel. Runs as its
+ * own task for channels 1 and up and in app_main for channel 0.
+ *
+ * @param pvParameters Channel
+ */
+static void usb_device_task(void *pvParameters)
+{
+    channel_t *ch = pvParameters;
+
+    while (true) {
+        device_info_t dev_info;
+
+        // Wait for a device to be added to the queue
+        if (xQueueReceive(device_queue, &dev_info, portMAX_DELAY) == pdTRUE) {
+            ESP_LOGI(TAG, "[ch%d] Received device from queue: Type=%s VID=0x%04X PID=0x%04X",
+                     ch->index,
+                     dev_info.type == DEVICE_TYPE_CDC ? "CDC" :
+                     dev_info.type == DEVICE_TYPE_FTDI ? "FTDI" : "UNKNOWN",
+                     dev_info.vid, dev_info.pid);
+
+            // Handle the device
+            dev_info.channel = ch;
+            handle_device(&dev_info);
+        }
+    }
+}
+
+// ============= CHANNELS =============
 
 /**
- * @brief Main application
+ * @brief Set up the ports and data path of a channel
  *
- * Installs both CDC-ACM and FTDI drivers and automatically handles devices
- * based on their VID/PID. Also sets up WiFi and TCP server for network bridging.
+ * Channel n listens on the configured ports plus n times
+ * CONFIG_USB_CHANNEL_PORT_STEP, and sends its UDP stream to the
+ * configured port plus the same offset.
+ *
+ * @param ch Channel
+ * @param index Channel number
+ * @return ESP_OK on success
  */
-void app_main(void)
+static esp_err_t channel_init(channel_t *ch, int index)
 {
-    ESP_LOGI(TAG, "USB Serial to TCP Bridge with Network Provisioning");
-    ESP_LOGI(TAG, "Version: %s", get_version_string());
+    int offset = index * CONFIG_USB_CHANNEL_PORT_STEP;
+    ch->index = index;
+    ch->data_port = CONFIG_TCP_SERVER_PORT + offset;
+    ch->control_port = CONFIG_TCP_CONTROL_PORT + offset;
+#ifdef CONFIG_RFC2217_ENABLE
+    ch->rfc2217_port = CONFIG_RFC2217_PORT + offset;
+#endif
+#ifdef CONFIG_UDP_STREAM_ENABLE
+    ch->udp_port = CONFIG_UDP_STREAM_PORT + offset;
+#endif
 
-    // 1. Initialize NVS
-    esp_err_t ret = nvs_flash_init();
-    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ret = nvs_flash_init();
+    // TCP → USB buffers, in PSRAM when DATA_BUFFERS_IN_PSRAM is set
+    ch->buffer_storage = mem_layout_alloc_bulk(CHANNEL_BUFFER_POOL_SIZE * sizeof(data_buffer_t),
+                                               "TCP→USB buffer pool");
+    ch->usb_tx_batch = mem_layout_alloc_bulk(USB_TX_BATCH_SIZE, "USB TX batch");
+    if (ch->buffer_storage == NULL || ch->usb_tx_batch == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = buffer_pool_init(&ch->buffer_pool, ch->buffer_storage, CHANNEL_BUFFER_POOL_SIZE);
+    if (err != ESP_OK) {
+        return err;
     }
-    ESP_ERROR_CHECK(ret);
 
-    // 2. Initialize WiFi (required before provisioning check)
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+    // USB → TCP ring and capture
+    err = usb_rx_ring_init(ch);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = usb_capture_init(ch);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = usb_tx_sinks_init(ch);
+    if (err != ESP_OK) {
+        return err;
+    }
 
-    // 3. Initialize TCP/IP and event loop
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    ch->tcp_to_usb_queue = xQueueCreate(TCP_TO_USB_QUEUE_LENGTH, sizeof(data_buffer_t*));
+    if (ch->tcp_to_usb_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create queues");
+        return ESP_ERR_NO_MEM;
+    }
 
-    wifi_event_group = xEventGroupCreate();
+    // TCP server state
+    for (int i = 0; i < CONFIG_TCP_MAX_CLIENTS; i++) {
+        ch->tcp_server.clients[i].channel = ch;
+        ch->tcp_server.clients[i].slot = i;
+        ch->tcp_server.clients[i].sock = -1;
+        ch->tcp_server.clients[i].connected = false;
+        ch->tcp_server.clients[i].compressor = NULL;
+        ch->tcp_server.clients[i].framer = NULL;
+        ch->tcp_server.clients[i].filter = NULL;
+    }
+    ch->tcp_server.client_count = 0;
+    ch->tcp_frame_next = TCP_FRAME_DEFAULT;
+    ch->tcp_framed_clients = 0;
+
+    // UDP stream state (started by udp_stream_start())
+    ch->udp_sock = -1;
+    memset(&ch->udp_dest, 0, sizeof(ch->udp_dest));
+    ch->udp_seq = 0;
+    ch->udp_failing = false;
+
+    // Control server state
+    ch->control_server.client_sock = -1;
+    ch->control_server.connected = false;
+    return ESP_OK;
+}
+
+// ============= NETWORK STARTUP =============
+
+/**
+ * @brief Bring up WiFi, then mDNS and the OTA server
+ *
+ * Runs beside the USB side so capture starts at power-on instead of after
+ * association and DHCP. Provisioning, when needed, also waits here. The
+ * servers are already listening on all interfaces and become reachable
+ * as soon as the station gets its address.
+ *
+ * @param pvParameters Unused
+ */
+static void network_start_task(void *pvParameters)
+{
+    // Initialize WiFi (required before provisioning check)
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
 
-    // 4. Initialize provisioning manager
+    // Initialize provisioning manager
     ESP_LOGI(TAG, "Initializing provisioning manager...");
     ESP_ERROR_CHECK(init_provisioning_manager());
 
-    
-
     // Register WiFi event handlers
     ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT,
                                                           ESP_EVENT_ANY_ID,
@@ -1269,11 +3657,11 @@ void app_main(void)
                                                           &wifi_event_handler,
                                                           NULL, NULL));
 
-    // 4. Create WiFi STA and AP interface and register event handlers
+    // Create WiFi STA and AP interface
     esp_netif_create_default_wifi_sta();
     esp_netif_create_default_wifi_ap();
 
-    // 5. Check if already provisioned
+    // Check if already provisioned
     bool provisioned = is_provisioned();
     ESP_LOGI(TAG, "Provisioning status: %s", provisioned ? "DONE" : "NOT DONE");
 
@@ -1291,127 +3679,165 @@ void app_main(void)
 
         if (bits & PROV_FAIL_BIT) {
             ESP_LOGE(TAG, "Provisioning failed");
-            return;
+            vTaskDelete(NULL);
         }
         ESP_LOGI(TAG, "Provisioning successful");
     }
 
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
     ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_FLASH)); // Auto-load from NVS
+#ifdef CONFIG_WIFI_FAST_CONNECT
+    // Warm boot: go straight to the AP of the last connection
+    if (provisioned) {
+        wifi_fast_connect_apply();
+    }
+#endif
     ESP_ERROR_CHECK(esp_wifi_start());
 
-    // 7. Wait for WiFi connection
+    // Wait for WiFi connection
     ESP_LOGI(TAG, "Waiting for WiFi connection...");
     EventBits_t bits = xEventGroupWaitBits(wifi_event_group,
                                             WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
                                             pdFALSE, pdFALSE, portMAX_DELAY);
 
-    if (bits & WIFI_CONNECTED_BIT) {
-        ESP_LOGI(TAG, "Connected to WiFi");
+    if (!(bits & WIFI_CONNECTED_BIT)) {
+        // USB capture keeps running; the data stays in the capture buffer and log spool
+        ESP_LOGE(TAG, "Failed to connect to WiFi");
+        vTaskDelete(NULL);
+    }
+    ESP_LOGI(TAG, "Connected to WiFi");
+#ifdef CONFIG_WIFI_FAST_CONNECT
+    wifi_fast_connect_save();
+#endif
 
-        // Check OTA rollback status
-        const esp_partition_t *running = esp_ota_get_running_partition();
-        esp_ota_img_states_t ota_state;
-        if (esp_ota_get_state_partition(running, &ota_state) == ESP_OK) {
-            if (ota_state == ESP_OTA_IMG_PENDING_VERIFY) {
-                ESP_LOGI(TAG, "First boot after OTA update, marking app as valid");
-                esp_ota_mark_app_valid_cancel_rollback();
-            }
+    // Check OTA rollback status
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    esp_ota_img_states_t ota_state;
+    if (esp_ota_get_state_partition(running, &ota_state) == ESP_OK) {
+        if (ota_state == ESP_OTA_IMG_PENDING_VERIFY) {
+            ESP_LOGI(TAG, "First boot after OTA update, marking app as valid");
+            esp_ota_mark_app_valid_cancel_rollback();
         }
-        ESP_LOGI(TAG, "Running from partition: %s", running->label);
-
-        // Initialize mDNS service
-        ESP_LOGI(TAG, "Initializing mDNS service...");
-        init_mdns();
-
-        // Initialize OTA HTTP server
-        ESP_LOGI(TAG, "Initializing OTA HTTP server...");
-        esp_err_t ota_err = ota_server_init();
-        if (ota_err != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to start OTA server: %s", esp_err_to_name(ota_err));
+    }
+    ESP_LOGI(TAG, "Running from partition: %s", running->label);
+
+    // Initialize mDNS service, then publish the USB status seen so far
+    ESP_LOGI(TAG, "Initializing mDNS service...");
+    init_mdns();
+    atomic_store(&mdns_ready, true);
+    for (int i = 0; i < CONFIG_USB_CHANNEL_COUNT; i++) {
+        channel_t *ch = &channels[i];
+        if (ch->mdns_usb_status.connected) {
+            update_mdns_usb_status(ch, true, ch->mdns_usb_status.vid, ch->mdns_usb_status.pid,
+                                   ch->mdns_usb_status.type);
         }
-    } else {
-        ESP_LOGE(TAG, "Failed to connect to WiFi");
-        return;
     }
 
-    // Initialize buffer pool
-    ESP_LOGI(TAG, "Initializing buffer pool...");
-    buffer_pool_init();
-
-    // Create queues for data bridging (stores buffer pointers)
-    ESP_LOGI(TAG, "Creating data queues...");
-    usb_to_tcp_queue = xQueueCreate(32, sizeof(data_buffer_t*));
-    tcp_to_usb_queue = xQueueCreate(32, sizeof(data_buffer_t*));
-    device_queue = xQueueCreate(4, sizeof(device_info_t));
-
-    if (usb_to_tcp_queue == NULL || tcp_to_usb_queue == NULL || device_queue == NULL) {
-        ESP_LOGE(TAG, "Failed to create queues");
-        return;
+#ifdef CONFIG_WEB_CONSOLE_ENABLE
+    // Live console of channel 0, registered on the HTTP server below
+    esp_err_t console_err = web_console_init(&channels[0].usb_capture);
+    if (console_err != ESP_OK) {
+        ESP_LOGW(TAG, "Web console disabled: %s", esp_err_to_name(console_err));
     }
+#endif
 
-    // Create TCP server mutex
-    tcp_server.tx_mutex = xSemaphoreCreateMutex();
-    if (tcp_server.tx_mutex == NULL) {
-        ESP_LOGE(TAG, "Failed to create TCP TX mutex");
-        return;
+    // Initialize OTA HTTP server
+    ESP_LOGI(TAG, "Initializing OTA HTTP server...");
+    esp_err_t ota_err = ota_server_init();
+    if (ota_err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start OTA server: %s", esp_err_to_name(ota_err));
     }
+    boot_phase_mark(BOOT_PHASE_SERVICES);
 
-    // Create device mutex for thread-safe access
-    device_mutex = xSemaphoreCreateMutex();
-    if (device_mutex == NULL) {
-        ESP_LOGE(TAG, "Failed to create device mutex");
-        return;
+    char timings[160];
+    size_t len = 0;
+    for (int i = 0; i < BOOT_PHASE_COUNT && len < sizeof(timings); i++) {
+        len += snprintf(timings + len, sizeof(timings) - len, " %s=%" PRIu32,
+                        boot_phase_names[i], atomic_load(&boot_phase_ms[i]));
     }
+    ESP_LOGI(TAG, "Boot phases (ms, 0 = not reached):%s, WiFi via %s", timings,
+             wifi_fast_connect_used() ? "cached AP" : "scan");
 
-    // Initialize TCP server state
-    tcp_server.client_sock = -1;
-    tcp_server.connected = false;
+    // Servers, WiFi, mDNS and OTA came up in parallel and share one entry
+    mem_layout_checkpoint("servers+wifi");
+    mem_layout_report();
 
-    // Initialize control server state
-    control_server.client_sock = -1;
-    control_server.connected = false;
+    vTaskDelete(NULL);
+}
 
-    // Start TCP server task
-    ESP_LOGI(TAG, "Starting TCP server on port %d...", CONFIG_TCP_SERVER_PORT);
-    BaseType_t task_created = xTaskCreate(tcp_server_task, "tcp_server", 4096, NULL, 5, NULL);
-    if (task_created != pdTRUE) {
-        ESP_LOGE(TAG, "Failed to create TCP server task");
-        return;
-    }
+// ============= MAIN APPLICATION =============
 
-    // Start control server task
-    ESP_LOGI(TAG, "Starting control server on port %d...", CONFIG_TCP_CONTROL_PORT);
-    task_created = xTaskCreate(control_server_task, "control_server", 4096, NULL, 5, NULL);
-    if (task_created != pdTRUE) {
-        ESP_LOGE(TAG, "Failed to create control server task");
-        return;
+/**
+ * @brief Main application
+ *
+ * Installs both CDC-ACM and FTDI drivers and automatically handles devices
+ * based on their VID/PID. Also sets up WiFi and TCP server for network bridging.
+ * The USB side and the servers start first; WiFi comes up in parallel in
+ * network_start_task, so target output from power-on is captured.
+ */
+void app_main(void)
+{
+    ESP_LOGI(TAG, "USB Serial to TCP Bridge with Network Provisioning");
+    ESP_LOGI(TAG, "Version: %s", get_version_string());
+    mem_layout_init();
+
+    // 1. Initialize NVS
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
     }
+    ESP_ERROR_CHECK(ret);
 
-#ifdef CONFIG_RFC2217_ENABLE
-    // Start RFC2217 server
-    ESP_LOGI(TAG, "Starting RFC2217 server on port %d...", CONFIG_RFC2217_PORT);
-    esp_err_t rfc2217_err = rfc2217_server_init();
-    if (rfc2217_err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to start RFC2217 server: %s", esp_err_to_name(rfc2217_err));
+    // 2. Initialize TCP/IP and event loop (sockets work before WiFi is up)
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+
+    wifi_event_group = xEventGroupCreate();
+    mem_layout_checkpoint("nvs+netif");
+
+    // 3. Data path of every channel: buffers, USB → TCP ring, capture
+    ESP_LOGI(TAG, "Initializing %d channel(s)...", CONFIG_USB_CHANNEL_COUNT);
+    for (int i = 0; i < CONFIG_USB_CHANNEL_COUNT; i++) {
+        if (channel_init(&channels[i], i) != ESP_OK) {
+            return;
+        }
     }
+#ifdef CONFIG_LOG_SPOOL_ENABLE
+    // Optional: boards without a log partition run without spooling
+    log_spool_init();
 #endif
+    channels_metrics_init();
+    mem_layout_checkpoint("data path");
 
-    // Start bridge tasks
-    ESP_LOGI(TAG, "Starting bridge tasks...");
-    task_created = xTaskCreate(usb_to_tcp_bridge_task, "usb_to_tcp", 4096, NULL, 6, NULL);
-    if (task_created != pdTRUE) {
-        ESP_LOGE(TAG, "Failed to create USB→TCP bridge task");
+    // Detected devices wait here for a free channel
+    device_queue = xQueueCreate(4 * CONFIG_USB_CHANNEL_COUNT, sizeof(device_info_t));
+    if (device_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create queues");
         return;
     }
 
-    task_created = xTaskCreate(tcp_to_usb_bridge_task, "tcp_to_usb", 4096, NULL, 6, NULL);
-    if (task_created != pdTRUE) {
-        ESP_LOGE(TAG, "Failed to create TCP→USB bridge task");
+    // Serial control workers (DTR/RTS/line coding requests)
+    if (serial_control_init() != ESP_OK) {
         return;
     }
 
-    // Install USB Host driver (shared by both drivers)
+    // TCP → USB stays in its own task per channel because USB writes block;
+    // it runs beside the USB driver tasks it waits on
+    BaseType_t task_created;
+    for (int i = 0; i < CONFIG_USB_CHANNEL_COUNT; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), i == 0 ? "tcp_to_usb" : "tcp_to_usb%d", i);
+        task_created = xTaskCreatePinnedToCore(tcp_to_usb_bridge_task, name, 4096, &channels[i],
+                                               CONFIG_TASK_TCP_TO_USB_PRIORITY, NULL,
+                                               CONFIG_TASK_USB_CORE);
+        if (task_created != pdTRUE) {
+            ESP_LOGE(TAG, "Failed to create TCP→USB bridge task");
+            return;
+        }
+    }
+
+    // 4. USB host: enumeration starts right away
     ESP_LOGI(TAG, "Installing USB Host");
     const usb_host_config_t host_config = {
         .skip_phy_setup = false,
@@ -1420,7 +3846,8 @@ void app_main(void)
     ESP_ERROR_CHECK(usb_host_install(&host_config));
 
     // Create USB library handling task
-    task_created = xTaskCreate(usb_lib_task, "usb_lib", 4096, NULL, EXAMPLE_USB_HOST_PRIORITY, NULL);
+    task_created = xTaskCreatePinnedToCore(usb_lib_task, "usb_lib", 4096, NULL,
+                                           CONFIG_TASK_USB_HOST_PRIORITY, NULL, CONFIG_TASK_USB_CORE);
     if (task_created != pdTRUE) {
         ESP_LOGE(TAG, "Failed to create USB library task");
         return;
@@ -1430,8 +3857,8 @@ void app_main(void)
     ESP_LOGI(TAG, "Installing CDC-ACM driver");
     cdc_acm_host_driver_config_t cdc_config = {
         .driver_task_stack_size = 4096,
-        .driver_task_priority = 5,
-        .xCoreID = 1,
+        .driver_task_priority = CONFIG_TASK_USB_DRIVER_PRIORITY,
+        .xCoreID = CONFIG_TASK_USB_CORE,
         .new_dev_cb = cdc_new_device_callback
     };
     ESP_ERROR_CHECK(cdc_acm_host_install(&cdc_config));
@@ -1439,25 +3866,92 @@ void app_main(void)
     // Install FTDI driver with new_dev_cb
     ESP_LOGI(TAG, "Installing FTDI driver");
     ftdi_sio_host_driver_config_t ftdi_config = FTDI_SIO_HOST_DRIVER_CONFIG_DEFAULT();
+    ftdi_config.driver_task_priority = CONFIG_TASK_USB_DRIVER_PRIORITY;
+    ftdi_config.xCoreID = CONFIG_TASK_USB_CORE;
     ftdi_config.new_dev_cb = ftdi_new_device_callback;
     ftdi_config.user_arg = NULL;
     ESP_ERROR_CHECK(ftdi_sio_host_install(&ftdi_config));
+    boot_phase_mark(BOOT_PHASE_USB_HOST);
+    mem_layout_checkpoint("bridge+usb host");
 
-    ESP_LOGI(TAG, "All systems initialized. Waiting for USB devices...");
+    // 5. WiFi in parallel (provisioning, association, DHCP, mDNS, OTA)
+    task_created = xTaskCreatePinnedToCore(network_start_task, "net_start", 6144, NULL,
+                                           tskIDLE_PRIORITY + 5, NULL, CONFIG_TASK_NET_CORE);
+    if (task_created != pdTRUE) {
+        ESP_LOGE(TAG, "Failed to create network startup task");
+        return;
+    }
 
-    // Main device handling loop
-    while (true) {
-        device_info_t dev_info;
+    // 6. Servers and the network loop, which also drains the rings into the capture
+    // All servers below are served by one network loop task
+    if (net_loop_init() != ESP_OK) {
+        return;
+    }
+    if (net_loop_add_poll(update_mdns_metrics, NULL) != ESP_OK) {
+        return;
+    }
+    if (net_loop_add_poll(tcp_rx_poll, NULL) != ESP_OK) {
+        return;
+    }
 
-        // Wait for a device to be added to the queue
-        if (xQueueReceive(device_queue, &dev_info, portMAX_DELAY) == pdTRUE) {
-            ESP_LOGI(TAG, "Received device from queue: Type=%s VID=0x%04X PID=0x%04X",
-                     dev_info.type == DEVICE_TYPE_CDC ? "CDC" :
-                     dev_info.type == DEVICE_TYPE_FTDI ? "FTDI" : "UNKNOWN",
-                     dev_info.vid, dev_info.pid);
+    for (int i = 0; i < CONFIG_USB_CHANNEL_COUNT; i++) {
+        channel_t *ch = &channels[i];
+        if (net_loop_add_poll(usb_tx_poll, ch) != ESP_OK) {
+            return;
+        }
 
-            // Handle the device
-            handle_device(&dev_info);
+        // Start TCP server
+        ESP_LOGI(TAG, "[ch%d] Starting TCP server on port %u...", ch->index, ch->data_port);
+        if (tcp_server_start(ch) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to start TCP server");
+            return;
+        }
+
+        // Start control server
+        ESP_LOGI(TAG, "[ch%d] Starting control server on port %u...", ch->index, ch->control_port);
+        if (control_server_start(ch) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to start control server");
+            return;
+        }
+
+#ifdef CONFIG_RFC2217_ENABLE
+        // Start RFC2217 server
+        ESP_LOGI(TAG, "[ch%d] Starting RFC2217 server on port %u...", ch->index, ch->rfc2217_port);
+        esp_err_t rfc2217_err = rfc2217_server_init(ch->index, ch->rfc2217_port, &rfc2217_tx_path);
+        if (rfc2217_err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to start RFC2217 server: %s", esp_err_to_name(rfc2217_err));
+        }
+#endif
+
+#ifdef CONFIG_UDP_STREAM_ENABLE
+        // UDP stream socket (sends only, not served by the network loop)
+        if (udp_stream_start(ch) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to start UDP stream");
+        }
+#endif
+    }
+
+    // Baseline for the TASKS command and periodic task load logging
+    task_stats_init();
+
+    ESP_LOGI(TAG, "Starting network loop...");
+    if (net_loop_start(CONFIG_TASK_NET_LOOP_PRIORITY, CONFIG_TASK_NET_CORE) != ESP_OK) {
+        return;
+    }
+    boot_phase_mark(BOOT_PHASE_NET_LOOP);
+
+    // Device handling: channels 1 and up get their own task, channel 0 runs here
+    for (int i = 1; i < CONFIG_USB_CHANNEL_COUNT; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "usb_dev%d", i);
+        task_created = xTaskCreatePinnedToCore(usb_device_task, name, 4096, &channels[i],
+                                               tskIDLE_PRIORITY + 1, NULL, CONFIG_TASK_USB_CORE);
+        if (task_created != pdTRUE) {
+            ESP_LOGE(TAG, "Failed to create USB device task");
+            return;
         }
     }
+
+    ESP_LOGI(TAG, "All systems initialized. Waiting for USB devices...");
+    usb_device_task(&channels[0]);
 }
@@ -0,0 +1,124 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Placement of bulk data buffers and the boot-time memory report
+ */
+
+#include "mem_layout.h"
+
+#include <stdint.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "mem_layout";
+
+// Bounds of initialized and zeroed static RAM (ESP-IDF linker script)
+extern uint8_t _data_start, _data_end, _bss_start, _bss_end;
+
+// ============================================================================
+// State
+// ============================================================================
+
+typedef struct {
+    const char *name;
+    long internal;              // Internal heap taken (bytes, negative = freed)
+    long psram;                 // PSRAM heap taken
+} mem_layout_subsystem_t;
+
+typedef struct {
+    mem_layout_subsystem_t subsystems[MEM_LAYOUT_MAX_SUBSYSTEMS];
+    int count;
+    size_t internal_free;       // Free heap at the previous checkpoint
+    size_t psram_free;
+    size_t bulk_internal;       // Bulk buffers per region
+    size_t bulk_psram;
+} mem_layout_state_t;
+
+static mem_layout_state_t s_mem;
+static portMUX_TYPE s_mem_lock = portMUX_INITIALIZER_UNLOCKED;  // Checkpoints come from two boot tasks
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+void mem_layout_init(void)
+{
+    s_mem.internal_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    s_mem.psram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+}
+
+void *mem_layout_alloc_bulk(size_t size, const char *what)
+{
+    void *buf = NULL;
+#ifdef CONFIG_DATA_BUFFERS_IN_PSRAM
+    buf = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (buf != NULL) {
+        portENTER_CRITICAL(&s_mem_lock);
+        s_mem.bulk_psram += size;
+        portEXIT_CRITICAL(&s_mem_lock);
+        return buf;
+    }
+    ESP_LOGW(TAG, "PSRAM allocation for %s failed, using internal RAM", what);
+#endif
+    buf = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (buf == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate %s (%u bytes)", what, (unsigned)size);
+        return NULL;
+    }
+    portENTER_CRITICAL(&s_mem_lock);
+    s_mem.bulk_internal += size;
+    portEXIT_CRITICAL(&s_mem_lock);
+    return buf;
+}
+
+void mem_layout_checkpoint(const char *subsystem)
+{
+    size_t internal_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    size_t psram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+
+    portENTER_CRITICAL(&s_mem_lock);
+    if (s_mem.count < MEM_LAYOUT_MAX_SUBSYSTEMS) {
+        mem_layout_subsystem_t *entry = &s_mem.subsystems[s_mem.count++];
+        entry->name = subsystem;
+        entry->internal = (long)s_mem.internal_free - (long)internal_free;
+        entry->psram = (long)s_mem.psram_free - (long)psram_free;
+    }
+    s_mem.internal_free = internal_free;
+    s_mem.psram_free = psram_free;
+    portEXIT_CRITICAL(&s_mem_lock);
+}
+
+void mem_layout_report(void)
+{
+    ESP_LOGI(TAG, "Static RAM: .data %u + .bss %u bytes",
+             (unsigned)(&_data_end - &_data_start), (unsigned)(&_bss_end - &_bss_start));
+    ESP_LOGI(TAG, "Internal heap: %u free (lowest %u, largest block %u), PSRAM heap: %u free",
+             (unsigned)heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+             (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL),
+             (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL),
+             (unsigned)heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+    ESP_LOGI(TAG, "Bulk buffers: %u bytes internal, %u bytes PSRAM",
+             (unsigned)s_mem.bulk_internal, (unsigned)s_mem.bulk_psram);
+
+    for (int i = 0; i < s_mem.count; i++) {
+        const mem_layout_subsystem_t *entry = &s_mem.subsystems[i];
+        ESP_LOGI(TAG, "  %-16s internal %7ld  PSRAM %7ld", entry->name, entry->internal, entry->psram);
+    }
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    TaskStatus_t *status = heap_caps_malloc(MEM_LAYOUT_MAX_TASKS * sizeof(TaskStatus_t), MALLOC_CAP_8BIT);
+    if (status == NULL) {
+        return;
+    }
+    UBaseType_t count = uxTaskGetSystemState(status, MEM_LAYOUT_MAX_TASKS, NULL);
+    ESP_LOGI(TAG, "Lowest free stack per task (bytes):");
+    for (UBaseType_t i = 0; i < count; i++) {
+        ESP_LOGI(TAG, "  %-16s %5u", status[i].pcTaskName, (unsigned)status[i].usStackHighWaterMark);
+    }
+    heap_caps_free(status);
+#endif
+}
@@ -0,0 +1,80 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Placement of bulk data buffers and the boot-time memory report
+ *
+ * Bulk data buffers (the TCP → USB pool and gathered USB OUT write of
+ * each channel) are allocated through mem_layout_alloc_bulk(), which puts
+ * them in PSRAM when CONFIG_DATA_BUFFERS_IN_PSRAM is set, so the internal
+ * RAM stays free for WiFi and lwIP. Boot code calls mem_layout_checkpoint()
+ * after each subsystem comes up; mem_layout_report() then logs the heap
+ * each subsystem took, static RAM, free heap and the stack headroom of
+ * every task, which shows how much internal RAM can be given to larger
+ * lwIP windows.
+ */
+
+#ifndef MEM_LAYOUT_H
+#define MEM_LAYOUT_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Configuration
+// ============================================================================
+
+#define MEM_LAYOUT_MAX_SUBSYSTEMS   8
+#define MEM_LAYOUT_MAX_TASKS        32
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+/**
+ * @brief Take the heap baseline for the first checkpoint
+ *
+ * Call at the start of app_main().
+ */
+void mem_layout_init(void);
+
+/**
+ * @brief Allocate a bulk data buffer
+ *
+ * From PSRAM when CONFIG_DATA_BUFFERS_IN_PSRAM is set (falling back to
+ * internal RAM), otherwise from internal RAM. The USB drivers copy OUT
+ * data into their own transfer buffers, so bulk buffers are never DMA
+ * targets. Free with heap_caps_free().
+ *
+ * @param size Size in bytes
+ * @param what Buffer name for the log
+ * @return Buffer, or NULL when neither region has room
+ */
+void *mem_layout_alloc_bulk(size_t size, const char *what);
+
+/**
+ * @brief Attribute the heap taken since the previous checkpoint
+ *
+ * Checkpoints taken after the WiFi startup task is created also count
+ * what WiFi allocated in parallel.
+ *
+ * @param subsystem Name of what was brought up (static string)
+ */
+void mem_layout_checkpoint(const char *subsystem);
+
+/**
+ * @brief Log the memory report
+ *
+ * Static RAM, free heap per region, bulk buffer placement, heap per
+ * subsystem and the lowest free stack of every task.
+ */
+void mem_layout_report(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEM_LAYOUT_H
@@ -0,0 +1,345 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Always-on throughput, drop and latency counters
+ */
+
+#include "metrics.h"
+
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+#define METRICS_PREFIX  "serial_logger_"
+
+// ============================================================================
+// State
+// ============================================================================
+
+typedef struct {
+    atomic_uint_least64_t events;
+    atomic_uint_least64_t bytes;
+} metrics_drop_counter_t;
+
+typedef struct {
+    atomic_uint_least32_t high_water;
+    uint32_t capacity;
+} metrics_queue_state_t;
+
+typedef struct {
+    atomic_uint_least64_t buckets[METRICS_HIST_BUCKETS];  // Non-cumulative counts
+    atomic_uint_least64_t sum_us;
+} metrics_hist_t;
+
+typedef struct {
+    const char *label;
+    atomic_uint_least64_t sent;
+    atomic_uint_least64_t stall_us;
+    atomic_uint_least64_t stalls;
+    atomic_uint_least64_t max_stall_us;
+} metrics_client_t;
+
+typedef struct {
+    atomic_uint_least64_t bytes[METRICS_BYTES_COUNT];
+    metrics_drop_counter_t drops[METRICS_DROP_COUNT];
+    metrics_queue_state_t queues[METRICS_QUEUE_COUNT];
+    metrics_hist_t latency[METRICS_LATENCY_COUNT];
+    metrics_client_t clients[METRICS_MAX_CLIENTS];
+    int client_count;
+} metrics_t;
+
+static metrics_t s_metrics;
+
+// Upper bounds of the latency buckets in microseconds (the last bucket is +Inf)
+static const uint32_t s_bucket_bounds[METRICS_HIST_BUCKETS - 1] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000,
+};
+
+static const char *const s_bytes_names[METRICS_BYTES_COUNT] = {
+    "usb_rx", "net_tx", "net_rx", "usb_tx",
+};
+
+static const char *const s_drop_names[METRICS_DROP_COUNT] = {
+    "usb_ring_full", "no_client", "client_lag", "client_stall",
+    "buffer_pool", "tcp_to_usb_queue", "no_device", "usb_tx_error",
+    "spool_full", "udp_send",
+};
+
+static const char *const s_queue_names[METRICS_QUEUE_COUNT] = {
+    "usb_rx_ring", "tcp_to_usb",
+};
+
+static const char *const s_latency_names[METRICS_LATENCY_COUNT] = {
+    "usb_rx", "usb_tx",
+};
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+#define LOAD(x) ((uint64_t)atomic_load_explicit(&(x), memory_order_relaxed))
+
+static void add_u64(atomic_uint_least64_t *counter, uint64_t value)
+{
+    atomic_fetch_add_explicit(counter, value, memory_order_relaxed);
+}
+
+static void max_u64(atomic_uint_least64_t *counter, uint64_t value)
+{
+    uint_least64_t cur = atomic_load_explicit(counter, memory_order_relaxed);
+    while (value > cur &&
+           !atomic_compare_exchange_weak_explicit(counter, &cur, value,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+static bool client_valid(int client)
+{
+    return client >= 0 && client < s_metrics.client_count;
+}
+
+// Bounded text output; stops writing once the buffer is full
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+} text_out_t;
+
+static void out_printf(text_out_t *out, const char *fmt, ...)
+{
+    if (out->len >= out->size) {
+        return;
+    }
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(out->buf + out->len, out->size - out->len, fmt, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= out->size - out->len) {
+        out->len = out->size;   // Truncated
+    } else {
+        out->len += n;
+    }
+}
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+void metrics_init(const char *const *client_labels, int client_count)
+{
+    if (client_count > METRICS_MAX_CLIENTS) {
+        client_count = METRICS_MAX_CLIENTS;
+    }
+    for (int i = 0; i < client_count; i++) {
+        s_metrics.clients[i].label = client_labels[i];
+    }
+    s_metrics.client_count = client_count;
+}
+
+void metrics_set_queue_capacity(metrics_queue_t queue, uint32_t capacity)
+{
+    s_metrics.queues[queue].capacity = capacity;
+}
+
+void metrics_add_bytes(metrics_bytes_t which, size_t bytes)
+{
+    add_u64(&s_metrics.bytes[which], bytes);
+}
+
+void metrics_add_drop(metrics_drop_t reason, size_t bytes)
+{
+    add_u64(&s_metrics.drops[reason].events, 1);
+    add_u64(&s_metrics.drops[reason].bytes, bytes);
+}
+
+void metrics_queue_level(metrics_queue_t queue, uint32_t level)
+{
+    atomic_uint_least32_t *hw = &s_metrics.queues[queue].high_water;
+    uint_least32_t cur = atomic_load_explicit(hw, memory_order_relaxed);
+    while (level > cur &&
+           !atomic_compare_exchange_weak_explicit(hw, &cur, level,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+void metrics_record_latency(metrics_latency_t which, uint32_t us)
+{
+    int bucket = 0;
+    while (bucket < METRICS_HIST_BUCKETS - 1 && us > s_bucket_bounds[bucket]) {
+        bucket++;
+    }
+    add_u64(&s_metrics.latency[which].buckets[bucket], 1);
+    add_u64(&s_metrics.latency[which].sum_us, us);
+}
+
+void metrics_client_sent(int client, size_t bytes)
+{
+    if (client_valid(client)) {
+        add_u64(&s_metrics.clients[client].sent, bytes);
+    }
+}
+
+void metrics_client_stall(int client, uint64_t us)
+{
+    if (client_valid(client)) {
+        add_u64(&s_metrics.clients[client].stall_us, us);
+        add_u64(&s_metrics.clients[client].stalls, 1);
+        max_u64(&s_metrics.clients[client].max_stall_us, us);
+    }
+}
+
+uint64_t metrics_bytes(metrics_bytes_t which)
+{
+    return LOAD(s_metrics.bytes[which]);
+}
+
+uint64_t metrics_drops_total(void)
+{
+    uint64_t total = 0;
+    for (int i = 0; i < METRICS_DROP_COUNT; i++) {
+        total += LOAD(s_metrics.drops[i].events);
+    }
+    return total;
+}
+
+size_t metrics_format_json(char *buf, size_t size)
+{
+    text_out_t out = { .buf = buf, .size = size };
+
+    out_printf(&out, "{\"bytes\":{");
+    for (int i = 0; i < METRICS_BYTES_COUNT; i++) {
+        out_printf(&out, "%s\"%s\":%" PRIu64, i ? "," : "",
+                   s_bytes_names[i], LOAD(s_metrics.bytes[i]));
+    }
+
+    out_printf(&out, "},\"drops\":{");
+    for (int i = 0; i < METRICS_DROP_COUNT; i++) {
+        out_printf(&out, "%s\"%s\":{\"events\":%" PRIu64 ",\"bytes\":%" PRIu64 "}",
+                   i ? "," : "", s_drop_names[i],
+                   LOAD(s_metrics.drops[i].events), LOAD(s_metrics.drops[i].bytes));
+    }
+
+    out_printf(&out, "},\"queues\":{");
+    for (int i = 0; i < METRICS_QUEUE_COUNT; i++) {
+        out_printf(&out, "%s\"%s\":{\"high_water\":%" PRIu64 ",\"capacity\":%" PRIu32 "}",
+                   i ? "," : "", s_queue_names[i],
+                   LOAD(s_metrics.queues[i].high_water), s_metrics.queues[i].capacity);
+    }
+
+    out_printf(&out, "},\"latency_us\":{");
+    for (int i = 0; i < METRICS_LATENCY_COUNT; i++) {
+        const metrics_hist_t *h = &s_metrics.latency[i];
+        uint64_t count = 0;
+        out_printf(&out, "%s\"%s\":{\"bounds\":[", i ? "," : "", s_latency_names[i]);
+        for (int b = 0; b < METRICS_HIST_BUCKETS - 1; b++) {
+            out_printf(&out, "%s%" PRIu32, b ? "," : "", s_bucket_bounds[b]);
+        }
+        out_printf(&out, "],\"counts\":[");
+        for (int b = 0; b < METRICS_HIST_BUCKETS; b++) {
+            uint64_t n = LOAD(h->buckets[b]);
+            count += n;
+            out_printf(&out, "%s%" PRIu64, b ? "," : "", n);
+        }
+        out_printf(&out, "],\"count\":%" PRIu64 ",\"sum\":%" PRIu64 "}", count, LOAD(h->sum_us));
+    }
+
+    out_printf(&out, "},\"clients\":[");
+    for (int i = 0; i < s_metrics.client_count; i++) {
+        const metrics_client_t *c = &s_metrics.clients[i];
+        out_printf(&out, "%s{\"name\":\"%s\",\"sent\":%" PRIu64 ",\"stall_us\":%" PRIu64
+                   ",\"stalls\":%" PRIu64 ",\"max_stall_us\":%" PRIu64 "}",
+                   i ? "," : "", c->label, LOAD(c->sent), LOAD(c->stall_us),
+                   LOAD(c->stalls), LOAD(c->max_stall_us));
+    }
+    out_printf(&out, "]}");
+
+    return out.len;
+}
+
+size_t metrics_format_prometheus(char *buf, size_t size)
+{
+    text_out_t out = { .buf = buf, .size = size };
+
+    out_printf(&out, "# HELP " METRICS_PREFIX "bytes_total Bytes transferred per direction\n"
+                     "# TYPE " METRICS_PREFIX "bytes_total counter\n");
+    for (int i = 0; i < METRICS_BYTES_COUNT; i++) {
+        out_printf(&out, METRICS_PREFIX "bytes_total{direction=\"%s\"} %" PRIu64 "\n",
+                   s_bytes_names[i], LOAD(s_metrics.bytes[i]));
+    }
+
+    out_printf(&out, "# HELP " METRICS_PREFIX "drops_total Drop events per reason\n"
+                     "# TYPE " METRICS_PREFIX "drops_total counter\n");
+    for (int i = 0; i < METRICS_DROP_COUNT; i++) {
+        out_printf(&out, METRICS_PREFIX "drops_total{reason=\"%s\"} %" PRIu64 "\n",
+                   s_drop_names[i], LOAD(s_metrics.drops[i].events));
+    }
+    out_printf(&out, "# HELP " METRICS_PREFIX "dropped_bytes_total Bytes lost per reason\n"
+                     "# TYPE " METRICS_PREFIX "dropped_bytes_total counter\n");
+    for (int i = 0; i < METRICS_DROP_COUNT; i++) {
+        out_printf(&out, METRICS_PREFIX "dropped_bytes_total{reason=\"%s\"} %" PRIu64 "\n",
+                   s_drop_names[i], LOAD(s_metrics.drops[i].bytes));
+    }
+
+    out_printf(&out, "# HELP " METRICS_PREFIX "queue_high_water Highest queue fill level since boot\n"
+                     "# TYPE " METRICS_PREFIX "queue_high_water gauge\n");
+    for (int i = 0; i < METRICS_QUEUE_COUNT; i++) {
+        out_printf(&out, METRICS_PREFIX "queue_high_water{queue=\"%s\"} %" PRIu64 "\n",
+                   s_queue_names[i], LOAD(s_metrics.queues[i].high_water));
+    }
+    out_printf(&out, "# HELP " METRICS_PREFIX "queue_capacity Queue capacity\n"
+                     "# TYPE " METRICS_PREFIX "queue_capacity gauge\n");
+    for (int i = 0; i < METRICS_QUEUE_COUNT; i++) {
+        out_printf(&out, METRICS_PREFIX "queue_capacity{queue=\"%s\"} %" PRIu32 "\n",
+                   s_queue_names[i], s_metrics.queues[i].capacity);
+    }
+
+    out_printf(&out, "# HELP " METRICS_PREFIX "usb_latency_us USB transfer latency in microseconds\n"
+                     "# TYPE " METRICS_PREFIX "usb_latency_us histogram\n");
+    for (int i = 0; i < METRICS_LATENCY_COUNT; i++) {
+        const metrics_hist_t *h = &s_metrics.latency[i];
+        uint64_t cumulative = 0;
+        for (int b = 0; b < METRICS_HIST_BUCKETS; b++) {
+            cumulative += LOAD(h->buckets[b]);
+            if (b < METRICS_HIST_BUCKETS - 1) {
+                out_printf(&out, METRICS_PREFIX "usb_latency_us_bucket{path=\"%s\",le=\"%" PRIu32 "\"} %" PRIu64 "\n",
+                           s_latency_names[i], s_bucket_bounds[b], cumulative);
+            } else {
+                out_printf(&out, METRICS_PREFIX "usb_latency_us_bucket{path=\"%s\",le=\"+Inf\"} %" PRIu64 "\n",
+                           s_latency_names[i], cumulative);
+            }
+        }
+        out_printf(&out, METRICS_PREFIX "usb_latency_us_sum{path=\"%s\"} %" PRIu64 "\n"
+                         METRICS_PREFIX "usb_latency_us_count{path=\"%s\"} %" PRIu64 "\n",
+                   s_latency_names[i], LOAD(h->sum_us), s_latency_names[i], cumulative);
+    }
+
+    out_printf(&out, "# HELP " METRICS_PREFIX "client_sent_bytes_total Bytes sent per client slot\n"
+                     "# TYPE " METRICS_PREFIX "client_sent_bytes_total counter\n");
+    for (int i = 0; i < s_metrics.client_count; i++) {
+        out_printf(&out, METRICS_PREFIX "client_sent_bytes_total{client=\"%s\"} %" PRIu64 "\n",
+                   s_metrics.clients[i].label, LOAD(s_metrics.clients[i].sent));
+    }
+    out_printf(&out, "# HELP " METRICS_PREFIX "client_stall_us_total Time a client accepted no data\n"
+                     "# TYPE " METRICS_PREFIX "client_stall_us_total counter\n");
+    for (int i = 0; i < s_metrics.client_count; i++) {
+        out_printf(&out, METRICS_PREFIX "client_stall_us_total{client=\"%s\"} %" PRIu64 "\n",
+                   s_metrics.clients[i].label, LOAD(s_metrics.clients[i].stall_us));
+    }
+    out_printf(&out, "# HELP " METRICS_PREFIX "client_stalls_total Number of send stalls\n"
+                     "# TYPE " METRICS_PREFIX "client_stalls_total counter\n");
+    for (int i = 0; i < s_metrics.client_count; i++) {
+        out_printf(&out, METRICS_PREFIX "client_stalls_total{client=\"%s\"} %" PRIu64 "\n",
+                   s_metrics.clients[i].label, LOAD(s_metrics.clients[i].stalls));
+    }
+    out_printf(&out, "# HELP " METRICS_PREFIX "client_max_stall_us Longest send stall\n"
+                     "# TYPE " METRICS_PREFIX "client_max_stall_us gauge\n");
+    for (int i = 0; i < s_metrics.client_count; i++) {
+        out_printf(&out, METRICS_PREFIX "client_max_stall_us{client=\"%s\"} %" PRIu64 "\n",
+                   s_metrics.clients[i].label, LOAD(s_metrics.clients[i].max_stall_us));
+    }
+
+    return out.len;
+}
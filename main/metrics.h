@@ -0,0 +1,179 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Always-on throughput, drop and latency counters
+ *
+ * Counters are updated lock-free from the USB callbacks, the network loop
+ * and the TCP → USB task, and rendered as JSON or Prometheus text for the
+ * /api/metrics HTTP handler. The module has no RTOS dependencies.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Configuration
+// ============================================================================
+
+#ifdef CONFIG_USB_CHANNEL_COUNT
+#define METRICS_CHANNELS        CONFIG_USB_CHANNEL_COUNT
+#else
+#define METRICS_CHANNELS        1
+#endif
+
+#define METRICS_MAX_CLIENTS     (10 * METRICS_CHANNELS) // Per channel: RFC2217 + CONFIG_TCP_MAX_CLIENTS (max 8) + UDP
+#define METRICS_HIST_BUCKETS    11      // Latency buckets, the last one is +Inf
+
+// ============================================================================
+// Metric identifiers
+// ============================================================================
+
+typedef enum {
+    METRICS_BYTES_USB_RX = 0,   // Received from the USB device
+    METRICS_BYTES_NET_TX,       // Sent to network clients (sum over clients)
+    METRICS_BYTES_NET_RX,       // Received from network clients for the device
+    METRICS_BYTES_USB_TX,       // Written to the USB device
+    METRICS_BYTES_COUNT
+} metrics_bytes_t;
+
+typedef enum {
+    METRICS_DROP_USB_RING_FULL = 0,     // USB → TCP ring stayed full, USB data discarded
+    METRICS_DROP_NO_CLIENT,             // USB data with no network client to receive it
+    METRICS_DROP_CLIENT_LAG,            // Lossy data client fell behind, oldest data skipped
+    METRICS_DROP_CLIENT_STALL,          // Unsent data of a client disconnected for stalling
+    METRICS_DROP_BUFFER_POOL,           // TCP → USB buffer pool exhausted
+    METRICS_DROP_TCP_TO_USB_QUEUE,      // TCP → USB queue full
+    METRICS_DROP_NO_DEVICE,             // TCP data with no USB device open
+    METRICS_DROP_USB_TX_ERROR,          // USB write failed
+    METRICS_DROP_SPOOL_FULL,            // Flash log spool queue full
+    METRICS_DROP_UDP_SEND,              // UDP datagram could not be sent
+    METRICS_DROP_COUNT
+} metrics_drop_t;
+
+typedef enum {
+    METRICS_QUEUE_USB_RX_RING = 0,  // USB → TCP ring (bytes)
+    METRICS_QUEUE_TCP_TO_USB,       // TCP → USB queue (buffers)
+    METRICS_QUEUE_COUNT
+} metrics_queue_t;
+
+typedef enum {
+    METRICS_LATENCY_USB_RX = 0,     // USB IN callback: time to hand data to the ring
+    METRICS_LATENCY_USB_TX,         // USB OUT: time until the driver completed or queued a write
+    METRICS_LATENCY_COUNT
+} metrics_latency_t;
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+/**
+ * @brief Initialize counters
+ *
+ * @param client_labels Label per client index, used in the formatted output
+ * @param client_count Number of clients (at most METRICS_MAX_CLIENTS)
+ */
+void metrics_init(const char *const *client_labels, int client_count);
+
+/**
+ * @brief Set the capacity reported for a queue
+ *
+ * @param queue Queue
+ * @param capacity Capacity in the queue's unit
+ */
+void metrics_set_queue_capacity(metrics_queue_t queue, uint32_t capacity);
+
+/**
+ * @brief Count transferred bytes
+ *
+ * @param which Direction
+ * @param bytes Number of bytes
+ */
+void metrics_add_bytes(metrics_bytes_t which, size_t bytes);
+
+/**
+ * @brief Count a drop event
+ *
+ * @param reason Why the data was dropped
+ * @param bytes Number of bytes lost
+ */
+void metrics_add_drop(metrics_drop_t reason, size_t bytes);
+
+/**
+ * @brief Record a queue fill level, keeping the maximum
+ *
+ * @param queue Queue
+ * @param level Current fill level
+ */
+void metrics_queue_level(metrics_queue_t queue, uint32_t level);
+
+/**
+ * @brief Add a sample to a latency histogram
+ *
+ * @param which Histogram
+ * @param us Latency in microseconds
+ */
+void metrics_record_latency(metrics_latency_t which, uint32_t us);
+
+/**
+ * @brief Count bytes sent to one client
+ *
+ * @param client Client index
+ * @param bytes Number of bytes
+ */
+void metrics_client_sent(int client, size_t bytes);
+
+/**
+ * @brief Record a period in which a client accepted no data
+ *
+ * @param client Client index
+ * @param us Length of the stall in microseconds
+ */
+void metrics_client_stall(int client, uint64_t us);
+
+/**
+ * @brief Read a byte counter
+ *
+ * @param which Direction
+ * @return Bytes counted since boot
+ */
+uint64_t metrics_bytes(metrics_bytes_t which);
+
+/**
+ * @brief Total number of drop events over all reasons
+ *
+ * @return Drop events since boot
+ */
+uint64_t metrics_drops_total(void);
+
+/**
+ * @brief Render all metrics as a JSON object
+ *
+ * @param buf Output buffer
+ * @param size Size of buf in bytes
+ * @return Length written, or size if the output was truncated
+ */
+size_t metrics_format_json(char *buf, size_t size);
+
+/**
+ * @brief Render all metrics in the Prometheus text exposition format
+ *
+ * @param buf Output buffer
+ * @param size Size of buf in bytes
+ * @return Length written, or size if the output was truncated
+ */
+size_t metrics_format_prometheus(char *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // METRICS_H
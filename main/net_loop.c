@@ -0,0 +1,419 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Single-task network event loop
+ */
+
+#include "net_loop.h"
+#include "stream_ring.h"
+
+#include <string.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_vfs_eventfd.h"
+#include "freertos/task.h"
+
+#include "lwip/sockets.h"
+
+static const char *TAG = "net_loop";
+
+// ============================================================================
+// Loop state
+// ============================================================================
+
+typedef struct {
+    int sock;                   // Socket (-1 = slot free)
+    net_loop_sock_cb_t on_readable;
+    void *ctx;
+    stream_ring_t tx_queue;     // Output the socket has not taken yet
+    uint8_t *tx_storage;        // Backing storage of tx_queue (NULL = no queue)
+    bool failed;                // A send failed; output is discarded until close
+    bool rx_paused;             // Owner cannot take input; leave it in the TCP window
+} net_loop_entry_t;
+
+typedef struct {
+    net_loop_poll_cb_t cb;
+    void *ctx;
+} net_loop_poll_t;
+
+typedef struct {
+    net_loop_entry_t entries[NET_LOOP_MAX_SOCKETS];
+    net_loop_poll_t polls[NET_LOOP_MAX_POLLS];
+    int poll_count;
+    int wake_fd;                // eventfd interrupting select()
+    atomic_bool wake_pending;   // Set between net_loop_wake() and the loop draining wake_fd
+    TaskHandle_t task;
+} net_loop_t;
+
+static net_loop_t s_loop = {
+    .wake_fd = -1,
+};
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static net_loop_entry_t *find_entry(int sock)
+{
+    for (int i = 0; i < NET_LOOP_MAX_SOCKETS; i++) {
+        if (s_loop.entries[i].sock == sock) {
+            return &s_loop.entries[i];
+        }
+    }
+    return NULL;
+}
+
+static net_loop_entry_t *register_sock(int sock, net_loop_sock_cb_t cb, void *ctx)
+{
+    net_loop_entry_t *entry = find_entry(-1);
+    if (entry == NULL) {
+        return NULL;
+    }
+
+    int flags = fcntl(sock, F_GETFL, 0);
+    fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+
+    entry->sock = sock;
+    entry->on_readable = cb;
+    entry->ctx = ctx;
+    entry->tx_storage = NULL;
+    entry->failed = false;
+    entry->rx_paused = false;
+    return entry;
+}
+
+/**
+ * @brief Handle the result of a non-blocking send
+ *
+ * @return Bytes sent, 0 if the socket would block or failed
+ */
+static size_t check_sent(net_loop_entry_t *entry, int ret)
+{
+    if (ret >= 0) {
+        return ret;
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        // Let the owner find out through EOF and clean up in its read callback
+        ESP_LOGD(TAG, "send on socket %d failed: errno %d", entry->sock, errno);
+        shutdown(entry->sock, SHUT_RDWR);
+        entry->failed = true;
+        if (entry->tx_storage != NULL) {
+            stream_ring_reset(&entry->tx_queue);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Push queued output into the socket
+ */
+static void flush_tx_queue(net_loop_entry_t *entry)
+{
+    while (stream_ring_used(&entry->tx_queue) > 0) {
+        const uint8_t *data;
+        size_t len = stream_ring_peek(&entry->tx_queue, &data);
+        size_t sent = check_sent(entry, send(entry->sock, data, len, 0));
+        if (sent == 0) {
+            return;
+        }
+        stream_ring_consume(&entry->tx_queue, sent);
+    }
+}
+
+static bool has_queued_output(net_loop_entry_t *entry)
+{
+    return entry->tx_storage != NULL && !entry->failed && stream_ring_used(&entry->tx_queue) > 0;
+}
+
+// ============================================================================
+// Loop task
+// ============================================================================
+
+static void net_loop_task(void *pvParameters)
+{
+    int fds[NET_LOOP_MAX_SOCKETS];
+
+    while (1) {
+        // Poll callbacks first, so work signalled by other tasks is done
+        // before sleeping; their deadlines bound the select() timeout
+        int64_t now = esp_timer_get_time();
+        int64_t timeout_us = -1;
+        for (int i = 0; i < s_loop.poll_count; i++) {
+            int64_t t = s_loop.polls[i].cb(now, s_loop.polls[i].ctx);
+            if (t >= 0 && (timeout_us < 0 || t < timeout_us)) {
+                timeout_us = t;
+            }
+        }
+
+        fd_set read_fds;
+        fd_set write_fds;
+        FD_ZERO(&read_fds);
+        FD_ZERO(&write_fds);
+        FD_SET(s_loop.wake_fd, &read_fds);
+        int max_fd = s_loop.wake_fd;
+        for (int i = 0; i < NET_LOOP_MAX_SOCKETS; i++) {
+            net_loop_entry_t *entry = &s_loop.entries[i];
+            fds[i] = entry->sock;
+            if (entry->sock < 0) {
+                continue;
+            }
+            // A failed socket is still read so its owner sees the EOF
+            if (!entry->rx_paused || entry->failed) {
+                FD_SET(entry->sock, &read_fds);
+            }
+            if (has_queued_output(entry)) {
+                FD_SET(entry->sock, &write_fds);
+            }
+            if (entry->sock > max_fd) {
+                max_fd = entry->sock;
+            }
+        }
+
+        struct timeval tv;
+        struct timeval *tvp = NULL;
+        if (timeout_us >= 0) {
+            tv.tv_sec = timeout_us / 1000000;
+            tv.tv_usec = timeout_us % 1000000;
+            tvp = &tv;
+        }
+
+        int ready = select(max_fd + 1, &read_fds, &write_fds, NULL, tvp);
+        if (ready < 0) {
+            ESP_LOGE(TAG, "select failed: errno %d", errno);
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+        if (ready == 0) {
+            continue;
+        }
+
+        if (FD_ISSET(s_loop.wake_fd, &read_fds)) {
+            // Clear the flag before draining so a wake racing with us is kept
+            atomic_store(&s_loop.wake_pending, false);
+            uint64_t count;
+            read(s_loop.wake_fd, &count, sizeof(count));
+        }
+
+        // A callback may close or reopen sockets, so only act on entries that
+        // still hold the socket select() looked at
+        for (int i = 0; i < NET_LOOP_MAX_SOCKETS; i++) {
+            net_loop_entry_t *entry = &s_loop.entries[i];
+            if (fds[i] < 0 || entry->sock != fds[i]) {
+                continue;
+            }
+            if (FD_ISSET(fds[i], &write_fds) && entry->tx_storage != NULL) {
+                flush_tx_queue(entry);
+            }
+            if (entry->sock == fds[i] && FD_ISSET(fds[i], &read_fds)) {
+                entry->on_readable(fds[i], entry->ctx);
+            }
+        }
+    }
+}
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+esp_err_t net_loop_init(void)
+{
+    for (int i = 0; i < NET_LOOP_MAX_SOCKETS; i++) {
+        s_loop.entries[i].sock = -1;
+        s_loop.entries[i].tx_storage = NULL;
+    }
+    s_loop.poll_count = 0;
+    atomic_init(&s_loop.wake_pending, false);
+
+    esp_vfs_eventfd_config_t config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+    esp_err_t err = esp_vfs_eventfd_register(&config);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "Failed to register eventfd: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    s_loop.wake_fd = eventfd(0, 0);
+    if (s_loop.wake_fd < 0) {
+        ESP_LOGE(TAG, "Failed to create eventfd: errno %d", errno);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t net_loop_start(UBaseType_t priority, BaseType_t core_id)
+{
+    BaseType_t ret = xTaskCreatePinnedToCore(net_loop_task, "net_loop",
+                                             NET_LOOP_TASK_STACK, NULL,
+                                             priority, &s_loop.task, core_id);
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create loop task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t net_loop_listen(uint16_t port, int backlog, net_loop_sock_cb_t on_accept,
+                          void *ctx, int *out_sock)
+{
+    struct sockaddr_in dest_addr = {
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+        .sin_family = AF_INET,
+        .sin_port = htons(port)
+    };
+
+    int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
+        return ESP_FAIL;
+    }
+
+    int opt = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    if (bind(sock, (struct sockaddr *)&dest_addr, sizeof(dest_addr)) != 0) {
+        ESP_LOGE(TAG, "Socket bind to port %u failed: errno %d", port, errno);
+        close(sock);
+        return ESP_FAIL;
+    }
+    if (listen(sock, backlog) != 0) {
+        ESP_LOGE(TAG, "Socket listen on port %u failed: errno %d", port, errno);
+        close(sock);
+        return ESP_FAIL;
+    }
+
+    if (register_sock(sock, on_accept, ctx) == NULL) {
+        ESP_LOGE(TAG, "Socket table full");
+        close(sock);
+        return ESP_ERR_NO_MEM;
+    }
+
+    *out_sock = sock;
+    return ESP_OK;
+}
+
+esp_err_t net_loop_add(int sock, size_t tx_queue_size, net_loop_sock_cb_t on_readable, void *ctx)
+{
+    net_loop_entry_t *entry = register_sock(sock, on_readable, ctx);
+    if (entry == NULL) {
+        ESP_LOGE(TAG, "Socket table full");
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (tx_queue_size > 0) {
+        entry->tx_storage = heap_caps_malloc(tx_queue_size, MALLOC_CAP_8BIT);
+        if (entry->tx_storage == NULL ||
+            stream_ring_init(&entry->tx_queue, entry->tx_storage, tx_queue_size) != ESP_OK) {
+            heap_caps_free(entry->tx_storage);
+            entry->tx_storage = NULL;
+            entry->sock = -1;
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+void net_loop_close(int sock)
+{
+    net_loop_entry_t *entry = find_entry(sock);
+    if (entry != NULL) {
+        heap_caps_free(entry->tx_storage);
+        entry->tx_storage = NULL;
+        entry->sock = -1;
+    }
+    shutdown(sock, SHUT_RDWR);
+    close(sock);
+}
+
+size_t net_loop_send(int sock, const void *data, size_t len)
+{
+    struct iovec iov = {
+        .iov_base = (void *)data,
+        .iov_len = len,
+    };
+    return net_loop_sendv(sock, &iov, 1);
+}
+
+size_t net_loop_sendv(int sock, const struct iovec *iov, int iovcnt)
+{
+    net_loop_entry_t *entry = find_entry(sock);
+    if (entry == NULL) {
+        return 0;
+    }
+
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        total += iov[i].iov_len;
+    }
+
+    // Queued output goes first to keep the byte order
+    size_t sent = 0;
+    if (!has_queued_output(entry)) {
+        sent = check_sent(entry, lwip_writev(sock, iov, iovcnt));
+    }
+    if (entry->failed) {
+        return total;   // Connection is going away; swallow output so callers move on
+    }
+    if (entry->tx_storage == NULL || sent == total) {
+        return sent;
+    }
+
+    // Queue the rest, skipping what went out directly
+    size_t accepted = sent;
+    size_t skip = sent;
+    for (int i = 0; i < iovcnt; i++) {
+        if (skip >= iov[i].iov_len) {
+            skip -= iov[i].iov_len;
+            continue;
+        }
+        size_t len = iov[i].iov_len - skip;
+        size_t queued = stream_ring_write(&entry->tx_queue, (const uint8_t *)iov[i].iov_base + skip, len);
+        skip = 0;
+        accepted += queued;
+        if (queued < len) {
+            break;
+        }
+    }
+    return accepted;
+}
+
+size_t net_loop_tx_space(int sock)
+{
+    net_loop_entry_t *entry = find_entry(sock);
+    if (entry == NULL || entry->tx_storage == NULL) {
+        return 0;
+    }
+    return stream_ring_free(&entry->tx_queue);
+}
+
+void net_loop_pause_rx(int sock, bool paused)
+{
+    net_loop_entry_t *entry = find_entry(sock);
+    if (entry != NULL) {
+        entry->rx_paused = paused;
+    }
+}
+
+esp_err_t net_loop_add_poll(net_loop_poll_cb_t cb, void *ctx)
+{
+    if (s_loop.poll_count >= NET_LOOP_MAX_POLLS) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_loop.polls[s_loop.poll_count].cb = cb;
+    s_loop.polls[s_loop.poll_count].ctx = ctx;
+    s_loop.poll_count++;
+    return ESP_OK;
+}
+
+void net_loop_wake(void)
+{
+    if (s_loop.wake_fd < 0) {
+        return;
+    }
+    if (!atomic_exchange(&s_loop.wake_pending, true)) {
+        uint64_t one = 1;
+        write(s_loop.wake_fd, &one, sizeof(one));
+    }
+}
@@ -0,0 +1,198 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Single-task network event loop
+ *
+ * One task multiplexes every listening and client socket with select().
+ * Sockets are non-blocking; each client socket has a write queue that
+ * absorbs whatever the TCP send buffer cannot take, and is flushed when
+ * the socket becomes writable. Other tasks interact with the loop only
+ * through net_loop_wake(), which interrupts select() via an eventfd.
+ *
+ * Except for net_loop_wake(), all functions must be called either from
+ * a loop callback or before net_loop_start().
+ */
+
+#ifndef NET_LOOP_H
+#define NET_LOOP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/uio.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Configuration
+// ============================================================================
+
+#ifdef CONFIG_USB_CHANNEL_COUNT
+#define NET_LOOP_CHANNELS       CONFIG_USB_CHANNEL_COUNT
+#else
+#define NET_LOOP_CHANNELS       1
+#endif
+
+#define NET_LOOP_MAX_SOCKETS    (16 * NET_LOOP_CHANNELS)    // Listening + client sockets
+#define NET_LOOP_MAX_POLLS      (2 + 2 * NET_LOOP_CHANNELS) // Poll callbacks
+#define NET_LOOP_TASK_STACK     6144
+
+// ============================================================================
+// Callbacks
+// ============================================================================
+
+/**
+ * @brief Socket event callback
+ *
+ * Called from the loop task when a socket is readable (or, for a
+ * listening socket, has a pending connection). Sockets are non-blocking,
+ * so spurious wakeups surface as EAGAIN and must be ignored.
+ *
+ * @param sock Socket
+ * @param ctx User context given at registration
+ */
+typedef void (*net_loop_sock_cb_t)(int sock, void *ctx);
+
+/**
+ * @brief Poll callback, run on every loop iteration
+ *
+ * Used for work driven by other tasks (signalled with net_loop_wake())
+ * and for periodic work.
+ *
+ * @param now_us Current time in microseconds
+ * @param ctx User context given at registration
+ * @return Microseconds until the callback wants to run again, -1 for
+ *         no deadline (only wakeups and socket events)
+ */
+typedef int64_t (*net_loop_poll_cb_t)(int64_t now_us, void *ctx);
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+/**
+ * @brief Initialize loop state and the wakeup eventfd
+ *
+ * @return ESP_OK on success
+ */
+esp_err_t net_loop_init(void);
+
+/**
+ * @brief Start the loop task
+ *
+ * @param priority Task priority
+ * @param core_id Core to pin the task to (tskNO_AFFINITY for none)
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the task cannot be created
+ */
+esp_err_t net_loop_start(UBaseType_t priority, BaseType_t core_id);
+
+/**
+ * @brief Create a listening TCP socket and register it
+ *
+ * @param port Port to listen on
+ * @param backlog listen() backlog
+ * @param on_accept Called when a connection is pending
+ * @param ctx User context for on_accept
+ * @param[out] out_sock Listening socket
+ * @return ESP_OK on success, ESP_FAIL on socket errors, ESP_ERR_NO_MEM when
+ *         the socket table is full
+ */
+esp_err_t net_loop_listen(uint16_t port, int backlog, net_loop_sock_cb_t on_accept,
+                          void *ctx, int *out_sock);
+
+/**
+ * @brief Register a connected socket
+ *
+ * The socket is switched to non-blocking mode.
+ *
+ * @param sock Connected socket
+ * @param tx_queue_size Size of the write queue in bytes (power of two, 0 for none)
+ * @param on_readable Called when data (or EOF) is available
+ * @param ctx User context for on_readable
+ * @return ESP_OK on success, ESP_ERR_NO_MEM when the table is full or the
+ *         queue cannot be allocated
+ */
+esp_err_t net_loop_add(int sock, size_t tx_queue_size, net_loop_sock_cb_t on_readable, void *ctx);
+
+/**
+ * @brief Unregister, shut down and close a socket
+ *
+ * Queued output that has not been sent is discarded.
+ *
+ * @param sock Socket
+ */
+void net_loop_close(int sock);
+
+/**
+ * @brief Send data without blocking
+ *
+ * Sends directly when the write queue is empty and queues what the
+ * socket does not take. On a socket error the connection is shut down,
+ * so its owner sees EOF on the next read.
+ *
+ * @param sock Registered socket
+ * @param data Data to send
+ * @param len Length of data in bytes
+ * @return Number of bytes sent or queued (less than len when the queue is full)
+ */
+size_t net_loop_send(int sock, const void *data, size_t len);
+
+/**
+ * @brief Gathering variant of net_loop_send()
+ *
+ * @param sock Registered socket
+ * @param iov Vectors to send
+ * @param iovcnt Number of vectors
+ * @return Number of bytes sent or queued
+ */
+size_t net_loop_sendv(int sock, const struct iovec *iov, int iovcnt);
+
+/**
+ * @brief Bytes that net_loop_send() is guaranteed to accept
+ *
+ * @param sock Registered socket
+ * @return Free space in the write queue (0 for an unknown socket)
+ */
+size_t net_loop_tx_space(int sock);
+
+/**
+ * @brief Stop or resume watching a socket for input
+ *
+ * While paused the socket's callback is not called for input, so data
+ * stays in the TCP receive window and the peer is throttled by TCP flow
+ * control. A socket whose send failed is still reported so its owner
+ * sees the EOF.
+ *
+ * @param sock Registered socket
+ * @param paused true to stop watching, false to resume
+ */
+void net_loop_pause_rx(int sock, bool paused);
+
+/**
+ * @brief Register a poll callback
+ *
+ * @param cb Callback
+ * @param ctx User context for the callback
+ * @return ESP_OK on success, ESP_ERR_NO_MEM when all slots are used
+ */
+esp_err_t net_loop_add_poll(net_loop_poll_cb_t cb, void *ctx);
+
+/**
+ * @brief Make the loop run its poll callbacks soon
+ *
+ * Safe to call from any task. Repeated calls before the loop wakes up
+ * are coalesced into one eventfd write.
+ */
+void net_loop_wake(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NET_LOOP_H
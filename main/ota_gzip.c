@@ -0,0 +1,225 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Streaming gzip decoder for OTA uploads
+ */
+
+#include "ota_gzip.h"
+
+#include <string.h>
+#include "esp_log.h"
+
+static const char *TAG = "ota_gzip";
+
+#define MIN_SIZE(a, b)  ((a) < (b) ? (a) : (b))
+
+// ============================================================================
+// Header
+// ============================================================================
+
+/**
+ * @brief Move to the first optional header field present at or after state
+ */
+static void next_field(ota_gzip_t *gz, gzip_state_t state)
+{
+    if (state <= GZIP_STATE_EXTRA_LEN && (gz->flags & GZIP_FEXTRA)) {
+        gz->state = GZIP_STATE_EXTRA_LEN;
+    } else if (state <= GZIP_STATE_NAME && (gz->flags & GZIP_FNAME)) {
+        gz->state = GZIP_STATE_NAME;
+    } else if (state <= GZIP_STATE_COMMENT && (gz->flags & GZIP_FCOMMENT)) {
+        gz->state = GZIP_STATE_COMMENT;
+    } else if (state <= GZIP_STATE_HCRC && (gz->flags & GZIP_FHCRC)) {
+        gz->state = GZIP_STATE_HCRC;
+    } else {
+        gz->state = GZIP_STATE_DEFLATE;
+    }
+}
+
+/**
+ * @brief Handle a completely collected fixed-size header field
+ */
+static esp_err_t field_done(ota_gzip_t *gz)
+{
+    const uint8_t *f = gz->field;
+
+    switch (gz->state) {
+    case GZIP_STATE_HEADER:
+        if (f[0] != GZIP_ID1 || f[1] != GZIP_ID2 || f[2] != GZIP_CM_DEFLATE ||
+            (f[3] & GZIP_FRESERVED) != 0) {
+            ESP_LOGE(TAG, "Unsupported gzip header");
+            return ESP_ERR_INVALID_ARG;
+        }
+        gz->flags = f[3];
+        next_field(gz, GZIP_STATE_EXTRA_LEN);
+        break;
+    case GZIP_STATE_EXTRA_LEN:
+        gz->skip = f[0] | (f[1] << 8);
+        if (gz->skip > 0) {
+            gz->state = GZIP_STATE_EXTRA;
+        } else {
+            next_field(gz, GZIP_STATE_NAME);
+        }
+        break;
+    case GZIP_STATE_HCRC:
+        gz->state = GZIP_STATE_DEFLATE;
+        break;
+    default:
+        break;
+    }
+    return ESP_OK;
+}
+
+// ============================================================================
+// Body
+// ============================================================================
+
+/**
+ * @brief Decode bytes before the trailer: header fields, then deflate data
+ */
+static esp_err_t feed_body(ota_gzip_t *gz, const uint8_t *in, size_t len)
+{
+    while (len > 0) {
+        switch (gz->state) {
+        case GZIP_STATE_HEADER:
+        case GZIP_STATE_EXTRA_LEN:
+        case GZIP_STATE_HCRC: {
+            size_t need = gz->state == GZIP_STATE_HEADER ? GZIP_HEADER_SIZE : 2;
+            size_t n = MIN_SIZE(len, need - gz->field_len);
+            memcpy(gz->field + gz->field_len, in, n);
+            gz->field_len += n;
+            in += n;
+            len -= n;
+            if (gz->field_len == need) {
+                gz->field_len = 0;
+                esp_err_t err = field_done(gz);
+                if (err != ESP_OK) {
+                    return err;
+                }
+            }
+            break;
+        }
+        case GZIP_STATE_EXTRA: {
+            size_t n = MIN_SIZE(len, gz->skip);
+            gz->skip -= n;
+            in += n;
+            len -= n;
+            if (gz->skip == 0) {
+                next_field(gz, GZIP_STATE_NAME);
+            }
+            break;
+        }
+        case GZIP_STATE_NAME:
+        case GZIP_STATE_COMMENT: {
+            const uint8_t *nul = memchr(in, 0, len);
+            size_t n = nul != NULL ? (size_t)(nul - in) + 1 : len;
+            in += n;
+            len -= n;
+            if (nul != NULL) {
+                next_field(gz, gz->state + 1);
+            }
+            break;
+        }
+        case GZIP_STATE_DEFLATE: {
+            tinfl_status status;
+            do {
+                size_t in_len = len;
+                size_t out_len = TINFL_LZ_DICT_SIZE - gz->dict_ofs;
+                status = tinfl_decompress(&gz->inflator, in, &in_len, gz->dict,
+                                          gz->dict + gz->dict_ofs, &out_len,
+                                          TINFL_FLAG_HAS_MORE_INPUT);
+                in += in_len;
+                len -= in_len;
+                if (out_len > 0) {
+                    esp_err_t err = gz->write(gz->write_ctx, gz->dict + gz->dict_ofs, out_len);
+                    if (err != ESP_OK) {
+                        return err;
+                    }
+                }
+                gz->out_len += out_len;
+                gz->dict_ofs = (gz->dict_ofs + out_len) & (TINFL_LZ_DICT_SIZE - 1);
+            } while (status == TINFL_STATUS_HAS_MORE_OUTPUT);
+
+            if (status == TINFL_STATUS_DONE) {
+                gz->state = GZIP_STATE_TRAILER;
+            } else if (status < 0) {
+                ESP_LOGE(TAG, "Inflate failed: %d", (int)status);
+                return ESP_ERR_INVALID_ARG;
+            }
+            break;
+        }
+        case GZIP_STATE_TRAILER:
+        case GZIP_STATE_DONE:
+            ESP_LOGE(TAG, "Unexpected data after the deflate stream");
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Check the trailer once the deflate stream has ended
+ */
+static esp_err_t check_trailer(ota_gzip_t *gz)
+{
+    // The image itself is verified by esp_ota_end(); ISIZE catches a short inflate
+    const uint8_t *f = gz->trailer;
+    uint32_t isize = f[4] | (f[5] << 8) | (f[6] << 16) | ((uint32_t)f[7] << 24);
+    if (isize != (uint32_t)gz->out_len) {
+        ESP_LOGE(TAG, "Inflated %u bytes, gzip trailer says %lu",
+                 (unsigned)gz->out_len, (unsigned long)isize);
+        return ESP_ERR_INVALID_ARG;
+    }
+    gz->state = GZIP_STATE_DONE;
+    return ESP_OK;
+}
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+esp_err_t ota_gzip_init(ota_gzip_t *gz, size_t upload_len, ota_gzip_write_fn write, void *ctx)
+{
+    if (upload_len < GZIP_HEADER_SIZE + GZIP_TRAILER_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    tinfl_init(&gz->inflator);
+    gz->dict_ofs = 0;
+    gz->state = GZIP_STATE_HEADER;
+    gz->flags = 0;
+    gz->field_len = 0;
+    gz->skip = 0;
+    gz->body_left = upload_len - GZIP_TRAILER_SIZE;
+    gz->trailer_len = 0;
+    gz->out_len = 0;
+    gz->write = write;
+    gz->write_ctx = ctx;
+    return ESP_OK;
+}
+
+esp_err_t ota_gzip_feed(ota_gzip_t *gz, const uint8_t *in, size_t len)
+{
+    size_t body = MIN_SIZE(len, gz->body_left);
+    gz->body_left -= body;
+    esp_err_t err = feed_body(gz, in, body);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    size_t n = MIN_SIZE(len - body, GZIP_TRAILER_SIZE - gz->trailer_len);
+    memcpy(gz->trailer + gz->trailer_len, in + body, n);
+    gz->trailer_len += n;
+    if (gz->trailer_len == GZIP_TRAILER_SIZE && gz->state == GZIP_STATE_TRAILER) {
+        return check_trailer(gz);
+    }
+    return ESP_OK;
+}
+
+esp_err_t ota_gzip_finish(const ota_gzip_t *gz)
+{
+    if (gz->state != GZIP_STATE_DONE) {
+        ESP_LOGE(TAG, "Compressed image is truncated");
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
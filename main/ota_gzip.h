@@ -0,0 +1,131 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Streaming gzip decoder for OTA uploads
+ *
+ * Inflates one gzip member (RFC 1952) with the ROM inflater as the upload
+ * streams in and hands the output to a write callback. The header is
+ * parsed incrementally.
+ *
+ * The trailer is taken from the last GZIP_TRAILER_SIZE bytes of the
+ * upload, whose length is known from Content-Length, and only the bytes
+ * before it reach the inflater. The ROM inflater (miniz 1.x) refills its
+ * bit buffer ahead of the bits it decodes and does not hand those bytes
+ * back when the deflate stream ends, so it cannot be trusted to stop
+ * exactly at the trailer.
+ *
+ * No allocator or RTOS dependencies; the state (about 43 KB) is owned by
+ * the caller. Single-threaded.
+ */
+
+#ifndef OTA_GZIP_H
+#define OTA_GZIP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "rom/miniz.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Format
+// ============================================================================
+
+#define GZIP_ID1            0x1f
+#define GZIP_ID2            0x8b
+#define GZIP_CM_DEFLATE     8
+#define GZIP_FHCRC          0x02
+#define GZIP_FEXTRA         0x04
+#define GZIP_FNAME          0x08
+#define GZIP_FCOMMENT       0x10
+#define GZIP_FRESERVED      0xe0
+#define GZIP_HEADER_SIZE    10
+#define GZIP_TRAILER_SIZE   8
+
+// ============================================================================
+// State
+// ============================================================================
+
+/**
+ * @brief Position in a gzip member
+ */
+typedef enum {
+    GZIP_STATE_HEADER,          // Fixed 10-byte header
+    GZIP_STATE_EXTRA_LEN,       // FEXTRA length
+    GZIP_STATE_EXTRA,           // FEXTRA payload
+    GZIP_STATE_NAME,            // Zero-terminated FNAME
+    GZIP_STATE_COMMENT,         // Zero-terminated FCOMMENT
+    GZIP_STATE_HCRC,            // FHCRC
+    GZIP_STATE_DEFLATE,         // Compressed blocks
+    GZIP_STATE_TRAILER,         // Deflate stream ended, CRC32 and ISIZE pending
+    GZIP_STATE_DONE,
+} gzip_state_t;
+
+/**
+ * @brief Receives inflated data; an error stops the decoder and is returned as is
+ */
+typedef esp_err_t (*ota_gzip_write_fn)(void *ctx, const uint8_t *data, size_t len);
+
+typedef struct {
+    tinfl_decompressor inflator;
+    uint8_t dict[TINFL_LZ_DICT_SIZE];   // Circular output window
+    size_t dict_ofs;
+    gzip_state_t state;
+    uint8_t flags;
+    uint8_t field[GZIP_HEADER_SIZE];    // Fixed-size header field being collected
+    size_t field_len;
+    size_t skip;                        // FEXTRA bytes left
+    size_t body_left;                   // Upload bytes before the trailer still to come
+    uint8_t trailer[GZIP_TRAILER_SIZE];
+    size_t trailer_len;
+    size_t out_len;                     // Inflated bytes
+
+    ota_gzip_write_fn write;
+    void *write_ctx;
+} ota_gzip_t;
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+/**
+ * @brief Start decoding an upload
+ *
+ * @param gz Decoder state
+ * @param upload_len Total upload length in bytes (the whole gzip member)
+ * @param write Called with every piece of inflated data
+ * @param ctx Passed to write
+ * @return ESP_OK, or ESP_ERR_INVALID_SIZE if the upload cannot hold a gzip member
+ */
+esp_err_t ota_gzip_init(ota_gzip_t *gz, size_t upload_len, ota_gzip_write_fn write, void *ctx);
+
+/**
+ * @brief Decode the next received bytes of the upload
+ *
+ * @param gz Decoder state
+ * @param in Received data
+ * @param len Length in bytes (the total must not exceed upload_len)
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for a malformed member (header,
+ *         deflate data, ISIZE, or data after the deflate stream), or the
+ *         error returned by the write callback
+ */
+esp_err_t ota_gzip_feed(ota_gzip_t *gz, const uint8_t *in, size_t len);
+
+/**
+ * @brief Check that the whole member has been decoded
+ *
+ * @param gz Decoder state
+ * @return ESP_OK, or ESP_ERR_INVALID_SIZE if the deflate stream or the
+ *         upload ended early
+ */
+esp_err_t ota_gzip_finish(const ota_gzip_t *gz);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // OTA_GZIP_H
@@ -1,8 +1,15 @@
 #include "ota_server.h"
 #include "ota_web_ui.h"
 #include "version.h"
+#include "metrics.h"
+#include "log_spool.h"
+#include "ota_gzip.h"
+#ifdef CONFIG_WEB_CONSOLE_ENABLE
+#include "web_console.h"
+#endif
 
 #include <string.h>
+#include <unistd.h>
 #include <sys/param.h>
 #include "esp_log.h"
 #include "esp_http_server.h"
@@ -10,8 +17,11 @@
 #include "esp_app_format.h"
 #include "esp_partition.h"
 #include "esp_system.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 
 static const char *TAG = "ota_server";
 
@@ -20,6 +30,11 @@ static httpd_handle_t server = NULL;
 
 // OTA configuration
 #define OTA_BUF_SIZE 4096
+#define OTA_PIPELINE_DEPTH 2            // Chunks shared by the receiver and the flash writer
+#define OTA_WRITER_STACK 3072
+
+// Metrics response buffer (the per-client series grow with the channel count)
+#define METRICS_BUF_SIZE (8192 + 4096 * (METRICS_CHANNELS - 1))
 
 /**
  * @brief Handler for GET /
@@ -51,7 +66,8 @@ static esp_err_t handler_api_info(httpd_req_t *req)
     // Build JSON response
     char json_response[256];
     snprintf(json_response, sizeof(json_response),
-             "{\"version\":\"%s\",\"partition\":\"%s\",\"uptime\":%lu}",
+             "{\"version\":\"%s\",\"partition\":\"%s\",\"uptime\":%lu,"
+             "\"ota_formats\":[\"bin\",\"gzip\"]}",
              version, partition_label, (unsigned long)uptime_sec);
 
     httpd_resp_set_type(req, "application/json");
@@ -59,18 +75,411 @@ static esp_err_t handler_api_info(httpd_req_t *req)
     return ESP_OK;
 }
 
+/**
+ * @brief Handler for GET /api/metrics
+ * Returns throughput, drop, queue, latency and client counters as JSON,
+ * or in the Prometheus text format for ?format=prometheus or an Accept
+ * header asking for text/plain
+ */
+static esp_err_t handler_api_metrics(httpd_req_t *req)
+{
+    bool prometheus = false;
+
+    char query[32];
+    char format[16];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "format", format, sizeof(format)) == ESP_OK) {
+        prometheus = strcmp(format, "prometheus") == 0;
+    } else {
+        char accept[64];
+        if (httpd_req_get_hdr_value_str(req, "Accept", accept, sizeof(accept)) == ESP_OK) {
+            prometheus = strstr(accept, "text/plain") != NULL;
+        }
+    }
+
+    char *buf = malloc(METRICS_BUF_SIZE);
+    if (buf == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+
+    size_t len;
+    if (prometheus) {
+        len = metrics_format_prometheus(buf, METRICS_BUF_SIZE);
+        httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    } else {
+        len = metrics_format_json(buf, METRICS_BUF_SIZE);
+        httpd_resp_set_type(req, "application/json");
+    }
+    if (len >= METRICS_BUF_SIZE) {
+        ESP_LOGW(TAG, "Metrics output truncated");
+        len = strlen(buf);
+    }
+
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    esp_err_t err = httpd_resp_send(req, buf, len);
+    free(buf);
+    return err;
+}
+
+/**
+ * @brief Handler for GET /api/log
+ * Streams the flash log spool, oldest first. By default only the serial
+ * data is sent; ?format=records sends the spooled sectors as stored, with
+ * their headers and timestamped records
+ */
+static esp_err_t handler_api_log(httpd_req_t *req)
+{
+    bool records = false;
+
+    char query[32];
+    char format[16];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "format", format, sizeof(format)) == ESP_OK) {
+        records = strcmp(format, "records") == 0;
+    }
+
+    log_spool_iter_t iter;
+    if (log_spool_iter_begin(&iter) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Log spool not available");
+        return ESP_FAIL;
+    }
+
+    uint8_t *sector = malloc(LOG_SPOOL_SECTOR_SIZE);
+    if (sector == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Content-Disposition",
+                       records ? "attachment; filename=\"serial_log.slog\""
+                               : "attachment; filename=\"serial_log.bin\"");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+    esp_err_t err = ESP_OK;
+    while (err == ESP_OK && log_spool_iter_next(&iter, sector) == ESP_OK) {
+        const log_spool_sector_header_t *header = (const log_spool_sector_header_t *)sector;
+        size_t sector_len = sizeof(*header) + header->data_len;
+        if (records) {
+            err = httpd_resp_send_chunk(req, (const char *)sector, sector_len);
+            continue;
+        }
+
+        // Strip the framing, sending each record payload
+        size_t offset = sizeof(*header);
+        while (err == ESP_OK && offset + sizeof(log_spool_record_header_t) <= sector_len) {
+            const log_spool_record_header_t *record =
+                (const log_spool_record_header_t *)(sector + offset);
+            offset += sizeof(*record);
+            if (record->len > sector_len - offset) {
+                break;
+            }
+            err = httpd_resp_send_chunk(req, (const char *)sector + offset, record->len);
+            offset += record->len;
+        }
+    }
+    log_spool_iter_end(&iter);
+    free(sector);
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Log download aborted: %s", esp_err_to_name(err));
+        return err;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+// ============================================================================
+// OTA Pipeline
+// ============================================================================
+
+/**
+ * @brief One flash write unit passed from the HTTP handler to the writer
+ */
+typedef struct {
+    uint8_t *data;
+    size_t len;
+} ota_chunk_t;
+
+/**
+ * @brief State of one upload
+ *
+ * The HTTP handler receives (and inflates) into the chunk it owns while
+ * the writer task flashes the previous one, so network receive keeps going
+ * during flash erase and program.
+ */
+typedef struct {
+    const esp_partition_t *partition;
+    esp_ota_handle_t handle;
+    bool started;                       // esp_ota_begin() done, not yet ended
+    size_t image_len;                   // Image bytes handed to the writer
+    ota_gzip_t *gzip;                   // NULL for an uncompressed upload
+
+    uint8_t *buffers;                   // Receive buffer followed by the chunks
+    ota_chunk_t chunks[OTA_PIPELINE_DEPTH];
+    ota_chunk_t *chunk;                 // Chunk being filled (NULL = none)
+    QueueHandle_t free_queue;           // Chunks the handler may fill
+    QueueHandle_t full_queue;           // Chunks waiting for flash, NULL stops the writer
+    SemaphoreHandle_t writer_done;
+    bool writer_running;
+    volatile bool cancelled;            // Drop queued chunks instead of writing them
+    volatile esp_err_t write_err;       // First esp_ota_write() failure
+
+    httpd_err_code_t status;            // Error response
+    const char *message;
+} ota_update_t;
+
+/**
+ * @brief Record the first failure of an upload
+ */
+static esp_err_t ota_fail(ota_update_t *ota, httpd_err_code_t status, const char *message)
+{
+    if (ota->message == NULL) {
+        ota->status = status;
+        ota->message = message;
+    }
+    return ESP_FAIL;
+}
+
+/**
+ * @brief Flash writer task, owns esp_ota_write() while an upload runs
+ */
+static void ota_writer_task(void *arg)
+{
+    ota_update_t *ota = (ota_update_t *)arg;
+    ota_chunk_t *chunk;
+
+    while (xQueueReceive(ota->full_queue, &chunk, portMAX_DELAY) == pdTRUE && chunk != NULL) {
+        if (ota->write_err == ESP_OK && !ota->cancelled) {
+            esp_err_t err = esp_ota_write(ota->handle, chunk->data, chunk->len);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "esp_ota_write failed: %s", esp_err_to_name(err));
+                ota->write_err = err;
+            }
+        }
+        xQueueSend(ota->free_queue, &chunk, portMAX_DELAY);
+    }
+
+    xSemaphoreGive(ota->writer_done);
+    vTaskDelete(NULL);
+}
+
+static esp_err_t ota_pipeline_init(ota_update_t *ota)
+{
+    ota->buffers = malloc(OTA_BUF_SIZE * (OTA_PIPELINE_DEPTH + 1));
+    // One spare slot so the stop marker never waits for the writer
+    ota->free_queue = xQueueCreate(OTA_PIPELINE_DEPTH, sizeof(ota_chunk_t *));
+    ota->full_queue = xQueueCreate(OTA_PIPELINE_DEPTH + 1, sizeof(ota_chunk_t *));
+    ota->writer_done = xSemaphoreCreateBinary();
+    if (ota->buffers == NULL || ota->free_queue == NULL ||
+        ota->full_queue == NULL || ota->writer_done == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int i = 0; i < OTA_PIPELINE_DEPTH; i++) {
+        ota_chunk_t *chunk = &ota->chunks[i];
+        chunk->data = ota->buffers + OTA_BUF_SIZE * (i + 1);
+        chunk->len = 0;
+        xQueueSend(ota->free_queue, &chunk, 0);
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Stop the writer once the chunks queued so far are handled
+ */
+static void ota_writer_stop(ota_update_t *ota)
+{
+    if (!ota->writer_running) {
+        return;
+    }
+    ota_chunk_t *stop = NULL;
+    xQueueSend(ota->full_queue, &stop, portMAX_DELAY);
+    xSemaphoreTake(ota->writer_done, portMAX_DELAY);
+    ota->writer_running = false;
+}
+
+/**
+ * @brief Release an upload, aborting the OTA if it did not complete
+ */
+static void ota_release(ota_update_t *ota)
+{
+    ota->cancelled = true;
+    ota_writer_stop(ota);
+    if (ota->started) {
+        esp_ota_abort(ota->handle);
+        ota->started = false;
+    }
+    if (ota->writer_done != NULL) {
+        vSemaphoreDelete(ota->writer_done);
+    }
+    if (ota->full_queue != NULL) {
+        vQueueDelete(ota->full_queue);
+    }
+    if (ota->free_queue != NULL) {
+        vQueueDelete(ota->free_queue);
+    }
+    free(ota->gzip);
+    free(ota->buffers);
+}
+
+/**
+ * @brief Validate the image header and start flashing
+ */
+static esp_err_t ota_start(ota_update_t *ota, uint8_t magic)
+{
+    if (magic != ESP_IMAGE_HEADER_MAGIC) {
+        ESP_LOGE(TAG, "Invalid firmware format (magic byte: 0x%02X, expected: 0x%02X)",
+                 magic, ESP_IMAGE_HEADER_MAGIC);
+        return ota_fail(ota, HTTPD_400_BAD_REQUEST, "Invalid firmware format");
+    }
+
+    esp_err_t err = esp_ota_begin(ota->partition, OTA_WITH_SEQUENTIAL_WRITES, &ota->handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_ota_begin failed: %s", esp_err_to_name(err));
+        return ota_fail(ota, HTTPD_500_INTERNAL_SERVER_ERROR, "OTA begin failed");
+    }
+    ota->started = true;
+
+    // Same priority as the HTTP server task, which sleeps in recv while the writer runs
+    BaseType_t created = xTaskCreatePinnedToCore(ota_writer_task, "ota_write", OTA_WRITER_STACK,
+                                                 ota, uxTaskPriorityGet(NULL), NULL,
+                                                 CONFIG_TASK_NET_CORE);
+    if (created != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create OTA writer task");
+        return ota_fail(ota, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+    }
+    ota->writer_running = true;
+    ESP_LOGI(TAG, "OTA started successfully");
+    return ESP_OK;
+}
+
+/**
+ * @brief Hand the filled chunk to the writer
+ */
+static esp_err_t ota_submit(ota_update_t *ota)
+{
+    xQueueSend(ota->full_queue, &ota->chunk, portMAX_DELAY);
+    ota->chunk = NULL;
+    if (ota->write_err != ESP_OK) {
+        return ota_fail(ota, HTTPD_500_INTERNAL_SERVER_ERROR, "Flash write failed");
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Append image data, passing every full chunk to the writer
+ */
+static esp_err_t ota_write(ota_update_t *ota, const uint8_t *data, size_t len)
+{
+    if (len == 0) {
+        return ESP_OK;
+    }
+    if (!ota->started) {
+        esp_err_t err = ota_start(ota, data[0]);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    if (ota->image_len + len > CONFIG_OTA_MAX_UPLOAD_SIZE) {
+        ESP_LOGE(TAG, "Firmware image exceeds %d bytes", CONFIG_OTA_MAX_UPLOAD_SIZE);
+        return ota_fail(ota, HTTPD_400_BAD_REQUEST, "Firmware too large");
+    }
+    ota->image_len += len;
+
+    while (len > 0) {
+        if (ota->chunk == NULL) {
+            xQueueReceive(ota->free_queue, &ota->chunk, portMAX_DELAY);
+            ota->chunk->len = 0;
+        }
+        size_t n = MIN(len, OTA_BUF_SIZE - ota->chunk->len);
+        memcpy(ota->chunk->data + ota->chunk->len, data, n);
+        ota->chunk->len += n;
+        data += n;
+        len -= n;
+        if (ota->chunk->len == OTA_BUF_SIZE) {
+            esp_err_t err = ota_submit(ota);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+// ============================================================================
+// gzip Decoding
+// ============================================================================
+
+static esp_err_t ota_gzip_write(void *ctx, const uint8_t *data, size_t len)
+{
+    return ota_write((ota_update_t *)ctx, data, len);
+}
+
+static esp_err_t ota_gzip_start(ota_update_t *ota, size_t upload_len)
+{
+    ota->gzip = malloc(sizeof(ota_gzip_t));
+    if (ota->gzip == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate inflate state (%u bytes)", (unsigned)sizeof(ota_gzip_t));
+        return ota_fail(ota, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+    }
+    if (ota_gzip_init(ota->gzip, upload_len, ota_gzip_write, ota) != ESP_OK) {
+        return ota_fail(ota, HTTPD_400_BAD_REQUEST, "Invalid compressed image");
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Flush the pipeline, then validate and activate the new image
+ */
+static esp_err_t ota_finish(ota_update_t *ota)
+{
+    if (ota->gzip != NULL && ota_gzip_finish(ota->gzip) != ESP_OK) {
+        return ota_fail(ota, HTTPD_400_BAD_REQUEST, "Invalid compressed image");
+    }
+    if (!ota->started) {
+        return ota_fail(ota, HTTPD_400_BAD_REQUEST, "No firmware data");
+    }
+
+    if (ota->chunk != NULL && ota->chunk->len > 0) {
+        esp_err_t err = ota_submit(ota);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    ota_writer_stop(ota);
+    if (ota->write_err != ESP_OK) {
+        return ota_fail(ota, HTTPD_500_INTERNAL_SERVER_ERROR, "Flash write failed");
+    }
+
+    // esp_ota_end() releases the handle whatever it returns
+    ota->started = false;
+    esp_err_t err = esp_ota_end(ota->handle);
+    if (err != ESP_OK) {
+        if (err == ESP_ERR_OTA_VALIDATE_FAILED) {
+            ESP_LOGE(TAG, "Firmware validation failed (checksum error)");
+            return ota_fail(ota, HTTPD_400_BAD_REQUEST, "Firmware validation failed");
+        }
+        ESP_LOGE(TAG, "esp_ota_end failed: %s", esp_err_to_name(err));
+        return ota_fail(ota, HTTPD_500_INTERNAL_SERVER_ERROR, "OTA end failed");
+    }
+
+    // Set boot partition to the newly uploaded firmware
+    err = esp_ota_set_boot_partition(ota->partition);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_ota_set_boot_partition failed: %s", esp_err_to_name(err));
+        return ota_fail(ota, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to set boot partition");
+    }
+    return ESP_OK;
+}
+
 /**
  * @brief Handler for POST /api/ota
- * Receives and flashes firmware update
+ * Receives and flashes a firmware update, plain or gzip compressed
  */
 static esp_err_t handler_api_ota(httpd_req_t *req)
 {
-    esp_err_t err;
-    esp_ota_handle_t update_handle = 0;
     const esp_partition_t *update_partition = NULL;
-    uint8_t *ota_write_data = NULL;
-    int binary_file_length = 0;
-    bool is_ota_started = false;
 
     ESP_LOGI(TAG, "Starting OTA update, content length: %d bytes", req->content_len);
 
@@ -102,20 +511,24 @@ static esp_err_t handler_api_ota(httpd_req_t *req)
              (unsigned long)update_partition->address,
              (unsigned long)update_partition->size);
 
-    // Allocate buffer for receiving data
-    ota_write_data = malloc(OTA_BUF_SIZE);
-    if (ota_write_data == NULL) {
-        ESP_LOGE(TAG, "Failed to allocate OTA buffer");
+    ota_update_t ota = {
+        .partition = update_partition,
+    };
+    esp_err_t err = ota_pipeline_init(&ota);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to allocate OTA buffers");
+        ota_release(&ota);
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
         return ESP_FAIL;
     }
 
+    uint8_t *recv_buf = ota.buffers;
     int remaining = req->content_len;
     int total_received = 0;
+    int64_t start_us = esp_timer_get_time();
 
-    while (remaining > 0) {
-        int recv_len = httpd_req_recv(req, (char *)ota_write_data,
-                                       MIN(remaining, OTA_BUF_SIZE));
+    while (err == ESP_OK && remaining > 0) {
+        int recv_len = httpd_req_recv(req, (char *)recv_buf, MIN(remaining, OTA_BUF_SIZE));
 
         if (recv_len < 0) {
             if (recv_len == HTTPD_SOCK_ERR_TIMEOUT) {
@@ -123,110 +536,66 @@ static esp_err_t handler_api_ota(httpd_req_t *req)
                 continue;
             }
             ESP_LOGE(TAG, "Failed to receive firmware data");
-            if (is_ota_started) {
-                esp_ota_abort(update_handle);
-            }
-            free(ota_write_data);
-            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
-                               "Connection error");
-            return ESP_FAIL;
+            err = ota_fail(&ota, HTTPD_500_INTERNAL_SERVER_ERROR, "Connection error");
+            break;
         }
 
         if (recv_len == 0) {
             ESP_LOGW(TAG, "Connection closed by client");
-            if (is_ota_started) {
-                esp_ota_abort(update_handle);
-            }
-            free(ota_write_data);
-            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Connection closed");
-            return ESP_FAIL;
+            err = ota_fail(&ota, HTTPD_400_BAD_REQUEST, "Connection closed");
+            break;
         }
 
-        // Validate first chunk - check for ESP32 app magic byte
-        if (total_received == 0) {
-            if (ota_write_data[0] != ESP_IMAGE_HEADER_MAGIC) {
-                ESP_LOGE(TAG, "Invalid firmware format (magic byte: 0x%02X, expected: 0x%02X)",
-                         ota_write_data[0], ESP_IMAGE_HEADER_MAGIC);
-                free(ota_write_data);
-                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
-                                   "Invalid firmware format");
-                return ESP_FAIL;
-            }
-
-            // Begin OTA update
-            err = esp_ota_begin(update_partition, OTA_WITH_SEQUENTIAL_WRITES,
-                               &update_handle);
+        // An upload starting with the gzip magic is inflated as it streams in
+        if (total_received == 0 && recv_buf[0] == GZIP_ID1) {
+            err = ota_gzip_start(&ota, req->content_len);
             if (err != ESP_OK) {
-                ESP_LOGE(TAG, "esp_ota_begin failed: %s", esp_err_to_name(err));
-                free(ota_write_data);
-                httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
-                                   "OTA begin failed");
-                return ESP_FAIL;
+                break;
             }
-            is_ota_started = true;
-            ESP_LOGI(TAG, "OTA started successfully");
-        }
-
-        // Write data to flash
-        err = esp_ota_write(update_handle, (const void *)ota_write_data, recv_len);
-        if (err != ESP_OK) {
-            ESP_LOGE(TAG, "esp_ota_write failed: %s", esp_err_to_name(err));
-            esp_ota_abort(update_handle);
-            free(ota_write_data);
-            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
-                               "Flash write failed");
-            return ESP_FAIL;
+            ESP_LOGI(TAG, "gzip compressed image");
         }
 
         total_received += recv_len;
         remaining -= recv_len;
-        binary_file_length += recv_len;
+
+        if (ota.gzip != NULL) {
+            // A write failure is already recorded, anything else is bad data
+            err = ota_gzip_feed(ota.gzip, recv_buf, recv_len);
+            if (err != ESP_OK) {
+                err = ota_fail(&ota, HTTPD_400_BAD_REQUEST, "Invalid compressed image");
+            }
+        } else {
+            err = ota_write(&ota, recv_buf, recv_len);
+        }
 
         // Log progress every 64KB
         if (total_received % (64 * 1024) == 0 || remaining == 0) {
-            ESP_LOGI(TAG, "Written %d / %d bytes (%.1f%%)",
+            ESP_LOGI(TAG, "Received %d / %d bytes (%.1f%%)",
                      total_received, req->content_len,
                      (float)total_received / req->content_len * 100.0);
         }
     }
 
-    ESP_LOGI(TAG, "Total binary data length: %d bytes", binary_file_length);
-
-    // End OTA update
-    err = esp_ota_end(update_handle);
-    if (err != ESP_OK) {
-        if (err == ESP_ERR_OTA_VALIDATE_FAILED) {
-            ESP_LOGE(TAG, "Firmware validation failed (checksum error)");
-            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
-                               "Firmware validation failed");
-        } else {
-            ESP_LOGE(TAG, "esp_ota_end failed: %s", esp_err_to_name(err));
-            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
-                               "OTA end failed");
-        }
-        free(ota_write_data);
-        return ESP_FAIL;
+    if (err == ESP_OK) {
+        err = ota_finish(&ota);
     }
-
-    // Set boot partition to the newly uploaded firmware
-    err = esp_ota_set_boot_partition(update_partition);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "esp_ota_set_boot_partition failed: %s",
-                 esp_err_to_name(err));
-        free(ota_write_data);
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
-                           "Failed to set boot partition");
+        ota_release(&ota);
+        httpd_resp_send_err(req, ota.status, ota.message);
         return ESP_FAIL;
     }
 
+    ESP_LOGI(TAG, "Firmware image: %u bytes (%d bytes received) in %lld ms",
+             (unsigned)ota.image_len, total_received,
+             (long long)((esp_timer_get_time() - start_us) / 1000));
+    ota_release(&ota);
+
     ESP_LOGI(TAG, "OTA update completed successfully");
     ESP_LOGI(TAG, "Next boot partition: %s", update_partition->label);
 
     // Send success response
     httpd_resp_sendstr(req, "OK");
 
-    free(ota_write_data);
-
     // Schedule restart after a short delay
     ESP_LOGI(TAG, "Restarting in 3 seconds...");
     vTaskDelay(pdMS_TO_TICKS(3000));
@@ -235,6 +604,18 @@ static esp_err_t handler_api_ota(httpd_req_t *req)
     return ESP_OK;
 }
 
+#ifdef CONFIG_WEB_CONSOLE_ENABLE
+/**
+ * @brief Session close hook: drop console viewers before the socket goes away
+ */
+static void ota_session_closed(httpd_handle_t hd, int sockfd)
+{
+    (void)hd;
+    web_console_session_closed(sockfd);
+    close(sockfd);
+}
+#endif
+
 /**
  * @brief Start the OTA HTTP server
  */
@@ -249,7 +630,12 @@ esp_err_t ota_server_init(void)
     config.server_port = CONFIG_OTA_HTTP_SERVER_PORT;
     config.max_uri_handlers = 8;
     config.max_open_sockets = 4;
+#ifdef CONFIG_WEB_CONSOLE_ENABLE
+    config.max_open_sockets += CONFIG_WEB_CONSOLE_MAX_VIEWERS;     // Viewers stay connected
+    config.close_fn = ota_session_closed;
+#endif
     config.stack_size = 6144;
+    config.core_id = CONFIG_TASK_NET_CORE;     // Keep HTTP off the USB core
     config.lru_purge_enable = true;
     config.recv_wait_timeout = 10;
     config.send_wait_timeout = 10;
@@ -279,6 +665,22 @@ esp_err_t ota_server_init(void)
     };
     httpd_register_uri_handler(server, &uri_api_info);
 
+    httpd_uri_t uri_api_metrics = {
+        .uri = "/api/metrics",
+        .method = HTTP_GET,
+        .handler = handler_api_metrics,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &uri_api_metrics);
+
+    httpd_uri_t uri_api_log = {
+        .uri = "/api/log",
+        .method = HTTP_GET,
+        .handler = handler_api_log,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &uri_api_log);
+
     httpd_uri_t uri_api_ota = {
         .uri = "/api/ota",
         .method = HTTP_POST,
@@ -287,6 +689,13 @@ esp_err_t ota_server_init(void)
     };
     httpd_register_uri_handler(server, &uri_api_ota);
 
+#ifdef CONFIG_WEB_CONSOLE_ENABLE
+    // Fails when capture is disabled (web_console_init() was refused)
+    if (web_console_register(server) != ESP_OK) {
+        ESP_LOGW(TAG, "Web console not available");
+    }
+#endif
+
     ESP_LOGI(TAG, "HTTP server started successfully");
     ESP_LOGI(TAG, "OTA web UI available at: http://<device-ip>:%d/",
              config.server_port);
@@ -11,6 +11,7 @@
  * - GET  /              : Serve web UI for firmware upload
  * - GET  /api/info      : Return device information (JSON)
  * - POST /api/ota       : Handle firmware upload
+ * - GET  /ws/console    : Live serial console (WebSocket, see web_console.h)
  *
  * @return ESP_OK on success, error code otherwise
  */
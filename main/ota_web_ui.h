@@ -35,6 +35,11 @@ static const char ota_html[] =
 ".status-error{background:#f8d7da;color:#721c24;border:1px solid #f5c6cb}"
 ".status-info{background:#d1ecf1;color:#0c5460;border:1px solid #bee5eb}"
 ".hidden{display:none}"
+".console-section{background:#fff;padding:20px;margin-top:20px;border-radius:8px;box-shadow:0 2px 4px rgba(0,0,0,0.1)}"
+".console-bar{display:flex;align-items:center;gap:12px;margin-bottom:10px;font-size:14px;color:#666}"
+".console-state{flex:1;font-family:monospace}"
+".console-bar button{width:auto;padding:4px 12px;font-size:14px}"
+".console{height:360px;overflow-y:auto;padding:10px;background:#1e1e1e;color:#ddd;border-radius:4px;font:12px/1.4 monospace;white-space:pre-wrap;word-break:break-all}"
 "</style>"
 "</head>"
 "<body>"
@@ -46,11 +51,20 @@ static const char ota_html[] =
 "</div>"
 "<div class=\"upload-section\">"
 "<h2>Upload Firmware</h2>"
-"<input type=\"file\" id=\"fileInput\" accept=\".bin\"/>"
+"<input type=\"file\" id=\"fileInput\" accept=\".bin,.gz\"/>"
 "<button id=\"uploadBtn\" onclick=\"uploadFirmware()\">Upload Firmware</button>"
 "<progress id=\"progressBar\" value=\"0\" max=\"100\" class=\"hidden\"></progress>"
 "<div id=\"statusMessage\" class=\"status-message\"></div>"
 "</div>"
+"<div class=\"console-section\">"
+"<h2>Serial Console</h2>"
+"<div class=\"console-bar\">"
+"<span class=\"console-state\" id=\"consoleState\">Connecting...</span>"
+"<label><input type=\"checkbox\" id=\"autoScroll\" checked/> Auto-scroll</label>"
+"<button onclick=\"clearConsole()\">Clear</button>"
+"</div>"
+"<pre class=\"console\" id=\"console\"></pre>"
+"</div>"
 "<script>"
 "fetch('/api/info').then(r=>r.json()).then(d=>{"
 "document.getElementById('version').textContent=d.version||'Unknown';"
@@ -98,6 +112,26 @@ static const char ota_html[] =
 "document.getElementById('fileInput').addEventListener('change',function(){"
 "document.getElementById('uploadBtn').disabled=!this.files[0]"
 "});"
+"const CMAX=200000,ce=document.getElementById('console'),ct=ce.appendChild(document.createTextNode(''));"
+"let cd=new TextDecoder(),cp='',cc=false;"
+"function consoleAppend(t){if(!cp)requestAnimationFrame(consoleRender);cp+=t}"
+"function consoleRender(){"
+"const t=cp.replace(/\\x1b\\[[0-9;?]*[A-Za-z]/g,'').replace(/\\r/g,'');"
+"cp='';ct.appendData(t);"
+"const x=ct.length-CMAX;"
+"if(x>0){const c=ct.substringData(x,256).indexOf('\\n');ct.deleteData(0,c<0?x:x+c+1)}"
+"if(document.getElementById('autoScroll').checked)ce.scrollTop=ce.scrollHeight"
+"}"
+"function clearConsole(){ct.deleteData(0,ct.length)}"
+"function connectConsole(){"
+"const st=document.getElementById('consoleState'),"
+"ws=new WebSocket((location.protocol==='https:'?'wss://':'ws://')+location.host+'/ws/console');"
+"ws.binaryType='arraybuffer';"
+"ws.onopen=()=>{st.textContent='Connected';if(cc)consoleAppend('\\n[reconnected]\\n');cc=true;cd=new TextDecoder()};"
+"ws.onmessage=e=>{if(typeof e.data==='string')consoleAppend('\\n['+e.data+']\\n');else consoleAppend(cd.decode(e.data,{stream:true}))};"
+"ws.onclose=()=>{st.textContent='Disconnected, retrying...';setTimeout(connectConsole,3000)}"
+"}"
+"connectConsole();"
 "</script>"
 "</body>"
 "</html>";
@@ -49,6 +49,11 @@ void rfc2217_session_init(rfc2217_session_t *session, const char *signature)
     session->option_response_cmd = 0;
     session->option_response_opt = 0;
     session->break_changed = false;
+    session->flow_control_changed = false;
+    session->latency = RFC2217_LATENCY_AUTO;
+    session->xfer_size = 0;
+    session->latency_changed = false;
+    session->xfer_size_changed = false;
 }
 
 // ============================================================================
@@ -158,6 +163,7 @@ static void process_subnegotiation(rfc2217_session_t *session)
                     case RFC2217_CONTROL_FLOW_HARDWARE:
                         session->flowcontrol = value[0];
                         session->settings_changed = true;
+                        session->flow_control_changed = true;
                         ESP_LOGD(TAG, "Set flow control: %d", value[0]);
                         break;
 
@@ -240,6 +246,33 @@ static void process_subnegotiation(rfc2217_session_t *session)
             ESP_LOGD(TAG, "Flow control resume");
             break;
 
+        case RFC2217_VENDOR_SET_LATENCY:
+            if (value_len >= 1) {
+                if (value[0] == RFC2217_LATENCY_REQUEST) {
+                    ESP_LOGD(TAG, "Latency query");
+                } else {
+                    session->latency = value[0];
+                    session->settings_changed = true;
+                    session->latency_changed = true;
+                    ESP_LOGD(TAG, "Set latency: %d", value[0]);
+                }
+            }
+            break;
+
+        case RFC2217_VENDOR_SET_XFER_SIZE:
+            if (value_len >= 2) {
+                uint16_t size = ((uint16_t)value[0] << 8) | value[1];
+                if (size == RFC2217_XFER_SIZE_REQUEST) {
+                    ESP_LOGD(TAG, "Transfer size query");
+                } else if (size >= RFC2217_XFER_SIZE_MIN && size <= RFC2217_XFER_SIZE_MAX) {
+                    session->xfer_size = size;
+                    session->settings_changed = true;
+                    session->xfer_size_changed = true;
+                    ESP_LOGD(TAG, "Set transfer size: %u", size);
+                }
+            }
+            break;
+
         default:
             ESP_LOGW(TAG, "Unknown COM-PORT-OPTION command: %d", cmd);
             break;
@@ -411,6 +444,86 @@ rfc2217_result_t rfc2217_parse_byte(rfc2217_session_t *session, uint8_t byte,
     }
 }
 
+// ============================================================================
+// Bulk data plane (word-at-a-time IAC scan)
+// ============================================================================
+
+// Every byte of a word set to 0x01 / 0x80
+#define WORD_ONES   ((size_t)-1 / 0xFF)
+#define WORD_HIGHS  (WORD_ONES << 7)
+
+// Non-zero if any byte of w is 0xFF (classic "has zero byte" test on ~w)
+static inline size_t word_has_iac(size_t w)
+{
+    size_t x = ~w;
+    return (x - WORD_ONES) & ~x & WORD_HIGHS;
+}
+
+size_t rfc2217_find_iac(const uint8_t *data, size_t len)
+{
+    size_t i = 0;
+
+    // Byte-wise until word aligned
+    while (i < len && ((uintptr_t)(data + i) & (sizeof(size_t) - 1)) != 0) {
+        if (data[i] == TELNET_IAC) {
+            return i;
+        }
+        i++;
+    }
+
+    // Word-wise over aligned data
+    while (len - i >= sizeof(size_t)) {
+        size_t w;
+        memcpy(&w, data + i, sizeof(w));
+        if (word_has_iac(w)) {
+            break;
+        }
+        i += sizeof(size_t);
+    }
+
+    // Locate the exact byte (or finish the tail)
+    while (i < len && data[i] != TELNET_IAC) {
+        i++;
+    }
+    return i;
+}
+
+rfc2217_result_t rfc2217_parse_chunk(rfc2217_session_t *session,
+                                     const uint8_t *in, size_t in_len,
+                                     uint8_t *out_data, size_t *out_len,
+                                     size_t *consumed)
+{
+    size_t i = 0;
+    size_t o = 0;
+
+    while (i < in_len) {
+        if (session->state == RFC2217_STATE_DATA) {
+            // Copy the run of plain data up to the next IAC in one go
+            size_t run = rfc2217_find_iac(in + i, in_len - i);
+            if (run > 0) {
+                memcpy(out_data + o, in + i, run);
+                o += run;
+                i += run;
+                continue;
+            }
+        }
+
+        // IAC sequence: fall back to the state machine
+        size_t n = 0;
+        rfc2217_result_t result = rfc2217_parse_byte(session, in[i++], out_data + o, &n);
+        o += n;
+        if (result == RFC2217_RESULT_COMMAND || result == RFC2217_RESULT_ERROR) {
+            *out_len = o;
+            *consumed = i;
+            return result;
+        }
+    }
+
+    *out_len = o;
+    *consumed = i;
+    return o > 0 ? RFC2217_RESULT_DATA : RFC2217_RESULT_CONTINUE;
+}
+
 // ============================================================================
 // Data escaping for transmission
 // ============================================================================
@@ -418,20 +531,83 @@ rfc2217_result_t rfc2217_parse_byte(rfc2217_session_t *session, uint8_t byte,
 size_t rfc2217_escape_data(const uint8_t *in, size_t in_len,
                            uint8_t *out, size_t out_size)
 {
+    size_t i = 0;
     size_t j = 0;
-    for (size_t i = 0; i < in_len && j < out_size - 1; i++) {
-        if (in[i] == TELNET_IAC) {
-            out[j++] = TELNET_IAC;
-            if (j < out_size) {
-                out[j++] = TELNET_IAC;
-            }
-        } else {
-            out[j++] = in[i];
+
+    while (i < in_len) {
+        // Copy the run of plain data up to the next IAC
+        size_t run = rfc2217_find_iac(in + i, in_len - i);
+        if (run > out_size - j) {
+            run = out_size - j;
+        }
+        memcpy(out + j, in + i, run);
+        i += run;
+        j += run;
+
+        if (i >= in_len) {
+            break;
+        }
+        if (in[i] != TELNET_IAC || out_size - j < 2) {
+            // Output full
+            break;
         }
+
+        // IAC -> IAC IAC
+        out[j++] = TELNET_IAC;
+        out[j++] = TELNET_IAC;
+        i++;
     }
     return j;
 }
 
+// Doubled IACs for rfc2217_escape_spans() are taken from here
+#define IAC_FILL_SIZE 64
+static const uint8_t s_iac_fill[IAC_FILL_SIZE] = {
+    [0 ... IAC_FILL_SIZE - 1] = TELNET_IAC
+};
+
+size_t rfc2217_escape_spans(const uint8_t *in, size_t in_len,
+                            rfc2217_span_t *spans, size_t max_spans,
+                            size_t *consumed)
+{
+    size_t i = 0;
+    size_t n = 0;
+
+    while (i < in_len && n < max_spans) {
+        // Plain run, then the IAC run that follows it (bounded by the fill size)
+        size_t run = rfc2217_find_iac(in + i, in_len - i);
+        size_t iacs = 0;
+        while (i + run + iacs < in_len && in[i + run + iacs] == TELNET_IAC && iacs < IAC_FILL_SIZE) {
+            iacs++;
+        }
+
+        if (iacs > 0 && n + 2 > max_spans) {
+            // No room for the fill span: emit the plain run only
+            if (run > 0) {
+                spans[n].base = in + i;
+                spans[n].len = run;
+                n++;
+                i += run;
+            }
+            break;
+        }
+
+        // Input span carries the first copy of each IAC, the fill the second
+        spans[n].base = in + i;
+        spans[n].len = run + iacs;
+        n++;
+        if (iacs > 0) {
+            spans[n].base = s_iac_fill;
+            spans[n].len = iacs;
+            n++;
+        }
+        i += run + iacs;
+    }
+
+    *consumed = i;
+    return n;
+}
+
 // ============================================================================
 // Response builders
 // ============================================================================
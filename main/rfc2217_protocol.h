@@ -83,6 +83,12 @@ extern "C" {
 #define RFC2217_RESP_SET_MODEMSTATE_MASK (RFC2217_SET_MODEMSTATE_MASK + RFC2217_RESP_OFFSET)
 #define RFC2217_RESP_PURGE_DATA         (RFC2217_PURGE_DATA + RFC2217_RESP_OFFSET)
 
+// Vendor extensions (outside the RFC 2217 command range, ignored by other servers)
+#define RFC2217_VENDOR_SET_LATENCY      64  // 1 byte: FTDI latency timer
+#define RFC2217_VENDOR_SET_XFER_SIZE    65  // 2 bytes (network order): bulk IN transfer size
+#define RFC2217_RESP_VENDOR_SET_LATENCY (RFC2217_VENDOR_SET_LATENCY + RFC2217_RESP_OFFSET)
+#define RFC2217_RESP_VENDOR_SET_XFER_SIZE (RFC2217_VENDOR_SET_XFER_SIZE + RFC2217_RESP_OFFSET)
+
 // ============================================================================
 // SET-DATASIZE values
 // ============================================================================
@@ -144,6 +150,18 @@ extern "C" {
 #define RFC2217_CONTROL_INFLOW_XONXOFF      15
 #define RFC2217_CONTROL_INFLOW_HARDWARE     16
 
+// ============================================================================
+// Vendor option values
+// ============================================================================
+
+#define RFC2217_LATENCY_REQUEST     0   // Request current value
+#define RFC2217_LATENCY_AUTO        255 // Select from baud rate and traffic profile
+                                        // (1-254 = fixed latency in ms)
+
+#define RFC2217_XFER_SIZE_REQUEST   0   // Request current value
+#define RFC2217_XFER_SIZE_MIN       512
+#define RFC2217_XFER_SIZE_MAX       16384
+
 // ============================================================================
 // NOTIFY-MODEMSTATE bit definitions
 // ============================================================================
@@ -239,6 +257,7 @@ typedef struct {
     bool settings_changed;
     bool line_coding_changed;   // baudrate/datasize/parity/stopsize changed
     bool modem_control_changed; // DTR/RTS changed
+    bool flow_control_changed;  // SET-CONTROL flow control value received
     bool send_modemstate;
     bool send_linestate;
 
@@ -255,6 +274,12 @@ typedef struct {
 
     // Break signal change tracking
     bool break_changed;
+
+    // Vendor options (FTDI tuning)
+    uint8_t latency;            // RFC2217_LATENCY_AUTO or ms
+    uint16_t xfer_size;         // Bulk IN transfer size in bytes
+    bool latency_changed;
+    bool xfer_size_changed;
 } rfc2217_session_t;
 
 // ============================================================================
@@ -268,6 +293,15 @@ typedef enum {
     RFC2217_RESULT_ERROR,       // Parse error
 } rfc2217_result_t;
 
+// ============================================================================
+// Scatter/gather escape span
+// ============================================================================
+
+typedef struct {
+    const uint8_t *base;        // Start of span (input data or static IAC fill)
+    size_t len;                 // Span length in bytes
+} rfc2217_span_t;
+
 // ============================================================================
 // Function prototypes
 // ============================================================================
@@ -290,17 +324,71 @@ void rfc2217_session_init(rfc2217_session_t *session, const char *signature);
 rfc2217_result_t rfc2217_parse_byte(rfc2217_session_t *session, uint8_t byte,
                                      uint8_t *out_data, size_t *out_len);
 
+/**
+ * @brief Parse a block of bytes from the input stream
+ *
+ * Fast path for the data plane: while the parser is in data state, runs
+ * of plain bytes are located a word at a time and copied with memcpy.
+ * Only bytes around IAC sequences go through rfc2217_parse_byte().
+ *
+ * Parsing stops right after a command (or parse error) so the caller can
+ * flush data and respond before continuing with the remaining input.
+ *
+ * @param session Pointer to session structure
+ * @param in Input bytes
+ * @param in_len Number of input bytes
+ * @param out_data Output buffer for unescaped data (at least in_len bytes)
+ * @param out_len Pointer to number of data bytes written
+ * @param consumed Pointer to number of input bytes consumed
+ * @return RFC2217_RESULT_COMMAND or RFC2217_RESULT_ERROR when stopped at one,
+ *         otherwise RFC2217_RESULT_DATA if data was written, RFC2217_RESULT_CONTINUE if not
+ */
+rfc2217_result_t rfc2217_parse_chunk(rfc2217_session_t *session,
+                                     const uint8_t *in, size_t in_len,
+                                     uint8_t *out_data, size_t *out_len,
+                                     size_t *consumed);
+
+/**
+ * @brief Find the first IAC (0xFF) byte
+ *
+ * Scans a machine word at a time.
+ *
+ * @param data Input data
+ * @param len Input data length
+ * @return Index of the first IAC byte, or len if there is none
+ */
+size_t rfc2217_find_iac(const uint8_t *data, size_t len);
+
 /**
  * @brief Escape data for transmission (double IAC bytes)
  * @param in Input data buffer
  * @param in_len Input data length
  * @param out Output buffer (must be at least 2x in_len)
  * @param out_size Output buffer size
- * @return Number of bytes written to output
+ * @return Number of bytes written to output (stops before an input byte
+ *         that does not fit, so an IAC pair is never split)
  */
 size_t rfc2217_escape_data(const uint8_t *in, size_t in_len,
                            uint8_t *out, size_t out_size);
 
+/**
+ * @brief Describe escaped data as a list of spans without copying
+ *
+ * Each span points either into the input (plain data followed by a run
+ * of IAC bytes) or into a static IAC fill that supplies the doubled IACs,
+ * so the spans can be handed to writev() directly.
+ *
+ * @param in Input data buffer
+ * @param in_len Input data length
+ * @param spans Output span array
+ * @param max_spans Capacity of the span array
+ * @param consumed Pointer to number of input bytes covered by the spans
+ * @return Number of spans written
+ */
+size_t rfc2217_escape_spans(const uint8_t *in, size_t in_len,
+                            rfc2217_span_t *spans, size_t max_spans,
+                            size_t *consumed);
+
 /**
  * @brief Build WILL COM-PORT-OPTION response
  * @param out Output buffer
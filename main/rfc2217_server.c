@@ -8,13 +8,12 @@
 #include "rfc2217_server.h"
 #include "rfc2217_protocol.h"
 #include "serial_control.h"
+#include "net_loop.h"
+#include "metrics.h"
 
+#include <assert.h>
 #include <string.h>
 #include "esp_log.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
-#include "freertos/semphr.h"
-#include "freertos/queue.h"
 
 #include "lwip/err.h"
 #include "lwip/sockets.h"
@@ -29,170 +28,201 @@ static const char *TAG = "rfc2217";
 // Configuration
 // ============================================================================
 
-#ifndef CONFIG_RFC2217_PORT
-#define CONFIG_RFC2217_PORT 2217
-#endif
-
-#ifndef CONFIG_RFC2217_MODEM_POLL_INTERVAL_MS
-#define CONFIG_RFC2217_MODEM_POLL_INTERVAL_MS 100
-#endif
-
 #define RFC2217_RX_BUFFER_SIZE      256
 #define RFC2217_TX_BUFFER_SIZE      1024
-#define RFC2217_SERVER_TASK_STACK   4096
-#define RFC2217_MODEM_TASK_STACK    2048
+#define RFC2217_TX_QUEUE_SIZE       4096    // Network loop write queue (power of two)
+#define RFC2217_TX_IOV_MAX          16      // Spans per writev() slice
+#define RFC2217_TX_IOV_MIN_BYTES    256     // Below this per full slice, copy-escape instead
 
 // ============================================================================
 // Server state
 // ============================================================================
 
 typedef struct {
+    int channel;
+    uint16_t port;
     int listen_sock;
     int client_sock;
     bool connected;
     bool running;
     rfc2217_session_t session;
-    TaskHandle_t server_task;
-    TaskHandle_t modem_poll_task;
-    SemaphoreHandle_t tx_mutex;
-    QueueHandle_t tx_queue;
+    serial_modem_status_t last_status;  // Last modem status sent to the client
+    bool first_poll;                    // No modem status sent yet
+    const rfc2217_tx_path_t *tx_path;   // Carries client data to the USB device
+
+    // Client input, kept while the TX path is full (network loop)
+    uint8_t rx_buffer[RFC2217_RX_BUFFER_SIZE];
+    size_t rx_len;
+    size_t rx_pos;                      // Parsed up to
+    uint8_t tx_batch[RFC2217_RX_BUFFER_SIZE];   // Unescaped data never exceeds received bytes
+    size_t tx_len;
+    size_t tx_pos;                      // Taken by the TX path up to
+    bool blocked;                       // Input paused until the TX path has room
+    bool command_pending;               // Parsed command not handled yet
+    bool settings_pending;              // Settings queued; later data waits for the control worker
+    bool unsynced;                      // Data written since the last sync marker was reached
+    bool sync_queued;                   // sync_marker is queued behind that data
+    uint32_t sync_marker;
 } rfc2217_server_t;
 
-static rfc2217_server_t s_server = {
-    .listen_sock = -1,
-    .client_sock = -1,
-    .connected = false,
-    .running = false,
+static rfc2217_server_t s_servers[SERIAL_CONTROL_CHANNELS] = {
+    [0 ... SERIAL_CONTROL_CHANNELS - 1] = {
+        .listen_sock = -1,
+        .client_sock = -1,
+        .connected = false,
+        .running = false,
+    },
 };
 
+static rfc2217_server_t *server_get(int channel)
+{
+    assert(channel >= 0 && channel < SERIAL_CONTROL_CHANNELS);
+    return &s_servers[channel];
+}
+
 // ============================================================================
 // Forward declarations
 // ============================================================================
 
-static void rfc2217_server_task(void *pvParameters);
-static void rfc2217_modem_poll_task(void *pvParameters);
-static void handle_client_connection(int sock);
+static void rfc2217_accept(int listen_sock, void *ctx);
+static void rfc2217_client_receive(int sock, void *ctx);
+static void rfc2217_client_close(rfc2217_server_t *server);
+static bool rfc2217_process(rfc2217_server_t *server);
+static int64_t rfc2217_status_poll(int64_t now_us, void *ctx);
+static esp_err_t send_message(int sock, const uint8_t *msg, size_t len);
 static esp_err_t send_negotiation(int sock);
-static esp_err_t send_response(int sock, rfc2217_session_t *session);
-static esp_err_t apply_serial_settings(rfc2217_session_t *session);
+static esp_err_t send_response(rfc2217_server_t *server, int sock);
+static esp_err_t apply_serial_settings(rfc2217_server_t *server);
+static esp_err_t apply_line_coding(rfc2217_server_t *server);
 
 // ============================================================================
 // Public API
 // ============================================================================
 
-esp_err_t rfc2217_server_init(void)
+esp_err_t rfc2217_server_init(int channel, uint16_t port, const rfc2217_tx_path_t *tx_path)
 {
-    if (s_server.running) {
+    rfc2217_server_t *server = server_get(channel);
+    if (server->running) {
         ESP_LOGW(TAG, "Server already running");
         return ESP_ERR_INVALID_STATE;
     }
-
-    s_server.tx_mutex = xSemaphoreCreateMutex();
-    if (s_server.tx_mutex == NULL) {
-        ESP_LOGE(TAG, "Failed to create TX mutex");
-        return ESP_ERR_NO_MEM;
+    if (tx_path == NULL) {
+        return ESP_ERR_INVALID_ARG;
     }
 
-    s_server.running = true;
-    s_server.client_sock = -1;
-    s_server.connected = false;
+    server->channel = channel;
+    server->port = port;
+    server->tx_path = tx_path;
+    server->client_sock = -1;
+    server->connected = false;
+
+    esp_err_t err = net_loop_listen(port, 1, rfc2217_accept, server, &server->listen_sock);
+    if (err != ESP_OK) {
+        return err;
+    }
 
-    BaseType_t ret = xTaskCreate(rfc2217_server_task, "rfc2217_srv",
-                                  RFC2217_SERVER_TASK_STACK, NULL, 5,
-                                  &s_server.server_task);
-    if (ret != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create server task");
-        vSemaphoreDelete(s_server.tx_mutex);
-        s_server.running = false;
-        return ESP_ERR_NO_MEM;
+    err = net_loop_add_poll(rfc2217_status_poll, server);
+    if (err != ESP_OK) {
+        net_loop_close(server->listen_sock);
+        server->listen_sock = -1;
+        return err;
     }
+    // Status reports from the USB driver wake the loop, which runs the poll
+    serial_control_set_status_callback(net_loop_wake);
 
-    ESP_LOGI(TAG, "RFC2217 server initialized (port %d)", CONFIG_RFC2217_PORT);
+    server->running = true;
+    ESP_LOGI(TAG, "[ch%d] RFC2217 server listening on port %u", channel, port);
     return ESP_OK;
 }
 
-esp_err_t rfc2217_server_stop(void)
+esp_err_t rfc2217_server_stop(int channel)
 {
-    if (!s_server.running) {
+    rfc2217_server_t *server = server_get(channel);
+    if (!server->running) {
         return ESP_OK;
     }
 
-    s_server.running = false;
+    server->running = false;
 
-    // Close sockets to unblock tasks
-    if (s_server.client_sock >= 0) {
-        shutdown(s_server.client_sock, SHUT_RDWR);
-        close(s_server.client_sock);
-        s_server.client_sock = -1;
+    if (server->client_sock >= 0) {
+        rfc2217_client_close(server);
     }
-    if (s_server.listen_sock >= 0) {
-        close(s_server.listen_sock);
-        s_server.listen_sock = -1;
+    if (server->listen_sock >= 0) {
+        net_loop_close(server->listen_sock);
+        server->listen_sock = -1;
     }
 
-    // Wait for tasks to finish
-    vTaskDelay(pdMS_TO_TICKS(100));
-
-    if (s_server.tx_mutex != NULL) {
-        vSemaphoreDelete(s_server.tx_mutex);
-        s_server.tx_mutex = NULL;
-    }
-
-    ESP_LOGI(TAG, "RFC2217 server stopped");
+    ESP_LOGI(TAG, "[ch%d] RFC2217 server stopped", channel);
     return ESP_OK;
 }
 
-bool rfc2217_server_is_connected(void)
+bool rfc2217_server_is_connected(int channel)
 {
-    return s_server.connected;
+    return server_get(channel)->connected;
 }
 
-esp_err_t rfc2217_server_send_data(const uint8_t *data, size_t len)
+size_t rfc2217_server_send_data(int channel, const uint8_t *data, size_t len)
 {
-    if (!s_server.connected || s_server.client_sock < 0) {
-        return ESP_ERR_INVALID_STATE;
-    }
-
-    if (data == NULL || len == 0) {
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    // Escape data (IAC -> IAC IAC)
-    uint8_t escaped[RFC2217_TX_BUFFER_SIZE];
-    size_t escaped_len = rfc2217_escape_data(data, len, escaped, sizeof(escaped));
+    rfc2217_server_t *server = server_get(channel);
+    if (!server->connected || server->client_sock < 0 || data == NULL) {
+        return 0;
+    }
+
+    // Escape and send in bounded slices. Each slice is described as spans over
+    // the caller's buffer (plus a static IAC fill for the doubled bytes) and
+    // handed to the network loop with one sendv(), so nothing is copied unless
+    // the socket is full. Data alternating IAC with single plain bytes would
+    // yield tiny spans; such slices are escaped into a static buffer instead.
+    // A slice never exceeds half the free write queue, so even fully doubled
+    // output is accepted whole and an IAC pair is never split.
+    rfc2217_span_t spans[RFC2217_TX_IOV_MAX];
+    struct iovec iov[RFC2217_TX_IOV_MAX];
+    static uint8_t escaped[RFC2217_TX_BUFFER_SIZE];  // Only used from the network loop
+    size_t offset = 0;
+
+    while (offset < len) {
+        size_t room = net_loop_tx_space(server->client_sock) / 2;
+        if (room == 0) {
+            break;
+        }
+        size_t slice = len - offset;
+        if (slice > room) {
+            slice = room;
+        }
 
-    if (xSemaphoreTake(s_server.tx_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        return ESP_ERR_TIMEOUT;
-    }
+        size_t consumed = 0;
+        size_t span_count = rfc2217_escape_spans(data + offset, slice,
+                                                 spans, RFC2217_TX_IOV_MAX, &consumed);
+        int iov_count = 0;
 
-    int sent = 0;
-    int remaining = escaped_len;
-    while (remaining > 0 && s_server.connected) {
-        int ret = send(s_server.client_sock, escaped + sent, remaining, 0);
-        if (ret < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                // SO_SNDTIMEO fired: TCP window closed longer than timeout.
-                // Drop this chunk to avoid blocking further; the USB-level backpressure
-                // (blocking USB callbacks) should prevent data accumulation.
-                ESP_LOGW(TAG, "TCP send timeout, dropped %d bytes", remaining);
-                break;
+        if (span_count == RFC2217_TX_IOV_MAX && consumed < RFC2217_TX_IOV_MIN_BYTES) {
+            // IAC-dense slice: worst-case doubling must fit in the escape buffer
+            if (slice > sizeof(escaped) / 2) {
+                slice = sizeof(escaped) / 2;
             }
-            ESP_LOGE(TAG, "Send failed: errno %d", errno);
-            s_server.connected = false;
-            xSemaphoreGive(s_server.tx_mutex);
-            return ESP_FAIL;
+            iov[0].iov_base = escaped;
+            iov[0].iov_len = rfc2217_escape_data(data + offset, slice, escaped, sizeof(escaped));
+            iov_count = 1;
+            consumed = slice;
+        } else {
+            for (size_t i = 0; i < span_count; i++) {
+                iov[i].iov_base = (void *)spans[i].base;
+                iov[i].iov_len = spans[i].len;
+            }
+            iov_count = span_count;
         }
-        sent += ret;
-        remaining -= ret;
+
+        net_loop_sendv(server->client_sock, iov, iov_count);
+        offset += consumed;
     }
 
-    xSemaphoreGive(s_server.tx_mutex);
-    return ESP_OK;
+    return offset;
 }
 
-esp_err_t rfc2217_server_notify_modemstate(bool cts, bool dsr, bool ri, bool cd)
+esp_err_t rfc2217_server_notify_modemstate(int channel, bool cts, bool dsr, bool ri, bool cd)
 {
-    if (!s_server.connected || s_server.client_sock < 0) {
+    rfc2217_server_t *server = server_get(channel);
+    if (!server->connected || server->client_sock < 0) {
         return ESP_ERR_INVALID_STATE;
     }
 
@@ -203,310 +233,361 @@ esp_err_t rfc2217_server_notify_modemstate(bool cts, bool dsr, bool ri, bool cd)
     if (cd)  state |= RFC2217_MODEMSTATE_CD;
 
     // Check mask
-    if ((state & s_server.session.modemstate_mask) == 0 &&
-        (s_server.session.last_modemstate & s_server.session.modemstate_mask) == 0) {
+    if ((state & server->session.modemstate_mask) == 0 &&
+        (server->session.last_modemstate & server->session.modemstate_mask) == 0) {
         return ESP_OK;  // No reportable change
     }
 
     // Compute delta bits
-    uint8_t delta = (state ^ s_server.session.last_modemstate) & 0x0F;
+    uint8_t delta = (state ^ server->session.last_modemstate) & 0x0F;
     state |= delta;
 
     uint8_t msg[16];
     size_t msg_len = rfc2217_build_modemstate(state, msg);
 
-    if (xSemaphoreTake(s_server.tx_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
-        return ESP_ERR_TIMEOUT;
+    esp_err_t ret = send_message(server->client_sock, msg, msg_len);
+    if (ret != ESP_OK) {
+        return ret;
     }
 
-    int ret = send(s_server.client_sock, msg, msg_len, 0);
-    xSemaphoreGive(s_server.tx_mutex);
-
-    if (ret < 0) {
-        return ESP_FAIL;
-    }
-
-    s_server.session.last_modemstate = state & 0xF0;  // Store only steady-state bits
+    server->session.last_modemstate = state & 0xF0;  // Store only steady-state bits
     return ESP_OK;
 }
 
-esp_err_t rfc2217_server_notify_linestate(uint8_t state)
+esp_err_t rfc2217_server_notify_linestate(int channel, uint8_t state)
 {
-    if (!s_server.connected || s_server.client_sock < 0) {
+    rfc2217_server_t *server = server_get(channel);
+    if (!server->connected || server->client_sock < 0) {
         return ESP_ERR_INVALID_STATE;
     }
 
     // Check mask
-    if ((state & s_server.session.linestate_mask) == 0) {
+    if ((state & server->session.linestate_mask) == 0) {
         return ESP_OK;
     }
 
     uint8_t msg[16];
     size_t msg_len = rfc2217_build_linestate(state, msg);
 
-    if (xSemaphoreTake(s_server.tx_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
-        return ESP_ERR_TIMEOUT;
-    }
-
-    int ret = send(s_server.client_sock, msg, msg_len, 0);
-    xSemaphoreGive(s_server.tx_mutex);
-
-    return (ret >= 0) ? ESP_OK : ESP_FAIL;
+    return send_message(server->client_sock, msg, msg_len);
 }
 
 // ============================================================================
-// Server task
+// Connection handling (network loop callbacks)
 // ============================================================================
 
-static void rfc2217_server_task(void *pvParameters)
+static void rfc2217_accept(int listen_sock, void *ctx)
 {
-    struct sockaddr_in dest_addr = {
-        .sin_addr.s_addr = htonl(INADDR_ANY),
-        .sin_family = AF_INET,
-        .sin_port = htons(CONFIG_RFC2217_PORT)
-    };
-
-    // Create listening socket
-    s_server.listen_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
-    if (s_server.listen_sock < 0) {
-        ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
-        s_server.running = false;
-        vTaskDelete(NULL);
+    rfc2217_server_t *server = ctx;
+    struct sockaddr_in source_addr;
+    socklen_t addr_len = sizeof(source_addr);
+
+    int sock = accept(listen_sock, (struct sockaddr *)&source_addr, &addr_len);
+    if (sock < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            ESP_LOGE(TAG, "Accept failed: errno %d", errno);
+        }
         return;
     }
 
-    int opt = 1;
-    setsockopt(s_server.listen_sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-
-    int err = bind(s_server.listen_sock, (struct sockaddr *)&dest_addr, sizeof(dest_addr));
-    if (err != 0) {
-        ESP_LOGE(TAG, "Socket bind failed: errno %d", errno);
-        close(s_server.listen_sock);
-        s_server.listen_sock = -1;
-        s_server.running = false;
-        vTaskDelete(NULL);
-        return;
+    // Close existing connection if any
+    if (server->connected && server->client_sock >= 0) {
+        ESP_LOGI(TAG, "[ch%d] New client connecting, closing existing connection", server->channel);
+        rfc2217_client_close(server);
     }
 
-    err = listen(s_server.listen_sock, 1);
-    if (err != 0) {
-        ESP_LOGE(TAG, "Socket listen failed: errno %d", errno);
-        close(s_server.listen_sock);
-        s_server.listen_sock = -1;
-        s_server.running = false;
-        vTaskDelete(NULL);
+    if (net_loop_add(sock, RFC2217_TX_QUEUE_SIZE, rfc2217_client_receive, server) != ESP_OK) {
+        ESP_LOGE(TAG, "No room for RFC2217 connection");
+        close(sock);
         return;
     }
 
-    ESP_LOGI(TAG, "RFC2217 server listening on port %d", CONFIG_RFC2217_PORT);
+    // Output is coalesced by the flush policy, so disable Nagle
+    int nodelay = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
 
-    while (s_server.running) {
-        struct sockaddr_in source_addr;
-        socklen_t addr_len = sizeof(source_addr);
+    char addr_str[16];
+    inet_ntoa_r(source_addr.sin_addr, addr_str, sizeof(addr_str));
+    ESP_LOGI(TAG, "[ch%d] RFC2217 client connected from %s", server->channel, addr_str);
 
-        int sock = accept(s_server.listen_sock, (struct sockaddr *)&source_addr, &addr_len);
-        if (sock < 0) {
-            if (s_server.running) {
-                ESP_LOGE(TAG, "Accept failed: errno %d", errno);
-            }
-            continue;
-        }
-
-        // Close existing connection if any
-        if (s_server.connected && s_server.client_sock >= 0) {
-            ESP_LOGI(TAG, "New client connecting, closing existing connection");
-            shutdown(s_server.client_sock, SHUT_RDWR);
-            close(s_server.client_sock);
-
-            // Stop modem poll task
-            if (s_server.modem_poll_task != NULL) {
-                vTaskDelete(s_server.modem_poll_task);
-                s_server.modem_poll_task = NULL;
-            }
-        }
-
-        char addr_str[16];
-        inet_ntoa_r(source_addr.sin_addr, addr_str, sizeof(addr_str));
-        ESP_LOGI(TAG, "RFC2217 client connected from %s", addr_str);
+    server->client_sock = sock;
+    server->connected = true;
+    server->rx_len = 0;
+    server->rx_pos = 0;
+    server->tx_len = 0;
+    server->tx_pos = 0;
+    server->blocked = false;
+    server->command_pending = false;
+    server->settings_pending = false;
+    server->unsynced = false;
+    server->sync_queued = false;
 
-        s_server.client_sock = sock;
-        s_server.connected = true;
+    // Initialize session
+    char signature[64];
+    snprintf(signature, sizeof(signature), "ESP32-S3 Serial WiFi Logger %s", get_version_string());
+    rfc2217_session_init(&server->session, signature);
 
-        // Initialize session
-        char signature[64];
-        snprintf(signature, sizeof(signature), "ESP32-S3 Serial WiFi Logger %s", get_version_string());
-        rfc2217_session_init(&s_server.session, signature);
+    // Report the modem status right away; older line errors are stale
+    server->first_poll = true;
+    serial_control_take_line_errors(server->channel);
 
-        // Start modem poll task
-        xTaskCreate(rfc2217_modem_poll_task, "rfc2217_modem",
-                    RFC2217_MODEM_TASK_STACK, NULL, 4,
-                    &s_server.modem_poll_task);
+    // Send initial negotiation (WILL COM-PORT-OPTION)
+    if (send_negotiation(sock) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to send initial negotiation");
+        rfc2217_client_close(server);
+    }
+}
 
-        // Handle client connection
-        handle_client_connection(sock);
+static void rfc2217_client_close(rfc2217_server_t *server)
+{
+    ESP_LOGI(TAG, "[ch%d] RFC2217 client disconnected", server->channel);
+    server->connected = false;
+    net_loop_close(server->client_sock);
+    server->client_sock = -1;
+}
 
-        // Cleanup
-        ESP_LOGI(TAG, "RFC2217 client disconnected");
-        s_server.connected = false;
+static void rfc2217_client_receive(int sock, void *ctx)
+{
+    rfc2217_server_t *server = ctx;
 
-        if (s_server.modem_poll_task != NULL) {
-            vTaskDelete(s_server.modem_poll_task);
-            s_server.modem_poll_task = NULL;
+    int len = recv(sock, server->rx_buffer, sizeof(server->rx_buffer), 0);
+    if (len < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return;
         }
-
-        close(sock);
-        s_server.client_sock = -1;
+        ESP_LOGE(TAG, "Recv error: errno %d", errno);
+        rfc2217_client_close(server);
+        return;
+    } else if (len == 0) {
+        // Connection closed
+        rfc2217_client_close(server);
+        return;
     }
+    metrics_add_bytes(METRICS_BYTES_NET_RX, len);
 
-    if (s_server.listen_sock >= 0) {
-        close(s_server.listen_sock);
-        s_server.listen_sock = -1;
+    server->rx_len = len;
+    server->rx_pos = 0;
+    if (!rfc2217_process(server)) {
+        // The rest stays in the TCP receive window; rfc2217_status_poll() carries on
+        ESP_LOGD(TAG, "[ch%d] TX path busy, pausing RFC2217 input", server->channel);
+        server->blocked = true;
+        net_loop_pause_rx(sock, true);
     }
-
-    vTaskDelete(NULL);
 }
 
 // ============================================================================
-// Client connection handler
+// Client data and settings ordering
 // ============================================================================
 
-static void handle_client_connection(int sock)
+/**
+ * @brief Wait for the data queued so far to reach the device
+ *
+ * Queues one sync marker behind the data, then checks it on every call.
+ *
+ * @return true when no data is in flight, false to try again later
+ */
+static bool settle(rfc2217_server_t *server)
 {
-    uint8_t rx_buffer[RFC2217_RX_BUFFER_SIZE];
-    uint8_t data_buffer[RFC2217_RX_BUFFER_SIZE];
-    uint8_t tx_batch[RFC2217_RX_BUFFER_SIZE];
-    size_t tx_batch_len = 0;
+    if (!server->unsynced) {
+        return true;
+    }
+    if (!server->sync_queued) {
+        if (!server->tx_path->sync(server->channel, &server->sync_marker)) {
+            return false;
+        }
+        server->sync_queued = true;
+    }
+    if (!server->tx_path->synced(server->channel, server->sync_marker)) {
+        return false;
+    }
+    server->sync_queued = false;
+    server->unsynced = false;
+    return true;
+}
 
-    // Send initial negotiation (WILL COM-PORT-OPTION)
-    if (send_negotiation(sock) != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to send initial negotiation");
-        return;
+/**
+ * @brief Hand the unescaped data batch to the TX path
+ *
+ * Line coding set before the data is applied to it first, and data after
+ * queued settings waits until the control worker has applied them.
+ *
+ * @return true when the whole batch was taken, false to try again later
+ */
+static bool queue_data(rfc2217_server_t *server)
+{
+    if (server->session.line_coding_changed) {
+        if (!settle(server)) {
+            return false;
+        }
+        apply_line_coding(server);
+    }
+    if (server->settings_pending) {
+        if (!serial_control_is_idle(server->channel)) {
+            return false;
+        }
+        server->settings_pending = false;
     }
 
-    // Set socket timeouts
-    struct timeval tv = { .tv_sec = 1, .tv_usec = 0 };
-    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    size_t taken = server->tx_path->write(server->channel, server->tx_batch + server->tx_pos,
+                                          server->tx_len - server->tx_pos);
+    if (taken > 0) {
+        server->unsynced = true;
+        server->tx_pos += taken;
+    }
+    if (server->tx_pos < server->tx_len) {
+        return false;
+    }
+    server->tx_pos = 0;
+    server->tx_len = 0;
+    return true;
+}
 
-    struct timeval tv_snd = { .tv_sec = 5, .tv_usec = 0 };
-    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv_snd, sizeof(tv_snd));
+/**
+ * @brief Settings of the session that are applied with the command
+ *
+ * Line coding alone stays pending, see apply_serial_settings().
+ */
+static bool settings_apply_now(const rfc2217_session_t *session)
+{
+    return session->modem_control_changed || session->flow_control_changed ||
+           session->latency_changed || session->xfer_size_changed || session->break_changed;
+}
 
-    while (s_server.connected && s_server.running) {
-        int len = recv(sock, rx_buffer, sizeof(rx_buffer), 0);
-        if (len < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                // Timeout - continue
-                continue;
+/**
+ * @brief Handle received client input as far as the TX path allows
+ *
+ * Plain data runs are copied into tx_batch and queued to the channel's
+ * TCP → USB path; parsing stops at each command so it can be handled.
+ * The USB writes happen in the bridge task, so a device that holds off
+ * never stalls the network loop: when the path is full this returns and
+ * is called again from rfc2217_status_poll().
+ *
+ * Settings and data keep the order the client sent them in. A setting
+ * waits until the device has taken the data before it, and data after a
+ * setting waits until the control worker has applied it. Line coding is
+ * the exception: clients send baud rate, data size, parity and stop size
+ * as separate subnegotiations, so it is applied once, before the next
+ * data, the next other setting or at the end of the input.
+ *
+ * @return true when all input is handled, false when waiting for the
+ *         TX path or the control worker
+ */
+static bool rfc2217_process(rfc2217_server_t *server)
+{
+    rfc2217_session_t *session = &server->session;
+
+    while (1) {
+        if (server->tx_pos < server->tx_len && !queue_data(server)) {
+            return false;
+        }
+
+        if (server->command_pending) {
+            if (session->settings_changed) {
+                if (settings_apply_now(session) && !settle(server)) {
+                    return false;
+                }
+                apply_serial_settings(server);
+                session->settings_changed = false;
             }
-            ESP_LOGE(TAG, "Recv error: errno %d", errno);
-            break;
-        } else if (len == 0) {
-            // Connection closed
+            send_response(server, server->client_sock);
+            server->command_pending = false;
+        }
+
+        if (server->rx_pos == server->rx_len) {
             break;
         }
 
-        // Process received data
-        tx_batch_len = 0;
-        for (int i = 0; i < len; i++) {
-            size_t out_len = 0;
-            rfc2217_result_t result = rfc2217_parse_byte(&s_server.session, rx_buffer[i],
-                                                          data_buffer, &out_len);
-
-            switch (result) {
-                case RFC2217_RESULT_DATA:
-                    // Accumulate data bytes for batched transmission
-                    if (out_len > 0) {
-                        tx_batch[tx_batch_len++] = data_buffer[0];
-                    }
-                    break;
-
-                case RFC2217_RESULT_COMMAND:
-                    // Flush batched data before applying settings/sending response
-                    if (tx_batch_len > 0) {
-                        esp_err_t err = serial_control_transmit(tx_batch, tx_batch_len, 1000);
-                        if (err != ESP_OK) {
-                            ESP_LOGW(TAG, "Serial transmit failed: %s", esp_err_to_name(err));
-                        }
-                        tx_batch_len = 0;
-                    }
-                    if (s_server.session.settings_changed) {
-                        apply_serial_settings(&s_server.session);
-                        s_server.session.settings_changed = false;
-                    }
-                    send_response(sock, &s_server.session);
-                    break;
-
-                case RFC2217_RESULT_CONTINUE:
-                    // Continue parsing
-                    break;
-
-                case RFC2217_RESULT_ERROR:
-                    ESP_LOGW(TAG, "Parse error");
-                    break;
-            }
+        size_t out_len = 0;
+        size_t consumed = 0;
+        rfc2217_result_t result = rfc2217_parse_chunk(session,
+                                                      server->rx_buffer + server->rx_pos,
+                                                      server->rx_len - server->rx_pos,
+                                                      server->tx_batch, &out_len, &consumed);
+        server->rx_pos += consumed;
+        server->tx_len = out_len;
+
+        switch (result) {
+            case RFC2217_RESULT_COMMAND:
+                server->command_pending = true;
+                break;
+
+            case RFC2217_RESULT_ERROR:
+                ESP_LOGW(TAG, "Parse error");
+                break;
+
+            case RFC2217_RESULT_DATA:
+            case RFC2217_RESULT_CONTINUE:
+                // Input exhausted
+                break;
         }
+    }
 
-        // Flush any remaining batched data
-        if (tx_batch_len > 0) {
-            esp_err_t err = serial_control_transmit(tx_batch, tx_batch_len, 1000);
-            if (err != ESP_OK) {
-                ESP_LOGW(TAG, "Serial transmit failed: %s", esp_err_to_name(err));
-            }
+    // Line coding still pending at the end of the input
+    if (session->line_coding_changed) {
+        if (!settle(server)) {
+            return false;
         }
+        apply_line_coding(server);
     }
+    return true;
 }
 
 // ============================================================================
 // Negotiation and response
 // ============================================================================
 
-static esp_err_t send_negotiation(int sock)
+/**
+ * @brief Queue a protocol message as a whole
+ *
+ * Messages are never split, so a message that does not fit in the write
+ * queue is not sent at all.
+ */
+static esp_err_t send_message(int sock, const uint8_t *msg, size_t len)
 {
-    if (xSemaphoreTake(s_server.tx_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        return ESP_ERR_TIMEOUT;
+    if (net_loop_tx_space(sock) < len) {
+        ESP_LOGW(TAG, "TX queue full, dropped %u byte message", (unsigned)len);
+        return ESP_FAIL;
     }
+    net_loop_send(sock, msg, len);
+    return ESP_OK;
+}
 
+static esp_err_t send_negotiation(int sock)
+{
     uint8_t msg[8];
     esp_err_t ret = ESP_OK;
 
     // Negotiate BINARY mode (RFC 856) - required for correct 8-bit data transfer
     msg[0] = TELNET_IAC; msg[1] = TELNET_WILL; msg[2] = TELNET_OPTION_BINARY;
-    if (send(sock, msg, 3, 0) < 0) { ret = ESP_FAIL; goto done; }
+    if (send_message(sock, msg, 3) != ESP_OK) { ret = ESP_FAIL; goto done; }
     msg[0] = TELNET_IAC; msg[1] = TELNET_DO;   msg[2] = TELNET_OPTION_BINARY;
-    if (send(sock, msg, 3, 0) < 0) { ret = ESP_FAIL; goto done; }
+    if (send_message(sock, msg, 3) != ESP_OK) { ret = ESP_FAIL; goto done; }
 
     // Negotiate Suppress Go Ahead (RFC 858)
     msg[0] = TELNET_IAC; msg[1] = TELNET_WILL; msg[2] = TELNET_OPTION_SGA;
-    if (send(sock, msg, 3, 0) < 0) { ret = ESP_FAIL; goto done; }
+    if (send_message(sock, msg, 3) != ESP_OK) { ret = ESP_FAIL; goto done; }
     msg[0] = TELNET_IAC; msg[1] = TELNET_DO;   msg[2] = TELNET_OPTION_SGA;
-    if (send(sock, msg, 3, 0) < 0) { ret = ESP_FAIL; goto done; }
+    if (send_message(sock, msg, 3) != ESP_OK) { ret = ESP_FAIL; goto done; }
 
     // Send WILL COM-PORT-OPTION
     {
         size_t len = rfc2217_build_will_com_port(msg);
-        if (send(sock, msg, len, 0) < 0) { ret = ESP_FAIL; goto done; }
+        if (send_message(sock, msg, len) != ESP_OK) { ret = ESP_FAIL; goto done; }
 
         // Send DO COM-PORT-OPTION (request client to enable)
         len = rfc2217_build_do_com_port(msg);
-        if (send(sock, msg, len, 0) < 0) { ret = ESP_FAIL; goto done; }
+        if (send_message(sock, msg, len) != ESP_OK) { ret = ESP_FAIL; goto done; }
     }
 
     ESP_LOGD(TAG, "Sent initial negotiation (BINARY, SGA, COM-PORT-OPTION)");
 
 done:
-    xSemaphoreGive(s_server.tx_mutex);
     return ret;
 }
 
-static esp_err_t send_response(int sock, rfc2217_session_t *session)
+static esp_err_t send_response(rfc2217_server_t *server, int sock)
 {
-    // Protect all sends with tx_mutex to prevent races with rfc2217_server_send_data
-    // (called from usb_to_tcp_bridge_task) and rfc2217_server_notify_modemstate
-    // (called from rfc2217_modem_poll_task).
-    if (xSemaphoreTake(s_server.tx_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        session->last_command = 0xFF;
-        return ESP_ERR_TIMEOUT;
-    }
-
+    rfc2217_session_t *session = &server->session;
     esp_err_t ret = ESP_OK;
     uint8_t msg[128];
     size_t msg_len = 0;
@@ -514,7 +595,7 @@ static esp_err_t send_response(int sock, rfc2217_session_t *session)
     // Send pending Telnet option negotiation response (WILL/WONT/DO/DONT)
     if (session->need_option_response) {
         uint8_t opt_msg[3] = {TELNET_IAC, session->option_response_cmd, session->option_response_opt};
-        if (send(sock, opt_msg, 3, 0) < 0) {
+        if (send_message(sock, opt_msg, 3) != ESP_OK) {
             ret = ESP_FAIL;
             goto done;
         }
@@ -528,7 +609,7 @@ static esp_err_t send_response(int sock, rfc2217_session_t *session)
         case RFC2217_SIGNATURE:
             if (session->need_signature_response) {
                 msg_len = rfc2217_build_signature(session->signature, msg);
-                if (send(sock, msg, msg_len, 0) < 0) { ret = ESP_FAIL; goto done; }
+                if (send_message(sock, msg, msg_len) != ESP_OK) { ret = ESP_FAIL; goto done; }
                 session->need_signature_response = false;
                 ESP_LOGD(TAG, "Sent signature response");
             }
@@ -536,25 +617,25 @@ static esp_err_t send_response(int sock, rfc2217_session_t *session)
 
         case RFC2217_SET_BAUDRATE:
             msg_len = rfc2217_build_baudrate_response(session->baudrate, msg);
-            if (send(sock, msg, msg_len, 0) < 0) { ret = ESP_FAIL; goto done; }
+            if (send_message(sock, msg, msg_len) != ESP_OK) { ret = ESP_FAIL; goto done; }
             ESP_LOGD(TAG, "Sent baudrate response: %lu", (unsigned long)session->baudrate);
             break;
 
         case RFC2217_SET_DATASIZE:
             msg_len = rfc2217_build_byte_response(RFC2217_RESP_SET_DATASIZE, session->datasize, msg);
-            if (send(sock, msg, msg_len, 0) < 0) { ret = ESP_FAIL; goto done; }
+            if (send_message(sock, msg, msg_len) != ESP_OK) { ret = ESP_FAIL; goto done; }
             ESP_LOGD(TAG, "Sent datasize response: %d", session->datasize);
             break;
 
         case RFC2217_SET_PARITY:
             msg_len = rfc2217_build_byte_response(RFC2217_RESP_SET_PARITY, session->parity, msg);
-            if (send(sock, msg, msg_len, 0) < 0) { ret = ESP_FAIL; goto done; }
+            if (send_message(sock, msg, msg_len) != ESP_OK) { ret = ESP_FAIL; goto done; }
             ESP_LOGD(TAG, "Sent parity response: %d", session->parity);
             break;
 
         case RFC2217_SET_STOPSIZE:
             msg_len = rfc2217_build_byte_response(RFC2217_RESP_SET_STOPSIZE, session->stopsize, msg);
-            if (send(sock, msg, msg_len, 0) < 0) { ret = ESP_FAIL; goto done; }
+            if (send_message(sock, msg, msg_len) != ESP_OK) { ret = ESP_FAIL; goto done; }
             ESP_LOGD(TAG, "Sent stopsize response: %d", session->stopsize);
             break;
 
@@ -567,7 +648,7 @@ static esp_err_t send_response(int sock, rfc2217_session_t *session)
                     response_value = session->flowcontrol;
                 } else if (control_val >= RFC2217_CONTROL_FLOW_NONE &&
                            control_val <= RFC2217_CONTROL_FLOW_HARDWARE) {
-                    response_value = control_val;
+                    response_value = session->flowcontrol;  // NONE if the device refused
                 } else if (control_val == RFC2217_CONTROL_BREAK_REQUEST) {
                     response_value = session->break_state ? RFC2217_CONTROL_BREAK_ON : RFC2217_CONTROL_BREAK_OFF;
                 } else if (control_val == RFC2217_CONTROL_BREAK_ON ||
@@ -588,38 +669,57 @@ static esp_err_t send_response(int sock, rfc2217_session_t *session)
                 }
 
                 msg_len = rfc2217_build_byte_response(RFC2217_RESP_SET_CONTROL, response_value, msg);
-                if (send(sock, msg, msg_len, 0) < 0) { ret = ESP_FAIL; goto done; }
+                if (send_message(sock, msg, msg_len) != ESP_OK) { ret = ESP_FAIL; goto done; }
                 ESP_LOGD(TAG, "Sent control response: %d", response_value);
             }
             break;
 
         case RFC2217_SET_LINESTATE_MASK:
             msg_len = rfc2217_build_byte_response(RFC2217_RESP_SET_LINESTATE_MASK, session->linestate_mask, msg);
-            if (send(sock, msg, msg_len, 0) < 0) { ret = ESP_FAIL; goto done; }
+            if (send_message(sock, msg, msg_len) != ESP_OK) { ret = ESP_FAIL; goto done; }
             ESP_LOGD(TAG, "Sent linestate mask response: 0x%02X", session->linestate_mask);
             break;
 
         case RFC2217_SET_MODEMSTATE_MASK:
             msg_len = rfc2217_build_byte_response(RFC2217_RESP_SET_MODEMSTATE_MASK, session->modemstate_mask, msg);
-            if (send(sock, msg, msg_len, 0) < 0) { ret = ESP_FAIL; goto done; }
+            if (send_message(sock, msg, msg_len) != ESP_OK) { ret = ESP_FAIL; goto done; }
             ESP_LOGD(TAG, "Sent modemstate mask response: 0x%02X", session->modemstate_mask);
             break;
 
         case RFC2217_PURGE_DATA:
             msg_len = rfc2217_build_byte_response(RFC2217_RESP_PURGE_DATA, session->last_purge_value, msg);
-            if (send(sock, msg, msg_len, 0) < 0) { ret = ESP_FAIL; goto done; }
+            if (send_message(sock, msg, msg_len) != ESP_OK) { ret = ESP_FAIL; goto done; }
             ESP_LOGD(TAG, "Sent purge response: %d", session->last_purge_value);
             break;
 
         case RFC2217_FLOWCONTROL_SUSPEND:
             msg_len = rfc2217_build_byte_response(RFC2217_RESP_FLOWCONTROL_SUSPEND, 0, msg);
-            if (send(sock, msg, msg_len, 0) < 0) { ret = ESP_FAIL; goto done; }
+            if (send_message(sock, msg, msg_len) != ESP_OK) { ret = ESP_FAIL; goto done; }
             break;
 
         case RFC2217_FLOWCONTROL_RESUME:
             msg_len = rfc2217_build_byte_response(RFC2217_RESP_FLOWCONTROL_RESUME, 0, msg);
-            if (send(sock, msg, msg_len, 0) < 0) { ret = ESP_FAIL; goto done; }
+            if (send_message(sock, msg, msg_len) != ESP_OK) { ret = ESP_FAIL; goto done; }
+            break;
+
+        case RFC2217_VENDOR_SET_LATENCY: {
+            // Report the latency in effect, also when chosen automatically
+            bool is_auto;
+            uint8_t latency = serial_control_get_latency(server->channel, &is_auto);
+            msg_len = rfc2217_build_byte_response(RFC2217_RESP_VENDOR_SET_LATENCY, latency, msg);
+            if (send_message(sock, msg, msg_len) != ESP_OK) { ret = ESP_FAIL; goto done; }
+            ESP_LOGD(TAG, "Sent latency response: %d ms%s", latency, is_auto ? " (auto)" : "");
             break;
+        }
+
+        case RFC2217_VENDOR_SET_XFER_SIZE: {
+            size_t size = serial_control_get_in_xfer_size(server->channel);
+            uint8_t value[2] = {(uint8_t)(size >> 8), (uint8_t)(size & 0xFF)};
+            msg_len = rfc2217_build_subneg(RFC2217_RESP_VENDOR_SET_XFER_SIZE, value, sizeof(value), msg);
+            if (send_message(sock, msg, msg_len) != ESP_OK) { ret = ESP_FAIL; goto done; }
+            ESP_LOGD(TAG, "Sent transfer size response: %u", (unsigned)size);
+            break;
+        }
 
         default:
             // No response needed (e.g., for option negotiations WILL/DO/WONT/DONT)
@@ -628,15 +728,17 @@ static esp_err_t send_response(int sock, rfc2217_session_t *session)
 
 done:
     session->last_command = 0xFF;
-    xSemaphoreGive(s_server.tx_mutex);
     return ret;
 }
 
-static esp_err_t apply_serial_settings(rfc2217_session_t *session)
+/**
+ * @brief Apply pending line coding changes as one request
+ */
+static esp_err_t apply_line_coding(rfc2217_server_t *server)
 {
+    rfc2217_session_t *session = &server->session;
     esp_err_t ret = ESP_OK;
 
-    // Only apply line coding if it changed
     if (session->line_coding_changed) {
         serial_line_coding_t coding = {
             .baudrate = session->baudrate,
@@ -667,25 +769,81 @@ static esp_err_t apply_serial_settings(rfc2217_session_t *session)
             coding.stop_bits = 1;
         }
 
-        ret = serial_control_set_line_coding(&coding);
+        ret = serial_control_set_line_coding(server->channel, &coding);
         if (ret != ESP_OK) {
             ESP_LOGW(TAG, "Failed to set line coding: %s", esp_err_to_name(ret));
+        } else {
+            server->settings_pending = true;
         }
         session->line_coding_changed = false;
     }
+    return ret;
+}
+
+/**
+ * @brief Apply settings changed by a command
+ *
+ * Line coding alone stays pending for apply_line_coding(). Any other
+ * change applies it first, so the port sees the settings in the order the
+ * client sent them (e.g. the baud rate before a DTR reset pulse).
+ */
+static esp_err_t apply_serial_settings(rfc2217_server_t *server)
+{
+    rfc2217_session_t *session = &server->session;
+    esp_err_t ret = ESP_OK;
+
+    if (settings_apply_now(session)) {
+        apply_line_coding(server);
+    }
+    // Later data waits for whatever was queued to the control worker
+    if (session->modem_control_changed || session->flow_control_changed ||
+        session->latency_changed || session->break_changed) {
+        server->settings_pending = true;
+    }
 
     // Only apply modem control if it changed
     if (session->modem_control_changed) {
-        ret = serial_control_set_modem_control(session->dtr, session->rts);
+        ret = serial_control_set_modem_control(server->channel, session->dtr, session->rts);
         if (ret != ESP_OK) {
             ESP_LOGW(TAG, "Failed to set modem control: %s", esp_err_to_name(ret));
         }
         session->modem_control_changed = false;
     }
 
+    // Flow control; the answer to SET-CONTROL tells the client what is in effect
+    if (session->flow_control_changed) {
+        serial_flow_control_t flow = SERIAL_FLOW_NONE;
+        if (session->flowcontrol == RFC2217_CONTROL_FLOW_HARDWARE) {
+            flow = SERIAL_FLOW_RTS_CTS;
+        } else if (session->flowcontrol == RFC2217_CONTROL_FLOW_XONXOFF) {
+            flow = SERIAL_FLOW_XON_XOFF;
+        }
+        esp_err_t flow_ret = serial_control_set_flow_control(server->channel, flow);
+        if (flow_ret == ESP_ERR_NOT_SUPPORTED) {
+            session->flowcontrol = RFC2217_CONTROL_FLOW_NONE;
+        } else if (flow_ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to set flow control: %s", esp_err_to_name(flow_ret));
+        }
+        session->flow_control_changed = false;
+    }
+
+    // FTDI tuning vendor options
+    if (session->latency_changed) {
+        uint8_t latency = session->latency == RFC2217_LATENCY_AUTO ? SERIAL_LATENCY_AUTO : session->latency;
+        esp_err_t lat_ret = serial_control_set_latency(server->channel, latency);
+        if (lat_ret != ESP_OK && lat_ret != ESP_ERR_NOT_SUPPORTED) {
+            ESP_LOGW(TAG, "Failed to set latency timer: %s", esp_err_to_name(lat_ret));
+        }
+        session->latency_changed = false;
+    }
+    if (session->xfer_size_changed) {
+        serial_control_set_in_xfer_size(server->channel, session->xfer_size);
+        session->xfer_size_changed = false;
+    }
+
     // Apply break signal if it changed
     if (session->break_changed) {
-        esp_err_t brk_ret = serial_control_set_break(session->break_state);
+        esp_err_t brk_ret = serial_control_set_break(server->channel, session->break_state);
         if (brk_ret != ESP_OK && brk_ret != ESP_ERR_NOT_SUPPORTED) {
             ESP_LOGW(TAG, "Failed to set break: %s", esp_err_to_name(brk_ret));
         }
@@ -696,38 +854,53 @@ static esp_err_t apply_serial_settings(rfc2217_session_t *session)
 }
 
 // ============================================================================
-// Modem status polling task
+// Modem and line status, paused input (network loop poll callback)
 // ============================================================================
 
-static void rfc2217_modem_poll_task(void *pvParameters)
+/**
+ * @brief Forward modem and line status changes to the client
+ *
+ * The USB driver callbacks store the status and wake the network loop,
+ * so a change goes out within one loop iteration of the USB transfer that
+ * carried it. Checking costs two atomic loads per iteration.
+ *
+ * Paused client input is processed again here; the TX path and the
+ * control worker wake the loop when they make progress.
+ */
+static int64_t rfc2217_status_poll(int64_t now_us, void *ctx)
 {
-    serial_modem_status_t last_status = {0};
-    bool first_poll = true;
-
-    while (s_server.connected && s_server.running) {
-        serial_modem_status_t status;
-        esp_err_t err = serial_control_get_modem_status(&status);
-
-        if (err == ESP_OK) {
-            // Check for changes
-            if (first_poll ||
-                status.cts != last_status.cts ||
-                status.dsr != last_status.dsr ||
-                status.ri != last_status.ri ||
-                status.cd != last_status.cd) {
-
-                rfc2217_server_notify_modemstate(status.cts, status.dsr,
-                                                  status.ri, status.cd);
-                last_status = status;
-                first_poll = false;
-            }
-        } else if (err != ESP_ERR_NOT_SUPPORTED) {
-            // ESP_ERR_NOT_SUPPORTED is expected for CDC devices
-            ESP_LOGW(TAG, "Failed to get modem status: %s", esp_err_to_name(err));
-        }
+    rfc2217_server_t *server = ctx;
+    if (!server->connected) {
+        return -1;
+    }
+
+    if (server->blocked && rfc2217_process(server)) {
+        ESP_LOGD(TAG, "[ch%d] TX path drained, resuming RFC2217 input", server->channel);
+        server->blocked = false;
+        net_loop_pause_rx(server->client_sock, false);
+    }
+
+    serial_modem_status_t status;
+    if (serial_control_get_modem_status(server->channel, &status) == ESP_OK &&
+        (server->first_poll ||
+         status.cts != server->last_status.cts ||
+         status.dsr != server->last_status.dsr ||
+         status.ri != server->last_status.ri ||
+         status.cd != server->last_status.cd)) {
+        rfc2217_server_notify_modemstate(server->channel, status.cts, status.dsr, status.ri, status.cd);
+        server->last_status = status;
+        server->first_poll = false;
+    }
 
-        vTaskDelay(pdMS_TO_TICKS(CONFIG_RFC2217_MODEM_POLL_INTERVAL_MS));
+    uint8_t errors = serial_control_take_line_errors(server->channel);
+    if (errors != 0) {
+        uint8_t linestate = 0;
+        if (errors & SERIAL_LINE_OVERRUN) linestate |= RFC2217_LINESTATE_OVERRUN;
+        if (errors & SERIAL_LINE_PARITY)  linestate |= RFC2217_LINESTATE_PARITY;
+        if (errors & SERIAL_LINE_FRAMING) linestate |= RFC2217_LINESTATE_FRAMING;
+        if (errors & SERIAL_LINE_BREAK)   linestate |= RFC2217_LINESTATE_BREAK;
+        rfc2217_server_notify_linestate(server->channel, linestate);
     }
 
-    vTaskDelete(NULL);
+    return -1;
 }
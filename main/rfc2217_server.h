@@ -18,62 +18,96 @@ extern "C" {
 #endif
 
 /**
- * @brief Initialize and start the RFC2217 server
+ * @brief Path that carries client data to the channel's USB device
  *
- * Starts a TCP server on the configured port (default 2217) that
- * implements the RFC2217 Telnet COM Port Control protocol.
+ * Provided by the bridge; the USB writes happen in its own task, never in
+ * the network loop. All functions are called from the network loop and
+ * must not block. When write() or sync() come back short the server stops
+ * reading the client, so TCP flow control holds off the sender; the path
+ * wakes the loop (net_loop_wake()) once it has room again.
+ */
+typedef struct {
+    // Queue data for the device; returns the bytes taken (fewer when full)
+    size_t (*write)(int channel, const uint8_t *data, size_t len);
+    // Queue a marker behind the data written so far; false when full
+    bool (*sync)(int channel, uint32_t *marker);
+    // Check if the device has taken the data before a marker
+    bool (*synced)(int channel, uint32_t marker);
+} rfc2217_tx_path_t;
+
+/**
+ * @brief Initialize and start the RFC2217 server of a channel
  *
+ * Starts a TCP server on the given port that implements the RFC2217
+ * Telnet COM Port Control protocol for the channel's USB device. There is
+ * one server per channel (SERIAL_CONTROL_CHANNELS). The servers are served
+ * by the network loop, so this must be called after net_loop_init() and
+ * before net_loop_start().
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
+ * @param port TCP port to listen on
+ * @param tx_path Path for client data to the device (must stay valid)
  * @return ESP_OK on success
  */
-esp_err_t rfc2217_server_init(void);
+esp_err_t rfc2217_server_init(int channel, uint16_t port, const rfc2217_tx_path_t *tx_path);
 
 /**
- * @brief Stop the RFC2217 server
+ * @brief Stop the RFC2217 server of a channel
+ *
+ * Must be called from the network loop.
  *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
  * @return ESP_OK on success
  */
-esp_err_t rfc2217_server_stop(void);
+esp_err_t rfc2217_server_stop(int channel);
 
 /**
  * @brief Check if an RFC2217 client is connected
  *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
  * @return true if a client is connected
  */
-bool rfc2217_server_is_connected(void);
+bool rfc2217_server_is_connected(int channel);
 
 /**
  * @brief Send data to connected RFC2217 client (from USB)
  *
- * Data will be escaped (IAC -> IAC IAC) before transmission.
+ * Data will be escaped (IAC -> IAC IAC) before transmission. Never blocks:
+ * only as much data as fits in the connection's write queue is taken, and
+ * the caller retries the rest once the loop has drained it. Must be called
+ * from the network loop.
  *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
  * @param data Data buffer
  * @param len Data length
- * @return ESP_OK on success
+ * @return Number of input bytes taken (0 when not connected or the queue is full)
  */
-esp_err_t rfc2217_server_send_data(const uint8_t *data, size_t len);
+size_t rfc2217_server_send_data(int channel, const uint8_t *data, size_t len);
 
 /**
  * @brief Notify client of modem state change
  *
  * Sends NOTIFY-MODEMSTATE subnegotiation to the client.
  *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
  * @param cts Clear To Send state
  * @param dsr Data Set Ready state
  * @param ri Ring Indicator state
  * @param cd Carrier Detect state
  * @return ESP_OK on success
  */
-esp_err_t rfc2217_server_notify_modemstate(bool cts, bool dsr, bool ri, bool cd);
+esp_err_t rfc2217_server_notify_modemstate(int channel, bool cts, bool dsr, bool ri, bool cd);
 
 /**
  * @brief Notify client of line state change
  *
  * Sends NOTIFY-LINESTATE subnegotiation to the client.
  *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
  * @param state Line state bits (RFC2217_LINESTATE_*)
  * @return ESP_OK on success
  */
-esp_err_t rfc2217_server_notify_linestate(uint8_t state);
+esp_err_t rfc2217_server_notify_linestate(int channel, uint8_t state);
 
 #ifdef __cplusplus
 }
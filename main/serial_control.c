@@ -6,10 +6,14 @@
  */
 
 #include "serial_control.h"
+#include <assert.h>
+#include <stdio.h>
 #include <string.h>
+#include <stdatomic.h>
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
-#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
 
 #include "usb/cdc_acm_host.h"
 #include "usb/ftdi_sio_host.h"
@@ -18,50 +22,127 @@
 
 static const char *TAG = "serial_ctrl";
 
+#define SERIAL_CTRL_QUEUE_LENGTH    16
+#define SERIAL_CTRL_TASK_STACK      3072
+
+#ifndef CONFIG_TASK_SERIAL_CTRL_PRIORITY
+#define CONFIG_TASK_SERIAL_CTRL_PRIORITY 9
+#endif
+
+#ifndef CONFIG_FTDI_IN_BUFFER_SIZE
+#define CONFIG_FTDI_IN_BUFFER_SIZE 4096
+#endif
+
+#ifndef CONFIG_FTDI_LATENCY_TIMER_MS
+#define CONFIG_FTDI_LATENCY_TIMER_MS SERIAL_LATENCY_AUTO
+#endif
+
+#define FTDI_PACKET_PAYLOAD     62      // Data bytes per 64-byte packet after the status bytes
+#define AUTO_LATENCY_BULK_MIN   2
+#define AUTO_LATENCY_BULK_MAX   16      // FTDI power-on default
+
 // ============================================================================
-// External references to main.c globals
+// Device snapshot
 // ============================================================================
 
-typedef enum {
-    DEVICE_TYPE_UNKNOWN = 0,
-    DEVICE_TYPE_CDC,
-    DEVICE_TYPE_FTDI
-} device_type_t;
+// Published with one atomic pointer store; readers copy it and never lock.
+// Attach alternates between two slots, so a reader still holding the
+// previous snapshot is not overwritten by the next attach. Tasks that call
+// into the driver with the handle count themselves in readers first, and
+// detach waits for them, so the handle is never used after the close.
+typedef struct {
+    serial_device_type_t type;
+    void *handle;
+    uint32_t generation;        // Increases with every attach
+} device_snapshot_t;
+
+
+// ============================================================================
+// Control requests
+// ============================================================================
 
 typedef enum {
-    DEVICE_STATE_DETECTED = 0,
-    DEVICE_STATE_OPENING,
-    DEVICE_STATE_OPEN,
-    DEVICE_STATE_ERROR,
-    DEVICE_STATE_DISCONNECTED
-} device_state_t;
+    CTRL_OP_LINE_CODING = 0,
+    CTRL_OP_BAUDRATE,
+    CTRL_OP_MODEM_CONTROL,
+    CTRL_OP_BREAK,
+    CTRL_OP_LATENCY,
+    CTRL_OP_FLOW
+} ctrl_op_t;
 
 typedef struct {
-    device_type_t type;
-    device_state_t state;
-    uint16_t vid;
-    uint16_t pid;
+    ctrl_op_t op;
+    uint32_t generation;        // Device the request was made for
     union {
-        cdc_acm_dev_hdl_t cdc_hdl;
-        ftdi_sio_dev_hdl_t ftdi_hdl;
-    } handle;
-    SemaphoreHandle_t disconnected_sem;
-} device_info_t;
-
-// These are defined in main.c
-extern device_info_t *current_device;
-extern SemaphoreHandle_t device_mutex;
+        serial_line_coding_t coding;
+        uint32_t baudrate;
+        struct {
+            bool dtr;
+            bool rts;
+        } modem;
+        bool on;
+        uint8_t latency_ms;
+        serial_flow_control_t flow;
+    } arg;
+} ctrl_request_t;
 
 // ============================================================================
-// Internal state tracking
+// Channel state
 // ============================================================================
 
-static bool s_current_dtr = false;
-static bool s_current_rts = false;
-static uint32_t s_current_baudrate = 115200;
-static uint8_t s_current_data_bits = 8;
-static uint8_t s_current_parity = 0;
-static uint8_t s_current_stop_bits = 0;
+// Status reported by the USB driver callbacks, read without locking
+#define STATUS_VALID    0x01
+#define STATUS_CTS      0x02
+#define STATUS_DSR      0x04
+#define STATUS_RI       0x08
+#define STATUS_CD       0x10
+
+typedef struct {
+    int index;
+
+    device_snapshot_t snapshots[2];
+    _Atomic(const device_snapshot_t *) device;
+    atomic_uint readers;            // Tasks inside a driver call with the handle
+    uint32_t generation;            // Only written by the channel's device handler task
+
+    // Requests for this channel's device, applied by its own worker
+    QueueHandle_t ctrl_queue;
+    atomic_uint ctrl_pending;       // Requests queued or being applied
+
+    // Line coding the device is known to have (worker only), so requests
+    // that change nothing cost no control transfer
+    serial_line_coding_t applied_coding;
+    uint32_t applied_generation;    // Device applied_coding is valid for (0 = unknown)
+
+    // Last requested settings (written by the requesting task, the network loop)
+    bool current_dtr;
+    bool current_rts;
+    uint32_t current_baudrate;
+    uint8_t current_data_bits;
+    uint8_t current_parity;
+    uint8_t current_stop_bits;
+
+    // FTDI tuning, kept across devices
+    uint8_t latency_setting;        // SERIAL_LATENCY_AUTO or ms
+    uint8_t latency_applied;        // Last latency queued (0 = none yet)
+    serial_profile_t profile;
+    size_t in_xfer_size;
+    serial_flow_control_t flow_control;     // Also kept across devices
+
+    atomic_uint modem_status;       // STATUS_* bits (0 = nothing reported)
+    atomic_uint line_errors;        // SERIAL_LINE_* bits not yet taken
+} serial_channel_t;
+
+static serial_channel_t s_channels[SERIAL_CONTROL_CHANNELS] = {
+    [0 ... SERIAL_CONTROL_CHANNELS - 1] = {
+        .current_baudrate = 115200,
+        .current_data_bits = 8,
+        .latency_setting = CONFIG_FTDI_LATENCY_TIMER_MS,
+        .profile = SERIAL_PROFILE_INTERACTIVE,
+        .in_xfer_size = CONFIG_FTDI_IN_BUFFER_SIZE,
+    },
+};
+static _Atomic(serial_status_cb_t) s_status_cb;
 
 // ============================================================================
 // Retry configuration
@@ -76,487 +157,830 @@ static uint8_t s_current_stop_bits = 0;
 #endif
 
 // ============================================================================
-// Helper macros
+// Helpers
 // ============================================================================
 
-#define ACQUIRE_DEVICE_MUTEX() \
-    do { \
-        if (xSemaphoreTake(device_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) { \
-            ESP_LOGE(TAG, "Failed to acquire device mutex"); \
-            return ESP_ERR_TIMEOUT; \
-        } \
-    } while(0)
+static serial_channel_t *channel_get(int channel)
+{
+    assert(channel >= 0 && channel < SERIAL_CONTROL_CHANNELS);
+    return &s_channels[channel];
+}
+
+/**
+ * @brief Take the current device for driver calls
+ *
+ * The reader is counted before the snapshot is loaded: either detach sees
+ * the count and waits, or the reader sees the NULL detach stored.
+ *
+ * @param ch Channel
+ * @return Device (release with device_release()), or NULL without one
+ */
+static const device_snapshot_t *device_acquire(serial_channel_t *ch)
+{
+    atomic_fetch_add(&ch->readers, 1);
+    const device_snapshot_t *dev = atomic_load(&ch->device);
+    if (dev == NULL) {
+        atomic_fetch_sub(&ch->readers, 1);
+    }
+    return dev;
+}
 
-#define RELEASE_DEVICE_MUTEX() xSemaphoreGive(device_mutex)
+static void device_release(serial_channel_t *ch)
+{
+    atomic_fetch_sub(&ch->readers, 1);
+}
+
+static bool device_is_current(serial_channel_t *ch, uint32_t generation)
+{
+    const device_snapshot_t *dev = atomic_load(&ch->device);
+    return dev != NULL && dev->generation == generation;
+}
 
-#define CHECK_DEVICE_CONNECTED() \
+// Repeat a driver call while it reports ESP_ERR_NOT_FINISHED (device busy),
+// giving up early if the device goes away between attempts
+#define CALL_WITH_RETRY(ret, ch, generation, call) \
     do { \
-        if (current_device == NULL || current_device->state != DEVICE_STATE_OPEN) { \
-            RELEASE_DEVICE_MUTEX(); \
-            return ESP_ERR_INVALID_STATE; \
+        int retry_count_ = 0; \
+        while (((ret) = (call)) == ESP_ERR_NOT_FINISHED && \
+               ++retry_count_ < CONFIG_SERIAL_CTRL_RETRY_COUNT) { \
+            vTaskDelay(pdMS_TO_TICKS(CONFIG_SERIAL_CTRL_RETRY_INTERVAL_MS)); \
+            if (!device_is_current((ch), (generation))) { \
+                (ret) = ESP_ERR_INVALID_STATE; \
+                break; \
+            } \
         } \
-    } while(0)
+    } while (0)
 
-// ============================================================================
-// Implementation
-// ============================================================================
+/**
+ * @brief Queue a control request for the channel's current device
+ *
+ * @param ch Channel
+ * @param req Request (generation is filled in)
+ * @return ESP_OK when queued
+ */
+static esp_err_t ctrl_submit(serial_channel_t *ch, ctrl_request_t *req)
+{
+    const device_snapshot_t *dev = atomic_load(&ch->device);
+    if (dev == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (ch->ctrl_queue == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
-bool serial_control_is_connected(void)
+    req->generation = dev->generation;
+    atomic_fetch_add(&ch->ctrl_pending, 1);
+    if (xQueueSend(ch->ctrl_queue, req, 0) != pdTRUE) {
+        atomic_fetch_sub(&ch->ctrl_pending, 1);
+        ESP_LOGW(TAG, "Control queue full, request dropped");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+static uint8_t effective_latency(const serial_channel_t *ch)
 {
-    if (xSemaphoreTake(device_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
-        return false;
+    if (ch->latency_setting != SERIAL_LATENCY_AUTO) {
+        return ch->latency_setting;
     }
-    bool connected = (current_device != NULL && current_device->state == DEVICE_STATE_OPEN);
-    xSemaphoreGive(device_mutex);
-    return connected;
+    return serial_control_auto_latency(ch->current_baudrate, ch->profile);
 }
 
-esp_err_t serial_control_set_line_coding(const serial_line_coding_t *coding)
+/**
+ * @brief Queue the latency timer for the channel's current FTDI device
+ *
+ * @param ch Channel
+ * @param force Queue even if the value did not change
+ * @return ESP_OK when queued or unchanged, ESP_ERR_NOT_SUPPORTED for CDC-ACM
+ */
+static esp_err_t queue_latency(serial_channel_t *ch, bool force)
 {
-    if (coding == NULL) {
-        return ESP_ERR_INVALID_ARG;
+    const device_snapshot_t *dev = atomic_load(&ch->device);
+    if (dev == NULL) {
+        return ESP_OK;
+    }
+    if (dev->type != SERIAL_DEVICE_FTDI) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    uint8_t latency = effective_latency(ch);
+    if (!force && latency == ch->latency_applied) {
+        return ESP_OK;
+    }
+    ctrl_request_t req = {
+        .op = CTRL_OP_LATENCY,
+        .arg.latency_ms = latency,
+    };
+    esp_err_t ret = ctrl_submit(ch, &req);
+    if (ret == ESP_OK) {
+        ch->latency_applied = latency;
     }
+    return ret;
+}
+
+// ============================================================================
+// Control worker
+// ============================================================================
 
-    ACQUIRE_DEVICE_MUTEX();
-    CHECK_DEVICE_CONNECTED();
+static bool line_coding_known(const serial_channel_t *ch, const device_snapshot_t *dev)
+{
+    return ch->applied_generation == dev->generation;
+}
+
+static bool line_format_equal(const serial_line_coding_t *a, const serial_line_coding_t *b)
+{
+    return a->data_bits == b->data_bits && a->parity == b->parity && a->stop_bits == b->stop_bits;
+}
 
-    esp_err_t ret = ESP_OK;
-    int retry_count = 0;
+static esp_err_t apply_line_coding(serial_channel_t *ch, const device_snapshot_t *dev, const serial_line_coding_t *coding)
+{
+    esp_err_t ret;
+    bool known = line_coding_known(ch, dev);
+    const serial_line_coding_t *applied = &ch->applied_coding;
 
-    if (current_device->type == DEVICE_TYPE_CDC) {
+    if (dev->type == SERIAL_DEVICE_CDC) {
+        if (known && applied->baudrate == coding->baudrate && line_format_equal(applied, coding)) {
+            return ESP_OK;
+        }
         cdc_acm_line_coding_t cdc_coding = {
             .dwDTERate = coding->baudrate,
             .bDataBits = coding->data_bits,
             .bParityType = coding->parity,
             .bCharFormat = coding->stop_bits
         };
+        ch->applied_generation = 0;
+        CALL_WITH_RETRY(ret, ch, dev->generation,
+                        cdc_acm_host_line_coding_set((cdc_acm_dev_hdl_t)dev->handle, &cdc_coding));
+        if (ret == ESP_OK) {
+            ch->applied_coding = *coding;
+            ch->applied_generation = dev->generation;
+        }
+        return ret;
+    }
 
-        // Retry loop for CDC
-        do {
-            ret = cdc_acm_host_line_coding_set(current_device->handle.cdc_hdl, &cdc_coding);
-            if (ret == ESP_ERR_NOT_FINISHED) {
-                retry_count++;
-                RELEASE_DEVICE_MUTEX();
-                vTaskDelay(pdMS_TO_TICKS(CONFIG_SERIAL_CTRL_RETRY_INTERVAL_MS));
-                ACQUIRE_DEVICE_MUTEX();
-                CHECK_DEVICE_CONNECTED();
-            }
-        } while (ret == ESP_ERR_NOT_FINISHED && retry_count < CONFIG_SERIAL_CTRL_RETRY_COUNT);
-
-    } else if (current_device->type == DEVICE_TYPE_FTDI) {
-        // Set baudrate with retry
-        do {
-            ret = ftdi_sio_host_set_baudrate(current_device->handle.ftdi_hdl, coding->baudrate);
-            if (ret == ESP_ERR_NOT_FINISHED) {
-                retry_count++;
-                RELEASE_DEVICE_MUTEX();
-                vTaskDelay(pdMS_TO_TICKS(CONFIG_SERIAL_CTRL_RETRY_INTERVAL_MS));
-                ACQUIRE_DEVICE_MUTEX();
-                CHECK_DEVICE_CONNECTED();
-            }
-        } while (ret == ESP_ERR_NOT_FINISHED && retry_count < CONFIG_SERIAL_CTRL_RETRY_COUNT);
+    if (dev->type != SERIAL_DEVICE_FTDI) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
 
-        if (ret == ESP_OK) {
-            // Set line property
-            ftdi_data_bits_t data_bits;
-            switch (coding->data_bits) {
-                case 7: data_bits = FTDI_DATA_BITS_7; break;
-                case 8:
-                default: data_bits = FTDI_DATA_BITS_8; break;
-            }
+    // FTDI sets baud rate and character format with separate requests;
+    // only send the ones that change something
+    ftdi_sio_dev_hdl_t hdl = (ftdi_sio_dev_hdl_t)dev->handle;
+    bool set_baud = !known || applied->baudrate != coding->baudrate;
+    bool set_format = !known || !line_format_equal(applied, coding);
+    ch->applied_generation = 0;
+
+    if (set_baud) {
+        CALL_WITH_RETRY(ret, ch, dev->generation, ftdi_sio_host_set_baudrate(hdl, coding->baudrate));
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
 
-            ftdi_stop_bits_t stop_bits;
-            switch (coding->stop_bits) {
-                case 1: stop_bits = FTDI_STOP_BITS_15; break;
-                case 2: stop_bits = FTDI_STOP_BITS_2; break;
-                case 0:
-                default: stop_bits = FTDI_STOP_BITS_1; break;
-            }
+    if (set_format) {
+        ftdi_data_bits_t data_bits;
+        switch (coding->data_bits) {
+            case 7: data_bits = FTDI_DATA_BITS_7; break;
+            case 8:
+            default: data_bits = FTDI_DATA_BITS_8; break;
+        }
 
-            ftdi_parity_t parity;
-            switch (coding->parity) {
-                case 1: parity = FTDI_PARITY_ODD; break;
-                case 2: parity = FTDI_PARITY_EVEN; break;
-                case 3: parity = FTDI_PARITY_MARK; break;
-                case 4: parity = FTDI_PARITY_SPACE; break;
-                case 0:
-                default: parity = FTDI_PARITY_NONE; break;
-            }
+        ftdi_stop_bits_t stop_bits;
+        switch (coding->stop_bits) {
+            case 1: stop_bits = FTDI_STOP_BITS_15; break;
+            case 2: stop_bits = FTDI_STOP_BITS_2; break;
+            case 0:
+            default: stop_bits = FTDI_STOP_BITS_1; break;
+        }
 
-            // Retry loop for line property
-            retry_count = 0;
-            do {
-                ret = ftdi_sio_host_set_line_property(current_device->handle.ftdi_hdl,
-                                                       data_bits, stop_bits, parity);
-                if (ret == ESP_ERR_NOT_FINISHED) {
-                    retry_count++;
-                    RELEASE_DEVICE_MUTEX();
-                    vTaskDelay(pdMS_TO_TICKS(CONFIG_SERIAL_CTRL_RETRY_INTERVAL_MS));
-                    ACQUIRE_DEVICE_MUTEX();
-                    CHECK_DEVICE_CONNECTED();
-                }
-            } while (ret == ESP_ERR_NOT_FINISHED && retry_count < CONFIG_SERIAL_CTRL_RETRY_COUNT);
+        ftdi_parity_t parity;
+        switch (coding->parity) {
+            case 1: parity = FTDI_PARITY_ODD; break;
+            case 2: parity = FTDI_PARITY_EVEN; break;
+            case 3: parity = FTDI_PARITY_MARK; break;
+            case 4: parity = FTDI_PARITY_SPACE; break;
+            case 0:
+            default: parity = FTDI_PARITY_NONE; break;
         }
-    } else {
-        ret = ESP_ERR_NOT_SUPPORTED;
-    }
 
-    if (ret == ESP_OK) {
-        s_current_baudrate = coding->baudrate;
-        s_current_data_bits = coding->data_bits;
-        s_current_parity = coding->parity;
-        s_current_stop_bits = coding->stop_bits;
-        ESP_LOGD(TAG, "Line coding set: %lu bps, %d data, %d parity, %d stop",
-                 (unsigned long)coding->baudrate, coding->data_bits,
-                 coding->parity, coding->stop_bits);
+        CALL_WITH_RETRY(ret, ch, dev->generation,
+                        ftdi_sio_host_set_line_property(hdl, data_bits, stop_bits, parity));
+        if (ret != ESP_OK) {
+            return ret;
+        }
     }
 
-    RELEASE_DEVICE_MUTEX();
-    return ret;
+    ch->applied_coding = *coding;
+    ch->applied_generation = dev->generation;
+    return ESP_OK;
 }
 
-esp_err_t serial_control_get_line_coding(serial_line_coding_t *coding)
+static esp_err_t apply_baudrate(serial_channel_t *ch, const device_snapshot_t *dev, uint32_t baudrate)
 {
-    if (coding == NULL) {
-        return ESP_ERR_INVALID_ARG;
-    }
+    esp_err_t ret;
 
-    ACQUIRE_DEVICE_MUTEX();
-    CHECK_DEVICE_CONNECTED();
-
-    esp_err_t ret = ESP_OK;
+    if (line_coding_known(ch, dev)) {
+        // The rest of the line coding is known: no need to read it back
+        serial_line_coding_t coding = ch->applied_coding;
+        coding.baudrate = baudrate;
+        return apply_line_coding(ch, dev, &coding);
+    }
 
-    if (current_device->type == DEVICE_TYPE_CDC) {
+    if (dev->type == SERIAL_DEVICE_CDC) {
+        // Keep the device's other line settings
+        cdc_acm_dev_hdl_t hdl = (cdc_acm_dev_hdl_t)dev->handle;
         cdc_acm_line_coding_t cdc_coding;
-        ret = cdc_acm_host_line_coding_get(current_device->handle.cdc_hdl, &cdc_coding);
+        CALL_WITH_RETRY(ret, ch, dev->generation, cdc_acm_host_line_coding_get(hdl, &cdc_coding));
+        if (ret == ESP_OK) {
+            cdc_coding.dwDTERate = baudrate;
+            CALL_WITH_RETRY(ret, ch, dev->generation, cdc_acm_host_line_coding_set(hdl, &cdc_coding));
+        }
         if (ret == ESP_OK) {
-            coding->baudrate = cdc_coding.dwDTERate;
-            coding->data_bits = cdc_coding.bDataBits;
-            coding->parity = cdc_coding.bParityType;
-            coding->stop_bits = cdc_coding.bCharFormat;
+            ch->applied_coding = (serial_line_coding_t) {
+                .baudrate = baudrate,
+                .data_bits = cdc_coding.bDataBits,
+                .parity = cdc_coding.bParityType,
+                .stop_bits = cdc_coding.bCharFormat,
+            };
+            ch->applied_generation = dev->generation;
         }
-    } else if (current_device->type == DEVICE_TYPE_FTDI) {
-        // FTDI doesn't support reading back line coding, use cached values
-        coding->baudrate = s_current_baudrate;
-        coding->data_bits = s_current_data_bits;
-        coding->parity = s_current_parity;
-        coding->stop_bits = s_current_stop_bits;
+    } else if (dev->type == SERIAL_DEVICE_FTDI) {
+        // The character format cannot be read back from FTDI chips
+        CALL_WITH_RETRY(ret, ch, dev->generation,
+                        ftdi_sio_host_set_baudrate((ftdi_sio_dev_hdl_t)dev->handle, baudrate));
     } else {
         ret = ESP_ERR_NOT_SUPPORTED;
     }
-
-    RELEASE_DEVICE_MUTEX();
     return ret;
 }
 
-esp_err_t serial_control_set_baudrate(uint32_t baudrate)
+/**
+ * @brief Fold queued line coding requests into one
+ *
+ * Clients change baud rate, data size, parity and stop size one request
+ * at a time. Line coding requests for the same device that are already
+ * queued behind req are merged into it, so the device gets one update
+ * with the final settings. Any other request ends the merge, so DTR/RTS
+ * and break keep their order relative to line coding.
+ *
+ * @param ch Channel
+ * @param req Line coding or baud rate request, updated in place
+ * @return Number of requests merged
+ */
+static int coalesce_line_coding(serial_channel_t *ch, ctrl_request_t *req)
 {
-    ACQUIRE_DEVICE_MUTEX();
-    CHECK_DEVICE_CONNECTED();
-
-    esp_err_t ret = ESP_OK;
-
-    if (current_device->type == DEVICE_TYPE_CDC) {
-        cdc_acm_line_coding_t cdc_coding;
-        ret = cdc_acm_host_line_coding_get(current_device->handle.cdc_hdl, &cdc_coding);
-        if (ret == ESP_OK) {
-            cdc_coding.dwDTERate = baudrate;
-            ret = cdc_acm_host_line_coding_set(current_device->handle.cdc_hdl, &cdc_coding);
+    int merged = 0;
+    ctrl_request_t next;
+
+    while (xQueuePeek(ch->ctrl_queue, &next, 0) == pdTRUE &&
+           (next.op == CTRL_OP_LINE_CODING || next.op == CTRL_OP_BAUDRATE) &&
+           next.generation == req->generation) {
+        xQueueReceive(ch->ctrl_queue, &next, 0);
+        if (next.op == CTRL_OP_LINE_CODING) {
+            req->op = CTRL_OP_LINE_CODING;
+            req->arg.coding = next.arg.coding;
+        } else if (req->op == CTRL_OP_LINE_CODING) {
+            req->arg.coding.baudrate = next.arg.baudrate;
+        } else {
+            req->arg.baudrate = next.arg.baudrate;
         }
-    } else if (current_device->type == DEVICE_TYPE_FTDI) {
-        ret = ftdi_sio_host_set_baudrate(current_device->handle.ftdi_hdl, baudrate);
+        merged++;
+    }
+    return merged;
+}
+
+static esp_err_t apply_modem_control(serial_channel_t *ch, const device_snapshot_t *dev, bool dtr, bool rts)
+{
+    esp_err_t ret;
+
+    if (dev->type == SERIAL_DEVICE_CDC) {
+        CALL_WITH_RETRY(ret, ch, dev->generation,
+                        cdc_acm_host_set_control_line_state((cdc_acm_dev_hdl_t)dev->handle, dtr, rts));
+    } else if (dev->type == SERIAL_DEVICE_FTDI) {
+        CALL_WITH_RETRY(ret, ch, dev->generation,
+                        ftdi_sio_host_set_modem_control((ftdi_sio_dev_hdl_t)dev->handle, dtr, rts));
     } else {
         ret = ESP_ERR_NOT_SUPPORTED;
     }
+    return ret;
+}
 
-    if (ret == ESP_OK) {
-        s_current_baudrate = baudrate;
-        ESP_LOGD(TAG, "Baudrate set: %lu", (unsigned long)baudrate);
+static esp_err_t apply_break(serial_channel_t *ch, const device_snapshot_t *dev, bool on)
+{
+    if (dev->type != SERIAL_DEVICE_CDC) {
+        return ESP_ERR_NOT_SUPPORTED;
     }
-
-    RELEASE_DEVICE_MUTEX();
-    return ret;
+    // CDC break is time-limited, can't be turned off explicitly
+    if (!on) {
+        return ESP_OK;
+    }
+    return cdc_acm_host_send_break((cdc_acm_dev_hdl_t)dev->handle, 100);
 }
 
-esp_err_t serial_control_get_baudrate(uint32_t *baudrate)
+static esp_err_t apply_latency(serial_channel_t *ch, const device_snapshot_t *dev, uint8_t latency_ms)
 {
-    if (baudrate == NULL) {
-        return ESP_ERR_INVALID_ARG;
+    esp_err_t ret;
+
+    if (dev->type != SERIAL_DEVICE_FTDI) {
+        return ESP_ERR_NOT_SUPPORTED;
     }
+    CALL_WITH_RETRY(ret, ch, dev->generation,
+                    ftdi_sio_host_set_latency_timer((ftdi_sio_dev_hdl_t)dev->handle, latency_ms));
+    return ret;
+}
 
-    ACQUIRE_DEVICE_MUTEX();
-    CHECK_DEVICE_CONNECTED();
+static esp_err_t apply_flow_control(serial_channel_t *ch, const device_snapshot_t *dev, serial_flow_control_t flow)
+{
+    esp_err_t ret;
 
-    esp_err_t ret = ESP_OK;
+    if (dev->type != SERIAL_DEVICE_FTDI) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    ftdi_flow_control_t ftdi_flow = FTDI_FLOW_NONE;
+    if (flow == SERIAL_FLOW_RTS_CTS) {
+        ftdi_flow = FTDI_FLOW_RTS_CTS;
+    } else if (flow == SERIAL_FLOW_XON_XOFF) {
+        ftdi_flow = FTDI_FLOW_XON_XOFF;
+    }
+    CALL_WITH_RETRY(ret, ch, dev->generation,
+                    ftdi_sio_host_set_flow_control((ftdi_sio_dev_hdl_t)dev->handle, ftdi_flow));
+    return ret;
+}
 
-    if (current_device->type == DEVICE_TYPE_CDC) {
-        cdc_acm_line_coding_t cdc_coding;
-        ret = cdc_acm_host_line_coding_get(current_device->handle.cdc_hdl, &cdc_coding);
-        if (ret == ESP_OK) {
-            *baudrate = cdc_coding.dwDTERate;
+/**
+ * @brief Count requests as finished
+ *
+ * Calls the status callback once nothing is pending, so data held back
+ * behind the settings (see serial_control_is_idle()) can go out.
+ *
+ * @param ch Channel
+ * @param count Requests finished (including merged ones)
+ */
+static void ctrl_done(serial_channel_t *ch, unsigned int count)
+{
+    if (atomic_fetch_sub(&ch->ctrl_pending, count) == count) {
+        serial_status_cb_t cb = atomic_load(&s_status_cb);
+        if (cb != NULL) {
+            cb();
         }
-    } else if (current_device->type == DEVICE_TYPE_FTDI) {
-        *baudrate = s_current_baudrate;
-    } else {
-        ret = ESP_ERR_NOT_SUPPORTED;
     }
-
-    RELEASE_DEVICE_MUTEX();
-    return ret;
 }
 
-esp_err_t serial_control_set_dtr(bool state)
+/**
+ * @brief Control worker task
+ *
+ * Only task issuing control transfers for its channel. Requests run in
+ * order; a busy device is retried here, away from the network loop and
+ * the data path, and without delaying the other channels' devices.
+ *
+ * @param arg Channel (serial_channel_t *)
+ */
+static void serial_ctrl_task(void *arg)
 {
-    ACQUIRE_DEVICE_MUTEX();
-    CHECK_DEVICE_CONNECTED();
+    serial_channel_t *ch = (serial_channel_t *)arg;
+    ctrl_request_t req;
 
-    esp_err_t ret = ESP_OK;
-    int retry_count = 0;
-    s_current_dtr = state;
+    while (1) {
+        if (xQueueReceive(ch->ctrl_queue, &req, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        unsigned int done = 1;
 
-    if (current_device->type == DEVICE_TYPE_CDC) {
-        do {
-            ret = cdc_acm_host_set_control_line_state(current_device->handle.cdc_hdl,
-                                                       s_current_dtr, s_current_rts);
-            if (ret == ESP_ERR_NOT_FINISHED) {
-                retry_count++;
-                RELEASE_DEVICE_MUTEX();
-                vTaskDelay(pdMS_TO_TICKS(CONFIG_SERIAL_CTRL_RETRY_INTERVAL_MS));
-                ACQUIRE_DEVICE_MUTEX();
-                CHECK_DEVICE_CONNECTED();
+        const device_snapshot_t *snap = device_acquire(ch);
+        if (snap == NULL || snap->generation != req.generation) {
+            ESP_LOGD(TAG, "Dropping request %d for a device that went away", req.op);
+            if (snap != NULL) {
+                device_release(ch);
             }
-        } while (ret == ESP_ERR_NOT_FINISHED && retry_count < CONFIG_SERIAL_CTRL_RETRY_COUNT);
-    } else if (current_device->type == DEVICE_TYPE_FTDI) {
-        do {
-            ret = ftdi_sio_host_set_modem_control(current_device->handle.ftdi_hdl,
-                                                   s_current_dtr, s_current_rts);
-            if (ret == ESP_ERR_NOT_FINISHED) {
-                retry_count++;
-                RELEASE_DEVICE_MUTEX();
-                vTaskDelay(pdMS_TO_TICKS(CONFIG_SERIAL_CTRL_RETRY_INTERVAL_MS));
-                ACQUIRE_DEVICE_MUTEX();
-                CHECK_DEVICE_CONNECTED();
+            ctrl_done(ch, done);
+            continue;
+        }
+        device_snapshot_t dev = *snap;
+
+        if (req.op == CTRL_OP_LINE_CODING || req.op == CTRL_OP_BAUDRATE) {
+            int merged = coalesce_line_coding(ch, &req);
+            if (merged > 0) {
+                ESP_LOGD(TAG, "[ch%d] Merged %d line coding requests", ch->index, merged);
             }
-        } while (ret == ESP_ERR_NOT_FINISHED && retry_count < CONFIG_SERIAL_CTRL_RETRY_COUNT);
-    } else {
-        ret = ESP_ERR_NOT_SUPPORTED;
+            done += merged;
+        }
+
+        esp_err_t ret;
+        switch (req.op) {
+        case CTRL_OP_LINE_CODING:
+            ret = apply_line_coding(ch, &dev, &req.arg.coding);
+            if (ret == ESP_OK) {
+                ESP_LOGD(TAG, "Line coding set: %lu bps, %d data, %d parity, %d stop",
+                         (unsigned long)req.arg.coding.baudrate, req.arg.coding.data_bits,
+                         req.arg.coding.parity, req.arg.coding.stop_bits);
+            }
+            break;
+        case CTRL_OP_BAUDRATE:
+            ret = apply_baudrate(ch, &dev, req.arg.baudrate);
+            if (ret == ESP_OK) {
+                ESP_LOGD(TAG, "Baudrate set: %lu", (unsigned long)req.arg.baudrate);
+            }
+            break;
+        case CTRL_OP_MODEM_CONTROL:
+            ret = apply_modem_control(ch, &dev, req.arg.modem.dtr, req.arg.modem.rts);
+            if (ret == ESP_OK) {
+                ESP_LOGD(TAG, "Modem control set: DTR=%d, RTS=%d", req.arg.modem.dtr, req.arg.modem.rts);
+            }
+            break;
+        case CTRL_OP_BREAK:
+            ret = apply_break(ch, &dev, req.arg.on);
+            break;
+        case CTRL_OP_LATENCY:
+            ret = apply_latency(ch, &dev, req.arg.latency_ms);
+            if (ret == ESP_OK) {
+                ESP_LOGI(TAG, "[ch%d] Latency timer set: %d ms", ch->index, req.arg.latency_ms);
+            }
+            break;
+        case CTRL_OP_FLOW:
+            ret = apply_flow_control(ch, &dev, req.arg.flow);
+            if (ret == ESP_OK) {
+                ESP_LOGI(TAG, "[ch%d] Flow control set: %d", ch->index, req.arg.flow);
+            }
+            break;
+        default:
+            ret = ESP_ERR_INVALID_ARG;
+            break;
+        }
+
+        device_release(ch);
+
+        if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+            ESP_LOGW(TAG, "[ch%d] Control request %d failed: %s", ch->index, req.op, esp_err_to_name(ret));
+        }
+        ctrl_done(ch, done);
     }
+}
 
-    if (ret == ESP_OK) {
-        ESP_LOGD(TAG, "DTR set: %d", state);
+// ============================================================================
+// Implementation
+// ============================================================================
+
+esp_err_t serial_control_init(void)
+{
+    for (int i = 0; i < SERIAL_CONTROL_CHANNELS; i++) {
+        serial_channel_t *ch = &s_channels[i];
+        ch->index = i;
+        ch->ctrl_queue = xQueueCreate(SERIAL_CTRL_QUEUE_LENGTH, sizeof(ctrl_request_t));
+        if (ch->ctrl_queue == NULL) {
+            ESP_LOGE(TAG, "Failed to create control queue");
+            return ESP_ERR_NO_MEM;
+        }
+
+        // Control transfers complete in the USB driver tasks, so run beside them
+        char name[16];
+        snprintf(name, sizeof(name), i == 0 ? "serial_ctrl" : "serial_ctrl%d", i);
+        BaseType_t created = xTaskCreatePinnedToCore(serial_ctrl_task, name, SERIAL_CTRL_TASK_STACK,
+                                                     ch, CONFIG_TASK_SERIAL_CTRL_PRIORITY, NULL,
+                                                     CONFIG_TASK_USB_CORE);
+        if (created != pdTRUE) {
+            ESP_LOGE(TAG, "Failed to create control task");
+            vQueueDelete(ch->ctrl_queue);
+            ch->ctrl_queue = NULL;
+            return ESP_ERR_NO_MEM;
+        }
     }
+    return ESP_OK;
+}
 
-    RELEASE_DEVICE_MUTEX();
-    return ret;
+void serial_control_attach(int channel, serial_device_type_t type, void *handle)
+{
+    serial_channel_t *ch = channel_get(channel);
+    ch->generation++;
+    device_snapshot_t *slot = &ch->snapshots[ch->generation & 1];
+    slot->type = type;
+    slot->handle = handle;
+    slot->generation = ch->generation;
+    atomic_store(&ch->device, slot);
 }
 
-esp_err_t serial_control_get_dtr(bool *state)
+void serial_control_detach(int channel)
 {
-    if (state == NULL) {
-        return ESP_ERR_INVALID_ARG;
+    serial_channel_t *ch = channel_get(channel);
+    atomic_store(&ch->device, NULL);
+
+    // Let driver calls that took the device before the store finish. They
+    // are bounded by the driver timeouts, and transfers to a device that is
+    // gone may only fail once the USB driver task runs again, i.e. after we
+    // return, so this can take up to one timeout.
+    TickType_t start = xTaskGetTickCount();
+    while (atomic_load(&ch->readers) > 0) {
+        vTaskDelay(1);
+    }
+    TickType_t waited = xTaskGetTickCount() - start;
+    if (waited > 0) {
+        ESP_LOGD(TAG, "[ch%d] Waited %lu ms for device users", ch->index,
+                 (unsigned long)pdTICKS_TO_MS(waited));
     }
-    *state = s_current_dtr;
-    return ESP_OK;
 }
 
-esp_err_t serial_control_set_rts(bool state)
+bool serial_control_acquire(int channel, serial_device_type_t *type, void **handle)
 {
-    ACQUIRE_DEVICE_MUTEX();
-    CHECK_DEVICE_CONNECTED();
+    const device_snapshot_t *dev = device_acquire(channel_get(channel));
+    if (dev == NULL) {
+        return false;
+    }
+    *type = dev->type;
+    *handle = dev->handle;
+    return true;
+}
 
-    esp_err_t ret = ESP_OK;
-    int retry_count = 0;
-    s_current_rts = state;
+void serial_control_release(int channel)
+{
+    device_release(channel_get(channel));
+}
 
-    if (current_device->type == DEVICE_TYPE_CDC) {
-        do {
-            ret = cdc_acm_host_set_control_line_state(current_device->handle.cdc_hdl,
-                                                       s_current_dtr, s_current_rts);
-            if (ret == ESP_ERR_NOT_FINISHED) {
-                retry_count++;
-                RELEASE_DEVICE_MUTEX();
-                vTaskDelay(pdMS_TO_TICKS(CONFIG_SERIAL_CTRL_RETRY_INTERVAL_MS));
-                ACQUIRE_DEVICE_MUTEX();
-                CHECK_DEVICE_CONNECTED();
-            }
-        } while (ret == ESP_ERR_NOT_FINISHED && retry_count < CONFIG_SERIAL_CTRL_RETRY_COUNT);
-    } else if (current_device->type == DEVICE_TYPE_FTDI) {
-        do {
-            ret = ftdi_sio_host_set_modem_control(current_device->handle.ftdi_hdl,
-                                                   s_current_dtr, s_current_rts);
-            if (ret == ESP_ERR_NOT_FINISHED) {
-                retry_count++;
-                RELEASE_DEVICE_MUTEX();
-                vTaskDelay(pdMS_TO_TICKS(CONFIG_SERIAL_CTRL_RETRY_INTERVAL_MS));
-                ACQUIRE_DEVICE_MUTEX();
-                CHECK_DEVICE_CONNECTED();
-            }
-        } while (ret == ESP_ERR_NOT_FINISHED && retry_count < CONFIG_SERIAL_CTRL_RETRY_COUNT);
-    } else {
-        ret = ESP_ERR_NOT_SUPPORTED;
+bool serial_control_is_connected(int channel)
+{
+    return atomic_load(&channel_get(channel)->device) != NULL;
+}
+
+bool serial_control_is_idle(int channel)
+{
+    return atomic_load(&channel_get(channel)->ctrl_pending) == 0;
+}
+
+esp_err_t serial_control_set_line_coding(int channel, const serial_line_coding_t *coding)
+{
+    if (coding == NULL) {
+        return ESP_ERR_INVALID_ARG;
     }
 
+    serial_channel_t *ch = channel_get(channel);
+    ctrl_request_t req = {
+        .op = CTRL_OP_LINE_CODING,
+        .arg.coding = *coding,
+    };
+    esp_err_t ret = ctrl_submit(ch, &req);
     if (ret == ESP_OK) {
-        ESP_LOGD(TAG, "RTS set: %d", state);
+        ch->current_baudrate = coding->baudrate;
+        ch->current_data_bits = coding->data_bits;
+        ch->current_parity = coding->parity;
+        ch->current_stop_bits = coding->stop_bits;
+        queue_latency(ch, false);
     }
+    return ret;
+}
+
+esp_err_t serial_control_get_line_coding(int channel, serial_line_coding_t *coding)
+{
+    if (coding == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!serial_control_is_connected(channel)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const serial_channel_t *ch = channel_get(channel);
+    coding->baudrate = ch->current_baudrate;
+    coding->data_bits = ch->current_data_bits;
+    coding->parity = ch->current_parity;
+    coding->stop_bits = ch->current_stop_bits;
+    return ESP_OK;
+}
 
-    RELEASE_DEVICE_MUTEX();
+esp_err_t serial_control_set_baudrate(int channel, uint32_t baudrate)
+{
+    serial_channel_t *ch = channel_get(channel);
+    ctrl_request_t req = {
+        .op = CTRL_OP_BAUDRATE,
+        .arg.baudrate = baudrate,
+    };
+    esp_err_t ret = ctrl_submit(ch, &req);
+    if (ret == ESP_OK) {
+        ch->current_baudrate = baudrate;
+        queue_latency(ch, false);
+    }
     return ret;
 }
 
-esp_err_t serial_control_get_rts(bool *state)
+esp_err_t serial_control_get_baudrate(int channel, uint32_t *baudrate)
 {
-    if (state == NULL) {
+    if (baudrate == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
-    *state = s_current_rts;
+    if (!serial_control_is_connected(channel)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    *baudrate = channel_get(channel)->current_baudrate;
     return ESP_OK;
 }
 
-esp_err_t serial_control_set_modem_control(bool dtr, bool rts)
+esp_err_t serial_control_set_dtr(int channel, bool state)
 {
-    ACQUIRE_DEVICE_MUTEX();
-    CHECK_DEVICE_CONNECTED();
+    return serial_control_set_modem_control(channel, state, channel_get(channel)->current_rts);
+}
 
-    esp_err_t ret = ESP_OK;
-    int retry_count = 0;
-    s_current_dtr = dtr;
-    s_current_rts = rts;
+esp_err_t serial_control_get_dtr(int channel, bool *state)
+{
+    if (state == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *state = channel_get(channel)->current_dtr;
+    return ESP_OK;
+}
 
-    if (current_device->type == DEVICE_TYPE_CDC) {
-        do {
-            ret = cdc_acm_host_set_control_line_state(current_device->handle.cdc_hdl, dtr, rts);
-            if (ret == ESP_ERR_NOT_FINISHED) {
-                retry_count++;
-                RELEASE_DEVICE_MUTEX();
-                vTaskDelay(pdMS_TO_TICKS(CONFIG_SERIAL_CTRL_RETRY_INTERVAL_MS));
-                ACQUIRE_DEVICE_MUTEX();
-                CHECK_DEVICE_CONNECTED();
-            }
-        } while (ret == ESP_ERR_NOT_FINISHED && retry_count < CONFIG_SERIAL_CTRL_RETRY_COUNT);
-    } else if (current_device->type == DEVICE_TYPE_FTDI) {
-        do {
-            ret = ftdi_sio_host_set_modem_control(current_device->handle.ftdi_hdl, dtr, rts);
-            if (ret == ESP_ERR_NOT_FINISHED) {
-                retry_count++;
-                RELEASE_DEVICE_MUTEX();
-                vTaskDelay(pdMS_TO_TICKS(CONFIG_SERIAL_CTRL_RETRY_INTERVAL_MS));
-                ACQUIRE_DEVICE_MUTEX();
-                CHECK_DEVICE_CONNECTED();
-            }
-        } while (ret == ESP_ERR_NOT_FINISHED && retry_count < CONFIG_SERIAL_CTRL_RETRY_COUNT);
-    } else {
-        ret = ESP_ERR_NOT_SUPPORTED;
+esp_err_t serial_control_set_rts(int channel, bool state)
+{
+    return serial_control_set_modem_control(channel, channel_get(channel)->current_dtr, state);
+}
+
+esp_err_t serial_control_get_rts(int channel, bool *state)
+{
+    if (state == NULL) {
+        return ESP_ERR_INVALID_ARG;
     }
+    *state = channel_get(channel)->current_rts;
+    return ESP_OK;
+}
 
+esp_err_t serial_control_set_modem_control(int channel, bool dtr, bool rts)
+{
+    serial_channel_t *ch = channel_get(channel);
+    ctrl_request_t req = {
+        .op = CTRL_OP_MODEM_CONTROL,
+        .arg.modem = { .dtr = dtr, .rts = rts },
+    };
+    esp_err_t ret = ctrl_submit(ch, &req);
     if (ret == ESP_OK) {
-        ESP_LOGD(TAG, "Modem control set: DTR=%d, RTS=%d", dtr, rts);
+        ch->current_dtr = dtr;
+        ch->current_rts = rts;
     }
-
-    RELEASE_DEVICE_MUTEX();
     return ret;
 }
 
-esp_err_t serial_control_get_modem_status(serial_modem_status_t *status)
+esp_err_t serial_control_get_modem_status(int channel, serial_modem_status_t *status)
 {
     if (status == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    ACQUIRE_DEVICE_MUTEX();
-    CHECK_DEVICE_CONNECTED();
+    unsigned bits = atomic_load(&channel_get(channel)->modem_status);
+    if ((bits & STATUS_VALID) == 0) {
+        memset(status, 0, sizeof(serial_modem_status_t));
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    status->cts = (bits & STATUS_CTS) != 0;
+    status->dsr = (bits & STATUS_DSR) != 0;
+    status->ri = (bits & STATUS_RI) != 0;
+    status->cd = (bits & STATUS_CD) != 0;
+    return ESP_OK;
+}
 
-    esp_err_t ret = ESP_OK;
-    memset(status, 0, sizeof(serial_modem_status_t));
+void serial_control_report_status(int channel, const serial_modem_status_t *status, uint8_t line_errors)
+{
+    serial_channel_t *ch = channel_get(channel);
+    if (status != NULL) {
+        unsigned bits = STATUS_VALID;
+        if (status->cts) bits |= STATUS_CTS;
+        if (status->dsr) bits |= STATUS_DSR;
+        if (status->ri)  bits |= STATUS_RI;
+        if (status->cd)  bits |= STATUS_CD;
+        atomic_store(&ch->modem_status, bits);
+    }
+    if (line_errors != 0) {
+        atomic_fetch_or(&ch->line_errors, line_errors);
+    }
 
-    if (current_device->type == DEVICE_TYPE_FTDI) {
-        ftdi_modem_status_t ftdi_status;
-        ret = ftdi_sio_host_get_modem_status(current_device->handle.ftdi_hdl, &ftdi_status);
-        if (ret == ESP_OK) {
-            status->cts = ftdi_status.cts;
-            status->dsr = ftdi_status.dsr;
-            status->ri = ftdi_status.ri;
-            status->cd = ftdi_status.rlsd;
-        }
-    } else if (current_device->type == DEVICE_TYPE_CDC) {
-        // CDC-ACM doesn't support reading modem status
-        // Return default values (all off)
-        ret = ESP_ERR_NOT_SUPPORTED;
-    } else {
-        ret = ESP_ERR_NOT_SUPPORTED;
+    serial_status_cb_t cb = atomic_load(&s_status_cb);
+    if (cb != NULL) {
+        cb();
     }
+}
 
-    RELEASE_DEVICE_MUTEX();
-    return ret;
+void serial_control_clear_status(int channel)
+{
+    serial_channel_t *ch = channel_get(channel);
+    atomic_store(&ch->modem_status, 0);
+    atomic_store(&ch->line_errors, 0);
 }
 
-esp_err_t serial_control_set_break(bool on)
+uint8_t serial_control_take_line_errors(int channel)
 {
-    ACQUIRE_DEVICE_MUTEX();
-    CHECK_DEVICE_CONNECTED();
+    return (uint8_t)atomic_exchange(&channel_get(channel)->line_errors, 0);
+}
 
-    esp_err_t ret = ESP_OK;
+void serial_control_set_status_callback(serial_status_cb_t cb)
+{
+    atomic_store(&s_status_cb, cb);
+}
 
-    if (current_device->type == DEVICE_TYPE_CDC) {
-        // CDC-ACM break control via send_break
-        if (on) {
-            ret = cdc_acm_host_send_break(current_device->handle.cdc_hdl, 100);
-        }
-        // Note: CDC break is time-limited, can't be turned off explicitly
-    } else if (current_device->type == DEVICE_TYPE_FTDI) {
-        // FTDI break control
-        // Note: FTDI driver may not expose break control directly
-        // This is a placeholder - actual implementation depends on driver support
-        ESP_LOGW(TAG, "Break control not fully supported on FTDI");
-        ret = ESP_ERR_NOT_SUPPORTED;
-    } else {
-        ret = ESP_ERR_NOT_SUPPORTED;
+uint8_t serial_control_auto_latency(uint32_t baudrate, serial_profile_t profile)
+{
+    if (profile == SERIAL_PROFILE_INTERACTIVE || baudrate == 0) {
+        return 1;
+    }
+    // Time for one packet of payload to arrive (10 bits per byte)
+    uint32_t fill_ms = (FTDI_PACKET_PAYLOAD * 10 * 1000 + baudrate - 1) / baudrate;
+    if (fill_ms < AUTO_LATENCY_BULK_MIN) {
+        return AUTO_LATENCY_BULK_MIN;
+    }
+    if (fill_ms > AUTO_LATENCY_BULK_MAX) {
+        return AUTO_LATENCY_BULK_MAX;
     }
+    return (uint8_t)fill_ms;
+}
 
-    RELEASE_DEVICE_MUTEX();
-    return ret;
+esp_err_t serial_control_set_latency(int channel, uint8_t latency_ms)
+{
+    serial_channel_t *ch = channel_get(channel);
+    ch->latency_setting = latency_ms;
+    return queue_latency(ch, false);
+}
+
+uint8_t serial_control_get_latency(int channel, bool *is_auto)
+{
+    const serial_channel_t *ch = channel_get(channel);
+    if (is_auto != NULL) {
+        *is_auto = (ch->latency_setting == SERIAL_LATENCY_AUTO);
+    }
+    return effective_latency(ch);
+}
+
+void serial_control_set_profile(int channel, serial_profile_t profile)
+{
+    serial_channel_t *ch = channel_get(channel);
+    ch->profile = profile;
+    queue_latency(ch, false);
 }
 
-esp_err_t serial_control_transmit(const uint8_t *data, size_t len, uint32_t timeout_ms)
+esp_err_t serial_control_set_in_xfer_size(int channel, size_t size)
 {
-    if (data == NULL || len == 0) {
+    if (size < SERIAL_XFER_SIZE_MIN || size > SERIAL_XFER_SIZE_MAX) {
         return ESP_ERR_INVALID_ARG;
     }
+    channel_get(channel)->in_xfer_size = size;
+    return ESP_OK;
+}
 
-    ACQUIRE_DEVICE_MUTEX();
-    CHECK_DEVICE_CONNECTED();
+size_t serial_control_get_in_xfer_size(int channel)
+{
+    return channel_get(channel)->in_xfer_size;
+}
 
-    esp_err_t ret = ESP_OK;
-    int retry_count = 0;
+esp_err_t serial_control_set_flow_control(int channel, serial_flow_control_t flow)
+{
+    if (flow != SERIAL_FLOW_NONE && flow != SERIAL_FLOW_RTS_CTS && flow != SERIAL_FLOW_XON_XOFF) {
+        return ESP_ERR_INVALID_ARG;
+    }
 
-    if (current_device->type == DEVICE_TYPE_CDC) {
-        do {
-            ret = cdc_acm_host_data_tx_blocking(current_device->handle.cdc_hdl,
-                                                data, len, timeout_ms);
-            if (ret == ESP_ERR_NOT_FINISHED) {
-                retry_count++;
-                RELEASE_DEVICE_MUTEX();
-                vTaskDelay(pdMS_TO_TICKS(CONFIG_SERIAL_CTRL_RETRY_INTERVAL_MS));
-                ACQUIRE_DEVICE_MUTEX();
-                CHECK_DEVICE_CONNECTED();
-            }
-        } while (ret == ESP_ERR_NOT_FINISHED && retry_count < CONFIG_SERIAL_CTRL_RETRY_COUNT);
-    } else if (current_device->type == DEVICE_TYPE_FTDI) {
-        do {
-            ret = ftdi_sio_host_data_tx_blocking(current_device->handle.ftdi_hdl,
-                                                  data, len, timeout_ms);
-            if (ret == ESP_ERR_NOT_FINISHED) {
-                retry_count++;
-                RELEASE_DEVICE_MUTEX();
-                vTaskDelay(pdMS_TO_TICKS(CONFIG_SERIAL_CTRL_RETRY_INTERVAL_MS));
-                ACQUIRE_DEVICE_MUTEX();
-                CHECK_DEVICE_CONNECTED();
-            }
-        } while (ret == ESP_ERR_NOT_FINISHED && retry_count < CONFIG_SERIAL_CTRL_RETRY_COUNT);
-    } else {
-        ret = ESP_ERR_NOT_SUPPORTED;
+    serial_channel_t *ch = channel_get(channel);
+    const device_snapshot_t *dev = atomic_load(&ch->device);
+    if (dev != NULL && dev->type != SERIAL_DEVICE_FTDI) {
+        // CDC-ACM has no flow control request; only "none" is accurate
+        return flow == SERIAL_FLOW_NONE ? ESP_OK : ESP_ERR_NOT_SUPPORTED;
+    }
+
+    ch->flow_control = flow;
+    if (dev == NULL) {
+        return ESP_OK;
     }
+    ctrl_request_t req = {
+        .op = CTRL_OP_FLOW,
+        .arg.flow = flow,
+    };
+    return ctrl_submit(ch, &req);
+}
+
+serial_flow_control_t serial_control_get_flow_control(int channel)
+{
+    return channel_get(channel)->flow_control;
+}
 
-    RELEASE_DEVICE_MUTEX();
+esp_err_t serial_control_apply_tuning(int channel)
+{
+    serial_channel_t *ch = channel_get(channel);
+    esp_err_t ret = queue_latency(ch, true);
+    if (ret == ESP_ERR_NOT_SUPPORTED) {
+        return ESP_OK;
+    }
+    if (ret == ESP_OK && ch->flow_control != SERIAL_FLOW_NONE) {
+        // The chip comes up without a handshake
+        ctrl_request_t req = {
+            .op = CTRL_OP_FLOW,
+            .arg.flow = ch->flow_control,
+        };
+        ret = ctrl_submit(ch, &req);
+    }
     return ret;
 }
+
+esp_err_t serial_control_set_break(int channel, bool on)
+{
+    serial_channel_t *ch = channel_get(channel);
+    const device_snapshot_t *dev = atomic_load(&ch->device);
+    if (dev != NULL && dev->type == SERIAL_DEVICE_FTDI) {
+        // The FTDI driver does not expose break control
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    ctrl_request_t req = {
+        .op = CTRL_OP_BREAK,
+        .arg.on = on,
+    };
+    return ctrl_submit(ch, &req);
+}
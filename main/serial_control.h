@@ -6,19 +6,40 @@
  *
  * Provides unified API for controlling serial port settings
  * on both CDC-ACM and FTDI USB-serial devices.
+ *
+ * The open device is published as an atomic snapshot, so the connection
+ * check takes no lock. Control requests (line coding, DTR/RTS, break) are
+ * queued in order to a worker task that owns all control transfers and
+ * their retries; callers never wait for the device. Data is written by
+ * the bridge's TCP → USB tasks, which never wait behind a control request.
+ *
+ * Every bridge channel has its own device, settings and worker, so a
+ * device that is slow to answer only delays requests for its own channel.
  */
 
 #ifndef SERIAL_CONTROL_H
 #define SERIAL_CONTROL_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include <stdbool.h>
 #include "esp_err.h"
+#include "sdkconfig.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// ============================================================================
+// Channels
+// ============================================================================
+
+#ifdef CONFIG_USB_CHANNEL_COUNT
+#define SERIAL_CONTROL_CHANNELS     CONFIG_USB_CHANNEL_COUNT
+#else
+#define SERIAL_CONTROL_CHANNELS     1
+#endif
+
 // ============================================================================
 // Line coding structure (compatible with CDC-ACM)
 // ============================================================================
@@ -30,6 +51,39 @@ typedef struct {
     uint8_t stop_bits;      // Stop bits: 0=1, 1=1.5, 2=2
 } serial_line_coding_t;
 
+// ============================================================================
+// Device
+// ============================================================================
+
+typedef enum {
+    SERIAL_DEVICE_NONE = 0,
+    SERIAL_DEVICE_CDC,      // handle is a cdc_acm_dev_hdl_t
+    SERIAL_DEVICE_FTDI      // handle is a ftdi_sio_dev_hdl_t
+} serial_device_type_t;
+
+// ============================================================================
+// FTDI tuning
+// ============================================================================
+
+#define SERIAL_LATENCY_AUTO         0       // Latency timer follows baud rate and profile
+#define SERIAL_XFER_SIZE_MIN        512
+#define SERIAL_XFER_SIZE_MAX        16384
+
+typedef enum {
+    SERIAL_PROFILE_INTERACTIVE = 0,         // Small packets, lowest latency
+    SERIAL_PROFILE_BULK                     // Throughput, fewer USB transfers
+} serial_profile_t;
+
+// ============================================================================
+// Flow control
+// ============================================================================
+
+typedef enum {
+    SERIAL_FLOW_NONE = 0,                   // No handshake
+    SERIAL_FLOW_RTS_CTS,                    // Hardware handshake on RTS/CTS
+    SERIAL_FLOW_XON_XOFF                    // Software handshake (DC1/DC3)
+} serial_flow_control_t;
+
 // ============================================================================
 // Modem status structure
 // ============================================================================
@@ -41,106 +95,348 @@ typedef struct {
     bool cd;                // Carrier Detect (RLSD)
 } serial_modem_status_t;
 
+// ============================================================================
+// Line status events
+// ============================================================================
+
+#define SERIAL_LINE_OVERRUN     0x01    // Receive overrun
+#define SERIAL_LINE_PARITY      0x02    // Parity error
+#define SERIAL_LINE_FRAMING     0x04    // Framing error
+#define SERIAL_LINE_BREAK       0x08    // Break received
+
+/**
+ * @brief Called after the modem or line status changed
+ *
+ * Also called by the control worker when it has finished every queued
+ * request. Runs in the USB driver's callback context or the worker and
+ * must not block.
+ */
+typedef void (*serial_status_cb_t)(void);
+
 // ============================================================================
 // Function prototypes
 // ============================================================================
 
+/**
+ * @brief Start the control worker tasks (one per channel)
+ * @return ESP_OK on success, ESP_ERR_NO_MEM on allocation failure
+ */
+esp_err_t serial_control_init(void);
+
+/**
+ * @brief Publish a newly opened device
+ *
+ * Called by the device handler once the device is open. Requests queued
+ * for a previous device are discarded by the worker.
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
+ * @param type Device type
+ * @param handle Driver handle of the open device
+ */
+void serial_control_attach(int channel, serial_device_type_t type, void *handle);
+
+/**
+ * @brief Withdraw the device before its driver handle is closed
+ *
+ * Safe to call from the USB driver's event callback. New control
+ * requests fail with ESP_ERR_INVALID_STATE afterwards. Returns once every
+ * task that holds the device (serial_control_acquire(), the control
+ * worker) has finished its driver call, so the handle can be closed.
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
+ */
+void serial_control_detach(int channel);
+
+/**
+ * @brief Take the device handle for data transfers
+ *
+ * serial_control_detach() waits until the device is released, so the
+ * handle stays open until then. Hold it only around driver calls with a
+ * timeout, and give up waiting for the device once
+ * serial_control_is_connected() turns false.
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
+ * @param[out] type Device type
+ * @param[out] handle Driver handle
+ * @return true if a device was taken (release with serial_control_release())
+ */
+bool serial_control_acquire(int channel, serial_device_type_t *type, void **handle);
+
+/**
+ * @brief Release a device taken with serial_control_acquire()
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
+ */
+void serial_control_release(int channel);
+
 /**
  * @brief Check if a serial device is currently connected
+ *
+ * Lock-free; safe to call from any task.
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
  * @return true if device is connected and ready
  */
-bool serial_control_is_connected(void);
+bool serial_control_is_connected(int channel);
+
+/**
+ * @brief Check if the control worker has applied every queued request
+ *
+ * Lock-free; safe to call from any task. Writers that must not overtake
+ * a setting (e.g. data after a baud rate change) wait for this; the
+ * status callback runs when it becomes true.
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
+ * @return true if no control request is queued or in progress
+ */
+bool serial_control_is_idle(int channel);
 
 /**
  * @brief Set serial line coding (baudrate, data bits, parity, stop bits)
+ *
+ * Queued to the control worker; errors from the device are logged there.
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
  * @param coding Pointer to line coding structure
- * @return ESP_OK on success
+ * @return ESP_OK when queued, ESP_ERR_INVALID_STATE without a device,
+ *         ESP_ERR_NO_MEM when the control queue is full
  */
-esp_err_t serial_control_set_line_coding(const serial_line_coding_t *coding);
+esp_err_t serial_control_set_line_coding(int channel, const serial_line_coding_t *coding);
 
 /**
  * @brief Get current serial line coding
+ *
+ * Returns the last requested settings without USB traffic.
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
  * @param coding Pointer to structure to receive current settings
  * @return ESP_OK on success
  */
-esp_err_t serial_control_get_line_coding(serial_line_coding_t *coding);
+esp_err_t serial_control_get_line_coding(int channel, serial_line_coding_t *coding);
 
 /**
  * @brief Set baudrate only
+ *
+ * Queued to the control worker like serial_control_set_line_coding().
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
  * @param baudrate Baudrate in bps
- * @return ESP_OK on success
+ * @return ESP_OK when queued
  */
-esp_err_t serial_control_set_baudrate(uint32_t baudrate);
+esp_err_t serial_control_set_baudrate(int channel, uint32_t baudrate);
 
 /**
  * @brief Get current baudrate
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
  * @param baudrate Pointer to receive current baudrate
  * @return ESP_OK on success
  */
-esp_err_t serial_control_get_baudrate(uint32_t *baudrate);
+esp_err_t serial_control_get_baudrate(int channel, uint32_t *baudrate);
 
 /**
  * @brief Set DTR (Data Terminal Ready) signal
+ *
+ * Queued to the control worker with the current RTS state. Requests are
+ * applied in order, so reset sequences keep their shape.
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
  * @param state true=ON, false=OFF
- * @return ESP_OK on success
+ * @return ESP_OK when queued
  */
-esp_err_t serial_control_set_dtr(bool state);
+esp_err_t serial_control_set_dtr(int channel, bool state);
 
 /**
  * @brief Get current DTR state
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
  * @param state Pointer to receive current state
  * @return ESP_OK on success
  */
-esp_err_t serial_control_get_dtr(bool *state);
+esp_err_t serial_control_get_dtr(int channel, bool *state);
 
 /**
  * @brief Set RTS (Request To Send) signal
+ *
+ * Queued to the control worker with the current DTR state.
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
  * @param state true=ON, false=OFF
- * @return ESP_OK on success
+ * @return ESP_OK when queued
  */
-esp_err_t serial_control_set_rts(bool state);
+esp_err_t serial_control_set_rts(int channel, bool state);
 
 /**
  * @brief Get current RTS state
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
  * @param state Pointer to receive current state
  * @return ESP_OK on success
  */
-esp_err_t serial_control_get_rts(bool *state);
+esp_err_t serial_control_get_rts(int channel, bool *state);
 
 /**
  * @brief Set both DTR and RTS signals
+ *
+ * Queued to the control worker.
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
  * @param dtr DTR state
  * @param rts RTS state
- * @return ESP_OK on success
+ * @return ESP_OK when queued
  */
-esp_err_t serial_control_set_modem_control(bool dtr, bool rts);
+esp_err_t serial_control_set_modem_control(int channel, bool dtr, bool rts);
 
 /**
  * @brief Get modem status (CTS, DSR, RI, CD)
  *
- * Note: This is only supported on FTDI devices.
- * On CDC-ACM devices, this will return all signals as false.
+ * Returns the last status reported by the device driver, without locking
+ * or USB traffic. FTDI devices report with every IN transfer; CDC-ACM
+ * devices only send SERIAL_STATE when something changes, and have no CTS.
  *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
  * @param status Pointer to structure to receive modem status
- * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED if device doesn't support
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED if no status has been
+ *         reported for the current device
  */
-esp_err_t serial_control_get_modem_status(serial_modem_status_t *status);
+esp_err_t serial_control_get_modem_status(int channel, serial_modem_status_t *status);
 
 /**
- * @brief Send break signal
- * @param on true to start break, false to stop
- * @return ESP_OK on success
+ * @brief Record a status report from the device driver
+ *
+ * Called from the USB driver callbacks. Stores the modem status, adds the
+ * line errors to the pending set and calls the status callback.
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
+ * @param status Modem status (NULL to keep the previous one)
+ * @param line_errors SERIAL_LINE_* bits seen in this report
  */
-esp_err_t serial_control_set_break(bool on);
+void serial_control_report_status(int channel, const serial_modem_status_t *status, uint8_t line_errors);
 
 /**
- * @brief Transmit data
- * @param data Data buffer
- * @param len Data length
- * @param timeout_ms Timeout in milliseconds
- * @return ESP_OK on success
+ * @brief Forget the status of a device that went away
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
+ */
+void serial_control_clear_status(int channel);
+
+/**
+ * @brief Take the line errors reported since the previous call
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
+ * @return SERIAL_LINE_* bits (0 = none)
+ */
+uint8_t serial_control_take_line_errors(int channel);
+
+/**
+ * @brief Register the status change callback
+ *
+ * @param cb Callback (NULL to remove)
+ */
+void serial_control_set_status_callback(serial_status_cb_t cb);
+
+/**
+ * @brief Latency timer chosen for a baud rate and traffic profile
+ *
+ * Interactive traffic uses 1 ms. Bulk traffic waits about as long as one
+ * 62-byte packet takes to arrive at the baud rate, between 2 and 16 ms.
+ *
+ * @param baudrate Baud rate in bps
+ * @param profile Traffic profile
+ * @return Latency timer in ms
+ */
+uint8_t serial_control_auto_latency(uint32_t baudrate, serial_profile_t profile);
+
+/**
+ * @brief Set the FTDI latency timer
+ *
+ * Kept across devices and applied to every FTDI device opened on the channel;
+ * queued to the control worker when one is connected now.
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
+ * @param latency_ms SERIAL_LATENCY_AUTO or 1-255 ms
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED while a CDC-ACM device
+ *         is connected (the setting is still kept)
+ */
+esp_err_t serial_control_set_latency(int channel, uint8_t latency_ms);
+
+/**
+ * @brief Get the FTDI latency timer in effect
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
+ * @param[out] is_auto Set to true when chosen automatically (may be NULL)
+ * @return Latency timer in ms
+ */
+uint8_t serial_control_get_latency(int channel, bool *is_auto);
+
+/**
+ * @brief Set the traffic profile used by the automatic latency timer
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
+ * @param profile Traffic profile
+ */
+void serial_control_set_profile(int channel, serial_profile_t profile);
+
+/**
+ * @brief Set the FTDI bulk IN transfer size
+ *
+ * Transfers are allocated when the device is opened, so this takes effect
+ * at the next FTDI device connection.
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
+ * @param size SERIAL_XFER_SIZE_MIN to SERIAL_XFER_SIZE_MAX bytes
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG when out of range
+ */
+esp_err_t serial_control_set_in_xfer_size(int channel, size_t size);
+
+/**
+ * @brief Get the FTDI bulk IN transfer size used for the next open
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
+ * @return Transfer size in bytes
+ */
+size_t serial_control_get_in_xfer_size(int channel);
+
+/**
+ * @brief Set the flow control of the serial port
+ *
+ * Kept across devices and applied again to the next device. The USB
+ * serial chip does the handshake; while the target holds off, writes
+ * back up into the TCP → USB path and from there into TCP flow control.
+ * Queued to the control worker.
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
+ * @param flow Flow control mode
+ * @return ESP_OK when queued (or stored with no device connected),
+ *         ESP_ERR_NOT_SUPPORTED on CDC-ACM devices (the class has no
+ *         flow control request), ESP_ERR_INVALID_ARG for an unknown mode
+ */
+esp_err_t serial_control_set_flow_control(int channel, serial_flow_control_t flow);
+
+/**
+ * @brief Get the flow control setting
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
+ * @return Flow control mode
+ */
+serial_flow_control_t serial_control_get_flow_control(int channel);
+
+/**
+ * @brief Apply the tuning settings to a newly attached FTDI device
+ *
+ * Called by the device handler after serial_control_attach(). Covers the
+ * latency timer and the flow control setting.
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
+ * @return ESP_OK when queued (or nothing to do for CDC-ACM devices)
+ */
+esp_err_t serial_control_apply_tuning(int channel);
+
+/**
+ * @brief Send break signal
+ *
+ * Queued to the control worker.
+ *
+ * @param channel Channel (0 to SERIAL_CONTROL_CHANNELS - 1)
+ * @param on true to start break, false to stop
+ * @return ESP_OK when queued, ESP_ERR_NOT_SUPPORTED on FTDI devices
  */
-esp_err_t serial_control_transmit(const uint8_t *data, size_t len, uint32_t timeout_ms);
+esp_err_t serial_control_set_break(int channel, bool on);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,336 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Pattern filter for the raw data port
+ */
+
+#include "stream_filter.h"
+
+#include <string.h>
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+// Length of the line piece starting at in: up to and including '\n'
+static inline size_t line_piece(const uint8_t *in, size_t len, bool *ends_line)
+{
+    const uint8_t *nl = memchr(in, '\n', len);
+    *ends_line = nl != NULL;
+    return nl != NULL ? (size_t)(nl - in) + 1 : len;
+}
+
+/**
+ * @brief Build the automaton from the patterns
+ *
+ * The patterns form a trie; a breadth-first pass then sets each state's
+ * failure link (the longest proper suffix that is also a trie state) and
+ * fills every missing transition from it, which turns the trie into a
+ * complete DFA. A state accepts if it or any state on its failure chain
+ * ends a pattern.
+ */
+static esp_err_t compile(stream_filter_t *sf)
+{
+    memset(sf->classes, 0, sizeof(sf->classes));
+    memset(sf->accept, 0, sizeof(sf->accept));
+    memset(sf->next, 0, sizeof(sf->next));
+    sf->class_count = 1;
+    sf->node_count = 1;
+
+    for (int p = 0; p < sf->pattern_count; p++) {
+        int s = 0;
+        for (const uint8_t *b = (const uint8_t *)sf->patterns[p]; *b != '\0'; b++) {
+            if (sf->classes[*b] == 0) {
+                if (sf->class_count == STREAM_FILTER_MAX_CLASSES) {
+                    return ESP_ERR_NO_MEM;
+                }
+                sf->classes[*b] = (uint8_t)sf->class_count++;
+            }
+            uint8_t *child = &sf->next[s][sf->classes[*b]];
+            if (*child == 0) {
+                if (sf->node_count == STREAM_FILTER_MAX_NODES) {
+                    return ESP_ERR_NO_MEM;
+                }
+                *child = (uint8_t)sf->node_count++;
+            }
+            s = *child;
+        }
+        sf->accept[s] = true;
+    }
+
+    // Children of the root fail to the root; missing root transitions
+    // already loop back to it
+    uint8_t fail[STREAM_FILTER_MAX_NODES];
+    uint8_t queue[STREAM_FILTER_MAX_NODES];
+    int head = 0;
+    int tail = 0;
+    for (int c = 1; c < sf->class_count; c++) {
+        uint8_t v = sf->next[0][c];
+        if (v != 0) {
+            fail[v] = 0;
+            queue[tail++] = v;
+        }
+    }
+
+    // Shallower states come first, so the failure state's row is complete
+    while (head < tail) {
+        uint8_t u = queue[head++];
+        sf->accept[u] |= sf->accept[fail[u]];
+        for (int c = 0; c < sf->class_count; c++) {
+            uint8_t v = sf->next[u][c];
+            if (v != 0) {
+                fail[v] = sf->next[fail[u]][c];
+                queue[tail++] = v;
+            } else {
+                sf->next[u][c] = sf->next[fail[u]][c];
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+void stream_filter_init(stream_filter_t *sf)
+{
+    memset(sf, 0, sizeof(*sf));
+    compile(sf);
+}
+
+esp_err_t stream_filter_add(stream_filter_t *sf, const char *pattern)
+{
+    size_t len = strlen(pattern);
+    if (len == 0 || len > STREAM_FILTER_PATTERN_MAX || memchr(pattern, '\n', len) != NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (sf->pattern_count == STREAM_FILTER_MAX_PATTERNS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    memcpy(sf->patterns[sf->pattern_count++], pattern, len + 1);
+    esp_err_t err = compile(sf);
+    if (err != ESP_OK) {
+        // The previous set fitted, so it compiles again
+        sf->pattern_count--;
+        compile(sf);
+        return err;
+    }
+    sf->generation++;
+    return ESP_OK;
+}
+
+void stream_filter_clear(stream_filter_t *sf)
+{
+    sf->pattern_count = 0;
+    sf->mode = STREAM_FILTER_OFF;
+    compile(sf);
+    sf->generation++;
+}
+
+void stream_filter_set_mode(stream_filter_t *sf, stream_filter_mode_t mode,
+                            size_t pre_context, size_t post_context)
+{
+    sf->mode = mode;
+    sf->pre_context = pre_context;
+    sf->post_context = post_context;
+    sf->generation++;
+}
+
+size_t stream_filter_scan(const stream_filter_t *sf, uint8_t *state, const uint8_t *in, size_t len)
+{
+    unsigned s = *state;
+    for (size_t i = 0; i < len; i++) {
+        s = sf->next[s][sf->classes[in[i]]];
+        if (sf->accept[s]) {
+            *state = (uint8_t)s;
+            return i + 1;
+        }
+    }
+    *state = (uint8_t)s;
+    return len;
+}
+
+void stream_filter_stream_init(stream_filter_stream_t *st, const stream_filter_t *sf)
+{
+    st->matches = 0;
+    st->in_bytes = 0;
+    st->out_bytes = 0;
+    stream_filter_stream_reset(st, sf);
+}
+
+void stream_filter_stream_reset(stream_filter_stream_t *st, const stream_filter_t *sf)
+{
+    st->generation = sf->generation;
+    st->state = 0;
+    st->line_start = true;
+    st->matched = false;
+    st->cut = false;
+    st->ready = false;
+    st->line_len = 0;
+    st->line_sent = 0;
+    st->passing = false;
+    st->pass_left = 0;
+    st->overrun = 0;
+}
+
+size_t stream_filter_lines(stream_filter_stream_t *st, const stream_filter_t *sf,
+                           const uint8_t *in, size_t len, int64_t time_us)
+{
+    if (st->generation != sf->generation) {
+        stream_filter_stream_reset(st, sf);
+    }
+    if (st->ready) {
+        st->ready = false;
+        st->line_len = 0;
+        st->line_sent = 0;
+    }
+
+    size_t i = 0;
+    while (i < len) {
+        if (st->line_start) {
+            st->line_start = false;
+            st->line_time_us = time_us;
+        }
+
+        bool ends_line;
+        size_t n = line_piece(in + i, len - i, &ends_line);
+        if (!st->matched) {
+            stream_filter_scan(sf, &st->state, in + i, n);
+            st->matched = sf->accept[st->state];
+        }
+
+        // One byte stays free for the newline of a cut line
+        size_t room = STREAM_FILTER_LINE_MAX - 1 - st->line_len;
+        size_t keep = n < room ? n : room;
+        memcpy(st->line + st->line_len, in + i, keep);
+        st->line_len += keep;
+        st->cut |= keep < n;
+        i += n;
+
+        if (ends_line) {
+            bool pass = st->matched;
+            if (pass) {
+                if (st->cut) {
+                    st->line[st->line_len++] = '\n';
+                }
+                st->ready = true;
+                st->matches++;
+                st->out_bytes += st->line_len;
+            } else {
+                st->line_len = 0;
+            }
+            st->state = 0;
+            st->matched = false;
+            st->cut = false;
+            st->line_start = true;
+            if (pass) {
+                break;
+            }
+        }
+    }
+
+    st->in_bytes += i;
+    return i;
+}
+
+void stream_filter_trigger(stream_filter_stream_t *st, const stream_filter_t *sf,
+                           const uint8_t *in, size_t len, stream_filter_span_t *span)
+{
+    if (st->generation != sf->generation) {
+        stream_filter_stream_reset(st, sf);
+    }
+    if (st->ready) {
+        st->ready = false;
+        st->line_len = 0;
+        st->line_sent = 0;
+    }
+    span->triggered = false;
+
+    // Idle: drop line pieces until one matches, holding the start of the
+    // current line
+    size_t i = 0;
+    while (!st->passing && i < len) {
+        bool ends_line;
+        size_t n = line_piece(in + i, len - i, &ends_line);
+        uint8_t piece_state = st->state;
+        size_t m = stream_filter_scan(sf, &st->state, in + i, n);
+        if (sf->accept[st->state]) {
+            // The piece is scanned again below, which sets the post-context;
+            // until its match it is within the dump
+            st->state = piece_state;
+            st->passing = true;
+            st->pass_left = m;
+            st->overrun = 0;
+            st->matches++;
+            st->ready = st->line_len > 0 && !st->cut;
+            st->out_bytes += st->ready ? st->line_len : 0;
+            span->triggered = true;
+            break;
+        }
+
+        if (ends_line) {
+            st->state = 0;
+            st->line_len = 0;
+            st->cut = false;
+        } else {
+            size_t room = STREAM_FILTER_LINE_MAX - st->line_len;
+            size_t keep = n < room ? n : room;
+            memcpy(st->line + st->line_len, in + i, keep);
+            st->line_len += keep;
+            st->cut |= keep < n;
+        }
+        i += n;
+    }
+    span->skip = i;
+
+    // Passing: every match restarts the post-context. After it, the dump
+    // runs to the end of the line, but at most STREAM_FILTER_LINE_MAX bytes.
+    while (st->passing && i < len) {
+        bool ends_line;
+        size_t n = line_piece(in + i, len - i, &ends_line);
+
+        for (size_t off = 0; off < n;) {
+            size_t budget = st->pass_left + STREAM_FILTER_LINE_MAX - st->overrun;
+            size_t seg = n - off < budget ? n - off : budget;
+            size_t k = stream_filter_scan(sf, &st->state, in + i + off, seg);
+            off += k;
+            if (k <= st->pass_left) {
+                st->pass_left -= k;
+            } else {
+                st->overrun += k - st->pass_left;
+                st->pass_left = 0;
+            }
+            if (sf->accept[st->state] && sf->post_context >= st->pass_left) {
+                st->pass_left = sf->post_context;
+                st->overrun = 0;
+            }
+            if (st->overrun == STREAM_FILTER_LINE_MAX) {
+                // No line end in sight after the post-context: end the dump here
+                n = off;
+                ends_line = true;
+            }
+        }
+        i += n;
+
+        if (ends_line) {
+            st->state = 0;
+            if (st->pass_left == 0) {
+                // A held line start that begins this dump stays until the
+                // next call, like a LINES line
+                st->passing = false;
+                st->overrun = 0;
+                if (!st->ready) {
+                    st->line_len = 0;
+                }
+                st->cut = false;
+            }
+        }
+    }
+    span->pass = i - span->skip;
+
+    st->in_bytes += i;
+    st->out_bytes += span->pass;
+}
@@ -0,0 +1,227 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Pattern filter for the raw data port
+ *
+ * A small set of literal patterns is compiled into one Aho-Corasick
+ * automaton, stored as a complete transition table over byte classes
+ * (each byte that occurs in a pattern gets its own class, every other
+ * byte shares class 0). Matching is one table lookup per byte for any
+ * number of patterns, with no backtracking. Patterns match within a line:
+ * the automaton restarts at every '\n', and lines are found with memchr()
+ * over whole spans.
+ *
+ * Two modes:
+ *
+ * LINES passes only complete lines that contain a pattern. The current
+ * line is held in the stream state until its '\n' arrives; a longer line
+ * is still matched in full but passed cut to STREAM_FILTER_LINE_MAX - 1
+ * bytes plus its newline.
+ *
+ * TRIGGER drops everything until a pattern matches, then passes the
+ * stream from the matching line until post_context bytes after the last
+ * match, up to the end of that line (at most STREAM_FILTER_LINE_MAX
+ * further bytes). Matches while passing extend the dump. When the
+ * matching line began in an earlier call, its start is held in the stream
+ * state like a LINES line. Context before the line is up to the caller,
+ * which can send it from its history (pre_context).
+ *
+ * The compiled filter is shared by all streams; each stream has its own
+ * small state. No allocator or RTOS dependencies. Single-threaded.
+ */
+
+#ifndef STREAM_FILTER_H
+#define STREAM_FILTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Limits
+// ============================================================================
+
+#define STREAM_FILTER_MAX_PATTERNS      8
+#define STREAM_FILTER_PATTERN_MAX       48      // Longest pattern in bytes (fits one control command)
+#define STREAM_FILTER_MAX_NODES         128     // Automaton states: total pattern bytes plus one
+#define STREAM_FILTER_MAX_CLASSES       48      // Distinct pattern bytes plus one
+#define STREAM_FILTER_LINE_MAX          256     // Longest line passed whole (LINES)
+
+typedef enum {
+    STREAM_FILTER_OFF = 0,      // Pass everything
+    STREAM_FILTER_LINES,        // Pass only lines that contain a pattern
+    STREAM_FILTER_TRIGGER,      // Pass a context dump around each match
+} stream_filter_mode_t;
+
+// ============================================================================
+// Compiled Filter
+// ============================================================================
+
+typedef struct {
+    stream_filter_mode_t mode;
+    size_t pre_context;         // TRIGGER: bytes before the matching line (sent by the caller)
+    size_t post_context;        // TRIGGER: bytes passed after the last match
+    uint32_t generation;        // Changes whenever patterns or mode change
+
+    int pattern_count;
+    char patterns[STREAM_FILTER_MAX_PATTERNS][STREAM_FILTER_PATTERN_MAX + 1];
+
+    int node_count;
+    int class_count;
+    uint8_t classes[256];                                       // Byte → class
+    bool accept[STREAM_FILTER_MAX_NODES];                       // A pattern ends in this state
+    uint8_t next[STREAM_FILTER_MAX_NODES][STREAM_FILTER_MAX_CLASSES];  // Transitions
+} stream_filter_t;
+
+// ============================================================================
+// Stream State
+// ============================================================================
+
+typedef struct {
+    uint32_t generation;        // Filter generation the state belongs to
+    uint8_t state;              // Automaton state within the current line
+
+    // LINES (and the start of the matching line for TRIGGER)
+    bool line_start;            // The next byte starts a line
+    bool matched;               // The current line contains a pattern
+    bool cut;                   // The current line did not fit into line
+    bool ready;                 // line holds a passed line: send line[line_sent..line_len)
+    size_t line_len;
+    size_t line_sent;           // Advanced by the caller
+    int64_t line_time_us;       // Arrival time of the first byte of the line
+    uint8_t line[STREAM_FILTER_LINE_MAX];
+
+    // TRIGGER
+    bool passing;               // A dump is in progress
+    size_t pass_left;           // Bytes until the post-context has passed
+    size_t overrun;             // Bytes passed after it while waiting for the line end
+
+    uint64_t matches;           // Lines passed (LINES) or dumps started (TRIGGER)
+    uint64_t in_bytes;          // Total input
+    uint64_t out_bytes;         // Total passed
+} stream_filter_stream_t;
+
+// Result of one stream_filter_trigger() call: skip bytes, then pass bytes
+typedef struct {
+    size_t skip;                // Leading bytes dropped
+    size_t pass;                // Bytes after them to pass
+    bool triggered;             // A new dump starts after skip (st->ready: with the held line start)
+} stream_filter_span_t;
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+/**
+ * @brief Initialize an empty filter (no patterns, OFF)
+ *
+ * @param sf Filter
+ */
+void stream_filter_init(stream_filter_t *sf);
+
+/**
+ * @brief Add a pattern and recompile the automaton
+ *
+ * @param sf Filter
+ * @param pattern Literal pattern (1 to STREAM_FILTER_PATTERN_MAX bytes, no '\n')
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for an empty or bad
+ *         pattern, ESP_ERR_NO_MEM when the pattern set or the automaton is full
+ *         (the previous patterns stay in effect)
+ */
+esp_err_t stream_filter_add(stream_filter_t *sf, const char *pattern);
+
+/**
+ * @brief Remove every pattern and turn the filter off
+ *
+ * @param sf Filter
+ */
+void stream_filter_clear(stream_filter_t *sf);
+
+/**
+ * @brief Select the mode
+ *
+ * @param sf Filter
+ * @param mode Mode
+ * @param pre_context TRIGGER: bytes wanted before the matching line
+ * @param post_context TRIGGER: bytes passed after the last match
+ */
+void stream_filter_set_mode(stream_filter_t *sf, stream_filter_mode_t mode,
+                            size_t pre_context, size_t post_context);
+
+/**
+ * @brief Run the automaton until the first match
+ *
+ * @param sf Filter
+ * @param[in,out] state Automaton state (0 at the start of a line)
+ * @param in Input data (within one line)
+ * @param len Input length in bytes
+ * @return Bytes scanned: up to and including the end of the first match,
+ *         else len. The input matched if sf->accept[*state] is set.
+ */
+size_t stream_filter_scan(const stream_filter_t *sf, uint8_t *state, const uint8_t *in, size_t len);
+
+/**
+ * @brief Start a stream, clearing its counters
+ *
+ * @param st Stream state
+ * @param sf Filter
+ */
+void stream_filter_stream_init(stream_filter_stream_t *st, const stream_filter_t *sf);
+
+/**
+ * @brief Restart a stream after a gap in its data
+ *
+ * The data that follows is taken as the start of a line. A held line and
+ * a dump in progress are dropped; counters are kept.
+ * Streams restart by themselves when the filter changes.
+ *
+ * @param st Stream state
+ * @param sf Filter
+ */
+void stream_filter_stream_reset(stream_filter_stream_t *st, const stream_filter_t *sf);
+
+/**
+ * @brief Filter data in LINES mode
+ *
+ * Stops after the first line that passes, with st->ready set; the caller
+ * sends it in full before calling again.
+ *
+ * @param st Stream state
+ * @param sf Filter
+ * @param in Input data
+ * @param len Input length in bytes
+ * @param time_us Arrival time of every byte of in (kept for the line)
+ * @return Input bytes consumed
+ */
+size_t stream_filter_lines(stream_filter_stream_t *st, const stream_filter_t *sf,
+                           const uint8_t *in, size_t len, int64_t time_us);
+
+/**
+ * @brief Filter data in TRIGGER mode
+ *
+ * Consumes span->skip + span->pass bytes. The caller calls again with the
+ * rest of the input. When a dump starts and st->ready is set, the start
+ * of the matching line from earlier calls (if it fit into line) precedes
+ * the passed bytes; a caller that sends pre-context up to the passed bytes
+ * already covers it.
+ *
+ * @param st Stream state
+ * @param sf Filter
+ * @param in Input data
+ * @param len Input length in bytes
+ * @param[out] span What to do with the start of in
+ */
+void stream_filter_trigger(stream_filter_stream_t *st, const stream_filter_t *sf,
+                           const uint8_t *in, size_t len, stream_filter_span_t *span);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STREAM_FILTER_H
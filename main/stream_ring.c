@@ -0,0 +1,120 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Lock-free single-producer / single-consumer byte ring
+ */
+
+#include <string.h>
+#include "stream_ring.h"
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static inline size_t min_size(size_t a, size_t b)
+{
+    return a < b ? a : b;
+}
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+esp_err_t stream_ring_init(stream_ring_t *ring, uint8_t *buffer, size_t size)
+{
+    if (ring == NULL || buffer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // Indices are free-running and masked, so size must be a power of two
+    if (size == 0 || (size & (size - 1)) != 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    ring->buffer = buffer;
+    ring->size = size;
+    ring->mask = size - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return ESP_OK;
+}
+
+void stream_ring_reset(stream_ring_t *ring)
+{
+    atomic_store(&ring->head, 0);
+    atomic_store(&ring->tail, 0);
+}
+
+size_t stream_ring_used(stream_ring_t *ring)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return head - tail;
+}
+
+size_t stream_ring_free(stream_ring_t *ring)
+{
+    return ring->size - stream_ring_used(ring);
+}
+
+size_t stream_ring_write(stream_ring_t *ring, const uint8_t *data, size_t len)
+{
+    // Only the producer modifies head, so a relaxed load is sufficient.
+    // tail needs acquire so the consumer has finished reading freed bytes.
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    size_t n = min_size(len, ring->size - (head - tail));
+    if (n == 0) {
+        return 0;
+    }
+
+    // Copy in at most two pieces (up to end of storage, then from start)
+    size_t offset = head & ring->mask;
+    size_t first = min_size(n, ring->size - offset);
+    memcpy(ring->buffer + offset, data, first);
+    if (n > first) {
+        memcpy(ring->buffer, data + first, n - first);
+    }
+
+    // Publish the new bytes to the consumer
+    atomic_store_explicit(&ring->head, head + n, memory_order_release);
+    return n;
+}
+
+size_t stream_ring_peek(stream_ring_t *ring, const uint8_t **data)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    size_t used = head - tail;
+    size_t offset = tail & ring->mask;
+    *data = ring->buffer + offset;
+    return min_size(used, ring->size - offset);
+}
+
+void stream_ring_consume(stream_ring_t *ring, size_t len)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + len, memory_order_release);
+}
+
+size_t stream_ring_head(stream_ring_t *ring)
+{
+    return atomic_load_explicit(&ring->head, memory_order_acquire);
+}
+
+size_t stream_ring_peek_from(stream_ring_t *ring, size_t pos, const uint8_t **data)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    size_t avail = head - pos;
+    size_t offset = pos & ring->mask;
+    *data = ring->buffer + offset;
+    return min_size(avail, ring->size - offset);
+}
+
+void stream_ring_consume_to(stream_ring_t *ring, size_t pos)
+{
+    atomic_store_explicit(&ring->tail, pos, memory_order_release);
+}
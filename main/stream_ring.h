@@ -0,0 +1,146 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Lock-free single-producer / single-consumer byte ring
+ *
+ * The producer (USB IN callback) and the consumer (USB→TCP bridge task)
+ * each own one free-running index, so no lock is needed on either side.
+ * The storage is caller-provided, which lets the application place it in
+ * PSRAM and keeps this module free of allocator and RTOS dependencies.
+ */
+
+#ifndef STREAM_RING_H
+#define STREAM_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Ring State
+// ============================================================================
+
+typedef struct {
+    uint8_t *buffer;            // Backing storage (size bytes)
+    size_t size;                // Capacity in bytes (power of two)
+    size_t mask;                // size - 1
+    atomic_size_t head;         // Total bytes written (owned by producer)
+    atomic_size_t tail;         // Total bytes consumed (owned by consumer)
+} stream_ring_t;
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+/**
+ * @brief Initialize a ring over caller-provided storage
+ *
+ * @param ring Ring to initialize
+ * @param buffer Backing storage, must stay valid for the lifetime of the ring
+ * @param size Size of storage in bytes, must be a power of two
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG / ESP_ERR_INVALID_SIZE on bad input
+ */
+esp_err_t stream_ring_init(stream_ring_t *ring, uint8_t *buffer, size_t size);
+
+/**
+ * @brief Discard all buffered data
+ *
+ * Only safe while neither producer nor consumer is running.
+ *
+ * @param ring Ring to reset
+ */
+void stream_ring_reset(stream_ring_t *ring);
+
+/**
+ * @brief Number of bytes available to the consumer
+ *
+ * @param ring Ring
+ * @return Buffered byte count
+ */
+size_t stream_ring_used(stream_ring_t *ring);
+
+/**
+ * @brief Number of bytes the producer can write without overwriting
+ *
+ * @param ring Ring
+ * @return Free byte count
+ */
+size_t stream_ring_free(stream_ring_t *ring);
+
+/**
+ * @brief Copy data into the ring (producer side)
+ *
+ * Writes as much as fits and publishes it to the consumer in one step.
+ *
+ * @param ring Ring
+ * @param data Data to write
+ * @param len Length of data in bytes
+ * @return Number of bytes actually written (may be less than len when full)
+ */
+size_t stream_ring_write(stream_ring_t *ring, const uint8_t *data, size_t len);
+
+/**
+ * @brief Get the largest contiguous readable span (consumer side)
+ *
+ * The span stays valid until stream_ring_consume() is called. When the
+ * buffered data wraps around the end of storage, only the part up to the
+ * end is returned; the next call returns the remainder.
+ *
+ * @param ring Ring
+ * @param[out] data Pointer to the start of the span
+ * @return Length of the span in bytes (0 when empty)
+ */
+size_t stream_ring_peek(stream_ring_t *ring, const uint8_t **data);
+
+/**
+ * @brief Release bytes previously returned by stream_ring_peek() (consumer side)
+ *
+ * @param ring Ring
+ * @param len Number of bytes to release
+ */
+void stream_ring_consume(stream_ring_t *ring, size_t len);
+
+/**
+ * @brief Current write position (consumer side)
+ *
+ * Positions are free-running byte counts, so data between the read
+ * position and this value is readable with stream_ring_peek_from().
+ *
+ * @param ring Ring
+ * @return Total bytes written so far
+ */
+size_t stream_ring_head(stream_ring_t *ring);
+
+/**
+ * @brief Get the contiguous readable span starting at an absolute position
+ *
+ * Lets one consumer keep several cursors into the unreleased data, e.g.
+ * when senders flush at different times. pos must lie between the current
+ * read position and stream_ring_head().
+ *
+ * @param ring Ring
+ * @param pos Absolute position to read from
+ * @param[out] data Pointer to the start of the span
+ * @return Length of the span in bytes (0 when pos has caught up with head)
+ */
+size_t stream_ring_peek_from(stream_ring_t *ring, size_t pos, const uint8_t **data);
+
+/**
+ * @brief Release all bytes before an absolute position (consumer side)
+ *
+ * @param ring Ring
+ * @param pos New read position, not past stream_ring_head()
+ */
+void stream_ring_consume_to(stream_ring_t *ring, size_t pos);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STREAM_RING_H
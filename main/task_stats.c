@@ -0,0 +1,262 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Per-task CPU load from FreeRTOS run time statistics
+ */
+
+#include "task_stats.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "task_stats";
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+
+#define TASK_STATS_LOG_STACK        3072
+#define TASK_STATS_LOG_PRIORITY     1
+#define TASK_STATS_LOG_BUFFER_SIZE  1536
+
+// ============================================================================
+// State
+// ============================================================================
+
+typedef struct {
+    TaskHandle_t handle;
+    uint32_t run_time;          // Run time counter at the previous sample
+} task_stats_prev_t;
+
+typedef struct {
+    SemaphoreHandle_t mutex;
+    TaskStatus_t status[TASK_STATS_MAX_TASKS];  // Scratch for uxTaskGetSystemState()
+    task_stats_prev_t prev[TASK_STATS_MAX_TASKS];
+    size_t prev_count;
+    uint32_t prev_total;        // Total run time at the previous sample
+} task_stats_state_t;
+
+static task_stats_state_t s_stats;
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static uint32_t prev_run_time(TaskHandle_t handle)
+{
+    for (size_t i = 0; i < s_stats.prev_count; i++) {
+        if (s_stats.prev[i].handle == handle) {
+            return s_stats.prev[i].run_time;
+        }
+    }
+    return 0;   // Created since the previous sample
+}
+
+static int status_core(const TaskStatus_t *status)
+{
+#if CONFIG_FREERTOS_VTASKLIST_INCLUDE_COREID
+    if (status->xCoreID >= 0 && status->xCoreID < portNUM_PROCESSORS) {
+        return (int)status->xCoreID;
+    }
+#endif
+    return -1;
+}
+
+/**
+ * @brief Take a system snapshot and turn it into deltas (mutex held)
+ */
+static esp_err_t sample_locked(task_stats_t *stats)
+{
+    uint32_t total = 0;
+    UBaseType_t count = uxTaskGetSystemState(s_stats.status, TASK_STATS_MAX_TASKS, &total);
+    if (count == 0) {
+        ESP_LOGW(TAG, "More than %d tasks, cannot sample", TASK_STATS_MAX_TASKS);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Counters are 32-bit esp_timer microseconds; unsigned deltas survive wrap-around
+    uint32_t elapsed = total - s_stats.prev_total;
+
+    if (stats != NULL) {
+        memset(stats, 0, sizeof(*stats));
+        stats->interval_ms = elapsed / 1000;
+
+        for (UBaseType_t i = 0; i < count; i++) {
+            const TaskStatus_t *st = &s_stats.status[i];
+            uint32_t used = st->ulRunTimeCounter - prev_run_time(st->xHandle);
+            uint32_t permille = elapsed > 0 ? (uint32_t)((uint64_t)used * 1000 / elapsed) : 0;
+            if (permille > 1000) {
+                permille = 1000;
+            }
+
+            task_stats_task_t entry = {
+                .core = status_core(st),
+                .priority = st->uxCurrentPriority,
+                .load_permille = permille,
+                .stack_free = (uint32_t)st->usStackHighWaterMark,
+            };
+            strncpy(entry.name, st->pcTaskName, sizeof(entry.name) - 1);
+
+            // Idle tasks give the per-core load
+            if (strncmp(entry.name, "IDLE", 4) == 0 && entry.core >= 0) {
+                stats->core_load_permille[entry.core] = 1000 - permille;
+            }
+
+            // Insertion sort, highest load first
+            size_t pos = stats->count;
+            while (pos > 0 && stats->tasks[pos - 1].load_permille < permille) {
+                stats->tasks[pos] = stats->tasks[pos - 1];
+                pos--;
+            }
+            stats->tasks[pos] = entry;
+            stats->count++;
+        }
+    }
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        s_stats.prev[i].handle = s_stats.status[i].xHandle;
+        s_stats.prev[i].run_time = s_stats.status[i].ulRunTimeCounter;
+    }
+    s_stats.prev_count = count;
+    s_stats.prev_total = total;
+    return ESP_OK;
+}
+
+#if CONFIG_TASK_STATS_LOG_INTERVAL_S > 0
+static void task_stats_log_task(void *arg)
+{
+    static task_stats_t stats;
+    static char text[TASK_STATS_LOG_BUFFER_SIZE];
+
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_TASK_STATS_LOG_INTERVAL_S * 1000));
+
+        if (task_stats_sample(&stats) != ESP_OK) {
+            continue;
+        }
+        task_stats_format(&stats, text, sizeof(text));
+
+        // One log line per table row
+        char *save = NULL;
+        for (char *line = strtok_r(text, "\n", &save); line != NULL;
+             line = strtok_r(NULL, "\n", &save)) {
+            ESP_LOGI(TAG, "%s", line);
+        }
+    }
+}
+#endif
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+esp_err_t task_stats_init(void)
+{
+    if (s_stats.mutex != NULL) {
+        return ESP_OK;
+    }
+    s_stats.mutex = xSemaphoreCreateMutex();
+    if (s_stats.mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Baseline so the first sample covers the time since init
+    xSemaphoreTake(s_stats.mutex, portMAX_DELAY);
+    sample_locked(NULL);
+    xSemaphoreGive(s_stats.mutex);
+
+#if CONFIG_TASK_STATS_LOG_INTERVAL_S > 0
+    BaseType_t ret = xTaskCreate(task_stats_log_task, "task_stats", TASK_STATS_LOG_STACK,
+                                 NULL, TASK_STATS_LOG_PRIORITY, NULL);
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create log task");
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Logging task load every %d s", CONFIG_TASK_STATS_LOG_INTERVAL_S);
+#endif
+    return ESP_OK;
+}
+
+esp_err_t task_stats_sample(task_stats_t *stats)
+{
+    if (s_stats.mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_stats.mutex, portMAX_DELAY);
+    esp_err_t ret = sample_locked(stats);
+    xSemaphoreGive(s_stats.mutex);
+    return ret;
+}
+
+#else // Run time statistics disabled
+
+esp_err_t task_stats_init(void)
+{
+    ESP_LOGW(TAG, "FreeRTOS run time statistics disabled, task load unavailable");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t task_stats_sample(task_stats_t *stats)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif
+
+size_t task_stats_format(const task_stats_t *stats, char *buf, size_t size)
+{
+    if (size == 0) {
+        return 0;
+    }
+
+    int n = snprintf(buf, size, "INTERVAL %lu ms", (unsigned long)stats->interval_ms);
+    if (n < 0 || (size_t)n >= size) {
+        buf[0] = '\0';
+        return 0;
+    }
+    size_t len = n;
+
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        n = snprintf(buf + len, size - len, " CPU%d %lu.%lu%%", core,
+                     (unsigned long)(stats->core_load_permille[core] / 10),
+                     (unsigned long)(stats->core_load_permille[core] % 10));
+        if (n < 0 || (size_t)n >= size - len) {
+            buf[len] = '\0';
+            return len;
+        }
+        len += n;
+    }
+    n = snprintf(buf + len, size - len, "\n%-16s %4s %4s %6s %6s\n",
+                 "TASK", "CORE", "PRIO", "LOAD", "STACK");
+    if (n < 0 || (size_t)n >= size - len) {
+        buf[len] = '\0';
+        return len;
+    }
+    len += n;
+
+    for (size_t i = 0; i < stats->count; i++) {
+        const task_stats_task_t *t = &stats->tasks[i];
+        char core[4];
+        if (t->core >= 0) {
+            snprintf(core, sizeof(core), "%d", t->core);
+        } else {
+            strcpy(core, "*");
+        }
+
+        n = snprintf(buf + len, size - len, "%-16s %4s %4u %4lu.%lu %6lu\n",
+                     t->name, core, (unsigned)t->priority,
+                     (unsigned long)(t->load_permille / 10),
+                     (unsigned long)(t->load_permille % 10),
+                     (unsigned long)t->stack_free);
+        if (n < 0 || (size_t)n >= size - len) {
+            buf[len] = '\0';    // Drop the row that did not fit
+            break;
+        }
+        len += n;
+    }
+    return len;
+}
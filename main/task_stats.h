@@ -0,0 +1,94 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Per-task CPU load from FreeRTOS run time statistics
+ *
+ * Each sample reports what every task consumed since the previous sample,
+ * together with its core affinity, priority and stack headroom, so the
+ * task layout chosen in "Task Layout Configuration" can be verified on a
+ * running device. Requires CONFIG_FREERTOS_USE_TRACE_FACILITY and
+ * CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS.
+ */
+
+#ifndef TASK_STATS_H
+#define TASK_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Configuration
+// ============================================================================
+
+#define TASK_STATS_MAX_TASKS    32
+#define TASK_STATS_NAME_LEN     16
+
+// ============================================================================
+// Sample
+// ============================================================================
+
+typedef struct {
+    char name[TASK_STATS_NAME_LEN];
+    int core;                   // Pinned core, -1 = no affinity (or unknown)
+    UBaseType_t priority;       // Current priority
+    uint32_t load_permille;     // Share of one core over the interval (1000 = 100%)
+    uint32_t stack_free;        // Lowest free stack seen since creation (bytes)
+} task_stats_task_t;
+
+typedef struct {
+    task_stats_task_t tasks[TASK_STATS_MAX_TASKS];  // Sorted by load, highest first
+    size_t count;
+    uint32_t core_load_permille[portNUM_PROCESSORS]; // Busy share per core (1000 - idle task)
+    uint32_t interval_ms;       // Time covered by the sample
+} task_stats_t;
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+/**
+ * @brief Initialize statistics and take the baseline sample
+ *
+ * Starts the periodic log task when CONFIG_TASK_STATS_LOG_INTERVAL_S > 0.
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED without run time statistics,
+ *         ESP_ERR_NO_MEM on allocation failure
+ */
+esp_err_t task_stats_init(void);
+
+/**
+ * @brief Sample per-task load since the previous sample
+ *
+ * Safe to call from any task.
+ *
+ * @param[out] stats Sample
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE before task_stats_init(),
+ *         ESP_ERR_NOT_SUPPORTED without run time statistics
+ */
+esp_err_t task_stats_sample(task_stats_t *stats);
+
+/**
+ * @brief Format a sample as a text table
+ *
+ * One header line with the per-core load, then one line per task. Tasks
+ * that do not fit into the buffer are left out.
+ *
+ * @param stats Sample
+ * @param buf Output buffer
+ * @param size Size of buf in bytes
+ * @return Length of the text written (excluding the terminator)
+ */
+size_t task_stats_format(const task_stats_t *stats, char *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TASK_STATS_H
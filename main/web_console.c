@@ -0,0 +1,294 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Live serial console for the web UI
+ */
+
+#include "sdkconfig.h"
+
+#ifdef CONFIG_WEB_CONSOLE_ENABLE
+
+#include "web_console.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+
+static const char *TAG = "web_console";
+
+// One frame fits below the send low-water mark (TCP_SNDLOWAT, ~2.8 KB with
+// the default send buffer), so a socket that select() reports writable
+// takes it without blocking the HTTP server task
+#define WEB_CONSOLE_FRAME_SIZE      2048
+#define WEB_CONSOLE_FRAMES_PER_PASS 8       // Per viewer, so one fast viewer cannot starve the others
+#define WEB_CONSOLE_RX_MAX          64      // Viewers send nothing useful; larger frames close the session
+
+#ifndef CONFIG_WEB_CONSOLE_MAX_VIEWERS
+#define CONFIG_WEB_CONSOLE_MAX_VIEWERS  2
+#endif
+#ifndef CONFIG_WEB_CONSOLE_INTERVAL_MS
+#define CONFIG_WEB_CONSOLE_INTERVAL_MS  30
+#endif
+#ifndef CONFIG_WEB_CONSOLE_BACKLOG_KB
+#define CONFIG_WEB_CONSOLE_BACKLOG_KB   4
+#endif
+
+// ============================================================================
+// State
+// ============================================================================
+
+typedef struct {
+    int fd;                     // Session socket (-1 = free)
+    size_t pos;                 // Capture position of the next byte to send
+} web_console_viewer_t;
+
+typedef struct {
+    const capture_buffer_t *capture;
+    httpd_handle_t server;
+    esp_timer_handle_t timer;
+
+    // Owned by the HTTP server task (handler, feed work and close_fn)
+    web_console_viewer_t viewers[CONFIG_WEB_CONSOLE_MAX_VIEWERS];
+    int viewer_count;
+
+    // Timer → HTTP server task
+    atomic_bool feed_queued;            // Feed work is queued and has not started yet
+    atomic_bool viewers_behind;         // Last pass left data unsent
+    atomic_size_t fed_head;             // Published head the last pass caught up to
+} web_console_state_t;
+
+static web_console_state_t s_console = {
+    .viewers = { [0 ... CONFIG_WEB_CONSOLE_MAX_VIEWERS - 1] = { .fd = -1 } },
+};
+
+// Frame staging shared by all viewers; only the HTTP server task uses it
+static uint8_t s_frame[WEB_CONSOLE_FRAME_SIZE];
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static bool socket_writable(int fd)
+{
+    fd_set write_fds;
+    FD_ZERO(&write_fds);
+    FD_SET(fd, &write_fds);
+    struct timeval timeout = { 0 };
+    return select(fd + 1, NULL, &write_fds, NULL, &timeout) > 0;
+}
+
+static esp_err_t send_text(int fd, const char *text)
+{
+    httpd_ws_frame_t frame = {
+        .final = true,
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)text,
+        .len = strlen(text),
+    };
+    return httpd_ws_send_frame_async(s_console.server, fd, &frame);
+}
+
+static void viewer_remove(web_console_viewer_t *viewer)
+{
+    viewer->fd = -1;
+    if (--s_console.viewer_count == 0) {
+        esp_timer_stop(s_console.timer);
+    }
+}
+
+static void viewer_drop(web_console_viewer_t *viewer, esp_err_t err)
+{
+    ESP_LOGW(TAG, "Viewer on socket %d failed (%s), closing", viewer->fd, esp_err_to_name(err));
+    httpd_sess_trigger_close(s_console.server, viewer->fd);
+    viewer_remove(viewer);
+}
+
+// ============================================================================
+// Feed
+// ============================================================================
+
+/**
+ * @brief Send each viewer what its socket takes without blocking
+ * Runs in the HTTP server task
+ */
+static void feed_work(void *arg)
+{
+    (void)arg;
+    atomic_store(&s_console.feed_queued, false);
+
+    size_t head = capture_buffer_published(s_console.capture);
+    bool behind = false;
+
+    for (int i = 0; i < CONFIG_WEB_CONSOLE_MAX_VIEWERS; i++) {
+        web_console_viewer_t *viewer = &s_console.viewers[i];
+        if (viewer->fd < 0) {
+            continue;
+        }
+
+        for (int frames = 0; viewer->pos != head && frames < WEB_CONSOLE_FRAMES_PER_PASS; frames++) {
+            if (!socket_writable(viewer->fd)) {
+                break;          // Slow tab: try again on the next pass
+            }
+
+            size_t start = viewer->pos;
+            size_t len = capture_buffer_read(s_console.capture, &viewer->pos, s_frame, sizeof(s_frame));
+            size_t skipped = viewer->pos - start - len;
+            esp_err_t err = ESP_OK;
+            if (skipped > 0) {
+                char notice[48];
+                snprintf(notice, sizeof(notice), "%u bytes skipped", (unsigned)skipped);
+                err = send_text(viewer->fd, notice);
+            }
+            if (err == ESP_OK && len > 0) {
+                httpd_ws_frame_t frame = {
+                    .final = true,
+                    .type = HTTPD_WS_TYPE_BINARY,
+                    .payload = s_frame,
+                    .len = len,
+                };
+                err = httpd_ws_send_frame_async(s_console.server, viewer->fd, &frame);
+            }
+            if (err != ESP_OK) {
+                viewer_drop(viewer, err);
+                break;
+            }
+        }
+
+        if (viewer->fd >= 0 && viewer->pos != head) {
+            behind = true;
+        }
+    }
+
+    atomic_store(&s_console.fed_head, head);
+    atomic_store(&s_console.viewers_behind, behind);
+}
+
+/**
+ * @brief Periodic check for new data, runs in the esp_timer task
+ */
+static void feed_timer_callback(void *arg)
+{
+    (void)arg;
+    if (!atomic_load(&s_console.viewers_behind) &&
+        capture_buffer_published(s_console.capture) == atomic_load(&s_console.fed_head)) {
+        return;
+    }
+    if (atomic_exchange(&s_console.feed_queued, true)) {
+        return;
+    }
+    if (httpd_queue_work(s_console.server, feed_work, NULL) != ESP_OK) {
+        atomic_store(&s_console.feed_queued, false);
+    }
+}
+
+// ============================================================================
+// WebSocket Handler
+// ============================================================================
+
+/**
+ * @brief Handler for /ws/console
+ * The handshake adds a viewer; frames from the browser are read and ignored
+ */
+static esp_err_t handler_ws_console(httpd_req_t *req)
+{
+    int fd = httpd_req_to_sockfd(req);
+
+    if (req->method == HTTP_GET) {
+        web_console_viewer_t *viewer = NULL;
+        for (int i = 0; i < CONFIG_WEB_CONSOLE_MAX_VIEWERS && viewer == NULL; i++) {
+            if (s_console.viewers[i].fd < 0) {
+                viewer = &s_console.viewers[i];
+            }
+        }
+        if (viewer == NULL) {
+            ESP_LOGW(TAG, "Viewer limit reached, rejecting socket %d", fd);
+            send_text(fd, "too many viewers");
+            httpd_sess_trigger_close(req->handle, fd);
+            return ESP_OK;
+        }
+
+        // Start with the backlog (capture_buffer_read() clamps it to what is held)
+        size_t head = capture_buffer_published(s_console.capture);
+        size_t backlog = CONFIG_WEB_CONSOLE_BACKLOG_KB * 1024;
+        viewer->fd = fd;
+        viewer->pos = head - (head < backlog ? head : backlog);
+        if (s_console.viewer_count++ == 0) {
+            esp_timer_start_periodic(s_console.timer, CONFIG_WEB_CONSOLE_INTERVAL_MS * 1000);
+        }
+        atomic_store(&s_console.viewers_behind, true);
+        ESP_LOGI(TAG, "Viewer connected on socket %d (%d/%d)", fd, s_console.viewer_count,
+                 CONFIG_WEB_CONSOLE_MAX_VIEWERS);
+        return ESP_OK;
+    }
+
+    httpd_ws_frame_t frame = { 0 };
+    esp_err_t err = httpd_ws_recv_frame(req, &frame, 0);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (frame.len > WEB_CONSOLE_RX_MAX) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint8_t discard[WEB_CONSOLE_RX_MAX];
+    frame.payload = discard;
+    return frame.len > 0 ? httpd_ws_recv_frame(req, &frame, frame.len) : ESP_OK;
+}
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+esp_err_t web_console_init(const capture_buffer_t *capture)
+{
+    if (capture == NULL || capture->size == 0) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = feed_timer_callback,
+        .name = "web_console",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &s_console.timer);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    s_console.capture = capture;
+    ESP_LOGI(TAG, "Web console ready (%d viewers, %d KB backlog)", CONFIG_WEB_CONSOLE_MAX_VIEWERS,
+             CONFIG_WEB_CONSOLE_BACKLOG_KB);
+    return ESP_OK;
+}
+
+esp_err_t web_console_register(httpd_handle_t server)
+{
+    if (s_console.capture == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_console.server = server;
+    httpd_uri_t uri_ws_console = {
+        .uri = "/ws/console",
+        .method = HTTP_GET,
+        .handler = handler_ws_console,
+        .user_ctx = NULL,
+        .is_websocket = true,
+    };
+    return httpd_register_uri_handler(server, &uri_ws_console);
+}
+
+void web_console_session_closed(int sockfd)
+{
+    for (int i = 0; i < CONFIG_WEB_CONSOLE_MAX_VIEWERS; i++) {
+        if (s_console.viewers[i].fd == sockfd) {
+            ESP_LOGI(TAG, "Viewer on socket %d disconnected", sockfd);
+            viewer_remove(&s_console.viewers[i]);
+        }
+    }
+}
+
+#endif // CONFIG_WEB_CONSOLE_ENABLE
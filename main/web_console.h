@@ -0,0 +1,61 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Live serial console for the web UI
+ *
+ * Streams USB RX data to browsers over a WebSocket (/ws/console) on the
+ * OTA HTTP server. Each viewer is only a cursor into the shared capture
+ * buffer, so nothing is buffered per viewer: while viewers are connected a
+ * timer schedules a feed pass in the HTTP server task, and each pass sends
+ * a viewer what its socket takes without blocking, in binary frames. A
+ * viewer that falls behind by more than the capture buffer skips ahead and
+ * is sent a text frame saying how much it missed. The bridge never waits
+ * for a viewer.
+ */
+
+#ifndef WEB_CONSOLE_H
+#define WEB_CONSOLE_H
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include "capture_buffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initialize the console over a capture buffer
+ *
+ * Call before the HTTP server starts. The capture buffer is written by
+ * the network loop and only read through capture_buffer_read().
+ *
+ * @param capture Capture buffer of the channel to show
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED when capture is disabled,
+ *         ESP_ERR_NO_MEM on allocation failure
+ */
+esp_err_t web_console_init(const capture_buffer_t *capture);
+
+/**
+ * @brief Register the /ws/console endpoint on the HTTP server
+ *
+ * @param server Running HTTP server
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized
+ */
+esp_err_t web_console_register(httpd_handle_t server);
+
+/**
+ * @brief Forget the viewer on a closing HTTP session
+ *
+ * Call from the HTTP server's close_fn for every session.
+ *
+ * @param sockfd Socket of the session
+ */
+void web_console_session_closed(int sockfd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WEB_CONSOLE_H
@@ -0,0 +1,196 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Warm boot WiFi reconnect from a cached access point
+ */
+
+#include "wifi_fast_connect.h"
+
+#include <string.h>
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_wifi.h"
+#include "nvs.h"
+
+static const char *TAG = "fast_connect";
+
+#define NVS_NAMESPACE       "fast_connect"
+#define NVS_KEY             "ap"
+#define RECORD_VERSION      1
+
+typedef struct {
+    uint8_t version;
+    uint8_t channel;
+    uint8_t bssid[6];
+    uint8_t ssid[32];           // Cache is only valid for this SSID
+} fast_connect_record_t;
+
+static fast_connect_record_t s_record;     // Last stored record
+static bool s_record_valid = false;
+static bool s_applied = false;              // Cached AP in the station config
+static bool s_used = false;                 // Connected through the cached AP
+
+// ============================================================================
+// NVS
+// ============================================================================
+
+static esp_err_t record_load(void)
+{
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (ret != ESP_OK) {
+        return ret == ESP_ERR_NVS_NOT_FOUND ? ESP_ERR_NOT_FOUND : ret;
+    }
+
+    size_t len = sizeof(s_record);
+    ret = nvs_get_blob(nvs, NVS_KEY, &s_record, &len);
+    nvs_close(nvs);
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (len != sizeof(s_record) || s_record.version != RECORD_VERSION) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    s_record_valid = true;
+    return ESP_OK;
+}
+
+static void record_erase(void)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK) {
+        nvs_erase_key(nvs, NVS_KEY);
+        nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+    s_record_valid = false;
+}
+
+/**
+ * @brief Change the RAM copy of the station config only
+ *
+ * Storage goes back to flash right away, so configs set later (such as
+ * reprovisioned credentials) are persisted as usual.
+ */
+static esp_err_t set_config_ram(wifi_config_t *config)
+{
+    esp_err_t ret = esp_wifi_set_storage(WIFI_STORAGE_RAM);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = esp_wifi_set_config(WIFI_IF_STA, config);
+    esp_err_t restore = esp_wifi_set_storage(WIFI_STORAGE_FLASH);
+    return ret != ESP_OK ? ret : restore;
+}
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+esp_err_t wifi_fast_connect_apply(void)
+{
+    esp_err_t ret = record_load();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    wifi_config_t config;
+    ret = esp_wifi_get_config(WIFI_IF_STA, &config);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (memcmp(config.sta.ssid, s_record.ssid, sizeof(s_record.ssid)) != 0) {
+        ESP_LOGI(TAG, "Cached AP is for another SSID, scanning");
+        record_erase();
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Keep the flash copy as provisioned: the cached AP is a boot-time hint
+    memcpy(config.sta.bssid, s_record.bssid, sizeof(config.sta.bssid));
+    config.sta.bssid_set = true;
+    config.sta.channel = s_record.channel;
+    ret = set_config_ram(&config);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    s_applied = true;
+    ESP_LOGI(TAG, "Connecting to cached AP " MACSTR " on channel %u",
+             MAC2STR(s_record.bssid), s_record.channel);
+    return ESP_OK;
+}
+
+bool wifi_fast_connect_fallback(void)
+{
+    if (!s_applied) {
+        return false;
+    }
+    s_applied = false;
+
+    // Unlock the BSSID so reconnects can also roam to another AP
+    wifi_config_t config;
+    if (esp_wifi_get_config(WIFI_IF_STA, &config) == ESP_OK) {
+        config.sta.bssid_set = false;
+        config.sta.channel = 0;
+        set_config_ram(&config);
+    }
+    if (!s_used) {
+        record_erase();
+        ESP_LOGW(TAG, "Cached AP not reachable, falling back to a full scan");
+    }
+    return true;
+}
+
+esp_err_t wifi_fast_connect_save(void)
+{
+    if (s_applied) {
+        s_used = true;
+    }
+
+    wifi_ap_record_t ap;
+    esp_err_t ret = esp_wifi_sta_get_ap_info(&ap);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    fast_connect_record_t record = {
+        .version = RECORD_VERSION,
+        .channel = ap.primary,
+    };
+    memcpy(record.bssid, ap.bssid, sizeof(record.bssid));
+    memcpy(record.ssid, ap.ssid, sizeof(record.ssid));
+
+    if (s_record_valid && memcmp(&record, &s_record, sizeof(record)) == 0) {
+        return ESP_OK;
+    }
+
+    nvs_handle_t nvs;
+    ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = nvs_set_blob(nvs, NVS_KEY, &record, sizeof(record));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to store AP: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    s_record = record;
+    s_record_valid = true;
+    ESP_LOGI(TAG, "Stored AP " MACSTR " on channel %u for the next boot",
+             MAC2STR(record.bssid), record.channel);
+    return ESP_OK;
+}
+
+bool wifi_fast_connect_used(void)
+{
+    return s_used;
+}
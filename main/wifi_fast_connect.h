@@ -0,0 +1,76 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kenta Ida
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Warm boot WiFi reconnect from a cached access point
+ *
+ * After every successful connection the BSSID and channel of the access
+ * point are stored in NVS. On the next boot the station is pointed at that
+ * access point directly, so association starts with a single-channel probe
+ * instead of a full scan. If the cached access point cannot be joined the
+ * cache is dropped and the normal scan is used. The IP address is reused
+ * through lwIP's DHCP INIT-REBOOT (CONFIG_LWIP_DHCP_RESTORE_LAST_IP),
+ * which asks for the previous lease in one exchange instead of a full
+ * DHCP discovery.
+ */
+
+#ifndef WIFI_FAST_CONNECT_H
+#define WIFI_FAST_CONNECT_H
+
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+/**
+ * @brief Point the station at the cached access point
+ *
+ * Call after esp_wifi_set_mode() and before esp_wifi_start(). The cached
+ * BSSID and channel are applied to the RAM copy of the station config
+ * only, so the provisioned config in flash is never changed; config
+ * storage is back to flash when this returns.
+ *
+ * @return ESP_OK if the cache was applied, ESP_ERR_NOT_FOUND if there is
+ *         no cache for the provisioned SSID, or an NVS/WiFi error
+ */
+esp_err_t wifi_fast_connect_apply(void);
+
+/**
+ * @brief Handle a station disconnect
+ *
+ * If the station config is locked to the cached access point, unlocks it
+ * so the next attempt scans all channels. When that access point was
+ * never joined, the cache is also erased from NVS.
+ *
+ * @return true if the cache was dropped (the caller should reconnect
+ *         without counting a retry)
+ */
+bool wifi_fast_connect_fallback(void);
+
+/**
+ * @brief Store the current access point for the next boot
+ *
+ * Call once connected. NVS is only written when the access point changed.
+ *
+ * @return ESP_OK on success
+ */
+esp_err_t wifi_fast_connect_save(void);
+
+/**
+ * @brief Whether this boot connected through the cached access point
+ *
+ * @return true if the first connection used the cache
+ */
+bool wifi_fast_connect_used(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WIFI_FAST_CONNECT_H
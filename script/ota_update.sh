@@ -18,7 +18,7 @@ if [ "${DEBUG:-0}" = "1" ]; then
 fi
 
 # Script version
-SCRIPT_VERSION="1.0.2"
+SCRIPT_VERSION="1.1.0"
 
 # Color output
 RED='\033[0;31m'
@@ -31,6 +31,9 @@ NC='\033[0m' # No Color
 GITHUB_REPO="ciniml/serial_wifi_logger"
 GITHUB_API="https://api.github.com/repos/${GITHUB_REPO}"
 
+# Set when the device accepts gzip compressed images (from /api/info)
+DEVICE_ACCEPTS_GZIP=0
+
 # Temporary directory for downloads
 TMP_DIR="/tmp/ota_update_$$"
 
@@ -73,7 +76,9 @@ Examples:
   $0 serial-A02048.local
 
 Environment Variables:
-  GITHUB_TOKEN   Optional GitHub personal access token for private repos
+  GITHUB_TOKEN      Optional GitHub personal access token for private repos
+  OTA_UNCOMPRESSED  Set to 1 to upload the plain image even if the device
+                    accepts the gzip compressed one
 EOF
     exit 1
 }
@@ -208,6 +213,14 @@ download_firmware() {
     fi
 
     print_success "Extracted firmware: $(du -h "$firmware_bin" | cut -f1)" >&2
+
+    # Prefer the compressed image when the device can inflate it
+    local firmware_gz="$firmware_bin.gz"
+    if [ "$DEVICE_ACCEPTS_GZIP" = "1" ] && [ "${OTA_UNCOMPRESSED:-0}" != "1" ] && [ -f "$firmware_gz" ]; then
+        print_info "Using compressed image: $(du -h "$firmware_gz" | cut -f1)" >&2
+        echo "$firmware_gz"
+        return
+    fi
     echo "$firmware_bin"
 }
 
@@ -234,6 +247,10 @@ get_device_info() {
     local partition=$(echo "$response" | jq -r '.partition')
     local uptime=$(echo "$response" | jq -r '.uptime')
 
+    if echo "$response" | jq -e '(.ota_formats // []) | index("gzip")' &> /dev/null; then
+        DEVICE_ACCEPTS_GZIP=1
+    fi
+
     echo ""
     echo "════════════════════════════════════════"
     echo "  Device Information"
@@ -1,6 +1,8 @@
 #!/usr/bin/env python
 # Pack ESP32 firmware binary for burn with M5Burner
 
+import gzip
+import json
 import re
 import pathlib
 
@@ -38,4 +40,14 @@ with open('firmware.bin', 'wb') as f:
                 bytes_written = 0
                 while bytes_written < bytes_read:
                     bytes_written += f.write(data[bytes_written:])
-                current_address += bytes_read
\ No newline at end of file
+                current_address += bytes_read
+
+# Compressed application image for OTA, inflated by the device while it streams in
+with open('build/project_description.json') as f:
+    app_bin = pathlib.Path('build').joinpath(json.load(f)['app_bin'])
+app_gz = app_bin.name + '.gz'
+with open(app_bin, 'rb') as g:
+    app = g.read()
+with open(app_gz, 'wb') as f:
+    f.write(gzip.compress(app, compresslevel=9, mtime=0))
+print(f'{app_gz}: {len(app)} -> {pathlib.Path(app_gz).stat().st_size} bytes')
@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+"""
+Compressed data port client.
+
+Asks the logger to compress the next data port connection (COMPRESS LZ4 on
+the control port), connects to the data port and writes the decompressed
+serial stream to stdout or a file. Uses only the standard library.
+
+Usage:
+    python3 compressed_client.py <host> [--port 8888] [--control-port 8889] [--output FILE]
+
+Example:
+    python3 compressed_client.py serial-XXXXXX.local
+    python3 compressed_client.py 192.168.1.100 --output serial.log
+"""
+
+import argparse
+import socket
+import struct
+import sys
+
+STREAM_MAGIC = b"SLZ4"
+STREAM_VERSION = 1
+STREAM_HEADER_SIZE = 8
+FRAME_HEADER_SIZE = 4
+
+
+class StreamDecoder:
+    """Decoder for the SLZ4 stream: LZ4 blocks that may refer to earlier blocks."""
+
+    def __init__(self):
+        self.buffer = bytearray()
+        self.history = bytearray()
+        self.window = None
+        self.raw_bytes = 0
+        self.wire_bytes = 0
+
+    def feed(self, data: bytes) -> bytes:
+        """Add received bytes, return the data of all complete frames."""
+        self.buffer += data
+        self.wire_bytes += len(data)
+        out = bytearray()
+
+        if self.window is None:
+            if len(self.buffer) < STREAM_HEADER_SIZE:
+                return b""
+            magic, version, _, window = struct.unpack_from("<4sBBH", self.buffer)
+            if magic != STREAM_MAGIC or version != STREAM_VERSION:
+                raise ValueError("not a compressed stream (was COMPRESS LZ4 accepted?)")
+            self.window = window
+            del self.buffer[:STREAM_HEADER_SIZE]
+
+        while len(self.buffer) >= FRAME_HEADER_SIZE:
+            raw_len, block_len = struct.unpack_from("<HH", self.buffer)
+            if len(self.buffer) < FRAME_HEADER_SIZE + block_len:
+                break
+            block = bytes(self.buffer[FRAME_HEADER_SIZE:FRAME_HEADER_SIZE + block_len])
+            del self.buffer[:FRAME_HEADER_SIZE + block_len]
+            out += self._decode_block(block, raw_len)
+
+        self.raw_bytes += len(out)
+        return bytes(out)
+
+    def _decode_block(self, block: bytes, raw_len: int) -> bytes:
+        hist = self.history
+        start = len(hist)
+        i = 0
+        while i < len(block):
+            token = block[i]
+            i += 1
+
+            literal_len = token >> 4
+            if literal_len == 15:
+                while True:
+                    n = block[i]
+                    i += 1
+                    literal_len += n
+                    if n != 255:
+                        break
+            hist += block[i:i + literal_len]
+            i += literal_len
+            if i >= len(block):
+                break           # Last sequence has literals only
+
+            offset = block[i] | (block[i + 1] << 8)
+            i += 2
+            match_len = (token & 0x0F)
+            if match_len == 15:
+                while True:
+                    n = block[i]
+                    i += 1
+                    match_len += n
+                    if n != 255:
+                        break
+            match_len += 4
+
+            if offset == 0 or offset > len(hist):
+                raise ValueError("corrupt block: bad match offset")
+            pos = len(hist) - offset
+            for k in range(match_len):  # Matches may overlap their own output
+                hist.append(hist[pos + k])
+
+        data = bytes(hist[start:])
+        if len(data) != raw_len:
+            raise ValueError(f"corrupt block: {len(data)} bytes decoded, {raw_len} expected")
+        # Only the window is referenced by later blocks
+        if len(hist) > self.window:
+            del hist[:len(hist) - self.window]
+        return data
+
+
+def request_compression(host: str, control_port: int) -> None:
+    with socket.create_connection((host, control_port), timeout=5) as ctrl:
+        ctrl.sendall(b"COMPRESS LZ4\n")
+        reply = ctrl.recv(64).decode(errors="replace").strip()
+    if reply != "OK":
+        raise RuntimeError(f"COMPRESS LZ4 rejected: {reply}")
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Receive the compressed serial stream")
+    parser.add_argument("host", help="Logger hostname or IP address")
+    parser.add_argument("--port", type=int, default=8888, help="Data port (default: 8888)")
+    parser.add_argument("--control-port", type=int, default=8889, help="Control port (default: 8889)")
+    parser.add_argument("--output", "-o", help="Write to FILE instead of stdout")
+    args = parser.parse_args()
+
+    try:
+        request_compression(args.host, args.control_port)
+        sock = socket.create_connection((args.host, args.port), timeout=5)
+    except (OSError, RuntimeError) as e:
+        print(f"ERROR: {e}", file=sys.stderr)
+        return 1
+
+    out = open(args.output, "wb") if args.output else sys.stdout.buffer
+    decoder = StreamDecoder()
+    sock.settimeout(None)
+    try:
+        with sock:
+            while True:
+                data = sock.recv(65536)
+                if not data:
+                    break
+                out.write(decoder.feed(data))
+                out.flush()
+    except KeyboardInterrupt:
+        pass
+    except ValueError as e:
+        print(f"ERROR: {e}", file=sys.stderr)
+        return 1
+    finally:
+        if args.output:
+            out.close()
+
+    if decoder.wire_bytes > 0:
+        print(f"{decoder.raw_bytes} bytes received as {decoder.wire_bytes} bytes "
+              f"({decoder.raw_bytes / decoder.wire_bytes:.2f}x)", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""
+Timestamp framed data port client.
+
+Asks the logger to frame the next data port connection (FRAME BINARY on
+the control port), connects to the data port and prints every serial line
+with the time its first byte arrived at the logger's USB port. Times are
+converted to wall clock by anchoring the logger's boot clock in the stream
+header to the local time the header was received. Uses only the standard
+library.
+
+Usage:
+    python3 framed_client.py <host> [--port 8888] [--control-port 8889]
+                             [--boot-time] [--no-request] [--output FILE]
+
+Example:
+    python3 framed_client.py serial-XXXXXX.local
+    python3 framed_client.py 192.168.1.100 --output serial.log
+"""
+
+import argparse
+import datetime
+import socket
+import struct
+import sys
+import time
+
+STREAM_MAGIC = b"SLTS"
+STREAM_VERSION = 1
+STREAM_HEADER_SIZE = 16
+RECORD_HEADER_SIZE = 8
+LEN_MASK = 0x3FFF
+CONTINUED = 0x8000
+
+
+class RecordDecoder:
+    """Decoder for the SLTS stream: one timestamped record per line or line fragment."""
+
+    def __init__(self):
+        self.buffer = bytearray()
+        self.anchor_us = None   # Local wall clock minus logger boot clock
+        self.line = bytearray()
+        self.line_time_us = 0
+        self.lines = 0
+
+    def feed(self, data: bytes):
+        """Add received bytes, yield (time_us, line) for every complete line."""
+        self.buffer += data
+
+        if self.anchor_us is None:
+            if len(self.buffer) < STREAM_HEADER_SIZE:
+                return
+            magic, version, boot_us = struct.unpack_from("<4sB3xQ", self.buffer)
+            if magic != STREAM_MAGIC or version != STREAM_VERSION:
+                raise ValueError("not a framed stream (was FRAME BINARY accepted?)")
+            self.anchor_us = time.time_ns() // 1000 - boot_us
+            del self.buffer[:STREAM_HEADER_SIZE]
+
+        while len(self.buffer) >= RECORD_HEADER_SIZE:
+            len_flags, = struct.unpack_from("<H", self.buffer)
+            length = len_flags & LEN_MASK
+            if len(self.buffer) < RECORD_HEADER_SIZE + length:
+                break
+            stamp = int.from_bytes(self.buffer[2:RECORD_HEADER_SIZE], "little")
+            payload = bytes(self.buffer[RECORD_HEADER_SIZE:RECORD_HEADER_SIZE + length])
+            del self.buffer[:RECORD_HEADER_SIZE + length]
+
+            if not len_flags & CONTINUED:
+                if self.line:   # Previous line ended without a newline
+                    yield self.line_time_us, bytes(self.line)
+                    self.line.clear()
+                self.line_time_us = stamp
+                self.lines += 1
+            self.line += payload
+            if self.line.endswith(b"\n"):
+                yield self.line_time_us, bytes(self.line)
+                self.line.clear()
+
+
+def request_framing(host: str, control_port: int) -> None:
+    with socket.create_connection((host, control_port), timeout=5) as ctrl:
+        ctrl.sendall(b"FRAME BINARY\n")
+        reply = ctrl.recv(64).decode(errors="replace").strip()
+    if reply != "OK":
+        raise RuntimeError(f"FRAME BINARY rejected: {reply}")
+
+
+def format_time(decoder: RecordDecoder, time_us: int, boot_time: bool) -> str:
+    if boot_time:
+        return f"{time_us / 1e6:12.6f}"
+    local_us = decoder.anchor_us + time_us
+    stamp = datetime.datetime.fromtimestamp(local_us // 1_000_000)
+    return f"{stamp:%Y-%m-%d %H:%M:%S}.{local_us % 1_000_000:06d}"
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Receive the timestamp framed serial stream")
+    parser.add_argument("host", help="Logger hostname or IP address")
+    parser.add_argument("--port", type=int, default=8888, help="Data port (default: 8888)")
+    parser.add_argument("--control-port", type=int, default=8889, help="Control port (default: 8889)")
+    parser.add_argument("--boot-time", action="store_true",
+                        help="Print the logger's time since boot instead of wall clock")
+    parser.add_argument("--no-request", action="store_true",
+                        help="Do not send FRAME BINARY (the logger frames by default)")
+    parser.add_argument("--output", "-o", help="Write to FILE instead of stdout")
+    args = parser.parse_args()
+
+    try:
+        if not args.no_request:
+            request_framing(args.host, args.control_port)
+        sock = socket.create_connection((args.host, args.port), timeout=5)
+    except (OSError, RuntimeError) as e:
+        print(f"ERROR: {e}", file=sys.stderr)
+        return 1
+
+    out = open(args.output, "w", encoding="utf-8") if args.output else sys.stdout
+    decoder = RecordDecoder()
+    sock.settimeout(None)
+    try:
+        with sock:
+            while True:
+                data = sock.recv(65536)
+                if not data:
+                    break
+                for time_us, line in decoder.feed(data):
+                    text = line.decode(errors="replace").rstrip("\r\n")
+                    out.write(f"{format_time(decoder, time_us, args.boot_time)} {text}\n")
+                out.flush()
+    except KeyboardInterrupt:
+        pass
+    except ValueError as e:
+        print(f"ERROR: {e}", file=sys.stderr)
+        return 1
+    finally:
+        if args.output:
+            out.close()
+
+    print(f"{decoder.lines} lines received", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
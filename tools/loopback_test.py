@@ -1,21 +1,63 @@
 #!/usr/bin/env python3
 """
-RFC2217 loopback integrity test.
+RFC2217 loopback integrity and load test.
 
 Hardware setup: short TX and RX pins on the USB-UART device connected to the ESP32.
 
+Without load options this is the integrity test: all 256 byte values are sent
+`count` times through the RFC2217 port and must come back unchanged.
+
+With --sweep or --duration it becomes a load test. For each baud rate it runs
+the integrity test, measures idle round trip time with single probe frames,
+then keeps a paced stream of timestamped, CRC-checked frames going for
+--duration seconds and reports goodput in each direction, loss and latency
+percentiles. Optionally the raw data port is read and the control port is
+polled at the same time, so all three servers are under load together.
+Results can be written as JSON (--json) and two reports compared (--compare),
+e.g. a CDC-ACM bridge against an FTDI bridge.
+
+With --hold-off the load runs on one channel while another channel's device is held
+off: that channel is switched to XON/XOFF on its control port and an XOFF plus a burst
+of data is written to its RFC2217 port. On the TX-RX loopback the chip receives its own
+XOFF and stops sending, so the burst backs up into the bridge. The channel under load
+must keep streaming without loss or stalls (--max-stall-ms); afterwards flow control is
+switched off again and the burst must come back. The held channel needs an FTDI device.
+
 Usage:
     python3 loopback_test.py <ip> [--port 2217] [--baud 115200] [--count 4]
+    python3 loopback_test.py <ip> --sweep [BAUDS] [--duration 10] [--load 0.95]
+                             [--raw-port 8888] [--control-port 8889]
+                             [--label NAME] [--json FILE]
+    python3 loopback_test.py <ip> --port 2227 --duration 30 \
+                             --hold-off 2217 --hold-off-control 8889 [--max-stall-ms 1000]
+    python3 loopback_test.py --compare A.json B.json
 
 Example:
     python3 loopback_test.py 192.168.1.100
     python3 loopback_test.py 192.168.1.100 --baud 9600 --count 8
+    python3 loopback_test.py 192.168.1.100 --sweep 115200,921600,3000000 --duration 60 \\
+        --raw-port 8888 --control-port 8889 --label FT232R --json ft232r.json
 """
 
 import argparse
+import json
+import platform
+import socket
+import struct
 import sys
+import threading
+import time
+import zlib
 import serial
 
+DEFAULT_SWEEP = [9600, 115200, 460800, 921600, 1000000, 2000000, 3000000, 6000000, 12000000]
+
+# Frame: magic, seq, send time (ns, monotonic), payload length, payload, CRC32
+FRAME_MAGIC = b"\xA5\x5A"
+FRAME_HEADER = struct.Struct(">2sIQH")
+FRAME_CRC = struct.Struct(">I")
+FRAME_MAX_PAYLOAD = 4096
+
 
 def run_loopback_test(url: str, baud: int, count: int) -> bool:
     # Build test payload first so we can compute the read timeout.
@@ -71,9 +113,461 @@ def run_loopback_test(url: str, baud: int, count: int) -> bool:
     return True
 
 
+# ============================================================================
+# Frames
+# ============================================================================
+
+# Fixed pseudo-random pattern (includes 0xFF, so IAC escaping is exercised)
+_PATTERN = bytes((i * 167 + (i >> 8) * 13 + 0x5D) & 0xFF for i in range(65536 + FRAME_MAX_PAYLOAD))
+
+
+def build_frame(seq: int, payload_len: int) -> bytes:
+    offset = (seq * 257) % 65536
+    payload = _PATTERN[offset:offset + payload_len]
+    header = FRAME_HEADER.pack(FRAME_MAGIC, seq & 0xFFFFFFFF, time.monotonic_ns(), payload_len)
+    return header + payload + FRAME_CRC.pack(zlib.crc32(header + payload))
+
+
+class FrameReceiver:
+    """Reassembles frames from a byte stream and keeps the statistics."""
+
+    def __init__(self):
+        self.buffer = bytearray()
+        self.lock = threading.Lock()
+        self.frames = 0
+        self.payload_bytes = 0
+        self.crc_errors = 0
+        self.resync_bytes = 0
+        self.seen = set()
+        self.latencies_ms = []
+        self.first_ns = None
+        self.last_ns = None
+
+    def feed(self, data: bytes) -> list:
+        """Add received bytes, return the sequence numbers of complete frames."""
+        now = time.monotonic_ns()
+        seqs = []
+        with self.lock:
+            self.buffer += data
+            buf = self.buffer
+            while True:
+                start = buf.find(FRAME_MAGIC)
+                if start < 0:
+                    keep = 1 if buf.endswith(FRAME_MAGIC[:1]) else 0
+                    self.resync_bytes += len(buf) - keep
+                    del buf[:len(buf) - keep]
+                    break
+                if start > 0:
+                    self.resync_bytes += start
+                    del buf[:start]
+                if len(buf) < FRAME_HEADER.size:
+                    break
+                _, seq, sent_ns, length = FRAME_HEADER.unpack_from(buf)
+                if length > FRAME_MAX_PAYLOAD:
+                    self.crc_errors += 1
+                    del buf[:1]
+                    continue
+                total = FRAME_HEADER.size + length + FRAME_CRC.size
+                if len(buf) < total:
+                    break
+                (crc,) = FRAME_CRC.unpack_from(buf, FRAME_HEADER.size + length)
+                if crc != zlib.crc32(bytes(buf[:FRAME_HEADER.size + length])):
+                    self.crc_errors += 1
+                    del buf[:1]
+                    continue
+                del buf[:total]
+
+                if seq not in self.seen:
+                    self.seen.add(seq)
+                    self.frames += 1
+                    self.payload_bytes += length
+                    self.latencies_ms.append((now - sent_ns) / 1e6)
+                    if self.first_ns is None:
+                        self.first_ns = now
+                    self.last_ns = now
+                seqs.append(seq)
+        return seqs
+
+
+def percentiles(values: list) -> dict:
+    if not values:
+        return {"count": 0}
+    v = sorted(values)
+
+    def pick(q):
+        return round(v[min(len(v) - 1, int(q * len(v)))], 3)
+
+    return {"count": len(v), "min": round(v[0], 3), "p50": pick(0.50), "p90": pick(0.90),
+            "p99": pick(0.99), "max": round(v[-1], 3)}
+
+
+# ============================================================================
+# Load test
+# ============================================================================
+
+def measure_idle_rtt(port, count: int, payload_len: int = 16) -> dict:
+    """Send single probe frames and wait for each to come back."""
+    receiver = FrameReceiver()
+    lost = 0
+    for seq in range(count):
+        port.write(build_frame(seq, payload_len))
+        deadline = time.monotonic() + 2.0
+        while seq not in receiver.seen and time.monotonic() < deadline:
+            data = port.read(port.in_waiting or 1)
+            if data:
+                receiver.feed(data)
+        if seq not in receiver.seen:
+            lost += 1
+    result = percentiles(receiver.latencies_ms)
+    result["lost"] = lost
+    return result
+
+
+def stream_reader(source, receiver: FrameReceiver, stop: threading.Event, errors: list):
+    """Feed a serial port or socket into a FrameReceiver until stopped."""
+    try:
+        while not stop.is_set():
+            if isinstance(source, socket.socket):
+                try:
+                    data = source.recv(65536)
+                except socket.timeout:
+                    continue
+                if not data:
+                    errors.append("connection closed")
+                    break
+            else:
+                data = source.read(source.in_waiting or 1)
+            if data:
+                receiver.feed(data)
+    except Exception as e:
+        errors.append(str(e))
+
+
+def control_poller(host: str, port: int, interval: float, stop: threading.Event, result: dict):
+    """Send VERSION on the control port periodically and time the replies."""
+    times = []
+    failures = 0
+    try:
+        with socket.create_connection((host, port), timeout=5) as sock:
+            f = sock.makefile("rb")
+            while not stop.is_set():
+                start = time.monotonic_ns()
+                sock.sendall(b"VERSION\n")
+                line = f.readline()
+                if not line:
+                    failures += 1
+                    break
+                times.append((time.monotonic_ns() - start) / 1e6)
+                stop.wait(interval)
+    except OSError as e:
+        result["error"] = str(e)
+        failures += 1
+    result.update(percentiles(times))
+    result["failures"] = failures
+
+
+# Hold-off burst: no IAC, so it goes through RFC2217 unescaped
+HOLD_OFF_XOFF = b"\x13"
+HOLD_OFF_FILL = b"U"
+HOLD_OFF_BURST = 64 * 1024
+
+
+def control_command(host: str, port: int, command: str) -> str:
+    with socket.create_connection((host, port), timeout=5) as sock:
+        sock.sendall(command.encode() + b"\n")
+        return sock.makefile("rb").readline().decode(errors="replace").strip()
+
+
+class HoldOff:
+    """Keeps another channel's device held off while the load runs."""
+
+    def __init__(self, host: str, port: int, control_port: int):
+        self.host = host
+        self.control_port = control_port
+        self.echoed = 0
+        self.echoed_held = 0
+        self.error = None
+        self.stop = threading.Event()
+        reply = control_command(host, control_port, "FLOW XONXOFF")
+        if not reply.startswith("OK"):
+            raise RuntimeError(f"FLOW XONXOFF on port {control_port}: {reply}")
+        self.sock = socket.create_connection((host, port), timeout=0.2)
+        self.reader = threading.Thread(target=self._read, daemon=True)
+        # sendall() blocks once the bridge stops reading: that is the hold-off
+        self.writer = threading.Thread(target=self._write, daemon=True)
+        self.reader.start()
+        self.writer.start()
+
+    def _write(self):
+        try:
+            self.sock.sendall(HOLD_OFF_XOFF)
+            time.sleep(0.2)
+            self.sock.sendall(HOLD_OFF_FILL * HOLD_OFF_BURST)
+        except OSError as e:
+            self.error = str(e)
+
+    def _read(self):
+        # Telnet negotiation and NOTIFY messages are mixed in; count the fill bytes only
+        while not self.stop.is_set():
+            try:
+                data = self.sock.recv(65536)
+            except socket.timeout:
+                continue
+            except OSError as e:
+                self.error = str(e)
+                break
+            if not data:
+                break
+            self.echoed += data.count(HOLD_OFF_FILL)
+
+    def release(self) -> dict:
+        self.echoed_held = self.echoed
+        reply = control_command(self.host, self.control_port, "FLOW NONE")
+        self.writer.join(timeout=10)
+        idle_since = time.monotonic()
+        last = -1
+        while self.echoed < HOLD_OFF_BURST and time.monotonic() - idle_since < 3.0:
+            if self.echoed != last:
+                last = self.echoed
+                idle_since = time.monotonic()
+            time.sleep(0.05)
+        self.stop.set()
+        self.reader.join(timeout=3)
+        self.sock.close()
+        result = {"burst": HOLD_OFF_BURST, "echoed_while_held": self.echoed_held,
+                  "echoed": self.echoed, "release": reply}
+        if self.error:
+            result["error"] = self.error
+        return result
+
+
+def run_load(url: str, baud: int, args) -> dict:
+    """Sustained paced load at one baud rate."""
+    line_rate = baud / 10               # 8N1: 10 bits per byte
+    frame_len = FRAME_HEADER.size + args.frame_size + FRAME_CRC.size
+    interval = frame_len / (line_rate * args.load)
+
+    port = serial.serial_for_url(url, baudrate=baud, timeout=0.1)
+    with port:
+        port.reset_input_buffer()
+        result = {"idle_rtt_ms": measure_idle_rtt(port, args.probes)}
+        time.sleep(0.2)
+        port.reset_input_buffer()
+
+        stop = threading.Event()
+        threads = []
+        reader_errors = []
+
+        rfc_rx = FrameReceiver()
+        threads.append(threading.Thread(target=stream_reader,
+                                        args=(port, rfc_rx, stop, reader_errors), daemon=True))
+
+        raw_rx = None
+        raw_errors = []
+        raw_sock = None
+        if args.raw_port:
+            raw_rx = FrameReceiver()
+            raw_sock = socket.create_connection((args.ip, args.raw_port), timeout=0.2)
+            threads.append(threading.Thread(target=stream_reader,
+                                            args=(raw_sock, raw_rx, stop, raw_errors), daemon=True))
+
+        control = {}
+        control_stop = threading.Event()
+        if args.control_port:
+            threads.append(threading.Thread(target=control_poller,
+                                            args=(args.ip, args.control_port, 0.5, control_stop, control),
+                                            daemon=True))
+
+        for t in threads:
+            t.start()
+
+        hold = HoldOff(args.ip, args.hold_off, args.hold_off_control) if args.hold_off else None
+
+        # Paced sender: frames are due at fixed intervals, bursts catch up after stalls
+        sent = 0
+        sent_bytes = 0
+        start = time.monotonic()
+        next_due = start
+        end = start + args.duration
+        last_report = start
+        while True:
+            now = time.monotonic()
+            if now >= end:
+                break
+            if now < next_due:
+                time.sleep(min(next_due - now, 0.01))
+                continue
+            port.write(build_frame(sent, args.frame_size))
+            sent += 1
+            sent_bytes += frame_len
+            next_due += interval
+            if now - last_report >= 5:
+                last_report = now
+                print(f"  {now - start:5.0f}s  sent {sent} frames, received {rfc_rx.frames}", flush=True)
+        port.flush()
+        send_elapsed = time.monotonic() - start
+
+        # Drain: wait until everything is back or nothing arrives for 2 s
+        idle_since = time.monotonic()
+        last_count = -1
+        while time.monotonic() - idle_since < 2.0:
+            count = rfc_rx.frames + (raw_rx.frames if raw_rx else 0)
+            if rfc_rx.frames >= sent and (raw_rx is None or raw_rx.frames >= sent):
+                break
+            if count != last_count:
+                last_count = count
+                idle_since = time.monotonic()
+            time.sleep(0.05)
+        stop.set()
+        control_stop.set()
+        for t in threads:
+            t.join(timeout=3)
+        if raw_sock is not None:
+            raw_sock.close()
+        hold_result = hold.release() if hold is not None else None
+
+    def direction_stats(rx: FrameReceiver, errors: list) -> dict:
+        elapsed = (rx.last_ns - rx.first_ns) / 1e9 if rx.frames > 1 else 0
+        stats = {
+            "frames_received": rx.frames,
+            "frames_lost": sent - rx.frames,
+            "crc_errors": rx.crc_errors,
+            "resync_bytes": rx.resync_bytes,
+            "goodput_Bps": round(rx.frames * frame_len / elapsed) if elapsed > 0 else 0,
+            "latency_ms": percentiles(rx.latencies_ms),
+        }
+        if errors:
+            stats["error"] = errors[0]
+        return stats
+
+    result.update({
+        "duration_s": round(send_elapsed, 3),
+        "frame_bytes": frame_len,
+        "line_rate_Bps": round(line_rate),
+        "offered_Bps": round(line_rate * args.load),
+        "frames_sent": sent,
+        # Network → serial: what the bridge accepted from us
+        "tx_goodput_Bps": round(sent_bytes / send_elapsed) if send_elapsed > 0 else 0,
+        # Serial → network: what came back intact on the RFC2217 port
+        "rx": direction_stats(rfc_rx, reader_errors),
+    })
+    if raw_rx is not None:
+        result["raw_port"] = direction_stats(raw_rx, raw_errors)
+    if args.control_port:
+        result["control_rtt_ms"] = control
+    if hold_result is not None:
+        result["hold_off"] = hold_result
+    return result
+
+
+def run_sweep(url: str, bauds: list, args) -> dict:
+    report = {
+        "tool": "loopback_test.py",
+        "label": args.label,
+        "target": args.ip,
+        "host": platform.node(),
+        "started": time.strftime("%Y-%m-%dT%H:%M:%S%z"),
+        "settings": {"duration_s": args.duration, "load": args.load, "frame_size": args.frame_size,
+                     "probes": args.probes, "raw_port": args.raw_port,
+                     "control_port": args.control_port, "hold_off": args.hold_off},
+        "results": [],
+    }
+    for baud in bauds:
+        print(f"=== {baud} baud ===")
+        entry = {"baud": baud}
+        try:
+            entry["integrity"] = run_loopback_test(url, baud, args.count)
+            if args.duration > 0:
+                entry.update(run_load(url, baud, args))
+        except Exception as e:
+            print(f"ERROR: {e}", file=sys.stderr)
+            entry["error"] = str(e)
+        report["results"].append(entry)
+        print_entry(entry)
+    return report
+
+
+def entry_passed(entry: dict, max_loss: float, max_stall_ms: float) -> bool:
+    if "error" in entry or not entry.get("integrity", False):
+        return False
+    for key in ("rx", "raw_port"):
+        stats = entry.get(key)
+        if stats is None:
+            continue
+        if stats["crc_errors"] > 0:
+            return False
+        if entry["frames_sent"] and stats["frames_lost"] / entry["frames_sent"] > max_loss:
+            return False
+    hold = entry.get("hold_off")
+    if hold is not None:
+        # Only meaningful if the other channel was really held off; it must lose nothing either
+        if "error" in hold or hold["echoed_while_held"] > hold["burst"] // 2:
+            return False
+        if hold["echoed"] < hold["burst"]:
+            return False
+        if entry["rx"]["latency_ms"].get("max", 0) > max_stall_ms:
+            return False
+    return True
+
+
+def print_entry(entry: dict):
+    if "rx" not in entry:
+        return
+    rx = entry["rx"]
+    lat = rx["latency_ms"]
+    idle = entry["idle_rtt_ms"]
+    print(f"  tx {entry['tx_goodput_Bps']} B/s, rx {rx['goodput_Bps']} B/s "
+          f"(line {entry['line_rate_Bps']} B/s), lost {rx['frames_lost']}/{entry['frames_sent']}, "
+          f"crc errors {rx['crc_errors']}")
+    if idle.get("count"):
+        print(f"  idle RTT ms: p50 {idle['p50']} p99 {idle['p99']} max {idle['max']}")
+    if lat.get("count"):
+        print(f"  loaded latency ms: p50 {lat['p50']} p90 {lat['p90']} p99 {lat['p99']} max {lat['max']}")
+    if "raw_port" in entry:
+        raw = entry["raw_port"]
+        print(f"  raw port: rx {raw['goodput_Bps']} B/s, lost {raw['frames_lost']}, "
+              f"p99 {raw['latency_ms'].get('p99')} ms")
+    if "control_rtt_ms" in entry:
+        ctl = entry["control_rtt_ms"]
+        print(f"  control RTT ms: p50 {ctl.get('p50')} p99 {ctl.get('p99')} failures {ctl['failures']}")
+    if "hold_off" in entry:
+        hold = entry["hold_off"]
+        print(f"  held channel: {hold['echoed_while_held']}/{hold['burst']} bytes back while held, "
+              f"{hold['echoed']} after release")
+
+
+def compare_reports(paths: list) -> None:
+    reports = []
+    for path in paths:
+        with open(path) as f:
+            reports.append(json.load(f))
+    labels = [r.get("label") or path for r, path in zip(reports, paths)]
+    bauds = sorted({e["baud"] for r in reports for e in r["results"]})
+
+    print(f"{'baud':>9}  " + "  ".join(f"{label[:24]:>24}" for label in labels))
+    print(f"{'':>9}  " + "  ".join(f"{'rx B/s  p99 ms  lost':>24}" for _ in labels))
+    for baud in bauds:
+        cells = []
+        for r in reports:
+            e = next((e for e in r["results"] if e["baud"] == baud), None)
+            if e is None or "rx" not in e:
+                cells.append(f"{(e or {}).get('error', '-')[:24]:>24}")
+                continue
+            rx = e["rx"]
+            cells.append(f"{rx['goodput_Bps']:>10} {rx['latency_ms'].get('p99', '-'):>7} "
+                         f"{rx['frames_lost']:>5}")
+        print(f"{baud:>9}  " + "  ".join(cells))
+
+
+def parse_bauds(text: str) -> list:
+    if not text:
+        return DEFAULT_SWEEP
+    return [int(b) for b in text.split(",") if b]
+
+
 def main() -> None:
-    parser = argparse.ArgumentParser(description="RFC2217 loopback integrity test")
-    parser.add_argument("ip", help="ESP32 IP address")
+    parser = argparse.ArgumentParser(description="RFC2217 loopback integrity and load test")
+    parser.add_argument("ip", nargs="?", help="ESP32 IP address")
     parser.add_argument("--port", type=int, default=2217, help="RFC2217 port (default: 2217)")
     parser.add_argument("--baud", type=int, default=115200, help="Baud rate (default: 115200)")
     parser.add_argument(
@@ -82,11 +576,66 @@ def main() -> None:
         default=4,
         help="Number of times to repeat the 256-byte pattern (default: 4 = 1024 bytes)",
     )
+    parser.add_argument("--sweep", nargs="?", const="", metavar="BAUDS",
+                        help="Load test each baud rate (comma separated, default: 9600 ... 12000000)")
+    parser.add_argument("--duration", type=float, default=None,
+                        help="Sustained load per baud rate in seconds (default: 10 with --sweep)")
+    parser.add_argument("--load", type=float, default=0.95,
+                        help="Offered load as a fraction of the line rate (default: 0.95)")
+    parser.add_argument("--frame-size", type=int, default=256,
+                        help=f"Payload bytes per frame (default: 256, max {FRAME_MAX_PAYLOAD})")
+    parser.add_argument("--probes", type=int, default=20, help="Idle RTT probes (default: 20)")
+    parser.add_argument("--raw-port", type=int, default=0,
+                        help="Also receive on the raw data port, e.g. 8888 (default: off)")
+    parser.add_argument("--control-port", type=int, default=0,
+                        help="Also poll VERSION on the control port, e.g. 8889 (default: off)")
+    parser.add_argument("--max-loss", type=float, default=0.0,
+                        help="Fraction of lost frames still counted as a pass (default: 0)")
+    parser.add_argument("--hold-off", type=int, default=0, metavar="PORT",
+                        help="Hold off the device behind this RFC2217 port during the load, "
+                             "e.g. 2217 while loading 2227 (default: off)")
+    parser.add_argument("--hold-off-control", type=int, default=0, metavar="PORT",
+                        help="Control port of the held channel, e.g. 8889")
+    parser.add_argument("--max-stall-ms", type=float, default=1000.0,
+                        help="With --hold-off, largest frame latency still counted as a pass "
+                             "(default: 1000)")
+    parser.add_argument("--label", default="", help="Name of the bridge under test for the report")
+    parser.add_argument("--json", metavar="FILE", help="Write the report as JSON ('-' for stdout)")
+    parser.add_argument("--compare", nargs="+", metavar="REPORT", help="Compare JSON reports and exit")
     args = parser.parse_args()
 
+    if args.compare:
+        compare_reports(args.compare)
+        sys.exit(0)
+    if not args.ip:
+        parser.error("ip is required")
+    if not 0 < args.frame_size <= FRAME_MAX_PAYLOAD:
+        parser.error(f"--frame-size must be 1 to {FRAME_MAX_PAYLOAD}")
+    if args.hold_off and not args.hold_off_control:
+        parser.error("--hold-off needs --hold-off-control")
+
     url = f"rfc2217://{args.ip}:{args.port}"
-    ok = run_loopback_test(url, args.baud, args.count)
-    sys.exit(0 if ok else 1)
+    if args.sweep is None and args.duration is None:
+        ok = run_loopback_test(url, args.baud, args.count)
+        sys.exit(0 if ok else 1)
+
+    bauds = parse_bauds(args.sweep) if args.sweep is not None else [args.baud]
+    if args.duration is None:
+        args.duration = 10.0
+    report = run_sweep(url, bauds, args)
+    passed = all(entry_passed(e, args.max_loss, args.max_stall_ms) for e in report["results"])
+    report["passed"] = passed
+
+    if args.json:
+        text = json.dumps(report, indent=2)
+        if args.json == "-":
+            print(text)
+        else:
+            with open(args.json, "w") as f:
+                f.write(text + "\n")
+            print(f"Report written to {args.json}")
+    print("PASS" if passed else "FAIL")
+    sys.exit(0 if passed else 1)
 
 
 if __name__ == "__main__":
@@ -0,0 +1,182 @@
+#!/usr/bin/env python3
+"""
+UDP stream receiver.
+
+Listens for the logger's UDP stream (unicast, or a multicast group with
+--group), writes the serial data to stdout or a file and reports gaps on
+stderr: datagrams lost on the network (sequence number jumps), data the
+logger skipped because the stream fell behind (stream offset jumps),
+late or duplicate datagrams, and stream restarts. Uses only the standard
+library.
+
+Usage:
+    python3 udp_receiver.py [--port 8890] [--group 239.255.0.88] [--interface IP]
+                            [--output FILE] [--quiet] [--stats SECONDS]
+
+Example:
+    python3 udp_receiver.py --group 239.255.0.88
+    python3 udp_receiver.py --port 8890 --quiet --stats 5
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import time
+
+STREAM_MAGIC = b"SLUD"
+STREAM_VERSION = 1
+HEADER_FORMAT = "<4sBBHIIQ"     # Magic, version, channel, length, seq, offset, time_us
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+
+
+class StreamTracker:
+    """Gap accounting for the datagrams of one sender and channel."""
+
+    def __init__(self, name: str):
+        self.name = name
+        self.next_seq = None
+        self.next_offset = 0
+        self.min_delay_us = None    # Smallest local time minus logger time seen
+        self.datagrams = 0
+        self.bytes = 0
+        self.lost_datagrams = 0
+        self.lost_bytes = 0
+        self.skipped_bytes = 0
+        self.late = 0
+        self.max_jitter_us = 0      # Largest delay above the smallest one (stats interval)
+
+    def report(self, message: str) -> None:
+        print(f"[{time.strftime('%H:%M:%S')}] {self.name}: {message}", file=sys.stderr)
+
+    def accept(self, seq: int, offset: int, length: int, time_us: int) -> bool:
+        """Account for one datagram, return False if its data must not be written."""
+        delay = time.monotonic_ns() // 1000 - time_us
+        if self.next_seq is not None and seq == 0 and self.next_seq != 0:
+            self.report("stream restarted (logger rebooted?)")
+            self.next_seq = None
+        if self.next_seq is None or self.min_delay_us is None or delay < self.min_delay_us:
+            self.min_delay_us = delay
+        self.max_jitter_us = max(self.max_jitter_us, delay - self.min_delay_us)
+
+        if self.next_seq is not None:
+            ahead = (seq - self.next_seq) & 0xFFFFFFFF
+            if ahead >= 0x80000000:
+                self.late += 1
+                self.report(f"late or duplicate datagram {seq} (expected {self.next_seq}), dropped")
+                return False
+            missing = (offset - self.next_offset) & 0xFFFFFFFF
+            if ahead > 0:
+                self.lost_datagrams += ahead
+                self.lost_bytes += missing
+                self.report(f"GAP: {ahead} datagram(s) lost ({self.next_seq}..{seq - 1}), "
+                            f"{missing} bytes")
+            elif missing > 0:
+                self.skipped_bytes += missing
+                self.report(f"SKIP: logger dropped {missing} bytes before datagram {seq} "
+                            "(network too slow or stream was off)")
+
+        self.next_seq = (seq + 1) & 0xFFFFFFFF
+        self.next_offset = (offset + length) & 0xFFFFFFFF
+        self.datagrams += 1
+        self.bytes += length
+        return True
+
+    def summary(self) -> str:
+        total = self.datagrams + self.lost_datagrams
+        loss = 100.0 * self.lost_datagrams / total if total else 0.0
+        return (f"{self.datagrams} datagrams, {self.bytes} bytes, "
+                f"lost {self.lost_datagrams} ({loss:.2f}%, {self.lost_bytes} bytes), "
+                f"skipped {self.skipped_bytes} bytes, late {self.late}, "
+                f"jitter {self.max_jitter_us / 1000:.1f} ms")
+
+
+def open_socket(port: int, group: str, interface: str) -> socket.socket:
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1 << 20)
+    sock.bind(("", port))
+    if group:
+        membership = socket.inet_aton(group) + socket.inet_aton(interface)
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, membership)
+    return sock
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Receive the UDP serial stream and report gaps")
+    parser.add_argument("--port", type=int, default=8890, help="UDP port (default: 8890)")
+    parser.add_argument("--group", help="Multicast group to join (default: unicast only)")
+    parser.add_argument("--interface", default="0.0.0.0",
+                        help="Local address to join the group on (default: any)")
+    parser.add_argument("--output", "-o", help="Write the serial data to FILE instead of stdout")
+    parser.add_argument("--quiet", "-q", action="store_true",
+                        help="Do not write the serial data, only gaps and statistics")
+    parser.add_argument("--stats", type=float, default=0,
+                        help="Print statistics every SECONDS (default: only at exit)")
+    args = parser.parse_args()
+
+    try:
+        sock = open_socket(args.port, args.group, args.interface)
+    except OSError as e:
+        print(f"ERROR: {e}", file=sys.stderr)
+        return 1
+
+    out = None
+    if not args.quiet:
+        out = open(args.output, "wb") if args.output else sys.stdout.buffer
+    trackers = {}
+    malformed = 0
+    next_stats = time.monotonic() + args.stats if args.stats > 0 else None
+    if next_stats is not None:
+        sock.settimeout(args.stats)
+
+    print(f"Listening on UDP port {args.port}" + (f", group {args.group}" if args.group else ""),
+          file=sys.stderr)
+    try:
+        while True:
+            try:
+                datagram, sender = sock.recvfrom(65536)
+            except socket.timeout:
+                datagram = None
+
+            if datagram is not None:
+                if len(datagram) < HEADER_SIZE:
+                    malformed += 1
+                    continue
+                magic, version, channel, length, seq, offset, time_us = \
+                    struct.unpack_from(HEADER_FORMAT, datagram)
+                if magic != STREAM_MAGIC or version != STREAM_VERSION or \
+                        len(datagram) != HEADER_SIZE + length:
+                    malformed += 1
+                    continue
+
+                key = (sender[0], channel)
+                tracker = trackers.get(key)
+                if tracker is None:
+                    tracker = trackers[key] = StreamTracker(f"{sender[0]} ch{channel}")
+                    tracker.report(f"stream started at datagram {seq}")
+                if tracker.accept(seq, offset, length, time_us) and out is not None:
+                    out.write(datagram[HEADER_SIZE:])
+                    out.flush()
+
+            if next_stats is not None and time.monotonic() >= next_stats:
+                for tracker in trackers.values():
+                    tracker.report(tracker.summary())
+                    tracker.max_jitter_us = 0
+                next_stats = time.monotonic() + args.stats
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if args.output and out is not None:
+            out.close()
+        sock.close()
+
+    for tracker in trackers.values():
+        tracker.report(tracker.summary())
+    if malformed:
+        print(f"{malformed} malformed datagrams ignored", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())